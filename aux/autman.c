@@ -14,16 +14,7 @@
 #include "logging.h"
 #include "automaton.h"
 #include "ptree.h"
-extern int yyparse( void );
-extern void yyrestart( FILE *new_file );
-
-
-/**************************
- **** Global variables ****/
-
-extern specification_t spc;
-
-/**************************/
+#include "context.h"
 
 
 /* Output formats */
@@ -54,6 +45,7 @@ int main( int argc, char **argv )
     int state_len = -1;
     byte format_option = OUTPUT_FORMAT_JSON;
     byte verification_model = 0;  /* For command-line flag "-P". */
+    bool minimize_flag = False;  /* For command-line flag "-m". */
 
     unsigned char verbose = 0;
     bool logging_flag = False;
@@ -71,7 +63,7 @@ int main( int argc, char **argv )
             }
 
             if (argv[i][1] == 'h') {
-                printf( "Usage: %s [-hVvlsP] [-t TYPE] [-L N] [-i FILE] [-o FILE] [FILE]\n\n"
+                printf( "Usage: %s [-hVvlsmP] [-t TYPE] [-L N] [-i FILE] [-o FILE] [FILE]\n\n"
                         "If no input file is given, or if FILE is -, read from stdin.  If no action\n"
                         "is requested, then assume -s.\n\n"
                         "  -h          this help message\n"
@@ -85,6 +77,8 @@ int main( int argc, char **argv )
                         "              assigned to variables, given specification.\n" */
                 printf( "  -t TYPE     convert to format: txt, dot, aut, json, tulip\n"
                         "              some of these require a reference specification.\n"
+                        "  -m          minimize strategy by merging bisimilar nodes;\n"
+                        "              if no other action is requested, then output in aut format.\n"
                         "  -P          create Spin Promela model of strategy\n"
                         "              if used with -o, then the LTL formula is printed to stdout.\n"
                         "  -L N        declare that state vector size is N\n"
@@ -147,6 +141,12 @@ int main( int argc, char **argv )
                 }
                 state_len = strtol( argv[i+1], NULL, 10 );
                 i++;
+            } else if (argv[i][1] == 'm') {
+                minimize_flag = True;
+                if (run_option == AUTMAN_SYNTAX) {
+                    run_option = AUTMAN_CONVERT;
+                    format_option = OUTPUT_FORMAT_AUT;
+                }
             } else if (argv[i][1] == 'P') {
                 run_option = AUTMAN_VERMODEL;
                 verification_model = VERMODEL_TARGET_SPIN;
@@ -223,11 +223,10 @@ int main( int argc, char **argv )
             perror( "gr1c-autman, fopen" );
             return -1;
         }
-        yyrestart( spc_fp );
         if (verbose)
             logprint( "Parsing reference specification file..." );
         SPC_INIT( spc );
-        if (yyparse())
+        if (gr1c_parse( spc_fp, &spc, NULL ))
             return 2;
         if (verbose)
             logprint( "Done." );
@@ -268,6 +267,20 @@ int main( int argc, char **argv )
         logprint( "Given automaton has size %d.", aut_size( head ) );
     }
 
+    if (minimize_flag) {
+        if (verbose > 1)
+            logprint( "Minimizing automaton..." );
+        head = aut_minimize( head, state_len );
+        if (head == NULL) {
+            fprintf( stderr, "Error: failed to minimize aut.\n" );
+            return -1;
+        }
+        if (verbose > 1)
+            logprint( "Done." );
+        if (verbose)
+            logprint( "Minimized automaton has size %d.", aut_size( head ) );
+    }
+
 
     /* Open output file if specified; else point to stdout. */
     if (output_file_index >= 0) {
@@ -7,7 +7,7 @@ CUDDVER=3.0.0
 SPINVER=6.4.5
 
 cd extern/src/cudd-$CUDDVER
-./configure --prefix=`pwd`/../..
+./configure --prefix=`pwd`/../.. --enable-dddmp
 make
 make install
 
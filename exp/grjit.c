@@ -10,6 +10,7 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
@@ -20,20 +21,12 @@
 #include "ptree.h"
 #include "solve.h"
 #include "automaton.h"
-#include "util.h"
 #include "solve_metric.h"
 #include "solve_support.h"
 #include "sim.h"
 #include "gr1c_util.h"
-extern int yyparse( void );
-
-
-/**************************
- **** Global variables ****/
-
-extern specification_t spc;
-
-/**************************/
+#include "context.h"
+#include "resultcache.h"
 
 
 /* See solve_metric.c */
@@ -68,8 +61,7 @@ void dump_simtrace( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
         if (last_nonzero_env < 0 && last_nonzero_sys < 0) {
             fprintf( fp, "{}" );
         } else {
-            for (j = 0; j < num_env; j++) {
-                var = get_list_item( evar_list, j );
+            for (j = 0, var = evar_list; j < num_env; j++, var = var->left) {
                 if (j == last_nonzero_env) {
                     fprintf( fp, "%s=%d", var->name, *(node->state+j) );
                     fprintf( fp, ", " );
@@ -77,8 +69,7 @@ void dump_simtrace( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                     fprintf( fp, "%s=%d, ", var->name, *(node->state+j) );
                 }
             }
-            for (j = 0; j < num_sys; j++) {
-                var = get_list_item( svar_list, j );
+            for (j = 0, var = svar_list; j < num_sys; j++, var = var->left) {
                 if (j == last_nonzero_sys) {
                     fprintf( fp, "%s=%d", var->name, *(node->state+num_env+j) );
                 } else {
@@ -107,6 +98,9 @@ int main( int argc, char **argv )
     unsigned char verbose = 0;
     int input_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    int cache_index = -1;  /* For command-line flag "--cache". */
+    int num_plays = -1;  /* For command-line flag "--plays". */
+    unsigned long seed = 0;  /* For command-line flag "--seed". */
     char dumpfilename[64];
 
     int i, j, var_index;
@@ -194,6 +188,46 @@ int main( int argc, char **argv )
                 }
                 output_file_index = i+1;
                 i++;
+            } else if (argv[i][1] == '-'
+                       && !strncmp( argv[i]+2, "cache", strlen( "cache" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                cache_index = i+1;
+                i++;
+            } else if (argv[i][1] == '-'
+                       && !strncmp( argv[i]+2, "plays", strlen( "plays" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                num_plays = strtol( argv[i+1], NULL, 10 );
+                if (num_plays < 1) {
+                    fprintf( stderr, "Number of plays must be positive.\n" );
+                    return 1;
+                }
+                i++;
+            } else if (argv[i][1] == '-'
+                       && !strncmp( argv[i]+2, "seed", strlen( "seed" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                seed = strtoul( argv[i+1], NULL, 10 );
+                i++;
+            } else if (argv[i][1] == '-'
+                       && !strncmp( argv[i]+2, "threads", strlen( "threads" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                if (strtol( argv[i+1], NULL, 10 ) < 1) {
+                    fprintf( stderr, "Number of threads must be positive.\n" );
+                    return 1;
+                }
+                setsolverthreads( strtol( argv[i+1], NULL, 10 ) );
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -207,7 +241,8 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlp] [-m ARG1,ARG2,...] [-o FILE] [FILE]\n\n"
+        printf( "Usage: %s [-hVvlp] [-m ARG1,ARG2,...] [-o FILE] [--cache DIR]\n"
+                "       [--plays N [--seed S] [--threads N]] [FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
@@ -219,7 +254,14 @@ int main( int argc, char **argv )
                 "                ARG2 is a space-separated list of metric variables;\n"
                 "                ARG3 is a space-separated list of initial values;\n"
                 "                    ARG3 is ignored and may be omitted if ARG1 equals -1.\n"
-                "                ARG4 is the horizon, if provided; otherwise compute it.\n" );
+                "                ARG4 is the horizon, if provided; otherwise compute it.\n"
+                "  --cache DIR reuse winning sets, sublevel sets, and distance bounds\n"
+                "              saved in directory DIR by previous runs, and save new ones\n" );
+        printf( "  --plays N   run N plays of the simulation given by -m, and output\n"
+                "              statistics about them as JSON, rather than a trace\n"
+                "  --seed S    seed of pseudorandom environment moves for --plays;\n"
+                "              default is 0\n"
+                "  --threads N run plays using N threads; default is 1\n" );
         return 1;
     }
 
@@ -251,7 +293,7 @@ int main( int argc, char **argv )
     if (verbose)
         logprint( "Parsing input..." );
     SPC_INIT( spc );
-    if (yyparse())
+    if (gr1c_parse( NULL, &spc, NULL ))
         return -1;
     if (verbose)
         logprint( "Done." );
@@ -427,10 +469,11 @@ int main( int argc, char **argv )
                             &spc.env_trans_array, &spc.et_array_len,
                             &spc.sys_trans_array, &spc.st_array_len,
                             &spc.env_goals, spc.num_egoals, &spc.sys_goals, spc.num_sgoals,
-                            verbose ) < 0)
+                            ALL_ENV_EXIST_SYS_INIT, verbose ) < 0)
         return -1;
     spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
                                                      verbose );
+    spc.var_st = vars_symtab( spc.evar_list, spc.svar_list );
 
     if (spc.et_array_len > 1) {
         spc.env_trans = merge_ptrees( spc.env_trans_array, spc.et_array_len, PT_AND );
@@ -464,12 +507,15 @@ int main( int argc, char **argv )
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
+    if (cache_index >= 0)
+        setresultcache( argv[cache_index], 0, False, ALL_ENV_EXIST_SYS_INIT );
+
     manager = Cudd_Init( 2*(num_env+num_sys),
                          0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
     Cudd_SetMaxCacheHard( manager, (unsigned int)-1 );
     Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
 
-    T = check_realizable( manager, EXIST_SYS_INIT, verbose );
+    T = check_realizable( manager, ALL_ENV_EXIST_SYS_INIT, verbose );
     if (verbose) {
         if (T != NULL) {
             logprint( "Realizable." );
@@ -522,41 +568,67 @@ int main( int argc, char **argv )
             if (init_state == NULL)
                 return -1;
 
-            play = sim_rhc( manager, W, etrans, strans, sgoals, metric_vars,
-                            horizon, init_state, max_sim_it, verbose );
-            if (play == NULL) {
-                fprintf( stderr,
-                         "Error while attempting receding horizon"
-                         " simulation.\n" );
-                return -1;
-            }
-            free( init_state );
-            logprint( "play length: %d", aut_size( play ) );
-            tmppt = spc.nonbool_var_list;
-            while (tmppt) {
-                aut_compact_nonbool( play, spc.evar_list, spc.svar_list,
-                                     tmppt->name, tmppt->value );
-                tmppt = tmppt->left;
-            }
-
-            num_env = tree_size( spc.evar_list );
-            num_sys = tree_size( spc.svar_list );
-
-            /* Open output file if specified; else point to stdout. */
-            if (output_file_index >= 0) {
-                fp = fopen( argv[output_file_index], "w" );
-                if (fp == NULL) {
-                    perror( "grjit, fopen" );
+            if (num_plays > 0) {
+                /* Open output file if specified; else point to stdout. */
+                if (output_file_index >= 0) {
+                    fp = fopen( argv[output_file_index], "w" );
+                    if (fp == NULL) {
+                        perror( "grjit, fopen" );
+                        return -1;
+                    }
+                } else {
+                    fp = stdout;
+                }
+                if (sim_rhc_batch( manager, W, etrans, strans, sgoals,
+                                   metric_vars, horizon, init_state,
+                                   max_sim_it, num_plays, getsolverthreads(),
+                                   seed, fp, verbose )) {
+                    fprintf( stderr,
+                             "Error while attempting receding horizon"
+                             " simulation.\n" );
                     return -1;
                 }
+                if (fp != stdout)
+                    fclose( fp );
+                free( init_state );
             } else {
-                fp = stdout;
-            }
+                play = sim_rhc( manager, W, etrans, strans, sgoals,
+                                metric_vars, horizon, init_state, max_sim_it,
+                                verbose );
+                if (play == NULL) {
+                    fprintf( stderr,
+                             "Error while attempting receding horizon"
+                             " simulation.\n" );
+                    return -1;
+                }
+                free( init_state );
+                logprint( "play length: %d", aut_size( play ) );
+                tmppt = spc.nonbool_var_list;
+                while (tmppt) {
+                    aut_compact_nonbool( play, spc.evar_list, spc.svar_list,
+                                         tmppt->name, tmppt->value );
+                    tmppt = tmppt->left;
+                }
 
-            /* Print simulation trace */
-            dump_simtrace( play, spc.evar_list, spc.svar_list, fp );
-            if (fp != stdout)
-                fclose( fp );
+                num_env = tree_size( spc.evar_list );
+                num_sys = tree_size( spc.svar_list );
+
+                /* Open output file if specified; else point to stdout. */
+                if (output_file_index >= 0) {
+                    fp = fopen( argv[output_file_index], "w" );
+                    if (fp == NULL) {
+                        perror( "grjit, fopen" );
+                        return -1;
+                    }
+                } else {
+                    fp = stdout;
+                }
+
+                /* Print simulation trace */
+                dump_simtrace( play, spc.evar_list, spc.svar_list, fp );
+                if (fp != stdout)
+                    fclose( fp );
+            }
         }
 
 
@@ -569,6 +641,7 @@ int main( int argc, char **argv )
     free( metric_vars );
     delete_tree( spc.evar_list );
     delete_tree( spc.svar_list );
+    symtab_free( spc.var_st );
     delete_tree( spc.env_init );
     delete_tree( spc.sys_init );
     delete_tree( spc.env_trans );
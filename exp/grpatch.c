@@ -18,17 +18,7 @@
 #include "automaton.h"
 #include "solve_metric.h"
 #include "gr1c_util.h"
-extern int yyparse( void );
-extern void yyrestart( FILE *new_file );
-
-
-/**************************
- **** Global variables ****/
-
-extern specification_t spc;
-extern ptree_t *gen_tree_ptr;
-
-/**************************/
+#include "context.h"
 
 
 /* Output formats */
@@ -41,6 +31,7 @@ extern ptree_t *gen_tree_ptr;
 /* Runtime modes */
 #define GR1C_MODE_UNSET 0
 #define GR1C_MODE_PATCH 4
+#define GR1C_MODE_SERVE 5
 
 
 #define PRINT_VERSION() \
@@ -54,6 +45,7 @@ int main( int argc, char **argv )
     bool help_flag = False;
     bool ptdump_flag = False;
     bool logging_flag = False;
+    bool serve_flag = False;
     byte format_option = OUTPUT_FORMAT_JSON;
     unsigned char verbose = 0;
     bool reading_options = True;  /* For disabling option parsing using "--" */
@@ -196,6 +188,19 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "serve", strlen( "serve" ) )) {
+                serve_flag = True;
+            } else if (!strncmp( argv[i]+2, "threads", strlen( "threads" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                if (strtol( argv[i+1], NULL, 10 ) < 1) {
+                    fprintf( stderr, "Number of threads must be positive.\n" );
+                    return 1;
+                }
+                setsolverthreads( strtol( argv[i+1], NULL, 10 ) );
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -221,10 +226,22 @@ int main( int argc, char **argv )
         fprintf( stderr, "\"-r\" flag can only be used with \"-a\"\n" );
         return 1;
     }
+    if (serve_flag) {
+        if (run_option != GR1C_MODE_UNSET) {
+            fprintf( stderr,
+                     "\"--serve\" cannot be used with \"-e\", \"-f\","
+                     " or \"-r\".\n" );
+            return 1;
+        } else if (aut_input_index < 0) {
+            fprintf( stderr, "\"--serve\" flag can only be used with \"-a\"\n" );
+            return 1;
+        }
+        run_option = GR1C_MODE_SERVE;
+    }
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlp] [-m VARS] [-t TYPE] [-aeo FILE] [-f FORM] [-r N] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvlp] [-m VARS] [-t TYPE] [-aeo FILE] [-f FORM] [-r N] [--serve] [--threads N] [[--] FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
@@ -240,7 +257,11 @@ int main( int argc, char **argv )
         printf( "  -f FORM     FORM is a Boolean (state) formula, currently only\n"
                 "              used for appending a system goal; requires -a flag.\n"
                 "  -r N        remove system goal N (in order, according to given file);\n"
-                "              requires -a flag.\n" );
+                "              requires -a flag.\n"
+                "  --serve     read patching commands from stdin and apply them in turn,\n"
+                "              writing the changed nodes after each; requires -a flag.\n"
+                "  --threads N solve local games of different goal modes using N threads,\n"
+                "              in parallel, when patching (default is 1)\n" );
         return 0;
     }
 
@@ -250,6 +271,13 @@ int main( int argc, char **argv )
                 " not yet implemented.\n" );
         return 1;
     }
+    if (run_option == GR1C_MODE_SERVE
+        && (input_index < 0 || !strncmp( argv[aut_input_index], "-", 1 ))) {
+        fprintf( stderr,
+                 "Commands are read from stdin when serving, so the"
+                 " specification and\nautomaton must be given as files.\n" );
+        return 1;
+    }
     if (run_option == GR1C_MODE_UNSET) {
         fprintf( stderr,
                  "%s requires a patching request. Try \"-h\".\n",
@@ -292,14 +320,10 @@ int main( int argc, char **argv )
             perror( "gr1c-patch, fseek" );
             return -1;
         }
-        yyrestart( clf_file );
         SPC_INIT( spc );
-        yyparse();
+        gr1c_parse( clf_file, &spc, &clformula );
         fclose( clf_file );
 
-        clformula = gen_tree_ptr;
-        gen_tree_ptr = NULL;
-
         if (ptdump_flag)
             tree_dot_dump( clformula, "clformula_ptree.dot" );
         if (verbose > 1) {
@@ -318,19 +342,17 @@ int main( int argc, char **argv )
             perror( "gr1c-patch, fopen" );
             return -1;
         }
-        yyrestart( fp );
     } else {
-        yyrestart( stdin );
+        fp = stdin;
     }
 
     /* Parse the specification. */
     spc.evar_list = NULL;
     spc.svar_list = NULL;
-    gen_tree_ptr = NULL;
     if (verbose)
         logprint( "Parsing input..." );
     SPC_INIT( spc );
-    if (yyparse())
+    if (gr1c_parse( fp, &spc, NULL ))
         return 2;
     if (verbose)
         logprint( "Done." );
@@ -499,6 +521,7 @@ int main( int argc, char **argv )
         return -1;
     spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
                                                      verbose );
+    spc.var_st = vars_symtab( spc.evar_list, spc.svar_list );
 
     tmppt = spc.nonbool_var_list;
     while (tmppt) {
@@ -506,7 +529,7 @@ int main( int argc, char **argv )
             if (verbose > 1)
                 logprint( "Expanding nonbool variable %s in command-line"
                           " formula...", tmppt->name );
-            clformula = expand_to_bool( clformula, tmppt->name, tmppt->value );
+            clformula = mark_nonbool( clformula, tmppt->name, tmppt->value );
             if (verbose > 1)
                 logprint( "Done." );
         }
@@ -543,7 +566,21 @@ int main( int argc, char **argv )
         }
     }
 
-    if (edges_input_index >= 0) {  /* patch_localfixpoint() */
+    if (run_option == GR1C_MODE_SERVE) {  /* patch_serve() */
+
+        if (verbose)
+            logprint( "Serving patching requests..." );
+        if (patch_serve( manager, strategy_fp, stdin, stdout,
+                         original_num_env, original_num_sys,
+                         offw, (offw != NULL) ? num_metric_vars : 0,
+                         verbose )) {
+            fprintf( stderr, "Failed to serve patching requests.\n" );
+            return -1;
+        }
+        if (verbose)
+            logprint( "Done." );
+
+    } else if (edges_input_index >= 0) {  /* patch_localfixpoint() */
 
         if (offw != NULL)
             free( offw );
@@ -641,7 +678,7 @@ int main( int argc, char **argv )
     }
     if (strategy_fp != stdin)
         fclose( strategy_fp );
-    if (strategy == NULL) {
+    if (strategy == NULL && run_option != GR1C_MODE_SERVE) {
         fprintf( stderr, "Failed to patch strategy.\n" );
         return -1;
     }
@@ -705,6 +742,7 @@ int main( int argc, char **argv )
     delete_tree( clformula );
     delete_tree( spc.evar_list );
     delete_tree( spc.svar_list );
+    symtab_free( spc.var_st );
     delete_tree( spc.env_init );
     delete_tree( spc.sys_init );
     delete_tree( spc.env_trans );
@@ -315,21 +315,17 @@ int aut_size( anode_t *head )
 }
 
 
-int forward_modereach( anode_t *node, int mode, vartype **N, int N_len,
-                       int magic_mode, int state_len )
+int forward_modereach( anode_t *node, int mode, stateidx_t *N_index,
+                       int magic_mode )
 {
-    int i, j;
+    int i;
     for (i = 0; i < node->trans_len; i++) {
-        if ((*(node->trans+i))->mode == mode) {
-            for (j = 0; j < N_len; j++)
-                if (statecmp( (*(node->trans+i))->state, *(N+j), state_len ))
-                    break;
-            if (j < N_len) {
-                (*(node->trans+i))->mode = magic_mode;
-                if (forward_modereach( *(node->trans+i), mode, N, N_len,
-                                       magic_mode, state_len ))
-                    return -1;
-            }
+        if ((*(node->trans+i))->mode == mode
+            && stateidx_find( N_index, (*(node->trans+i))->state ) >= 0) {
+            (*(node->trans+i))->mode = magic_mode;
+            if (forward_modereach( *(node->trans+i), mode, N_index,
+                                   magic_mode ))
+                return -1;
         }
     }
 
@@ -518,3 +514,607 @@ anode_t *forward_prune( anode_t *head, anode_t **U, int U_len )
     free( U );
     return head;
 }
+
+
+/* Comparison of node pointers by address, for use with qsort() and
+   bsearch() in aut_minimize() and aut_copy(). */
+int anode_ptrcmp( const void *p1, const void *p2 )
+{
+    size_t a = (size_t)(*(anode_t **)p1);
+    size_t b = (size_t)(*(anode_t **)p2);
+    if (a < b)
+        return -1;
+    else if (a > b)
+        return 1;
+    return 0;
+}
+
+/* Comparison of integers, for use with qsort(), e.g., in aut_minimize(). */
+int aut_intcmp( const void *p1, const void *p2 )
+{
+    int a = *(int *)p1, b = *(int *)p2;
+    if (a < b)
+        return -1;
+    else if (a > b)
+        return 1;
+    return 0;
+}
+
+/* FNV-1a style hash of an integer key followed by a sequence of
+   integers, e.g., a state vector. */
+unsigned long aut_sighash( int block, int *seq, int seq_len )
+{
+    int i;
+    unsigned long h = PTREE_HASH_INIT;
+    h = PTREE_HASH_STEP( h, (unsigned long)block );
+    for (i = 0; i < seq_len; i++)
+        h = PTREE_HASH_STEP( h, (unsigned long)(*(seq+i)) );
+    return h;
+}
+
+/* Partition of the nodes of an automaton, for aut_minimize().  Nodes
+   are identified by position in the array of nodes, and elem lists them
+   so that each block, and each compound block (a union of blocks, as
+   in the algorithm of Paige and Tarjan), is a contiguous range. */
+typedef struct {
+    int *elem;
+    int *loc;  /* Position of each node in elem */
+    int *block;  /* Block of each node */
+
+    /* Range of each block in elem; marked nodes are in [first, mid). */
+    int *first, *mid, *end;
+    int *cblock;  /* Compound block containing each block */
+    int num_blocks;
+    int *touched;  /* Blocks with marked nodes */
+    int num_touched;
+
+    int *cfirst, *cend;  /* Range of each compound block in elem */
+    int num_cblocks;
+    bool *pending;  /* Whether each compound block is in worklist */
+    int *worklist;  /* Compound blocks that contain more than one block */
+    int num_pending;
+} aut_partition_t;
+
+/* Mark node x, which must not already be marked. */
+void aut_partition_mark( aut_partition_t *P, int x )
+{
+    int b = *(P->block+x);
+    int y = *(P->elem + *(P->mid+b));
+
+    if (*(P->mid+b) == *(P->first+b))
+        *(P->touched + (P->num_touched)++) = b;
+    *(P->elem + *(P->loc+x)) = y;
+    *(P->loc+y) = *(P->loc+x);
+    *(P->elem + *(P->mid+b)) = x;
+    *(P->loc+x) = *(P->mid+b);
+    (*(P->mid+b))++;
+}
+
+/* Split each block with marked nodes into the marked and unmarked
+   nodes, if both are present, and clear all marks.  A compound block
+   that comes to contain more than one block is added to the worklist. */
+void aut_partition_split( aut_partition_t *P )
+{
+    int b, new_b, c, i, k;
+
+    for (i = 0; i < P->num_touched; i++) {
+        b = *(P->touched+i);
+        if (*(P->mid+b) == *(P->end+b)) {
+            *(P->mid+b) = *(P->first+b);
+            continue;
+        }
+        new_b = (P->num_blocks)++;
+        *(P->first+new_b) = *(P->mid+new_b) = *(P->first+b);
+        *(P->end+new_b) = *(P->mid+b);
+        *(P->first+b) = *(P->mid+b);
+        for (k = *(P->first+new_b); k < *(P->end+new_b); k++)
+            *(P->block + *(P->elem+k)) = new_b;
+        c = *(P->cblock+b);
+        *(P->cblock+new_b) = c;
+        if (!*(P->pending+c)) {
+            *(P->pending+c) = True;
+            *(P->worklist + (P->num_pending)++) = c;
+        }
+    }
+    P->num_touched = 0;
+}
+
+anode_t *aut_minimize( anode_t *head, int state_len )
+{
+    int i, j, k, n, num_edges, num_blocks, x, y, e, s, b, c;
+    unsigned long h, mask;
+    anode_t **nodes, **target, *node, *prev, *next;
+    int *succ, *succ_off, *edge_src, *pred, *pred_off;
+    int *block, *table, *rep, *mark;
+    int *count, *free_counts, num_free, *edge_count;
+    int *pre, pre_len, *pre_count, *old_count, *new_count;
+    aut_partition_t P;
+
+    if (head == NULL || state_len < 1)
+        return NULL;
+
+    /* Nodes are identified by position in an array sorted by address, so
+       that successors can be found with bsearch(). */
+    n = aut_size( head );
+    nodes = malloc( n*sizeof(anode_t *) );
+    succ_off = malloc( (n+1)*sizeof(int) );
+    pred_off = malloc( (n+1)*sizeof(int) );
+    rep = malloc( n*sizeof(int) );
+    mark = malloc( n*sizeof(int) );
+    if (nodes == NULL || succ_off == NULL || pred_off == NULL || rep == NULL
+        || mark == NULL) {
+        perror( "aut_minimize, malloc" );
+        exit(-1);
+    }
+    num_edges = 0;
+    for (node = head, i = 0; node != NULL; node = node->next, i++) {
+        *(nodes+i) = node;
+        num_edges += node->trans_len;
+    }
+    qsort( nodes, n, sizeof(anode_t *), anode_ptrcmp );
+
+    succ = malloc( (num_edges > 0 ? num_edges : 1)*sizeof(int) );
+    edge_src = malloc( (num_edges > 0 ? num_edges : 1)*sizeof(int) );
+    pred = malloc( (num_edges > 0 ? num_edges : 1)*sizeof(int) );
+    if (succ == NULL || edge_src == NULL || pred == NULL) {
+        perror( "aut_minimize, malloc" );
+        exit(-1);
+    }
+    *succ_off = 0;
+    for (i = 0; i < n; i++) {
+        *(succ_off+i+1) = *(succ_off+i) + (*(nodes+i))->trans_len;
+        for (j = 0; j < (*(nodes+i))->trans_len; j++) {
+            target = bsearch( (*(nodes+i))->trans+j, nodes, n,
+                              sizeof(anode_t *), anode_ptrcmp );
+            if (target == NULL) {
+                fprintf( stderr,
+                         "Error aut_minimize: transition to node not in"
+                         " the automaton.\n" );
+                free( nodes );
+                free( succ_off );
+                free( pred_off );
+                free( succ );
+                free( edge_src );
+                free( pred );
+                free( rep );
+                free( mark );
+                return NULL;
+            }
+            *(succ + *(succ_off+i) + j) = target - nodes;
+            *(edge_src + *(succ_off+i) + j) = i;
+        }
+    }
+
+    /* Edges into each node, by counting sort on the target */
+    for (i = 0; i <= n; i++)
+        *(pred_off+i) = 0;
+    for (e = 0; e < num_edges; e++)
+        (*(pred_off + *(succ+e) + 1))++;
+    for (i = 0; i < n; i++)
+        *(pred_off+i+1) += *(pred_off+i);
+    for (i = 0; i < n; i++)
+        *(mark+i) = *(pred_off+i);
+    for (e = 0; e < num_edges; e++)
+        *(pred + (*(mark + *(succ+e)))++) = e;
+
+    P.elem = malloc( n*sizeof(int) );
+    P.loc = malloc( n*sizeof(int) );
+    P.block = malloc( n*sizeof(int) );
+    P.first = malloc( n*sizeof(int) );
+    P.mid = malloc( n*sizeof(int) );
+    P.end = malloc( n*sizeof(int) );
+    P.cblock = malloc( n*sizeof(int) );
+    P.touched = malloc( n*sizeof(int) );
+    P.cfirst = malloc( n*sizeof(int) );
+    P.cend = malloc( n*sizeof(int) );
+    P.pending = malloc( n*sizeof(bool) );
+    P.worklist = malloc( n*sizeof(int) );
+    if (P.elem == NULL || P.loc == NULL || P.block == NULL
+        || P.first == NULL || P.mid == NULL || P.end == NULL
+        || P.cblock == NULL || P.touched == NULL || P.cfirst == NULL
+        || P.cend == NULL || P.pending == NULL || P.worklist == NULL) {
+        perror( "aut_minimize, malloc" );
+        exit(-1);
+    }
+    block = P.block;
+
+    /* Open-addressing table with at least twice as many slots as nodes;
+       entries are indices of the first node found with a key. */
+    for (mask = 1; mask < 2*(unsigned long)n; mask <<= 1) ;
+    table = malloc( mask*sizeof(int) );
+    if (table == NULL) {
+        perror( "aut_minimize, malloc" );
+        exit(-1);
+    }
+    mask--;
+
+    /* Initial partition: nodes with equal states and that either both
+       have or both do not have transitions. */
+    for (h = 0; h <= mask; h++)
+        *(table+h) = -1;
+    num_blocks = 0;
+    for (i = 0; i < n; i++) {
+        k = (*(succ_off+i+1) > *(succ_off+i));
+        h = aut_sighash( k, (*(nodes+i))->state, state_len ) & mask;
+        while ((j = *(table+h)) >= 0
+               && ((*(succ_off+j+1) > *(succ_off+j)) != k
+                   || !statecmp( (*(nodes+j))->state,
+                                 (*(nodes+i))->state, state_len )))
+            h = (h+1) & mask;
+        if (j < 0) {
+            *(table+h) = i;
+            *(block+i) = num_blocks++;
+        } else {
+            *(block+i) = *(block+j);
+        }
+    }
+    for (b = 0; b < num_blocks; b++)
+        *(P.end+b) = 0;
+    for (i = 0; i < n; i++)
+        (*(P.end + *(block+i)))++;
+    for (b = 0, k = 0; b < num_blocks; b++) {
+        *(P.first+b) = *(P.mid+b) = k;
+        k += *(P.end+b);
+        *(P.end+b) = *(P.first+b);
+        *(P.cblock+b) = 0;
+    }
+    for (i = 0; i < n; i++) {
+        b = *(block+i);
+        *(P.loc+i) = *(P.end+b);
+        *(P.elem + (*(P.end+b))++) = i;
+    }
+    P.num_blocks = num_blocks;
+    P.num_touched = 0;
+    P.num_cblocks = 1;
+    *P.cfirst = 0;
+    *P.cend = n;
+    for (c = 0; c < n; c++)
+        *(P.pending+c) = False;
+    P.num_pending = 0;
+    if (num_blocks > 1) {
+        *P.pending = True;
+        *(P.worklist + (P.num_pending)++) = 0;
+    }
+
+    /* Number of edges from each node into each compound block that it
+       has an edge into.  Each edge refers to the count of its source
+       and the compound block of its target.  Counts are recycled
+       through free_counts, so that at most one per edge is used, plus
+       one per node while counts of a new compound block are made. */
+    count = malloc( (num_edges+n+1)*sizeof(int) );
+    free_counts = malloc( (num_edges+n+1)*sizeof(int) );
+    edge_count = malloc( (num_edges > 0 ? num_edges : 1)*sizeof(int) );
+    pre = malloc( n*sizeof(int) );
+    pre_count = malloc( n*sizeof(int) );
+    old_count = malloc( n*sizeof(int) );
+    new_count = malloc( n*sizeof(int) );
+    if (count == NULL || free_counts == NULL || edge_count == NULL
+        || pre == NULL || pre_count == NULL || old_count == NULL
+        || new_count == NULL) {
+        perror( "aut_minimize, malloc" );
+        exit(-1);
+    }
+    num_free = 0;
+    for (k = num_edges+n; k >= 0; k--)
+        *(free_counts + num_free++) = k;
+    for (i = 0; i < n; i++) {
+        *(pre_count+i) = 0;
+        if (*(succ_off+i+1) == *(succ_off+i))
+            continue;
+        k = *(free_counts + --num_free);
+        *(count+k) = *(succ_off+i+1) - *(succ_off+i);
+        for (e = *(succ_off+i); e < *(succ_off+i+1); e++)
+            *(edge_count+e) = k;
+    }
+
+    /* Refine until every block is stable with respect to every compound
+       block, following the algorithm of Paige and Tarjan (1987) for the
+       relational coarsest partition.  A block B that is at most half of
+       the compound block S containing it is taken out of S, and blocks
+       are split by whether they have edges into B and by whether they
+       have edges into the rest of S, using the counts.  Each node is in
+       such a B at most log n times, so the time is O(E log n) for E
+       transitions and n nodes, besides building the initial partition. */
+    while (P.num_pending > 0) {
+        s = *(P.worklist + --(P.num_pending));
+        *(P.pending+s) = False;
+        i = *(block + *(P.elem + *(P.cfirst+s)));
+        j = *(block + *(P.elem + *(P.cend+s)-1));
+        if (i == j)
+            continue;
+        c = (P.num_cblocks)++;
+        if (*(P.end+i) - *(P.first+i) <= *(P.end+j) - *(P.first+j)) {
+            b = i;
+            *(P.cfirst+s) = *(P.end+b);
+        } else {
+            b = j;
+            *(P.cend+s) = *(P.first+b);
+        }
+        *(P.cfirst+c) = *(P.first+b);
+        *(P.cend+c) = *(P.end+b);
+        *(P.cblock+b) = c;
+        if (*(block + *(P.elem + *(P.cfirst+s)))
+            != *(block + *(P.elem + *(P.cend+s)-1))) {
+            *(P.pending+s) = True;
+            *(P.worklist + (P.num_pending)++) = s;
+        }
+
+        /* Predecessors of B, and the number of edges from each into B */
+        pre_len = 0;
+        for (k = *(P.cfirst+c); k < *(P.cend+c); k++) {
+            y = *(P.elem+k);
+            for (j = *(pred_off+y); j < *(pred_off+y+1); j++) {
+                e = *(pred+j);
+                x = *(edge_src+e);
+                if (*(pre_count+x) == 0) {
+                    *(pre + pre_len++) = x;
+                    *(old_count+x) = *(edge_count+e);
+                }
+                (*(pre_count+x))++;
+            }
+        }
+
+        for (k = 0; k < pre_len; k++)
+            aut_partition_mark( &P, *(pre+k) );
+        aut_partition_split( &P );
+
+        /* Nodes with all of their edges into S going into B */
+        for (k = 0; k < pre_len; k++) {
+            x = *(pre+k);
+            if (*(count + *(old_count+x)) == *(pre_count+x))
+                aut_partition_mark( &P, x );
+        }
+        aut_partition_split( &P );
+
+        for (k = 0; k < pre_len; k++) {
+            x = *(pre+k);
+            *(new_count+x) = *(free_counts + --num_free);
+            *(count + *(new_count+x)) = *(pre_count+x);
+        }
+        for (k = *(P.cfirst+c); k < *(P.cend+c); k++) {
+            y = *(P.elem+k);
+            for (j = *(pred_off+y); j < *(pred_off+y+1); j++) {
+                e = *(pred+j);
+                x = *(edge_src+e);
+                if (--(*(count + *(edge_count+e))) == 0)
+                    *(free_counts + num_free++) = *(edge_count+e);
+                *(edge_count+e) = *(new_count+x);
+            }
+        }
+        for (k = 0; k < pre_len; k++)
+            *(pre_count + *(pre+k)) = 0;
+    }
+    num_blocks = P.num_blocks;
+
+    /* The representative of each block is the first of its members in
+       the node list, so that the order of the list is preserved. */
+    for (i = 0; i < num_blocks; i++)
+        *(rep+i) = -1;
+    for (node = head; node != NULL; node = node->next) {
+        i = (anode_t **)bsearch( &node, nodes, n, sizeof(anode_t *),
+                                 anode_ptrcmp ) - nodes;
+        if (*(rep + *(block+i)) < 0)
+            *(rep + *(block+i)) = i;
+        if (node->initial)
+            (*(nodes + *(rep + *(block+i))))->initial = True;
+    }
+
+    /* Redirect transitions of representatives, dropping duplicates. */
+    for (i = 0; i < n; i++)
+        *(mark+i) = -1;
+    for (i = 0; i < n; i++) {
+        if (*(rep + *(block+i)) != i)
+            continue;
+        node = *(nodes+i);
+        k = 0;
+        for (j = *(succ_off+i); j < *(succ_off+i+1); j++) {
+            if (*(mark + *(block + *(succ+j))) == i)
+                continue;
+            *(mark + *(block + *(succ+j))) = i;
+            *(node->trans+k) = *(nodes + *(rep + *(block + *(succ+j))));
+            k++;
+        }
+        node->trans_len = k;
+    }
+
+    /* Delete all other nodes. */
+    prev = NULL;
+    for (node = head; node != NULL; node = next) {
+        next = node->next;
+        i = (anode_t **)bsearch( &node, nodes, n, sizeof(anode_t *),
+                                 anode_ptrcmp ) - nodes;
+        if (*(rep + *(block+i)) == i) {
+            prev = node;
+        } else {
+            if (prev == NULL) {
+                head = next;
+            } else {
+                prev->next = next;
+            }
+            if (node->state != NULL)
+                free( node->state );
+            if (node->trans != NULL)
+                free( node->trans );
+            free( node );
+        }
+    }
+
+    free( nodes );
+    free( succ_off );
+    free( pred_off );
+    free( succ );
+    free( edge_src );
+    free( pred );
+    free( rep );
+    free( mark );
+    free( table );
+    free( count );
+    free( free_counts );
+    free( edge_count );
+    free( pre );
+    free( pre_count );
+    free( old_count );
+    free( new_count );
+    free( P.elem );
+    free( P.loc );
+    free( P.block );
+    free( P.first );
+    free( P.mid );
+    free( P.end );
+    free( P.cblock );
+    free( P.touched );
+    free( P.cfirst );
+    free( P.cend );
+    free( P.pending );
+    free( P.worklist );
+    return head;
+}
+
+
+anode_t *aut_copy( anode_t *head, int state_len )
+{
+    int i, j, n;
+    anode_t **nodes, **sorted, **target, *node;
+    int *position;
+    anode_t *copy_head = NULL, *copy_tail = NULL, **copies;
+
+    if (head == NULL)
+        return NULL;
+
+    /* Map each node to its position through an array sorted by address. */
+    n = aut_size( head );
+    nodes = malloc( n*sizeof(anode_t *) );
+    sorted = malloc( n*sizeof(anode_t *) );
+    position = malloc( n*sizeof(int) );
+    copies = malloc( n*sizeof(anode_t *) );
+    if (nodes == NULL || sorted == NULL || position == NULL
+        || copies == NULL) {
+        perror( "aut_copy, malloc" );
+        exit(-1);
+    }
+    for (node = head, i = 0; node != NULL; node = node->next, i++)
+        *(nodes+i) = *(sorted+i) = node;
+    qsort( sorted, n, sizeof(anode_t *), anode_ptrcmp );
+    for (i = 0; i < n; i++) {
+        target = bsearch( nodes+i, sorted, n, sizeof(anode_t *),
+                          anode_ptrcmp );
+        *(position + (target - sorted)) = i;
+    }
+
+    for (i = 0; i < n; i++) {
+        *(copies+i) = insert_anode( NULL, (*(nodes+i))->mode,
+                                    (*(nodes+i))->rgrad,
+                                    (*(nodes+i))->initial,
+                                    (*(nodes+i))->state, state_len );
+        if (copy_tail == NULL) {
+            copy_head = *(copies+i);
+        } else {
+            copy_tail->next = *(copies+i);
+        }
+        copy_tail = *(copies+i);
+    }
+    for (i = 0; i < n; i++) {
+        node = *(nodes+i);
+        if (node->trans_len == 0)
+            continue;
+        (*(copies+i))->trans = malloc( node->trans_len*sizeof(anode_t *) );
+        if ((*(copies+i))->trans == NULL) {
+            perror( "aut_copy, malloc" );
+            exit(-1);
+        }
+        (*(copies+i))->trans_len = node->trans_len;
+        for (j = 0; j < node->trans_len; j++) {
+            target = bsearch( node->trans+j, sorted, n, sizeof(anode_t *),
+                              anode_ptrcmp );
+            if (target == NULL) {
+                fprintf( stderr,
+                         "Error aut_copy: transition to node not in the"
+                         " automaton.\n" );
+                (*(copies+i))->trans_len = j;
+                delete_aut( copy_head );
+                copy_head = NULL;
+                break;
+            }
+            *((*(copies+i))->trans+j) = *(copies + *(position
+                                                     + (target - sorted)));
+        }
+        if (copy_head == NULL)
+            break;
+    }
+
+    free( nodes );
+    free( sorted );
+    free( position );
+    free( copies );
+    return copy_head;
+}
+
+
+stateidx_t *stateidx_new( vartype **states, int len, int state_len )
+{
+    stateidx_t *si;
+    unsigned long h;
+    int i, j;
+
+    si = malloc( sizeof(stateidx_t) );
+    if (si == NULL) {
+        perror( "stateidx_new, malloc" );
+        exit(-1);
+    }
+    si->states = states;
+    si->len = len;
+    si->state_len = state_len;
+
+    /* At least twice as many slots as states, as in aut_minimize(). */
+    for (si->mask = 1; si->mask < 2*(unsigned long)len; si->mask <<= 1) ;
+    si->table = malloc( si->mask*sizeof(int) );
+    si->chain = malloc( (len > 0 ? len : 1)*sizeof(int) );
+    if (si->table == NULL || si->chain == NULL) {
+        perror( "stateidx_new, malloc" );
+        exit(-1);
+    }
+    si->mask--;
+    for (h = 0; h <= si->mask; h++)
+        *(si->table+h) = -1;
+
+    /* Insert from the end, so that each chain is in increasing order. */
+    for (i = len-1; i >= 0; i--) {
+        h = aut_sighash( 0, *(states+i), state_len ) & si->mask;
+        while ((j = *(si->table+h)) >= 0
+               && !statecmp( *(states+j), *(states+i), state_len ))
+            h = (h+1) & si->mask;
+        *(si->chain+i) = j;
+        *(si->table+h) = i;
+    }
+
+    return si;
+}
+
+
+void stateidx_free( stateidx_t *si )
+{
+    if (si == NULL)
+        return;
+    free( si->table );
+    free( si->chain );
+    free( si );
+}
+
+
+int stateidx_find( stateidx_t *si, vartype *state )
+{
+    unsigned long h;
+    int j;
+
+    h = aut_sighash( 0, state, si->state_len ) & si->mask;
+    while ((j = *(si->table+h)) >= 0
+           && !statecmp( *(si->states+j), state, si->state_len ))
+        h = (h+1) & si->mask;
+    return j;
+}
+
+
+int stateidx_next( stateidx_t *si, int i )
+{
+    return *(si->chain+i);
+}
@@ -159,6 +159,32 @@ void replace_anode_trans( anode_t *head, anode_t *old, anode_t *new );
 /** Return (possibly new) head pointer. */
 anode_t *aut_prune_deadends( anode_t *head );
 
+/** Merge bisimilar nodes of the automaton.
+
+   Two nodes are bisimilar if they have the same state and, for every
+   transition from one of them, there is a transition from the other
+   to a bisimilar node.  Goal modes and reach annotations are ignored,
+   so nodes of different modes may be merged.  The result has the same
+   set of executions as the given automaton and thus realizes the same
+   specifications.
+
+   Each class of bisimilar nodes is replaced by its first member in the
+   node list, which is marked initial if any member was.  Transitions
+   are redirected accordingly, duplicate transitions are dropped, and
+   the other members are deleted.  The classes are found by the
+   partition refinement algorithm of Paige and Tarjan, in O(E log n)
+   time for E transitions and n nodes.
+
+   \return (possibly new) head pointer, or NULL on error. */
+anode_t *aut_minimize( anode_t *head, int state_len );
+
+/** Create a copy of the automaton, with nodes in the same order and
+   transitions to the corresponding nodes of the copy.
+
+   \return head pointer of the copy, or NULL if head is NULL or if a
+   transition leads to a node not in the automaton. */
+anode_t *aut_copy( anode_t *head, int state_len );
+
 /** Dump tulipcon XML file describing the automaton (strategy).
    Variable names are obtained from evar_list and svar_list, in which
    the combined order is assumed to match that of the state vector in
@@ -240,12 +266,45 @@ int aut_size( anode_t *head );
 void delete_aut( anode_t *head );
 
 
+/** \brief Index of an array of state vectors.
+
+   Used to find the positions at which a state occurs in the array
+   without scanning it.  The array is not copied, so the state vectors
+   must not be changed or freed while the index is in use. */
+typedef struct {
+    vartype **states;
+    int len;
+    int state_len;
+    int *table;  /**<\brief Open addressing; position of the first
+                    occurrence of a state, or -1 if the slot is empty. */
+    unsigned long mask;  /**<\brief Number of slots in table, minus 1. */
+    int *chain;  /**<\brief Position of the next occurrence of the same
+                    state, or -1. */
+} stateidx_t;
+
+/** Create an index of the first len state vectors in states, each of
+   length state_len.  The caller should free it with stateidx_free(). */
+stateidx_t *stateidx_new( vartype **states, int len, int state_len );
+
+void stateidx_free( stateidx_t *si );
+
+/** Return the first position at which state occurs in the indexed
+   array, or -1 if not found. */
+int stateidx_find( stateidx_t *si, vartype *state );
+
+/** Return the first position after i at which the state at position i
+   occurs in the indexed array, or -1 if there is none.  Together with
+   stateidx_find(), this visits occurrences in increasing order. */
+int stateidx_next( stateidx_t *si, int i );
+
+
 /** Compute forward reachable set from given node in automaton,
-   restricting attention to nodes with state in N and goal mode of
-   mode, and setting the mode field of each reached node to
-   magic_mode.  Return zero on success, nonzero on error. */
-int forward_modereach( anode_t *node, int mode, vartype **N, int N_len,
-                       int magic_mode, int state_len );
+   restricting attention to nodes with state in the array indexed by
+   N_index and goal mode of mode, and setting the mode field of each
+   reached node to magic_mode.  Return zero on success, nonzero on
+   error. */
+int forward_modereach( anode_t *node, int mode, stateidx_t *N_index,
+                       int magic_mode );
 
 
 /** Convert binary-expanded form of a variable back into nonboolean.
@@ -414,11 +414,11 @@ int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                 return -1;
         } else {
             if (!(format_flags & DOT_AUT_EDGEINPUT)) {
-                for (j = 0; j < num_env; j++) {
+                for (j = 0, var = evar_list; j < num_env;
+                     j++, var = var->left) {
                     if ((format_flags & DOT_AUT_BINARY)
                         && *(node->state+j) == 0)
                         continue;
-                    var = get_list_item( evar_list, j );
                     if (j == last_nonzero_env) {
                         if (format_flags & DOT_AUT_BINARY) {
                             nb += snprintf( this_node_str+nb,
@@ -468,11 +468,11 @@ int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                 if (nb >= INPUT_STRING_LEN)
                     return -1;
             } else {
-                for (j = 0; j < num_sys; j++) {
+                for (j = 0, var = svar_list; j < num_sys;
+                     j++, var = var->left) {
                     if ((format_flags & DOT_AUT_BINARY)
                         && *(node->state+num_env+j) == 0)
                         continue;
-                    var = get_list_item( svar_list, j );
                     if (j == last_nonzero_sys) {
                         if (format_flags & DOT_AUT_BINARY) {
                             nb += snprintf( this_node_str+nb,
@@ -543,11 +543,11 @@ int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                 fprintf( fp, "{}" );
             } else {
                 if (!(format_flags & DOT_AUT_EDGEINPUT)) {
-                    for (j = 0; j < num_env; j++) {
+                    for (j = 0, var = evar_list; j < num_env;
+                         j++, var = var->left) {
                         if ((format_flags & DOT_AUT_BINARY)
                             && *((*(node->trans+i))->state+j) == 0)
                             continue;
-                        var = get_list_item( evar_list, j );
                         if (j == last_nonzero_env) {
                             if (format_flags & DOT_AUT_BINARY) {
                                 fprintf( fp, "%s", var->name );
@@ -577,11 +577,11 @@ int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                     && (format_flags & DOT_AUT_EDGEINPUT)) {
                     fprintf( fp, "{}" );
                 } else {
-                    for (j = 0; j < num_sys; j++) {
+                    for (j = 0, var = svar_list; j < num_sys;
+                         j++, var = var->left) {
                         if ((format_flags & DOT_AUT_BINARY)
                             && *((*(node->trans+i))->state+num_env+j) == 0)
                             continue;
-                        var = get_list_item( svar_list, j );
                         if (j == last_nonzero_sys) {
                             if (format_flags & DOT_AUT_BINARY) {
                                 fprintf( fp, "%s", var->name );
@@ -612,11 +612,11 @@ int dot_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
                 if (last_nonzero_env < 0) {
                     fprintf( fp, "{}" );
                 } else {
-                    for (j = 0; j < num_env; j++) {
+                    for (j = 0, var = evar_list; j < num_env;
+                         j++, var = var->left) {
                         if ((format_flags & DOT_AUT_BINARY)
                             && *((*(node->trans+i))->state+j) == 0)
                             continue;
-                        var = get_list_item( evar_list, j );
                         if (j == last_nonzero_env) {
                             if (format_flags & DOT_AUT_BINARY) {
                                 fprintf( fp, "%s", var->name );
@@ -671,8 +671,7 @@ int tulip_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
              "<tulipcon xmlns=\"http://tulip-control.sourceforge.net/ns/1\""
              " version=\"1\">\n" );
     fprintf( fp, "  <env_vars>\n" );
-    for (i = 0; i < num_env; i++) {
-        var = get_list_item( evar_list, i );
+    for (i = 0, var = evar_list; i < num_env; i++, var = var->left) {
         if (var->value >= 0) {
             fprintf( fp,
                      "    <item key=\"%s\" value=\"[0,%d]\" />\n",
@@ -685,8 +684,7 @@ int tulip_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
     }
     fprintf( fp, "  </env_vars>\n" );
     fprintf( fp, "  <sys_vars>\n" );
-    for (i = 0; i < num_sys; i++) {
-        var = get_list_item( svar_list, i );
+    for (i = 0, var = svar_list; i < num_sys; i++, var = var->left) {
         if (var->value >= 0) {
             fprintf( fp,
                      "    <item key=\"%s\" value=\"[0,%d]\" />\n",
@@ -716,13 +714,11 @@ int tulip_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
         for (i = 0; i < node->trans_len; i++)
             fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
         fprintf( fp, "</child_list>\n      <state>\n" );
-        for (i = 0; i < num_env; i++) {
-            var = get_list_item( evar_list, i );
+        for (i = 0, var = evar_list; i < num_env; i++, var = var->left) {
             fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
                      var->name, *(node->state+i) );
         }
-        for (i = 0; i < num_sys; i++) {
-            var = get_list_item( svar_list, i );
+        for (i = 0, var = svar_list; i < num_sys; i++, var = var->left) {
             fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
                      var->name, *(node->state+num_env+i) );
         }
@@ -790,15 +786,13 @@ int tulip0_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
              "<tulipcon xmlns=\"http://tulip-control.sourceforge.net/ns/0\""
              " version=\"0\">\n" );
     fprintf( fp, "  <env_vars>\n" );
-    for (i = 0; i < num_env; i++) {
-        var = get_list_item( evar_list, i );
+    for (i = 0, var = evar_list; i < num_env; i++, var = var->left) {
         fprintf( fp,
                  "    <item key=\"%s\" value=\"boolean\" />\n", var->name );
     }
     fprintf( fp, "  </env_vars>\n" );
     fprintf( fp, "  <sys_vars>\n" );
-    for (i = 0; i < num_sys; i++) {
-        var = get_list_item( svar_list, i );
+    for (i = 0, var = svar_list; i < num_sys; i++, var = var->left) {
         fprintf( fp,
                  "    <item key=\"%s\" value=\"boolean\" />\n", var->name );
     }
@@ -820,13 +814,11 @@ int tulip0_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
         for (i = 0; i < node->trans_len; i++)
             fprintf( fp, " %d", anode_index( head, *(node->trans+i) ) );
         fprintf( fp, "</child_list>\n      <state>\n" );
-        for (i = 0; i < num_env; i++) {
-            var = get_list_item( evar_list, i );
+        for (i = 0, var = evar_list; i < num_env; i++, var = var->left) {
             fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
                      var->name, *(node->state+i) );
         }
-        for (i = 0; i < num_sys; i++) {
-            var = get_list_item( svar_list, i );
+        for (i = 0, var = svar_list; i < num_sys; i++, var = var->left) {
             fprintf( fp, "        <item key=\"%s\" value=\"%d\" />\n",
                      var->name, *(node->state+num_env+i) );
         }
@@ -875,8 +867,7 @@ int json_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
     fprintf( fp, " \"extra\": \"\",\n\n" );
 
     fprintf( fp, " \"ENV\": [" );
-    for (i = 0; i < num_env; i++) {
-        var = get_list_item( evar_list, i );
+    for (i = 0, var = evar_list; i < num_env; i++, var = var->left) {
         fprintf( fp, "{\"%s\": ", var->name );
         if (var->value >= 0) {
             fprintf( fp, "[0,%d]}", var->value );
@@ -887,8 +878,7 @@ int json_aut_dump( anode_t *head, ptree_t *evar_list, ptree_t *svar_list,
             fprintf( fp, ", " );
     }
     fprintf( fp, "],\n \"SYS\": [" );
-    for (i = 0; i < num_sys; i++) {
-        var = get_list_item( svar_list, i );
+    for (i = 0, var = svar_list; i < num_sys; i++, var = var->left) {
         fprintf( fp, "{\"%s\": ", var->name );
         if (var->value >= 0) {
             fprintf( fp, "[0, %d]}", var->value );
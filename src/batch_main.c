@@ -0,0 +1,524 @@
+/* batch_main.c -- main entry point for gr1c-batch, which solves many
+ *     specifications in one process using a pool of worker threads.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "ptree.h"
+#include "solve.h"
+#include "automaton.h"
+#include "context.h"
+
+
+/* Output formats; cf. main.c */
+#define OUTPUT_FORMAT_TEXT 0
+#define OUTPUT_FORMAT_TULIP 1
+#define OUTPUT_FORMAT_DOT 2
+#define OUTPUT_FORMAT_AUT 3
+#define OUTPUT_FORMAT_JSON 5
+
+#define PRINT_VERSION() \
+    printf( "gr1c-batch (part of gr1c) " GR1C_VERSION "\n\n" GR1C_COPYRIGHT "\n" )
+
+/* Maximum length of a line in the manifest */
+#define BATCH_LINE_LEN 4096
+
+/* Maximum number of words in a line of the manifest */
+#define BATCH_MAX_WORDS 32
+
+
+/* A line of the manifest, i.e., a specification to be solved. */
+typedef struct {
+    int index;  /* Line number in the manifest, starting at 1. */
+    char *spec_filename;
+    char *output_filename;  /* NULL if only checking realizability */
+    unsigned char init_flags;
+    unsigned char synth_flags;
+    byte format_option;
+    bool realizable_only;
+} batch_job_t;
+
+/* State shared among worker threads */
+typedef struct {
+    batch_job_t *jobs;
+    int num_jobs;
+    int next_job;  /* Index of next job to be taken by a worker */
+    pthread_mutex_t jobs_lock;  /* Protects next_job */
+    pthread_mutex_t output_lock;  /* Protects stdout */
+    int num_failed;  /* Protected by output_lock */
+} batch_pool_t;
+
+
+/* Parse a line of the manifest into job.  Return 0 on success, 1 if the
+   line is empty or a comment, and -1 on error (with an error message
+   printed to stderr). */
+int batch_parse_line( char *line, int index, batch_job_t *job );
+
+/* Solve the specification of job and print the result as a JSON
+   object on one line.  Return 0 on success, -1 on error. */
+int batch_solve( batch_job_t *job, batch_pool_t *pool );
+
+/* Worker thread: take jobs from the pool until there are none left. */
+void *batch_worker( void *arg );
+
+/* Print string s to fp as a JSON string, i.e., quoted and escaped. */
+void json_print_string( char *s, FILE *fp );
+
+/* Return seconds elapsed since start. */
+double elapsed_since( struct timespec *start );
+
+
+int batch_parse_line( char *line, int index, batch_job_t *job )
+{
+    char *words[BATCH_MAX_WORDS];
+    int num_words = 0;
+    char *output_filename = NULL;
+    char *ext;
+    int i, j;
+
+    job->index = index;
+    job->spec_filename = NULL;
+    job->output_filename = NULL;
+    job->init_flags = ALL_ENV_EXIST_SYS_INIT;
+    job->synth_flags = SYNTH_DEFAULT;
+    job->format_option = OUTPUT_FORMAT_JSON;
+    job->realizable_only = False;
+
+    words[num_words] = strtok( line, " \t\r\n" );
+    while (words[num_words] != NULL) {
+        if (num_words == BATCH_MAX_WORDS-1) {
+            fprintf( stderr, "Error: too many words on line %d of manifest.\n",
+                     index );
+            return -1;
+        }
+        words[++num_words] = strtok( NULL, " \t\r\n" );
+    }
+    if (num_words == 0 || words[0][0] == '#')
+        return 1;
+
+    for (i = 0; i < num_words-1; i++) {
+        if (!strcmp( words[i], "-r" )) {
+            job->realizable_only = True;
+        } else if (!strcmp( words[i], "--reuse" )) {
+            job->synth_flags |= SYNTH_REUSE_NODES;
+        } else if (!strcmp( words[i], "--minimize" )) {
+            job->synth_flags |= SYNTH_MINIMIZE;
+        } else if (!strcmp( words[i], "--reachable" )) {
+            job->synth_flags |= SYNTH_RESTRICT_REACH;
+        } else if (!strcmp( words[i], "--lean" )) {
+            job->synth_flags |= SYNTH_LEAN_SUBLEVELS;
+        } else if (!strcmp( words[i], "-t" ) && i < num_words-2) {
+            i++;
+            if (!strcmp( words[i], "txt" )) {
+                job->format_option = OUTPUT_FORMAT_TEXT;
+            } else if (!strcmp( words[i], "tulip" )) {
+                job->format_option = OUTPUT_FORMAT_TULIP;
+            } else if (!strcmp( words[i], "dot" )) {
+                job->format_option = OUTPUT_FORMAT_DOT;
+            } else if (!strcmp( words[i], "aut" )) {
+                job->format_option = OUTPUT_FORMAT_AUT;
+            } else if (!strcmp( words[i], "json" )) {
+                job->format_option = OUTPUT_FORMAT_JSON;
+            } else {
+                fprintf( stderr,
+                         "Error: unrecognized output format on line %d of"
+                         " manifest.\n", index );
+                return -1;
+            }
+        } else if (!strcmp( words[i], "-n" ) && i < num_words-2) {
+            i++;
+            for (j = 0; j < strlen( words[i] ); j++)
+                words[i][j] = tolower( words[i][j] );
+            if (!strcmp( words[i], "all_env_exist_sys_init" )) {
+                job->init_flags = ALL_ENV_EXIST_SYS_INIT;
+            } else if (!strcmp( words[i], "all_init" )) {
+                job->init_flags = ALL_INIT;
+            } else if (!strcmp( words[i], "one_side_init" )) {
+                job->init_flags = ONE_SIDE_INIT;
+            } else {
+                fprintf( stderr,
+                         "Error: unrecognized init flags on line %d of"
+                         " manifest.\n", index );
+                return -1;
+            }
+        } else if (!strcmp( words[i], "-o" ) && i < num_words-2) {
+            output_filename = words[++i];
+        } else {
+            fprintf( stderr, "Error: invalid option \"%s\" on line %d of"
+                     " manifest.\n", words[i], index );
+            return -1;
+        }
+    }
+
+    job->spec_filename = strdup( words[num_words-1] );
+    if (job->spec_filename == NULL) {
+        perror( "batch_parse_line, strdup" );
+        exit(-1);
+    }
+    if (job->realizable_only)
+        return 0;
+
+    if (output_filename != NULL) {
+        job->output_filename = strdup( output_filename );
+        if (job->output_filename == NULL) {
+            perror( "batch_parse_line, strdup" );
+            exit(-1);
+        }
+    } else {
+        /* Default is the name of the specification file with an
+           extension for the output format appended. */
+        switch (job->format_option) {
+        case OUTPUT_FORMAT_TEXT:
+            ext = ".txt";
+            break;
+        case OUTPUT_FORMAT_TULIP:
+            ext = ".xml";
+            break;
+        case OUTPUT_FORMAT_DOT:
+            ext = ".dot";
+            break;
+        case OUTPUT_FORMAT_AUT:
+            ext = ".aut";
+            break;
+        default:
+            ext = ".json";
+        }
+        job->output_filename = malloc( strlen( job->spec_filename )
+                                       + strlen( ext ) + 1 );
+        if (job->output_filename == NULL) {
+            perror( "batch_parse_line, malloc" );
+            exit(-1);
+        }
+        strcpy( job->output_filename, job->spec_filename );
+        strcat( job->output_filename, ext );
+    }
+
+    return 0;
+}
+
+
+void json_print_string( char *s, FILE *fp )
+{
+    fputc( '"', fp );
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc( '\\', fp );
+            fputc( *s, fp );
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf( fp, "\\u%04x", (unsigned char)*s );
+        } else {
+            fputc( *s, fp );
+        }
+    }
+    fputc( '"', fp );
+}
+
+
+double elapsed_since( struct timespec *start )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec)*1e-9;
+}
+
+
+int batch_solve( batch_job_t *job, batch_pool_t *pool )
+{
+    gr1c_ctx_t *ctx;
+    FILE *fp;
+    ptree_t *tmppt;
+    DdNode *T = NULL;
+    anode_t *strategy = NULL;
+    struct timespec start;
+    double parse_time = -1., solve_time = -1.;
+    char *error = NULL;
+    int realizable = -1;  /* -1 if unknown */
+    int num_env, num_sys;
+    int load_result;
+
+    ctx = gr1c_ctx_new( job->init_flags, job->synth_flags, 0 );
+    if (ctx == NULL) {
+        error = "failed to create context";
+        goto report;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    fp = fopen( job->spec_filename, "r" );
+    if (fp == NULL) {
+        error = "failed to open specification file";
+        goto report;
+    }
+    load_result = gr1c_ctx_load( ctx, fp );
+    fclose( fp );
+    parse_time = elapsed_since( &start );
+    if (load_result == 2) {
+        error = "specification has errors";
+        goto report;
+    } else if (load_result < 0) {
+        error = "failed to prepare specification";
+        goto report;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    T = gr1c_ctx_check_realizable( ctx );
+    realizable = (T != NULL);
+    if (T != NULL && !job->realizable_only) {
+        strategy = gr1c_ctx_synthesize( ctx );
+        if (strategy == NULL)
+            error = "error while attempting synthesis";
+    }
+    solve_time = elapsed_since( &start );
+
+    if (strategy != NULL) {  /* De-expand nonboolean variables */
+        tmppt = ctx->spec.nonbool_var_list;
+        while (tmppt) {
+            aut_compact_nonbool( strategy, ctx->spec.evar_list,
+                                 ctx->spec.svar_list,
+                                 tmppt->name, tmppt->value );
+            tmppt = tmppt->left;
+        }
+        num_env = tree_size( ctx->spec.evar_list );
+        num_sys = tree_size( ctx->spec.svar_list );
+
+        fp = fopen( job->output_filename, "w" );
+        if (fp == NULL) {
+            error = "failed to open output file";
+        } else {
+            if (job->format_option == OUTPUT_FORMAT_TEXT) {
+                list_aut_dump( strategy, num_env+num_sys, fp );
+            } else if (job->format_option == OUTPUT_FORMAT_DOT) {
+                if (ctx->spec.nonbool_var_list != NULL) {
+                    dot_aut_dump( strategy, ctx->spec.evar_list,
+                                  ctx->spec.svar_list, DOT_AUT_ATTRIB, fp );
+                } else {
+                    dot_aut_dump( strategy, ctx->spec.evar_list,
+                                  ctx->spec.svar_list,
+                                  DOT_AUT_BINARY | DOT_AUT_ATTRIB, fp );
+                }
+            } else if (job->format_option == OUTPUT_FORMAT_AUT) {
+                aut_aut_dump( strategy, num_env+num_sys, fp );
+            } else if (job->format_option == OUTPUT_FORMAT_JSON) {
+                json_aut_dump( strategy, ctx->spec.evar_list,
+                               ctx->spec.svar_list, fp );
+            } else { /* OUTPUT_FORMAT_TULIP */
+                tulip_aut_dump( strategy, ctx->spec.evar_list,
+                                ctx->spec.svar_list, fp );
+            }
+            fclose( fp );
+        }
+        delete_aut( strategy );
+    }
+
+    if (T != NULL)
+        Cudd_RecursiveDeref( ctx->manager, T );
+
+  report:
+    gr1c_ctx_free( ctx );
+
+    pthread_mutex_lock( &pool->output_lock );
+    printf( "{\"index\": %d, \"spec\": ", job->index );
+    json_print_string( job->spec_filename, stdout );
+    if (realizable < 0) {
+        printf( ", \"realizable\": null" );
+    } else {
+        printf( ", \"realizable\": %s", realizable ? "true" : "false" );
+    }
+    if (parse_time < 0) {
+        printf( ", \"parse_time\": null" );
+    } else {
+        printf( ", \"parse_time\": %.6f", parse_time );
+    }
+    if (solve_time < 0) {
+        printf( ", \"solve_time\": null" );
+    } else {
+        printf( ", \"solve_time\": %.6f", solve_time );
+    }
+    if (realizable > 0 && !job->realizable_only && error == NULL) {
+        printf( ", \"output\": " );
+        json_print_string( job->output_filename, stdout );
+    } else {
+        printf( ", \"output\": null" );
+    }
+    if (error != NULL) {
+        printf( ", \"error\": " );
+        json_print_string( error, stdout );
+        pool->num_failed++;
+    }
+    printf( "}\n" );
+    fflush( stdout );
+    pthread_mutex_unlock( &pool->output_lock );
+
+    return (error == NULL) ? 0 : -1;
+}
+
+
+void *batch_worker( void *arg )
+{
+    batch_pool_t *pool = (batch_pool_t *)arg;
+    int k;
+
+    while (True) {
+        pthread_mutex_lock( &pool->jobs_lock );
+        k = pool->next_job++;
+        pthread_mutex_unlock( &pool->jobs_lock );
+        if (k >= pool->num_jobs)
+            break;
+        batch_solve( pool->jobs+k, pool );
+    }
+
+    return NULL;
+}
+
+
+int main( int argc, char **argv )
+{
+    FILE *fp;
+    bool help_flag = False;
+    int input_index = -1;
+    long num_workers = -1;
+    char line[BATCH_LINE_LEN];
+    int line_num;
+    batch_pool_t pool;
+    pthread_t *workers;
+    int i, result;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            if (argv[i][1] == '-' && argv[i][2] == '\0') {
+                if (i < argc-1)
+                    input_index = i+1;
+                break;
+            }
+            if (argv[i][2] != '\0') {
+                fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                return 1;
+            }
+            if (argv[i][1] == 'h') {
+                help_flag = True;
+            } else if (argv[i][1] == 'V') {
+                PRINT_VERSION();
+                PRINT_LINKED_VERSIONS();
+                return 0;
+            } else if (argv[i][1] == 'j') {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                num_workers = strtol( argv[i+1], NULL, 10 );
+                if (num_workers < 1) {
+                    fprintf( stderr,
+                             "Number of workers must be positive.\n" );
+                    return 1;
+                }
+                i++;
+            } else {
+                fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                return 1;
+            }
+        } else if (input_index < 0) {
+            if (i < argc-1) {
+                fprintf( stderr,
+                         "Unexpected arguments after filename. Try \"-h\".\n" );
+                return 1;
+            }
+            input_index = i;
+        }
+    }
+
+    if (help_flag) {
+        /* Split among printf() calls to conform with ISO C90 string length */
+        printf( "Usage: %s [-hV] [-j N] [[--] MANIFEST]\n\n"
+                "  -h          this help message\n"
+                "  -V          print version and exit\n"
+                "  -j N        solve with N worker threads; default is the\n"
+                "              number of online processors\n\n", argv[0] );
+        printf( "Each line of MANIFEST (stdin if not given) is of the form\n\n"
+                "  [-r] [-n INIT] [-t TYPE] [-o FILE] [--reuse] [--minimize]\n"
+                "  [--reachable] [--lean] SPEC\n\n"
+                "where the options are as for gr1c.  The default output file is\n"
+                "SPEC with an extension for TYPE appended, e.g., SPEC.json.\n"
+                "Empty lines and lines beginning with # are ignored.\n\n"
+                "For each line, a JSON object with the result is printed on one\n"
+                "line, in the order in which specifications are solved.\n" );
+        return 0;
+    }
+
+    if (input_index >= 0) {
+        fp = fopen( argv[input_index], "r" );
+        if (fp == NULL) {
+            perror( "gr1c-batch, fopen" );
+            return -1;
+        }
+    } else {
+        fp = stdin;
+    }
+
+    pool.jobs = NULL;
+    pool.num_jobs = 0;
+    line_num = 0;
+    while (fgets( line, BATCH_LINE_LEN, fp ) != NULL) {
+        line_num++;
+        pool.jobs = realloc( pool.jobs, (pool.num_jobs+1)*sizeof(batch_job_t) );
+        if (pool.jobs == NULL) {
+            perror( "gr1c-batch, realloc" );
+            exit(-1);
+        }
+        result = batch_parse_line( line, line_num, pool.jobs+pool.num_jobs );
+        if (result < 0)
+            return 1;
+        if (result == 0)
+            pool.num_jobs++;
+    }
+    if (fp != stdin)
+        fclose( fp );
+
+    if (num_workers < 0) {
+        num_workers = sysconf( _SC_NPROCESSORS_ONLN );
+        if (num_workers < 1)
+            num_workers = 1;
+    }
+    if (num_workers > pool.num_jobs)
+        num_workers = pool.num_jobs;
+
+    pool.next_job = 0;
+    pool.num_failed = 0;
+    pthread_mutex_init( &pool.jobs_lock, NULL );
+    pthread_mutex_init( &pool.output_lock, NULL );
+
+    workers = malloc( num_workers*sizeof(pthread_t) );
+    if (num_workers > 0 && workers == NULL) {
+        perror( "gr1c-batch, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_workers; i++) {
+        if (pthread_create( workers+i, NULL, batch_worker, &pool )) {
+            fprintf( stderr, "Error gr1c-batch: failed to create thread.\n" );
+            return -1;
+        }
+    }
+    for (i = 0; i < num_workers; i++)
+        pthread_join( *(workers+i), NULL );
+
+    pthread_mutex_destroy( &pool.jobs_lock );
+    pthread_mutex_destroy( &pool.output_lock );
+    free( workers );
+    for (i = 0; i < pool.num_jobs; i++) {
+        free( (pool.jobs+i)->spec_filename );
+        free( (pool.jobs+i)->output_filename );
+    }
+    free( pool.jobs );
+
+    return (pool.num_failed > 0) ? -1 : 0;
+}
@@ -0,0 +1,368 @@
+/* checkpoint.c -- Definitions for signatures appearing in checkpoint.h.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "dddmp.h"
+#include "checkpoint.h"
+
+
+#define CHECKPOINT_VERSION 1
+#define FILENAME_LEN 256
+char *checkpoint_prefix = NULL;
+int checkpoint_interval = CHECKPOINT_DEFAULT_INTERVAL;
+bool checkpoint_resume = False;
+unsigned long checkpoint_spec_hash = 0;
+time_t checkpoint_last = 0;
+
+
+/* Place in basename the common part of the names of the files of the
+   checkpoint with given tag.  Return 0 on success, -1 if the name is
+   too long. */
+int checkpoint_basename( char *basename, char *tag );
+
+
+void setcheckpoint( char *prefix, int interval, bool resume,
+                    unsigned long spec_hash )
+{
+    checkpoint_prefix = prefix;
+    checkpoint_interval = interval;
+    checkpoint_resume = resume;
+    checkpoint_spec_hash = spec_hash;
+    checkpoint_last = time( NULL );
+}
+
+
+bool checkpoint_enabled()
+{
+    return checkpoint_prefix != NULL;
+}
+
+
+bool checkpoint_due()
+{
+    if (checkpoint_prefix == NULL)
+        return False;
+    return difftime( time( NULL ), checkpoint_last ) >= checkpoint_interval;
+}
+
+
+int checkpoint_basename( char *basename, char *tag )
+{
+    if (strlen( checkpoint_prefix ) + strlen( tag ) + 2 > FILENAME_LEN)
+        return -1;
+    sprintf( basename, "%s-%s", checkpoint_prefix, tag );
+    return 0;
+}
+
+
+/* Combine the hash of the specification with the key of a checkpoint. */
+unsigned long checkpoint_keyhash( unsigned long key )
+{
+    return PTREE_HASH_STEP( checkpoint_spec_hash, key );
+}
+
+
+int checkpoint_save( DdManager *manager, char *tag, unsigned long key,
+                     DdNode **f, int f_len, int *vals, int vals_len )
+{
+    char basename[FILENAME_LEN];
+
+    if (checkpoint_prefix == NULL)
+        return -1;
+
+    if (checkpoint_basename( basename, tag )) {
+        fprintf( stderr, "Error checkpoint_save: prefix is too long.\n" );
+        return -1;
+    }
+    if (bddarray_save( manager, basename, checkpoint_keyhash( key ),
+                       f, f_len, vals, vals_len ))
+        return -1;
+
+    checkpoint_last = time( NULL );
+    return 0;
+}
+
+
+int checkpoint_load( DdManager *manager, char *tag, unsigned long key,
+                     DdNode ***f, int **vals, int *vals_len )
+{
+    char basename[FILENAME_LEN];
+
+    if (checkpoint_prefix == NULL || !checkpoint_resume)
+        return -1;
+
+    if (checkpoint_basename( basename, tag ))
+        return -1;
+    return bddarray_load( manager, basename, checkpoint_keyhash( key ), True,
+                          f, vals, vals_len );
+}
+
+
+int bddarray_save( DdManager *manager, char *basename, unsigned long hash,
+                   DdNode **f, int f_len, int *vals, int vals_len )
+{
+    char filename[FILENAME_LEN+8], tmpfilename[FILENAME_LEN+12];
+    FILE *fp;
+    int i;
+
+    if (strlen( basename ) >= FILENAME_LEN) {
+        fprintf( stderr, "Error bddarray_save: name is too long.\n" );
+        return -1;
+    }
+
+    sprintf( filename, "%s.dddmp", basename );
+    sprintf( tmpfilename, "%s.tmp", filename );
+    if (f_len > 0
+        && Dddmp_cuddBddArrayStore( manager, NULL, f_len, f, NULL, NULL, NULL,
+                                    DDDMP_MODE_BINARY, DDDMP_VARIDS,
+                                    tmpfilename, NULL ) != DDDMP_SUCCESS) {
+        fprintf( stderr,
+                 "Error bddarray_save: failed to store BDDs in \"%s\".\n",
+                 tmpfilename );
+        return -1;
+    }
+    if (f_len > 0 && rename( tmpfilename, filename )) {
+        perror( "bddarray_save, rename" );
+        return -1;
+    }
+
+    /* The description file is written last, so that an interrupted
+       save is not mistaken for a complete one. */
+    sprintf( filename, "%s.chk", basename );
+    sprintf( tmpfilename, "%s.tmp", filename );
+    fp = fopen( tmpfilename, "w" );
+    if (fp == NULL) {
+        perror( "bddarray_save, fopen" );
+        return -1;
+    }
+    fprintf( fp, "gr1c checkpoint %d\n", CHECKPOINT_VERSION );
+    fprintf( fp, "hash %lu\n", hash );
+    fprintf( fp, "order %d", Cudd_ReadSize( manager ) );
+    for (i = 0; i < Cudd_ReadSize( manager ); i++)
+        fprintf( fp, " %d", Cudd_ReadInvPerm( manager, i ) );
+    fprintf( fp, "\nbdds %d\n", f_len );
+    fprintf( fp, "vals %d", vals_len );
+    for (i = 0; i < vals_len; i++)
+        fprintf( fp, " %d", *(vals+i) );
+    fprintf( fp, "\n" );
+    if (fclose( fp ) || rename( tmpfilename, filename )) {
+        perror( "bddarray_save, rename" );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int bddarray_load( DdManager *manager, char *basename, unsigned long hash,
+                   bool restore_order,
+                   DdNode ***f, int **vals, int *vals_len )
+{
+    char filename[FILENAME_LEN+8];
+    FILE *fp;
+    int version, order_len, f_len;
+    unsigned long saved_hash;
+    int *order = NULL;
+    int i;
+
+    if (strlen( basename ) >= FILENAME_LEN)
+        return -1;
+
+    sprintf( filename, "%s.chk", basename );
+    fp = fopen( filename, "r" );
+    if (fp == NULL)
+        return -1;
+    if (fscanf( fp, " gr1c checkpoint %d", &version ) != 1
+        || version != CHECKPOINT_VERSION
+        || fscanf( fp, " hash %lu", &saved_hash ) != 1
+        || saved_hash != hash
+        || fscanf( fp, " order %d", &order_len ) != 1
+        || order_len != Cudd_ReadSize( manager )) {
+        fprintf( stderr,
+                 "Warning: ignoring \"%s\" because it does not"
+                 " match the current problem.\n", filename );
+        fclose( fp );
+        return -1;
+    }
+
+    order = malloc( (order_len > 0 ? order_len : 1)*sizeof(int) );
+    if (order == NULL) {
+        perror( "bddarray_load, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < order_len; i++) {
+        if (fscanf( fp, " %d", order+i ) != 1)
+            break;
+    }
+    if (i < order_len
+        || fscanf( fp, " bdds %d", &f_len ) != 1
+        || fscanf( fp, " vals %d", vals_len ) != 1 || *vals_len < 0) {
+        fprintf( stderr,
+                 "Warning: ignoring malformed file \"%s\".\n",
+                 filename );
+        free( order );
+        fclose( fp );
+        return -1;
+    }
+    *vals = malloc( (*vals_len > 0 ? *vals_len : 1)*sizeof(int) );
+    if (*vals == NULL) {
+        perror( "bddarray_load, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < *vals_len; i++) {
+        if (fscanf( fp, " %d", *vals+i ) != 1)
+            break;
+    }
+    fclose( fp );
+    if (i < *vals_len) {
+        fprintf( stderr,
+                 "Warning: ignoring malformed file \"%s\".\n",
+                 filename );
+        free( order );
+        free( *vals );
+        return -1;
+    }
+
+    /* Restore the variable order before loading, so that the BDDs are
+       built directly in the order that they had when saved. */
+    if (restore_order && order_len > 0 && !Cudd_ShuffleHeap( manager, order ))
+        fprintf( stderr,
+                 "Warning: failed to restore variable order from"
+                 " \"%s\".\n", filename );
+    free( order );
+
+    *f = NULL;
+    if (f_len > 0) {
+        sprintf( filename, "%s.dddmp", basename );
+        if (Dddmp_cuddBddArrayLoad( manager, DDDMP_ROOT_MATCHLIST, NULL,
+                                    DDDMP_VAR_MATCHIDS, NULL, NULL, NULL,
+                                    DDDMP_MODE_BINARY, filename, NULL,
+                                    f ) != f_len) {
+            fprintf( stderr,
+                     "Error bddarray_load: failed to load BDDs from"
+                     " \"%s\".\n", filename );
+            free( *vals );
+            return -1;
+        }
+    }
+
+    return f_len;
+}
+
+
+unsigned long checkpoint_filehash( FILE *fp )
+{
+    unsigned long h = 5381;
+    int c;
+    while ((c = fgetc( fp )) != EOF)
+        h = h*33 + (unsigned char)c;
+    return h;
+}
+
+
+/* Hash of the BDD f, where hashes of (regular) internal nodes are
+   memoized in the open-addressing table with mask+1 slots given by the
+   arrays keys and vals. */
+unsigned long checkpoint_nodehash( DdNode *f, DdNode **keys,
+                                   unsigned long *vals, unsigned long mask )
+{
+    DdNode *node = Cudd_Regular( f );
+    unsigned long h, slot;
+
+    if (Cudd_IsConstant( node )) {
+        h = 1;
+    } else {
+        slot = ((size_t)node >> 4) & mask;
+        while (*(keys+slot) != NULL && *(keys+slot) != node)
+            slot = (slot+1) & mask;
+        if (*(keys+slot) == node) {
+            h = *(vals+slot);
+        } else {
+            h = PTREE_HASH_INIT;
+            h = PTREE_HASH_STEP( h,
+                                 (unsigned long)Cudd_NodeReadIndex( node ) );
+            h = PTREE_HASH_STEP( h, checkpoint_nodehash( Cudd_T( node ),
+                                                         keys, vals, mask ) );
+            h = PTREE_HASH_STEP( h, checkpoint_nodehash( Cudd_E( node ),
+                                                         keys, vals, mask ) );
+
+            /* The recursion may have filled the slot found above. */
+            while (*(keys+slot) != NULL)
+                slot = (slot+1) & mask;
+            *(keys+slot) = node;
+            *(vals+slot) = h;
+        }
+    }
+    return Cudd_IsComplement( f ) ? ~h : h;
+}
+
+
+unsigned long checkpoint_bddhash( DdNode **f, int f_len )
+{
+    DdNode **keys;
+    unsigned long *vals;
+    unsigned long h, mask, slot;
+    int i;
+
+    /* At least twice as many slots as nodes */
+    for (mask = 1; mask < 2*(unsigned long)Cudd_SharingSize( f, f_len );
+         mask <<= 1) ;
+    keys = malloc( mask*sizeof(DdNode *) );
+    vals = malloc( mask*sizeof(unsigned long) );
+    if (keys == NULL || vals == NULL) {
+        perror( "checkpoint_bddhash, malloc" );
+        exit(-1);
+    }
+    for (slot = 0; slot < mask; slot++)
+        *(keys+slot) = NULL;
+    mask--;
+
+    h = PTREE_HASH_INIT;
+    for (i = 0; i < f_len; i++)
+        h = PTREE_HASH_STEP( h, checkpoint_nodehash( *(f+i),
+                                                     keys, vals, mask ) );
+
+    free( keys );
+    free( vals );
+    return h;
+}
+
+
+unsigned long checkpoint_gamekey( DdNode *etrans, DdNode *strans,
+                                  DdNode **egoals, int num_egoals,
+                                  DdNode **sgoals, int num_sgoals,
+                                  DdNode **sets, int num_sets )
+{
+    DdNode **f;
+    unsigned long key;
+    int i, f_len = 0;
+
+    if (checkpoint_prefix == NULL)
+        return 0;
+
+    f = malloc( (2+num_egoals+num_sgoals+num_sets)*sizeof(DdNode *) );
+    if (f == NULL) {
+        perror( "checkpoint_gamekey, malloc" );
+        exit(-1);
+    }
+    *(f + f_len++) = etrans;
+    *(f + f_len++) = strans;
+    for (i = 0; i < num_egoals; i++)
+        *(f + f_len++) = *(egoals+i);
+    for (i = 0; i < num_sgoals; i++)
+        *(f + f_len++) = *(sgoals+i);
+    for (i = 0; i < num_sets; i++)
+        *(f + f_len++) = *(sets+i);
+
+    key = checkpoint_bddhash( f, f_len );
+    free( f );
+    return key;
+}
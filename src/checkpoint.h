@@ -0,0 +1,107 @@
+/** \file checkpoint.h
+ * \brief Saving and restoring progress of long-running fixpoint computations.
+ *
+ * Checkpoints are identified by a tag, e.g., "winning" for the
+ * computation of the winning set.  Each consists of two files whose
+ * names are formed from the prefix given to setcheckpoint() and the
+ * tag: PREFIX-TAG.dddmp contains an array of BDDs as written by DDDMP,
+ * and PREFIX-TAG.chk records a hash of the specification and of the
+ * inputs of the computation (e.g., the transition BDDs, which differ
+ * from the specification for games patched in interactive mode), the
+ * variable order, and integers describing progress (e.g., iteration
+ * counters).
+ * The latter is written last, so a checkpoint is only used if both
+ * files were completely written.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+
+/** Default minimum time in seconds between consecutive checkpoints. */
+#define CHECKPOINT_DEFAULT_INTERVAL 300
+
+/** Enable checkpoints.  File names begin with the given prefix, and
+   checkpoints are written at most once every interval seconds.  If
+   resume is True, then checkpoint_load() attempts to restore from
+   existing files.  spec_hash identifies the problem being solved,
+   e.g., as returned by checkpoint_filehash(); checkpoints that were
+   saved with a different hash are ignored.  If prefix is NULL, then
+   checkpoints are disabled (default). */
+void setcheckpoint( char *prefix, int interval, bool resume,
+                    unsigned long spec_hash );
+
+/** Return True if checkpoints are enabled. */
+bool checkpoint_enabled();
+
+/** Return True if checkpoints are enabled and at least the configured
+   interval has passed since the last checkpoint was saved (or since
+   setcheckpoint() was called). */
+bool checkpoint_due();
+
+/** Save f_len BDDs from the array f and vals_len integers from the
+   array vals as the checkpoint with the given tag, together with the
+   current variable order.  key identifies the inputs of the
+   computation, e.g., as returned by checkpoint_bddhash().  Return 0 on
+   success, -1 on error. */
+int checkpoint_save( DdManager *manager, char *tag, unsigned long key,
+                     DdNode **f, int f_len, int *vals, int vals_len );
+
+/** Restore the checkpoint with the given tag, if resuming is enabled
+   and a checkpoint that matches the specification hash and key (as
+   given to checkpoint_save()) exists.  The variable order is restored
+   first.  On success, *f points to a new array of the (referenced)
+   BDDs, *vals points to a new array of the integers, *vals_len is the
+   number of integers, and the number of BDDs is returned.  The caller
+   should free both arrays.  Return -1 if no usable checkpoint is
+   found. */
+int checkpoint_load( DdManager *manager, char *tag, unsigned long key,
+                     DdNode ***f, int **vals, int *vals_len );
+
+/** Hash the f_len BDDs in the array f, for use as the key of a
+   checkpoint.  Equal BDDs in the same variable order have equal
+   hashes; after different reordering, a checkpoint may thus not be
+   used, but it is not used for different BDDs (barring collisions). */
+unsigned long checkpoint_bddhash( DdNode **f, int f_len );
+
+/** Key of checkpoints of a fixpoint computation on the game with the
+   given transition BDDs and num_egoals and num_sgoals goals, where the
+   num_sets BDDs in sets are other inputs (e.g., the winning set or the
+   set to be reached).  Return 0 without hashing if checkpoints are
+   disabled. */
+unsigned long checkpoint_gamekey( DdNode *etrans, DdNode *strans,
+                                  DdNode **egoals, int num_egoals,
+                                  DdNode **sgoals, int num_sgoals,
+                                  DdNode **sets, int num_sets );
+
+/** Save f_len BDDs and vals_len integers in the files BASENAME.dddmp
+   and BASENAME.chk, using the format of checkpoints described above,
+   where hash identifies the problem.  checkpoint_save() wraps this
+   function and is usually what you want.  Return 0 on success, -1 on
+   error. */
+int bddarray_save( DdManager *manager, char *basename, unsigned long hash,
+                   DdNode **f, int f_len, int *vals, int vals_len );
+
+/** Load BDDs and integers that were saved by bddarray_save() with the
+   same basename and hash.  If restore_order is True, then the saved
+   variable order is restored first; otherwise, the BDDs are rebuilt in
+   the current order.  Other arguments and the return value are as for
+   checkpoint_load(), which wraps this function. */
+int bddarray_load( DdManager *manager, char *basename, unsigned long hash,
+                   bool restore_order,
+                   DdNode ***f, int **vals, int *vals_len );
+
+/** Hash the remaining contents of the given file, e.g., of the
+   specification.  The file position is not restored. */
+unsigned long checkpoint_filehash( FILE *fp );
+
+
+#endif
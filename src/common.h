@@ -50,6 +50,8 @@ typedef struct {
     ptree_t **sys_trans_array;
     int et_array_len;
     int st_array_len;
+
+    symtab_t *var_st;  /* Of evar_list and svar_list; cf. vars_symtab() */
 } specification_t;
 
 #define SPC_INIT(X) \
@@ -68,7 +70,18 @@ typedef struct {
     X.env_trans_array = NULL; \
     X.sys_trans_array = NULL; \
     X.et_array_len = 0; \
-    X.st_array_len = 0
+    X.st_array_len = 0; \
+    X.var_st = NULL
+
+/** Parse specification from fp into spec, which should already be
+   initialized using SPC_INIT.  If fp is NULL, then read from stdin.
+   If the input is a formula rather than a specification, then its parse
+   tree is placed in *formula, unless formula is NULL.  Either the GR(1)
+   grammar (gr1c_parse.y) or the reachability game grammar (rg_parse.y)
+   is used, depending on which one the program is linked with.  The
+   parser is reentrant, i.e., it has no global state.  Return 0 on
+   success, nonzero on syntax error. */
+int gr1c_parse( FILE *fp, specification_t *spec, ptree_t **formula );
 
 
 #include "cudd.h"
@@ -0,0 +1,197 @@
+/* context.c -- Definitions for signatures appearing in context.h.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "context.h"
+#include "logging.h"
+#include "gr1c_util.h"
+
+
+/* Specification used when no context is bound, e.g., by the gr1c
+   programs.  Static storage implies that it is initially empty, as
+   given by SPC_INIT. */
+specification_t default_spec;
+
+/* Context bound in each thread.  N.B., __thread is an extension of
+   C99 that is supported by GCC and Clang. */
+__thread gr1c_ctx_t *bound_ctx = NULL;
+
+
+specification_t *gr1c_spec()
+{
+    if (bound_ctx == NULL)
+        return &default_spec;
+    return &(bound_ctx->spec);
+}
+
+
+gr1c_ctx_t *gr1c_ctx_bind( gr1c_ctx_t *ctx )
+{
+    gr1c_ctx_t *prev = bound_ctx;
+    bound_ctx = ctx;
+    return prev;
+}
+
+
+gr1c_ctx_t *gr1c_ctx_new( unsigned char init_flags, unsigned char synth_flags,
+                          unsigned char verbose )
+{
+    gr1c_ctx_t *ctx = malloc( sizeof(gr1c_ctx_t) );
+    if (ctx == NULL) {
+        perror( "gr1c_ctx_new, malloc" );
+        return NULL;
+    }
+    SPC_INIT( ctx->spec );
+    ctx->spec.env_trans = NULL;
+    ctx->spec.sys_trans = NULL;
+    ctx->manager = NULL;
+    ctx->init_flags = init_flags;
+    ctx->synth_flags = synth_flags;
+    ctx->verbose = verbose;
+    return ctx;
+}
+
+
+void gr1c_ctx_free( gr1c_ctx_t *ctx )
+{
+    int i;
+    specification_t *spec;
+
+    if (ctx == NULL)
+        return;
+    spec = &(ctx->spec);
+
+    delete_tree( spec->evar_list );
+    delete_tree( spec->svar_list );
+    symtab_free( spec->var_st );
+    delete_tree( spec->nonbool_var_list );
+    delete_tree( spec->env_init );
+    delete_tree( spec->sys_init );
+    if (spec->env_trans != NULL) {
+        /* The components are subtrees of the merged formula. */
+        delete_tree( spec->env_trans );
+    } else {
+        for (i = 0; i < spec->et_array_len; i++)
+            delete_tree( *(spec->env_trans_array+i) );
+    }
+    free( spec->env_trans_array );
+    if (spec->sys_trans != NULL) {
+        delete_tree( spec->sys_trans );
+    } else {
+        for (i = 0; i < spec->st_array_len; i++)
+            delete_tree( *(spec->sys_trans_array+i) );
+    }
+    free( spec->sys_trans_array );
+    for (i = 0; i < spec->num_egoals; i++)
+        delete_tree( *(spec->env_goals+i) );
+    if (spec->num_egoals > 0)
+        free( spec->env_goals );
+    for (i = 0; i < spec->num_sgoals; i++)
+        delete_tree( *(spec->sys_goals+i) );
+    if (spec->num_sgoals > 0)
+        free( spec->sys_goals );
+
+    if (ctx->manager != NULL) {
+        if (ctx->verbose > 1)
+            logprint( "Cudd_CheckZeroRef -> %d",
+                      Cudd_CheckZeroRef( ctx->manager ) );
+        Cudd_Quit( ctx->manager );
+    }
+    free( ctx );
+}
+
+
+int gr1c_ctx_load( gr1c_ctx_t *ctx, FILE *fp )
+{
+    specification_t *spec = &(ctx->spec);
+    int num_env, num_sys;
+
+    if (gr1c_parse( fp, spec, NULL ))
+        return 2;
+
+    if (check_gr1c_form( spec->evar_list, spec->svar_list,
+                         spec->env_init, spec->sys_init,
+                         spec->env_trans_array, spec->et_array_len,
+                         spec->sys_trans_array, spec->st_array_len,
+                         spec->env_goals, spec->num_egoals,
+                         spec->sys_goals, spec->num_sgoals,
+                         ctx->init_flags ) < 0)
+        return 2;
+
+    /* Omission implies empty. */
+    if (spec->et_array_len == 0) {
+        spec->et_array_len = 1;
+        spec->env_trans_array = malloc( sizeof(ptree_t *) );
+        if (spec->env_trans_array == NULL) {
+            perror( "gr1c_ctx_load, malloc" );
+            return -1;
+        }
+        *spec->env_trans_array = init_ptree( PT_CONSTANT, NULL, 1 );
+    }
+    if (spec->st_array_len == 0) {
+        spec->st_array_len = 1;
+        spec->sys_trans_array = malloc( sizeof(ptree_t *) );
+        if (spec->sys_trans_array == NULL) {
+            perror( "gr1c_ctx_load, malloc" );
+            return -1;
+        }
+        *spec->sys_trans_array = init_ptree( PT_CONSTANT, NULL, 1 );
+    }
+    if (spec->num_sgoals == 0) {
+        spec->num_sgoals = 1;
+        spec->sys_goals = malloc( sizeof(ptree_t *) );
+        if (spec->sys_goals == NULL) {
+            perror( "gr1c_ctx_load, malloc" );
+            return -1;
+        }
+        *spec->sys_goals = init_ptree( PT_CONSTANT, NULL, 1 );
+    }
+
+    if (expand_nonbool_GR1( spec->evar_list, spec->svar_list,
+                            &spec->env_init, &spec->sys_init,
+                            &spec->env_trans_array, &spec->et_array_len,
+                            &spec->sys_trans_array, &spec->st_array_len,
+                            &spec->env_goals, spec->num_egoals,
+                            &spec->sys_goals, spec->num_sgoals,
+                            ctx->init_flags, ctx->verbose ) < 0)
+        return -1;
+    spec->nonbool_var_list = expand_nonbool_variables( &spec->evar_list,
+                                                       &spec->svar_list,
+                                                       ctx->verbose );
+    spec->var_st = vars_symtab( spec->evar_list, spec->svar_list );
+
+    /* Merge component safety (transition) formulas */
+    if (spec->et_array_len > 1) {
+        spec->env_trans = merge_ptrees( spec->env_trans_array,
+                                        spec->et_array_len, PT_AND );
+    } else {
+        spec->env_trans = *spec->env_trans_array;
+    }
+    if (spec->st_array_len > 1) {
+        spec->sys_trans = merge_ptrees( spec->sys_trans_array,
+                                        spec->st_array_len, PT_AND );
+    } else {
+        spec->sys_trans = *spec->sys_trans_array;
+    }
+
+    num_env = tree_size( spec->evar_list );
+    num_sys = tree_size( spec->svar_list );
+
+    ctx->manager = Cudd_Init( 2*(num_env+num_sys),
+                              0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+    if (ctx->manager == NULL) {
+        fprintf( stderr, "Error gr1c_ctx_load: Cudd_Init failed.\n" );
+        return -1;
+    }
+    Cudd_SetMaxCacheHard( ctx->manager, (unsigned int)-1 );
+    Cudd_AutodynEnable( ctx->manager, CUDD_REORDER_SAME );
+
+    return 0;
+}
+
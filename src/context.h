@@ -0,0 +1,76 @@
+/** \file context.h
+ * \brief Solver contexts, for holding several specifications in one process.
+ *
+ * Solver functions, e.g., compute_winning_set() and synthesize(), read
+ * the specification through spc, which refers to the specification of
+ * the context that is bound in the calling thread by gr1c_ctx_bind().
+ * If no context is bound, then spc is a process-wide default, which is
+ * what the gr1c programs use.  Thus a process can hold several
+ * specifications, and different threads can solve different
+ * specifications concurrently, each in its own context (and hence with
+ * its own CUDD manager).
+ *
+ * The gr1c_ctx_ variants of solver functions (cf. solve.h) bind the
+ * given context for the duration of the call.  Any other solver
+ * function (e.g., from patching.h or solve_metric.h) can be used with
+ * a context by binding it first.
+ *
+ * N.B., options for logging (logging.h), checkpoints (checkpoint.h),
+ * and the result cache (resultcache.h) are process-wide.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "automaton.h"
+
+
+/** \brief A specification together with what is needed to solve it. */
+typedef struct {
+    specification_t spec;
+    DdManager *manager;  /**<\brief Created by gr1c_ctx_load(). */
+    unsigned char init_flags;
+    unsigned char synth_flags;  /**<\brief Cf. \ref SynthFlags */
+    unsigned char verbose;
+} gr1c_ctx_t;
+
+
+/** Return pointer to the specification that solver functions use in
+   the calling thread; cf. the description of context.h. */
+specification_t *gr1c_spec();
+
+/** The specification that solver functions use. */
+#define spc (*gr1c_spec())
+
+
+/** Create a context with an empty specification.  Return NULL on
+   error. */
+gr1c_ctx_t *gr1c_ctx_new( unsigned char init_flags, unsigned char synth_flags,
+                          unsigned char verbose );
+
+/** Free the specification and CUDD manager of the context, and then
+   the context itself.  The context should not be bound. */
+void gr1c_ctx_free( gr1c_ctx_t *ctx );
+
+/** Bind ctx in the calling thread, so that spc refers to its
+   specification.  If ctx is NULL, then the process-wide default is
+   used again.  Return the previously bound context, or NULL if there
+   was none. */
+gr1c_ctx_t *gr1c_ctx_bind( gr1c_ctx_t *ctx );
+
+/** Parse a GR(1) specification from fp (stdin if NULL) into the
+   context, and prepare it for solving as the gr1c program does: check
+   its form, expand nonboolean variables, merge transition rules, and
+   create the CUDD manager.  Return 0 on success, 2 if the specification
+   has errors, and -1 on other errors. */
+int gr1c_ctx_load( gr1c_ctx_t *ctx, FILE *fp );
+
+
+#endif
@@ -56,6 +56,14 @@ vartype *int_to_bitvec( int x, int vec_len );
 ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
                                    unsigned char verbose );
 
+/** Create the symbol table of the variables in evar_list followed by
+   those in svar_list, i.e., the variables of BDDs built by ptree_BDD()
+   when the two lists are chained together.  Call it after
+   expand_nonbool_variables(), and keep the result in the var_st field
+   of the specification, for use with ptree_BDD_symtab().  The lists
+   must not be changed while the table is in use. */
+symtab_t *vars_symtab( ptree_t *evar_list, ptree_t *svar_list );
+
 /** Return an array of length mapped_len where the nonboolean
    variables in given state array have been expanded according to
    their offsets and widths in offw.  Return NULL if error. */
@@ -76,6 +84,8 @@ int *get_offsets_list( ptree_t *evar_list, ptree_t *svar_list,
    unreachable values that result from nonbool expansion should be
    incorporated into initial conditions.  The _init trees are assumed
    to be well-formed given init_flags, as verified by check_gr1c_form().
+   Comparisons are not expanded into formulas over bits, but are
+   prepared by mark_nonbool() for direct encoding by ptree_BDD().
 
    \param verbose level of detail in logging; larger implies more detail. 0
    (zero) to be quiet. */
@@ -13,6 +13,7 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -27,9 +28,7 @@
 #include "solve.h"
 #include "solve_support.h"
 #include "logging.h"
-
-
-extern specification_t spc;
+#include "context.h"
 
 
 /***************************
@@ -46,6 +45,7 @@ extern specification_t spc;
 #define INTCOM_REWIN 11
 #define INTCOM_RELEVELS 12
 #define INTCOM_SYSNEXTA 13
+#define INTCOM_STATS 14
 /***************************/
 
 /* Help string */
@@ -69,6 +69,7 @@ extern specification_t spc;
     "printgoal GOALMODE\n" \
     "printegoals\n" \
     "enable (disable) autoreorder\n" \
+    "stats\n" \
     "quit"
 
 /**** Command arguments ****/
@@ -80,6 +81,70 @@ int intcom_index;  /* May be used to pass strategy goal mode or length
                       of intcom_state. */
 
 
+/* Answers to envnext, sysnext, and sysnexta commands, keyed by command,
+   state argument, and goal mode (only used by sysnext).  Entries are
+   valid for the transition BDDs and winning set that are referenced
+   here; querycache_sync() removes those that depend on any that changed. */
+#define QUERYCACHE_SLOTS 4096
+#define QUERYCACHE_MAX_ENTRIES 65536
+
+typedef struct querycache_entry_t {
+    int command;
+    int goal_mode;
+    vartype *state;
+    int state_len;
+    char *answer;  /* Output of the command, as printed */
+    struct querycache_entry_t *next;
+} querycache_entry_t;
+
+typedef struct {
+    querycache_entry_t **slots;
+    int num_entries;
+    int hits, misses;
+    DdNode *etrans, *strans, *W;
+} querycache_t;
+
+querycache_t *querycache_new();
+void querycache_free( DdManager *manager, querycache_t *qc );
+unsigned long querycache_hash( int command,
+                               vartype *state, int state_len, int goal_mode );
+
+/* Return the cached answer, or NULL if none.  Counts as hit or miss. */
+char *querycache_find( querycache_t *qc, int command,
+                       vartype *state, int state_len, int goal_mode );
+
+/* Add entry, which takes answer and a copy of state.  The key should
+   not already be present. */
+void querycache_insert( querycache_t *qc, int command,
+                        vartype *state, int state_len, int goal_mode,
+                        char *answer );
+
+/* Remove all entries of the given command, or all entries if command
+   is 0. */
+void querycache_flush( querycache_t *qc, int command );
+
+/* Remove entries that depend on any of etrans, strans, and W that
+   differ from those for which the cache is valid, and then make it
+   valid for these.  Because BDDs are canonical, comparing pointers
+   detects precisely whether the functions changed. */
+void querycache_sync( DdManager *manager, querycache_t *qc,
+                      DdNode *etrans, DdNode *strans, DdNode *W );
+
+
+/* Return the winning set for etrans and strans, given the winning set
+   W for the transitions *W_etrans and *W_strans, which are then
+   replaced by (references to) etrans and strans.  If the game only
+   became harder or only easier for the system since W was computed,
+   then the fixpoints are started from W; cf.
+   compute_winning_set_BDD_seeded().  W is dereferenced.  Return NULL
+   on error. */
+DdNode *update_winning_set( DdManager *manager, DdNode *W,
+                            DdNode **W_etrans, DdNode **W_strans,
+                            DdNode *etrans, DdNode *strans,
+                            DdNode **egoals, DdNode **sgoals,
+                            unsigned char verbose );
+
+
 char *fgets_wrap( char *prompt, int max_len, FILE *infp, FILE *outfp )
 {
     char *input;
@@ -190,11 +255,16 @@ int command_loop( DdManager *manager, FILE *infp, FILE *outfp )
                     var_index++;
                 }
             }
+        } else if (!strncmp( input, "stats", strlen( "stats" ) )) {
+            free( input );
+            return INTCOM_STATS;
         } else if (!strncmp( input, "refresh winning",
                              strlen( "refresh winning" ) )) {
+            free( input );
             return INTCOM_REWIN;
         } else if (!strncmp( input, "refresh levels",
                              strlen( "refresh levels" ) )) {
+            free( input );
             return INTCOM_RELEVELS;
         } else if (!strncmp( input, "printgoal ", strlen( "printgoal " ) )) {
 
@@ -401,6 +471,212 @@ int command_loop( DdManager *manager, FILE *infp, FILE *outfp )
 }
 
 
+DdNode *update_winning_set( DdManager *manager, DdNode *W,
+                            DdNode **W_etrans, DdNode **W_strans,
+                            DdNode *etrans, DdNode *strans,
+                            DdNode **egoals, DdNode **sgoals,
+                            unsigned char verbose )
+{
+    DdNode *new_W;
+    bool shrinking, growing;
+
+    if (etrans == *W_etrans && strans == *W_strans)
+        return W;
+
+    /* Removing system moves or adding environment moves can only
+       shrink the winning set, and conversely. */
+    shrinking = (Cudd_bddLeq( manager, strans, *W_strans )
+                 && Cudd_bddLeq( manager, *W_etrans, etrans ));
+    growing = (Cudd_bddLeq( manager, *W_strans, strans )
+               && Cudd_bddLeq( manager, etrans, *W_etrans ));
+    if (verbose > 1) {
+        if (shrinking) {
+            logprint( "Recomputing winning set, starting from the previous"
+                      " one as an upper bound." );
+        } else if (growing) {
+            logprint( "Recomputing winning set, starting from the previous"
+                      " one as a lower bound." );
+        } else {
+            logprint( "Recomputing winning set." );
+        }
+    }
+    new_W = compute_winning_set_BDD_seeded( manager, etrans, strans,
+                                            egoals, sgoals,
+                                            shrinking ? W : NULL,
+                                            growing ? W : NULL,
+                                            verbose );
+    Cudd_RecursiveDeref( manager, W );
+    if (new_W == NULL)
+        return NULL;
+
+    Cudd_RecursiveDeref( manager, *W_etrans );
+    Cudd_RecursiveDeref( manager, *W_strans );
+    *W_etrans = etrans;
+    Cudd_Ref( *W_etrans );
+    *W_strans = strans;
+    Cudd_Ref( *W_strans );
+    return new_W;
+}
+
+
+querycache_t *querycache_new()
+{
+    querycache_t *qc;
+    int slot;
+
+    qc = malloc( sizeof(querycache_t) );
+    if (qc == NULL) {
+        perror( "querycache_new, malloc" );
+        exit(-1);
+    }
+    qc->slots = malloc( QUERYCACHE_SLOTS*sizeof(querycache_entry_t *) );
+    if (qc->slots == NULL) {
+        perror( "querycache_new, malloc" );
+        exit(-1);
+    }
+    for (slot = 0; slot < QUERYCACHE_SLOTS; slot++)
+        *(qc->slots+slot) = NULL;
+    qc->num_entries = 0;
+    qc->hits = qc->misses = 0;
+    qc->etrans = qc->strans = qc->W = NULL;
+    return qc;
+}
+
+
+void querycache_free( DdManager *manager, querycache_t *qc )
+{
+    querycache_flush( qc, 0 );
+    if (qc->etrans != NULL)
+        Cudd_RecursiveDeref( manager, qc->etrans );
+    if (qc->strans != NULL)
+        Cudd_RecursiveDeref( manager, qc->strans );
+    if (qc->W != NULL)
+        Cudd_RecursiveDeref( manager, qc->W );
+    free( qc->slots );
+    free( qc );
+}
+
+
+unsigned long querycache_hash( int command,
+                               vartype *state, int state_len, int goal_mode )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    int i;
+    h = PTREE_HASH_STEP( h, (unsigned int)command );
+    h = PTREE_HASH_STEP( h, (unsigned int)goal_mode );
+    for (i = 0; i < state_len; i++)
+        h = PTREE_HASH_STEP( h, (unsigned int)*(state+i) );
+    return h;
+}
+
+
+char *querycache_find( querycache_t *qc, int command,
+                       vartype *state, int state_len, int goal_mode )
+{
+    querycache_entry_t *entry;
+
+    entry = *(qc->slots + querycache_hash( command, state, state_len,
+                                           goal_mode ) % QUERYCACHE_SLOTS);
+    while (entry != NULL) {
+        if (entry->command == command && entry->goal_mode == goal_mode
+            && entry->state_len == state_len
+            && statecmp( entry->state, state, state_len )) {
+            qc->hits++;
+            return entry->answer;
+        }
+        entry = entry->next;
+    }
+    qc->misses++;
+    return NULL;
+}
+
+
+void querycache_insert( querycache_t *qc, int command,
+                        vartype *state, int state_len, int goal_mode,
+                        char *answer )
+{
+    querycache_entry_t *entry;
+    int slot;
+
+    /* Bound memory use by starting over when full. */
+    if (qc->num_entries >= QUERYCACHE_MAX_ENTRIES)
+        querycache_flush( qc, 0 );
+
+    entry = malloc( sizeof(querycache_entry_t) );
+    if (entry == NULL) {
+        perror( "querycache_insert, malloc" );
+        exit(-1);
+    }
+    entry->state = malloc( state_len*sizeof(vartype) );
+    if (entry->state == NULL) {
+        perror( "querycache_insert, malloc" );
+        exit(-1);
+    }
+    memcpy( entry->state, state, state_len*sizeof(vartype) );
+    entry->command = command;
+    entry->goal_mode = goal_mode;
+    entry->state_len = state_len;
+    entry->answer = answer;
+
+    slot = querycache_hash( command, state, state_len, goal_mode )
+        % QUERYCACHE_SLOTS;
+    entry->next = *(qc->slots+slot);
+    *(qc->slots+slot) = entry;
+    qc->num_entries++;
+}
+
+
+void querycache_flush( querycache_t *qc, int command )
+{
+    querycache_entry_t **prev, *entry;
+    int slot;
+
+    for (slot = 0; slot < QUERYCACHE_SLOTS; slot++) {
+        prev = qc->slots+slot;
+        while (*prev != NULL) {
+            entry = *prev;
+            if (command == 0 || entry->command == command) {
+                *prev = entry->next;
+                free( entry->state );
+                free( entry->answer );
+                free( entry );
+                qc->num_entries--;
+            } else {
+                prev = &entry->next;
+            }
+        }
+    }
+}
+
+
+void querycache_sync( DdManager *manager, querycache_t *qc,
+                      DdNode *etrans, DdNode *strans, DdNode *W )
+{
+    if (qc->etrans != etrans) {
+        querycache_flush( qc, INTCOM_ENVNEXT );
+        if (qc->etrans != NULL)
+            Cudd_RecursiveDeref( manager, qc->etrans );
+        qc->etrans = etrans;
+        Cudd_Ref( qc->etrans );
+    }
+    if (qc->strans != strans) {
+        querycache_flush( qc, INTCOM_SYSNEXT );
+        querycache_flush( qc, INTCOM_SYSNEXTA );
+        if (qc->strans != NULL)
+            Cudd_RecursiveDeref( manager, qc->strans );
+        qc->strans = strans;
+        Cudd_Ref( qc->strans );
+    }
+    if (qc->W != W) {
+        querycache_flush( qc, INTCOM_SYSNEXT );
+        if (qc->W != NULL)
+            Cudd_RecursiveDeref( manager, qc->W );
+        qc->W = W;
+        Cudd_Ref( qc->W );
+    }
+}
+
+
 int levelset_interactive( DdManager *manager, unsigned char init_flags,
                           FILE *infp, FILE *outfp,
                           unsigned char verbose )
@@ -419,6 +695,15 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     DdNode *etrans_patched, *strans_patched;
     DdNode *vertex1, *vertex2; /* ...regarding vertices of the game graph. */
 
+    /* Transitions for which W was computed, and those as of the most
+       recent "refresh" commands that are still pending, or NULL.
+       Recomputation is deferred until W or the sublevel sets are
+       needed, so that any number of edits and refreshes between
+       queries costs one update. */
+    DdNode *W_etrans, *W_strans;
+    DdNode *rewin_etrans = NULL, *rewin_strans = NULL;
+    DdNode *relevels_etrans = NULL, *relevels_strans = NULL;
+
     DdNode *ddval;  /* Store result of evaluating a BDD */
     DdNode ***Y = NULL;
     DdNode *Y_i_primed;
@@ -433,6 +718,13 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     int *cube;  /* length will be twice total number of variables (to
                    account for both variables and their primes). */
 
+    /* Cache of answers to envnext, sysnext, and sysnexta */
+    querycache_t *qc;
+    FILE *ansfp = NULL;
+    char *answer;
+    size_t answer_len;
+    int query_len;
+
     /* Variables used during CUDD generation (state enumeration). */
     DdGen *gen;
     CUDD_VALUE_TYPE gvalue;
@@ -486,12 +778,12 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     /* Generate BDDs for the various parse trees from the problem spec. */
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
     if (verbose > 1)
         logprint( "Done." );
 
@@ -499,14 +791,16 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i),
+                                            spc.var_st, manager );
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *(sgoals+i) = ptree_BDD_symtab( *(spc.sys_goals+i),
+                                            spc.var_st, manager );
     } else {
         sgoals = NULL;
     }
@@ -532,30 +826,22 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
         free( cube );
         return -1;
     }
+    W_etrans = etrans;
+    Cudd_Ref( W_etrans );
+    W_strans = strans;
+    Cudd_Ref( W_strans );
+
+    qc = querycache_new();
 
     command = INTCOM_RELEVELS;  /* Initialization, force sublevel computation */
     do {
-        switch (command) {
-        case INTCOM_REWIN:
-            if (W != NULL)
-                Cudd_RecursiveDeref( manager, W );
-            W = compute_winning_set_BDD( manager,
-                                         etrans_patched, strans_patched,
-                                         egoals, sgoals, verbose );
-            if (W == NULL) {
-                fprintf( stderr,
-                         "Error levelset_interactive: failed to construct"
-                         " winning set.\n" );
-                return -1;
-            }
-            break;
-
-        case INTCOM_RELEVELS:
-            if (W != NULL)
-                Cudd_RecursiveDeref( manager, W );
-            W = compute_winning_set_BDD( manager,
-                                         etrans_patched, strans_patched,
-                                         egoals, sgoals, verbose );
+        /* Complete pending refreshes, if the result is needed. */
+        if ((command == INTCOM_WINNING || command == INTCOM_GETINDEX
+             || command == INTCOM_SYSNEXT)
+            && relevels_etrans != NULL) {
+            W = update_winning_set( manager, W, &W_etrans, &W_strans,
+                                    relevels_etrans, relevels_strans,
+                                    egoals, sgoals, verbose );
             if (W == NULL) {
                 fprintf( stderr,
                          "Error levelset_interactive: failed to construct"
@@ -564,18 +850,26 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
             }
             if (Y != NULL) {
                 for (i = 0; i < spc.num_sgoals; i++) {
-                    for (j = 0; j < *(num_sublevels+i); j++)
+                    for (j = 0; j < *(num_sublevels+i); j++) {
                         Cudd_RecursiveDeref( manager, *(*(Y+i)+j) );
-                    if (*(num_sublevels+i) > 0)
+                        for (r = 0; r < spc.num_egoals; r++)
+                            Cudd_RecursiveDeref( manager,
+                                                 *(*(*(X_ijr+i)+j)+r) );
+                        free( *(*(X_ijr+i)+j) );
+                    }
+                    if (*(num_sublevels+i) > 0) {
                         free( *(Y+i) );
+                        free( *(X_ijr+i) );
+                    }
                 }
                 if (spc.num_sgoals > 0) {
                     free( Y );
+                    free( X_ijr );
                     free( num_sublevels );
                 }
             }
             Y = compute_sublevel_sets( manager, W,
-                                       etrans_patched, strans_patched,
+                                       relevels_etrans, relevels_strans,
                                        egoals, spc.num_egoals,
                                        sgoals, spc.num_sgoals,
                                        &num_sublevels, &X_ijr, verbose );
@@ -585,6 +879,86 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
                          " sublevel sets.\n" );
                 return -1;
             }
+            Cudd_RecursiveDeref( manager, relevels_etrans );
+            Cudd_RecursiveDeref( manager, relevels_strans );
+            relevels_etrans = relevels_strans = NULL;
+            querycache_flush( qc, INTCOM_SYSNEXT );
+        }
+        if ((command == INTCOM_WINNING || command == INTCOM_GETINDEX
+             || command == INTCOM_SYSNEXT)
+            && rewin_etrans != NULL) {
+            W = update_winning_set( manager, W, &W_etrans, &W_strans,
+                                    rewin_etrans, rewin_strans,
+                                    egoals, sgoals, verbose );
+            if (W == NULL) {
+                fprintf( stderr,
+                         "Error levelset_interactive: failed to construct"
+                         " winning set.\n" );
+                return -1;
+            }
+            Cudd_RecursiveDeref( manager, rewin_etrans );
+            Cudd_RecursiveDeref( manager, rewin_strans );
+            rewin_etrans = rewin_strans = NULL;
+        }
+
+        /* Answer repeated queries from the cache, else capture the
+           answer to save it there. */
+        querycache_sync( manager, qc, etrans_patched, strans_patched, W );
+        if (command == INTCOM_ENVNEXT || command == INTCOM_SYSNEXT
+            || command == INTCOM_SYSNEXTA) {
+            if (command == INTCOM_ENVNEXT) {
+                query_len = num_env+num_sys;
+            } else {
+                query_len = 2*num_env+num_sys;
+            }
+            answer = querycache_find( qc, command, intcom_state, query_len,
+                                      (command == INTCOM_SYSNEXT)
+                                      ? intcom_index : 0 );
+            if (answer != NULL) {
+                fputs( answer, outfp );
+                free( intcom_state );
+                fflush( outfp );
+                continue;
+            }
+            ansfp = open_memstream( &answer, &answer_len );
+            if (ansfp == NULL) {
+                perror( "levelset_interactive, open_memstream" );
+                exit(-1);
+            }
+        }
+
+        switch (command) {
+        case INTCOM_STATS:
+            fprintf( outfp, "%d hits, %d misses, %d entries\n",
+                     qc->hits, qc->misses, qc->num_entries );
+            break;
+
+        case INTCOM_REWIN:
+            if (rewin_etrans != NULL) {
+                Cudd_RecursiveDeref( manager, rewin_etrans );
+                Cudd_RecursiveDeref( manager, rewin_strans );
+            }
+            rewin_etrans = etrans_patched;
+            Cudd_Ref( rewin_etrans );
+            rewin_strans = strans_patched;
+            Cudd_Ref( rewin_strans );
+            break;
+
+        case INTCOM_RELEVELS:
+            /* Supersedes any pending refresh of the winning set. */
+            if (rewin_etrans != NULL) {
+                Cudd_RecursiveDeref( manager, rewin_etrans );
+                Cudd_RecursiveDeref( manager, rewin_strans );
+                rewin_etrans = rewin_strans = NULL;
+            }
+            if (relevels_etrans != NULL) {
+                Cudd_RecursiveDeref( manager, relevels_etrans );
+                Cudd_RecursiveDeref( manager, relevels_strans );
+            }
+            relevels_etrans = etrans_patched;
+            Cudd_Ref( relevels_etrans );
+            relevels_strans = strans_patched;
+            Cudd_Ref( relevels_strans );
             break;
 
         case INTCOM_ENVNEXT:
@@ -592,21 +966,19 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
                 env_moves = get_env_moves( manager, cube, intcom_state,
                                            etrans_patched, num_env, num_sys,
                                            &emoves_len );
-                free( intcom_state );
             } else {
-                fprintf( outfp, "(none)\n" );
-                free( intcom_state );
+                fprintf( ansfp, "(none)\n" );
                 break;
             }
 
             for (i = 0; i < emoves_len; i++) {
                 if (num_env > 0)
-                    fprintf( outfp, "%d", **(env_moves+i) );
+                    fprintf( ansfp, "%d", **(env_moves+i) );
                 for (j = 1; j < num_env; j++)
-                    fprintf( outfp, " %d", *(*(env_moves+i)+j) );
-                fprintf( outfp, "\n" );
+                    fprintf( ansfp, " %d", *(*(env_moves+i)+j) );
+                fprintf( ansfp, "\n" );
             }
-            fprintf( outfp, "---\n" );
+            fprintf( ansfp, "---\n" );
 
             if (emoves_len > 0) {
                 for (i = 0; i < emoves_len; i++)
@@ -684,16 +1056,16 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
                 initialize_cube( state, gcube+2*num_env+num_sys, num_sys );
                 while (!saturated_cube( state, gcube+2*num_env+num_sys,
                                         num_sys )) {
-                    fprintf( outfp, "%d", *state );
+                    fprintf( ansfp, "%d", *state );
                     for (i = 1; i < num_sys; i++)
-                        fprintf( outfp, " %d", *(state+i) );
-                    fprintf( outfp, "\n" );
+                        fprintf( ansfp, " %d", *(state+i) );
+                    fprintf( ansfp, "\n" );
                     increment_cube( state, gcube+2*num_env+num_sys, num_sys );
                 }
-                fprintf( outfp, "%d", *state );
+                fprintf( ansfp, "%d", *state );
                 for (i = 1; i < num_sys; i++)
-                    fprintf( outfp, " %d", *(state+i) );
-                fprintf( outfp, "\n" );
+                    fprintf( ansfp, " %d", *(state+i) );
+                fprintf( ansfp, "\n" );
             }
             Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
             if (*state == -1) {
@@ -733,23 +1105,22 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
                     initialize_cube( state, gcube+2*num_env+num_sys, num_sys );
                     while (!saturated_cube( state, gcube+2*num_env+num_sys,
                                             num_sys )) {
-                        fprintf( outfp, "%d", *state );
+                        fprintf( ansfp, "%d", *state );
                         for (i = 1; i < num_sys; i++)
-                            fprintf( outfp, " %d", *(state+i) );
-                        fprintf( outfp, "\n" );
+                            fprintf( ansfp, " %d", *(state+i) );
+                        fprintf( ansfp, "\n" );
                         increment_cube( state, gcube+2*num_env+num_sys,
                                         num_sys );
                     }
-                    fprintf( outfp, "%d", *state );
+                    fprintf( ansfp, "%d", *state );
                     for (i = 1; i < num_sys; i++)
-                        fprintf( outfp, " %d", *(state+i) );
-                    fprintf( outfp, "\n" );
+                        fprintf( ansfp, " %d", *(state+i) );
+                    fprintf( ansfp, "\n" );
                 }
                 Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
             }
-            fprintf( outfp, "---\n" );
+            fprintf( ansfp, "---\n" );
 
-            free( intcom_state );
             Cudd_RecursiveDeref( manager, tmp );
             Cudd_RecursiveDeref( manager, Y_i_primed );
             Cudd_RecursiveDeref( manager, strans_into_W );
@@ -766,26 +1137,25 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
             } else {
                 tmp2 = tmp;
             }
-            free( intcom_state );
 
             Cudd_AutodynDisable( manager );
             Cudd_ForeachCube( manager, tmp2, gen, gcube, gvalue ) {
                 initialize_cube( state, gcube+2*num_env+num_sys, num_sys );
                 while (!saturated_cube( state, gcube+2*num_env+num_sys,
                                         num_sys )) {
-                    fprintf( outfp, "%d", *state );
+                    fprintf( ansfp, "%d", *state );
                     for (i = 1; i < num_sys; i++)
-                        fprintf( outfp, " %d", *(state+i) );
-                    fprintf( outfp, "\n" );
+                        fprintf( ansfp, " %d", *(state+i) );
+                    fprintf( ansfp, "\n" );
                     increment_cube( state, gcube+2*num_env+num_sys, num_sys );
                 }
-                fprintf( outfp, "%d", *state );
+                fprintf( ansfp, "%d", *state );
                 for (i = 1; i < num_sys; i++)
-                    fprintf( outfp, " %d", *(state+i) );
-                fprintf( outfp, "\n" );
+                    fprintf( ansfp, " %d", *(state+i) );
+                fprintf( ansfp, "\n" );
             }
             Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
-            fprintf( outfp, "---\n" );
+            fprintf( ansfp, "---\n" );
 
             Cudd_RecursiveDeref( manager, tmp2 );
             break;
@@ -954,12 +1324,33 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
             break;
         }
 
+        if (ansfp != NULL) {
+            fclose( ansfp );
+            ansfp = NULL;
+            fputs( answer, outfp );
+            querycache_insert( qc, command, intcom_state, query_len,
+                               (command == INTCOM_SYSNEXT) ? intcom_index : 0,
+                               answer );
+            free( intcom_state );
+        }
+
         fflush( outfp );
     } while ((command = command_loop( manager, infp, outfp )) > 0);
 
     /* Pre-exit clean-up */
+    querycache_free( manager, qc );
     Cudd_RecursiveDeref( manager, etrans_patched );
     Cudd_RecursiveDeref( manager, strans_patched );
+    if (rewin_etrans != NULL) {
+        Cudd_RecursiveDeref( manager, rewin_etrans );
+        Cudd_RecursiveDeref( manager, rewin_strans );
+    }
+    if (relevels_etrans != NULL) {
+        Cudd_RecursiveDeref( manager, relevels_etrans );
+        Cudd_RecursiveDeref( manager, relevels_strans );
+    }
+    Cudd_RecursiveDeref( manager, W_etrans );
+    Cudd_RecursiveDeref( manager, W_strans );
     Cudd_RecursiveDeref( manager, W );
     Cudd_RecursiveDeref( manager, etrans );
     Cudd_RecursiveDeref( manager, strans );
@@ -973,7 +1364,7 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
         free( sgoals );
     free( cube );
     free( state );
-    for (i = 0; i < spc.num_sgoals; i++) {
+    for (i = 0; Y != NULL && i < spc.num_sgoals; i++) {
         for (j = 0; j < *(num_sublevels+i); j++) {
             Cudd_RecursiveDeref( manager, *(*(Y+i)+j) );
             for (r = 0; r < spc.num_egoals; r++) {
@@ -991,7 +1382,7 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
         delete_tree( *spc.env_goals );
         free( spc.env_goals );
     }
-    if (spc.num_sgoals > 0) {
+    if (Y != NULL && spc.num_sgoals > 0) {
         free( Y );
         free( X_ijr );
         free( num_sublevels );
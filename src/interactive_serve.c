@@ -0,0 +1,1007 @@
+/* interactive_serve.c -- Batch protocol for queries of the winning set.
+ *                        Also consider interactive.c
+ *
+ * Clients send frames, each of which carries a sequence of queries, and
+ * receive one frame per request, in order, with the answers in the
+ * same order.  States are bit-packed, so that neither side parses
+ * text.  Several clients can be connected at once through a Unix
+ * domain socket; their requests are served one frame at a time, all
+ * against the same winning set.  The protocol is described in
+ * doc/interaction.md.
+ *
+ * The query for the next move of a strategy is answered as
+ * synthesize() would construct it, but only for the states that are
+ * actually queried, so that no strategy automaton is built.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ptree.h"
+#include "solve.h"
+#include "solve_support.h"
+#include "logging.h"
+#include "context.h"
+
+
+/*************
+ ** Queries **/
+#define SERVE_WINNING 'w'
+#define SERVE_ENVNEXT 'e'
+#define SERVE_SYSNEXTA 'a'
+#define SERVE_GETINDEX 'i'
+#define SERVE_STRATEGY 's'
+
+/* Status byte that precedes each answer */
+#define SERVE_OK 0
+#define SERVE_ERROR 1
+/*************/
+
+/* Frames that claim to be longer than this are rejected. */
+#define SERVE_MAX_FRAME (1 << 26)
+
+#define SERVE_MAX_CLIENTS 64
+#define SERVE_READ_LEN 65536
+
+#define MOVECACHE_SLOTS 4096
+#define MOVECACHE_MAX_ENTRIES 65536
+
+
+/* Growable byte array */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t size;
+} servebuf_t;
+
+/* Decision of the strategy for a state, environment move, and goal
+   mode, as made by serve_strategy_move() */
+typedef struct movecache_entry_t {
+    vartype *key;  /* State followed by environment move */
+    int goal_mode;
+    vartype *sys_move;
+    int next_mode;
+    struct movecache_entry_t *next;
+} movecache_entry_t;
+
+/* What is needed to answer queries */
+typedef struct {
+    DdManager *manager;
+    DdNode *W;
+    DdNode *etrans, *strans;
+    DdNode **egoals, **sgoals;
+    DdNode ***Y;  /* Sublevel sets; computed when first needed */
+    int *num_sublevels;
+
+    /* For strategy queries; computed when first needed */
+    DdNode *strans_into_W;
+    DdNode ***Ys;  /* Sublevel sets as shifted by synthesize() */
+    int *num_levels;
+    DdNode ****X_ijr;
+    movecache_entry_t **moves;  /* Decisions made so far */
+    int num_moves;
+    int move_hits, move_misses;
+
+    int num_env, num_sys;
+    int *cube;
+    vartype *state;  /* Work array, of length 2*(num_env+num_sys) */
+    vartype *query;  /* State and environment move of strategy query */
+    vartype *sys_move;
+    unsigned char verbose;
+} server_t;
+
+/* Set by the handler of SIGINT and SIGTERM */
+volatile sig_atomic_t serve_stop = 0;
+
+void serve_handle_signal( int signum );
+
+/* Append len bytes to buf, enlarging it as needed. */
+void servebuf_append( servebuf_t *buf, void *data, size_t len );
+
+/* Append integer x as 4 bytes, most significant first. */
+void servebuf_append_u32( servebuf_t *buf, unsigned int x );
+
+/* Append state vector of length len, packed with bit i of the state as
+   bit (i mod 8) of byte i/8. */
+void servebuf_append_state( servebuf_t *buf, vartype *state, int len );
+
+unsigned int read_u32( unsigned char *in );
+void unpack_state( unsigned char *in, vartype *state, int len );
+
+/* Number of bytes of a packed state of length len */
+#define PACKED_LEN(len) (((len)+7)/8)
+
+/* Answer the queries in the request of given length, appending the
+   answers to out.  Return 0 on success, or -1 if the request was
+   malformed or a query could not be answered because of an internal
+   error, in which case the answers to the queries that preceded the
+   error are followed by SERVE_ERROR. */
+int serve_request( server_t *sv, unsigned char *req, size_t len,
+                   servebuf_t *out );
+
+/* Append the number of possible next valuations of system variables in
+   the cofactor cof, and then each of them, packed. */
+void serve_sys_moves( server_t *sv, DdNode *cof, servebuf_t *out );
+
+/* Write all len bytes of data to fd.  Return 0 on success, -1 on error. */
+int write_all( int fd, unsigned char *data, size_t len );
+
+/* Find the next system move and goal mode from the state and
+   environment move in key (of length 2*num_env+num_sys) in goal mode
+   goal_mode, as synthesize() would, and write them into sys_move and
+   *next_mode.  Decisions are remembered in sv->moves.  Return 0 on
+   success, 1 if there is no such move (e.g., the state is not
+   winning), or -1 on error. */
+int serve_strategy_move( server_t *sv, vartype *key, int goal_mode,
+                         vartype *sys_move, int *next_mode );
+
+/* Return the index of the smallest of the sets sv->Ys that contains
+   the state in sv->cube, after advancing *goal_mode while the state is
+   in the goal of that mode, as synthesize() does for each node. */
+int serve_sublevel( server_t *sv, int *goal_mode );
+
+/* Return the conjunction of strans_into_W and the primed form of f
+   (or True if f is NULL), cofactored with respect to the state and
+   environment move in key; or NULL on error. */
+DdNode *serve_cof_moves( server_t *sv, DdNode *f, vartype *key );
+
+unsigned long movecache_hash( vartype *key, int key_len, int goal_mode );
+void movecache_flush( server_t *sv );
+
+/* Defined in solve.c */
+extern void shift_sublevel_sets( DdManager *manager, DdNode *W,
+                                 DdNode **sgoals,
+                                 int num_sgoals, int num_egoals,
+                                 DdNode ***Y, DdNode ****X_ijr,
+                                 int *num_sublevels, DdNode **Y_1 );
+
+
+void serve_handle_signal( int signum )
+{
+    serve_stop = 1;
+}
+
+
+void servebuf_append( servebuf_t *buf, void *data, size_t len )
+{
+    if (buf->len+len > buf->size) {
+        buf->size = 2*(buf->len+len);
+        buf->data = realloc( buf->data, buf->size );
+        if (buf->data == NULL) {
+            perror( "servebuf_append, realloc" );
+            exit(-1);
+        }
+    }
+    memcpy( buf->data+buf->len, data, len );
+    buf->len += len;
+}
+
+
+void servebuf_append_u32( servebuf_t *buf, unsigned int x )
+{
+    unsigned char bytes[4];
+    bytes[0] = (x >> 24) & 0xff;
+    bytes[1] = (x >> 16) & 0xff;
+    bytes[2] = (x >> 8) & 0xff;
+    bytes[3] = x & 0xff;
+    servebuf_append( buf, bytes, 4 );
+}
+
+
+void servebuf_append_state( servebuf_t *buf, vartype *state, int len )
+{
+    unsigned char byte = 0;
+    int i;
+    for (i = 0; i < len; i++) {
+        if (*(state+i))
+            byte |= 1 << (i%8);
+        if (i%8 == 7 || i == len-1) {
+            servebuf_append( buf, &byte, 1 );
+            byte = 0;
+        }
+    }
+}
+
+
+unsigned int read_u32( unsigned char *in )
+{
+    return ((unsigned int)*in << 24) | ((unsigned int)*(in+1) << 16)
+        | ((unsigned int)*(in+2) << 8) | (unsigned int)*(in+3);
+}
+
+
+void unpack_state( unsigned char *in, vartype *state, int len )
+{
+    int i;
+    for (i = 0; i < len; i++)
+        *(state+i) = (*(in+i/8) >> (i%8)) & 1;
+}
+
+
+int write_all( int fd, unsigned char *data, size_t len )
+{
+    ssize_t written;
+    while (len > 0) {
+        written = write( fd, data, len );
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        len -= written;
+    }
+    return 0;
+}
+
+
+void serve_sys_moves( server_t *sv, DdNode *cof, servebuf_t *out )
+{
+    DdGen *gen;
+    CUDD_VALUE_TYPE gvalue;
+    int *gcube;
+    size_t count_pos;
+    unsigned int count = 0;
+    unsigned char bytes[4];
+    int num_env = sv->num_env, num_sys = sv->num_sys;
+
+    count_pos = out->len;
+    servebuf_append_u32( out, 0 );  /* Filled in below */
+
+    Cudd_AutodynDisable( sv->manager );
+    Cudd_ForeachCube( sv->manager, cof, gen, gcube, gvalue ) {
+        initialize_cube( sv->state, gcube+2*num_env+num_sys, num_sys );
+        while (!saturated_cube( sv->state, gcube+2*num_env+num_sys,
+                                num_sys )) {
+            servebuf_append_state( out, sv->state, num_sys );
+            count++;
+            increment_cube( sv->state, gcube+2*num_env+num_sys, num_sys );
+        }
+        servebuf_append_state( out, sv->state, num_sys );
+        count++;
+    }
+    Cudd_AutodynEnable( sv->manager, CUDD_REORDER_SAME );
+
+    bytes[0] = (count >> 24) & 0xff;
+    bytes[1] = (count >> 16) & 0xff;
+    bytes[2] = (count >> 8) & 0xff;
+    bytes[3] = count & 0xff;
+    memcpy( out->data+count_pos, bytes, 4 );
+}
+
+
+unsigned long movecache_hash( vartype *key, int key_len, int goal_mode )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    int i;
+    h = PTREE_HASH_STEP( h, (unsigned int)goal_mode );
+    for (i = 0; i < key_len; i++)
+        h = PTREE_HASH_STEP( h, (unsigned int)*(key+i) );
+    return h;
+}
+
+
+void movecache_flush( server_t *sv )
+{
+    movecache_entry_t *entry;
+    int slot;
+
+    for (slot = 0; slot < MOVECACHE_SLOTS; slot++) {
+        while (*(sv->moves+slot) != NULL) {
+            entry = *(sv->moves+slot);
+            *(sv->moves+slot) = entry->next;
+            free( entry->key );
+            free( entry->sys_move );
+            free( entry );
+        }
+    }
+    sv->num_moves = 0;
+}
+
+
+DdNode *serve_cof_moves( server_t *sv, DdNode *f, vartype *key )
+{
+    int num_env = sv->num_env, num_sys = sv->num_sys;
+    DdNode *f_primed, *tmp, *tmp2;
+
+    if (f == NULL) {
+        f_primed = Cudd_ReadOne( sv->manager );
+    } else {
+        f_primed = Cudd_bddVarMap( sv->manager, f );
+        if (f_primed == NULL) {
+            fprintf( stderr,
+                     "Error serve_cof_moves: Error in swapping variables"
+                     " with primed forms.\n" );
+            return NULL;
+        }
+    }
+    Cudd_Ref( f_primed );
+    tmp = Cudd_bddAnd( sv->manager, sv->strans_into_W, f_primed );
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( sv->manager, f_primed );
+    tmp2 = state_to_cof( sv->manager, sv->cube, 2*(num_env+num_sys),
+                         key, tmp, 0, num_env+num_sys );
+    Cudd_RecursiveDeref( sv->manager, tmp );
+    if (num_env > 0) {
+        tmp = state_to_cof( sv->manager, sv->cube, 2*(num_env+num_sys),
+                            key+num_env+num_sys, tmp2,
+                            num_env+num_sys, num_env );
+        Cudd_RecursiveDeref( sv->manager, tmp2 );
+    } else {
+        tmp = tmp2;
+    }
+    return tmp;
+}
+
+
+int serve_sublevel( server_t *sv, int *goal_mode )
+{
+    DdNode *ddval;
+    int loop_mode = *goal_mode;
+    int j;
+
+    do {
+        j = *(sv->num_levels+*goal_mode);
+        do {
+            j--;
+            ddval = Cudd_Eval( sv->manager, *(*(sv->Ys+*goal_mode)+j),
+                               sv->cube );
+            if (Cudd_IsComplement( ddval )) {
+                j++;
+                break;
+            }
+        } while (j > 0);
+        if (j == 0) {
+            *goal_mode = (*goal_mode+1) % spc.num_sgoals;
+        } else {
+            break;
+        }
+    } while (loop_mode != *goal_mode);
+    return j;
+}
+
+int serve_strategy_move( server_t *sv, vartype *key, int goal_mode,
+                         vartype *sys_move, int *next_mode )
+{
+    DdManager *manager = sv->manager;
+    int num_env = sv->num_env, num_sys = sv->num_sys;
+    int key_len = 2*num_env+num_sys;
+    movecache_entry_t *entry;
+    DdNode *ddval, *tmp, *tmp2;
+    DdNode **X_j;
+    int query_mode = goal_mode;
+    int slot, offset, i, j, r;
+
+    /* Variables used during CUDD generation (state enumeration). */
+    DdGen *gen;
+    CUDD_VALUE_TYPE gvalue;
+    int *gcube;
+
+    slot = movecache_hash( key, key_len, goal_mode ) % MOVECACHE_SLOTS;
+    for (entry = *(sv->moves+slot); entry != NULL; entry = entry->next) {
+        if (entry->goal_mode == goal_mode
+            && statecmp( entry->key, key, key_len )) {
+            sv->move_hits++;
+            for (i = 0; i < num_sys; i++)
+                *(sys_move+i) = *(entry->sys_move+i);
+            *next_mode = entry->next_mode;
+            return 0;
+        }
+    }
+    sv->move_misses++;
+
+    if (sv->Ys == NULL) {
+        if (sv->verbose > 1)
+            logprint( "Computing sublevel sets for strategy queries..." );
+        sv->Ys = compute_sublevel_sets( manager, sv->W,
+                                        sv->etrans, sv->strans,
+                                        sv->egoals, spc.num_egoals,
+                                        sv->sgoals, spc.num_sgoals,
+                                        &sv->num_levels, &sv->X_ijr,
+                                        sv->verbose );
+        if (sv->Ys == NULL) {
+            fprintf( stderr,
+                     "Error serve_strategy_move: failed to construct"
+                     " sublevel sets.\n" );
+            return -1;
+        }
+        shift_sublevel_sets( manager, sv->W, sv->sgoals,
+                             spc.num_sgoals, spc.num_egoals,
+                             sv->Ys, sv->X_ijr, sv->num_levels, NULL );
+
+        /* The variable map was defined by compute_winning_set_BDD(). */
+        tmp = Cudd_bddVarMap( manager, sv->W );
+        if (tmp == NULL) {
+            fprintf( stderr,
+                     "Error serve_strategy_move: Error in swapping"
+                     " variables with primed forms.\n" );
+            return -1;
+        }
+        Cudd_Ref( tmp );
+        sv->strans_into_W = Cudd_bddAnd( manager, sv->strans, tmp );
+        Cudd_Ref( sv->strans_into_W );
+        Cudd_RecursiveDeref( manager, tmp );
+    }
+
+    for (i = 0; i < 2*(num_env+num_sys); i++)
+        *(sv->cube+i) = 0;
+    state_to_cube( key, sv->cube, num_env+num_sys );
+    ddval = Cudd_Eval( manager, sv->W, sv->cube );
+    if (Cudd_IsComplement( ddval ))
+        return 1;
+
+    /* The environment move must be admissible, as it would be among
+       those from get_env_moves() in synthesize(). */
+    if (num_env > 0) {
+        tmp = state_to_cof( manager, sv->cube, 2*(num_env+num_sys),
+                            key, sv->etrans, 0, num_env+num_sys );
+        tmp2 = state_to_cof( manager, sv->cube, 2*(num_env+num_sys),
+                             key+num_env+num_sys, tmp,
+                             num_env+num_sys, num_env );
+        Cudd_RecursiveDeref( manager, tmp );
+        if (tmp2 == Cudd_Not( Cudd_ReadOne( manager ) )) {
+            Cudd_RecursiveDeref( manager, tmp2 );
+            return 1;
+        }
+        Cudd_RecursiveDeref( manager, tmp2 );
+        for (i = 0; i < 2*(num_env+num_sys); i++)
+            *(sv->cube+i) = 0;
+        state_to_cube( key, sv->cube, num_env+num_sys );
+    }
+
+    j = serve_sublevel( sv, &goal_mode );
+
+    if (j == 0) {
+        tmp = serve_cof_moves( sv, **(sv->Ys+goal_mode), key );
+    } else {
+        tmp = serve_cof_moves( sv, *(*(sv->Ys+goal_mode)+j-1), key );
+    }
+    if (tmp == NULL)
+        return -1;
+    if (tmp == Cudd_Not( Cudd_ReadOne( manager ) )) {
+        /* Cannot step closer to system goal, so must be in goal state
+           or able to block environment goal. */
+        if (j > 0) {
+            for (offset = 1; offset >= 0; offset--) {
+                X_j = *(*(sv->X_ijr+goal_mode)+j - offset);
+                for (r = 0; r < spc.num_egoals; r++) {
+                    Cudd_RecursiveDeref( manager, tmp );
+                    tmp = serve_cof_moves( sv, *(X_j+r), key );
+                    if (tmp == NULL)
+                        return -1;
+                    if (tmp != Cudd_Not( Cudd_ReadOne( manager ) ))
+                        break;
+                }
+                if (r < spc.num_egoals)
+                    break;
+            }
+        } else {
+            Cudd_RecursiveDeref( manager, tmp );
+            tmp = serve_cof_moves( sv, NULL, key );
+            if (tmp == NULL)
+                return -1;
+        }
+        if (tmp == Cudd_Not( Cudd_ReadOne( manager ) )) {
+            Cudd_RecursiveDeref( manager, tmp );
+            return 1;
+        }
+    }
+
+    Cudd_AutodynDisable( manager );
+    gen = Cudd_FirstCube( manager, tmp, &gcube, &gvalue );
+    if (gen == NULL) {
+        fprintf( stderr, "Error serve_strategy_move: failed to find cube.\n" );
+        Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
+        Cudd_RecursiveDeref( manager, tmp );
+        return -1;
+    }
+    initialize_cube( sv->state, gcube+num_env+num_sys, num_env+num_sys );
+    Cudd_GenFree( gen );
+    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
+    Cudd_RecursiveDeref( manager, tmp );
+    for (i = 0; i < num_env; i++)
+        *(sv->state+i) = *(key+num_env+num_sys+i);
+    for (i = 0; i < num_sys; i++)
+        *(sys_move+i) = *(sv->state+num_env+i);
+
+    /* Label the next state with the goal mode of its node in the
+       strategy from synthesize(). */
+    state_to_cube( sv->state, sv->cube, num_env+num_sys );
+    ddval = Cudd_Eval( manager, **(sv->Ys+goal_mode), sv->cube );
+    if (Cudd_IsComplement( ddval )) {
+        *next_mode = goal_mode;
+    } else {
+        *next_mode = (goal_mode+1) % spc.num_sgoals;
+    }
+    serve_sublevel( sv, next_mode );
+
+    /* Bound memory use by starting over when full. */
+    if (sv->num_moves >= MOVECACHE_MAX_ENTRIES)
+        movecache_flush( sv );
+    entry = malloc( sizeof(movecache_entry_t) );
+    if (entry == NULL) {
+        perror( "serve_strategy_move, malloc" );
+        exit(-1);
+    }
+    entry->key = malloc( key_len*sizeof(vartype) );
+    entry->sys_move = malloc( num_sys*sizeof(vartype) );
+    if (entry->key == NULL || (num_sys > 0 && entry->sys_move == NULL)) {
+        perror( "serve_strategy_move, malloc" );
+        exit(-1);
+    }
+    memcpy( entry->key, key, key_len*sizeof(vartype) );
+    memcpy( entry->sys_move, sys_move, num_sys*sizeof(vartype) );
+    entry->goal_mode = query_mode;
+    entry->next_mode = *next_mode;
+    entry->next = *(sv->moves+slot);
+    *(sv->moves+slot) = entry;
+    sv->num_moves++;
+    return 0;
+}
+
+
+int serve_request( server_t *sv, unsigned char *req, size_t len,
+                   servebuf_t *out )
+{
+    int num_env = sv->num_env, num_sys = sv->num_sys;
+    size_t state_len = PACKED_LEN(num_env+num_sys);
+    size_t pos = 0;
+    unsigned char status, answer;
+    vartype **env_moves;
+    int emoves_len;
+    DdNode *ddval, *tmp, *tmp2;
+    int goal_mode, next_mode, i, j;
+
+    while (pos < len) {
+        switch (*(req+pos)) {
+        case SERVE_WINNING:
+            if (pos+1+state_len > len)
+                goto failed;
+            unpack_state( req+pos+1, sv->state, num_env+num_sys );
+            pos += 1+state_len;
+            state_to_cube( sv->state, sv->cube, num_env+num_sys );
+            ddval = Cudd_Eval( sv->manager, sv->W, sv->cube );
+            status = SERVE_OK;
+            answer = Cudd_IsComplement( ddval ) ? 0 : 1;
+            servebuf_append( out, &status, 1 );
+            servebuf_append( out, &answer, 1 );
+            break;
+
+        case SERVE_ENVNEXT:
+            if (pos+1+state_len > len)
+                goto failed;
+            unpack_state( req+pos+1, sv->state, num_env+num_sys );
+            pos += 1+state_len;
+            status = SERVE_OK;
+            servebuf_append( out, &status, 1 );
+            if (num_env == 0) {
+                servebuf_append_u32( out, 0 );
+                break;
+            }
+            env_moves = get_env_moves( sv->manager, sv->cube, sv->state,
+                                       sv->etrans, num_env, num_sys,
+                                       &emoves_len );
+            servebuf_append_u32( out, emoves_len );
+            for (i = 0; i < emoves_len; i++) {
+                servebuf_append_state( out, *(env_moves+i), num_env );
+                free( *(env_moves+i) );
+            }
+            if (emoves_len > 0)
+                free( env_moves );
+            break;
+
+        case SERVE_SYSNEXTA:
+            if (pos+1+state_len+PACKED_LEN(num_env) > len)
+                goto failed;
+            unpack_state( req+pos+1, sv->state, num_env+num_sys );
+            unpack_state( req+pos+1+state_len, sv->state+num_env+num_sys,
+                          num_env );
+            pos += 1+state_len+PACKED_LEN(num_env);
+            tmp = state_to_cof( sv->manager, sv->cube, 2*(num_env+num_sys),
+                                sv->state, sv->strans, 0, num_env+num_sys );
+            if (num_env > 0) {
+                tmp2 = state_to_cof( sv->manager, sv->cube,
+                                     2*(num_env+num_sys),
+                                     sv->state+num_env+num_sys,
+                                     tmp, num_env+num_sys, num_env );
+                Cudd_RecursiveDeref( sv->manager, tmp );
+            } else {
+                tmp2 = tmp;
+            }
+            status = SERVE_OK;
+            servebuf_append( out, &status, 1 );
+            serve_sys_moves( sv, tmp2, out );
+            Cudd_RecursiveDeref( sv->manager, tmp2 );
+            break;
+
+        case SERVE_GETINDEX:
+            if (pos+1+state_len+4 > len)
+                goto failed;
+            unpack_state( req+pos+1, sv->state, num_env+num_sys );
+            goal_mode = read_u32( req+pos+1+state_len );
+            pos += 1+state_len+4;
+            if (goal_mode < 0 || goal_mode >= spc.num_sgoals) {
+                status = SERVE_ERROR;
+                servebuf_append( out, &status, 1 );
+                break;
+            }
+            if (sv->Y == NULL) {
+                if (sv->verbose > 1)
+                    logprint( "Computing sublevel sets..." );
+                sv->Y = compute_sublevel_sets( sv->manager, sv->W,
+                                               sv->etrans, sv->strans,
+                                               sv->egoals, spc.num_egoals,
+                                               sv->sgoals, spc.num_sgoals,
+                                               &sv->num_sublevels, NULL,
+                                               sv->verbose );
+                if (sv->Y == NULL) {
+                    fprintf( stderr,
+                             "Error serve_request: failed to construct"
+                             " sublevel sets.\n" );
+                    goto failed;
+                }
+            }
+            state_to_cube( sv->state, sv->cube, num_env+num_sys );
+            status = SERVE_OK;
+            servebuf_append( out, &status, 1 );
+            ddval = Cudd_Eval( sv->manager, sv->W, sv->cube );
+            if (Cudd_IsComplement( ddval )) {
+                servebuf_append_u32( out, 0xffffffff );  /* Inf */
+                break;
+            }
+            j = *(sv->num_sublevels+goal_mode);
+            do {
+                j--;
+                ddval = Cudd_Eval( sv->manager, *(*(sv->Y+goal_mode)+j),
+                                   sv->cube );
+                if (Cudd_IsComplement( ddval )) {
+                    j++;
+                    break;
+                }
+            } while (j > 0);
+            servebuf_append_u32( out, j );
+            break;
+
+        case SERVE_STRATEGY:
+            if (pos+1+state_len+PACKED_LEN(num_env)+4 > len)
+                goto failed;
+            unpack_state( req+pos+1, sv->state, num_env+num_sys );
+            unpack_state( req+pos+1+state_len, sv->state+num_env+num_sys,
+                          num_env );
+            goal_mode = read_u32( req+pos+1+state_len+PACKED_LEN(num_env) );
+            pos += 1+state_len+PACKED_LEN(num_env)+4;
+            if (goal_mode < 0 || goal_mode >= spc.num_sgoals) {
+                status = SERVE_ERROR;
+                servebuf_append( out, &status, 1 );
+                break;
+            }
+            for (i = 0; i < 2*num_env+num_sys; i++)
+                *(sv->query+i) = *(sv->state+i);
+            i = serve_strategy_move( sv, sv->query, goal_mode,
+                                     sv->sys_move, &next_mode );
+            if (i < 0)
+                goto failed;
+            if (i > 0) {
+                status = SERVE_ERROR;
+                servebuf_append( out, &status, 1 );
+                break;
+            }
+            status = SERVE_OK;
+            servebuf_append( out, &status, 1 );
+            servebuf_append_state( out, sv->sys_move, num_sys );
+            servebuf_append_u32( out, next_mode );
+            break;
+
+        default:
+            goto failed;
+        }
+    }
+    return 0;
+
+  failed:
+    status = SERVE_ERROR;
+    servebuf_append( out, &status, 1 );
+    return -1;
+}
+
+
+int levelset_serve( DdManager *manager, char *socket_path,
+                    unsigned char verbose )
+{
+    server_t sv;
+    ptree_t *var_separator;
+    bool env_nogoal_flag = False;
+    servebuf_t in[SERVE_MAX_CLIENTS+1], out;  /* in[i] is input from fds[i] */
+    struct pollfd fds[SERVE_MAX_CLIENTS+1];
+    int num_fds;
+    int listen_fd = -1, out_fd;
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    unsigned char readbuf[SERVE_READ_LEN];
+    ssize_t num_read;
+    unsigned int frame_len;
+    int result = 1;
+    int i, j, k;
+
+    if (spc.num_egoals == 0) {
+        env_nogoal_flag = True;
+        spc.num_egoals = 1;
+        spc.env_goals = malloc( sizeof(ptree_t *) );
+        *spc.env_goals = init_ptree( PT_CONSTANT, NULL, 1 );
+    }
+
+    sv.manager = manager;
+    sv.verbose = verbose;
+    sv.num_env = tree_size( spc.evar_list );
+    sv.num_sys = tree_size( spc.svar_list );
+    sv.Y = NULL;
+    sv.num_sublevels = NULL;
+    sv.strans_into_W = NULL;
+    sv.Ys = NULL;
+    sv.num_levels = NULL;
+    sv.X_ijr = NULL;
+    sv.num_moves = sv.move_hits = sv.move_misses = 0;
+    sv.moves = calloc( MOVECACHE_SLOTS, sizeof(movecache_entry_t *) );
+    sv.state = malloc( 2*(sv.num_env+sv.num_sys)*sizeof(vartype) );
+    sv.query = malloc( 2*(sv.num_env+sv.num_sys)*sizeof(vartype) );
+    sv.sys_move = malloc( (sv.num_sys+1)*sizeof(vartype) );
+    sv.cube = malloc( 2*(sv.num_env+sv.num_sys)*sizeof(int) );
+    if (sv.state == NULL || sv.query == NULL || sv.sys_move == NULL
+        || sv.moves == NULL || sv.cube == NULL) {
+        perror( "levelset_serve, malloc" );
+        exit(-1);
+    }
+
+    /* Chain together environment and system variable lists for
+       working with BDD library. */
+    if (spc.evar_list == NULL) {
+        var_separator = NULL;
+        spc.evar_list = spc.svar_list;  /* that this is the deterministic case
+                                           is indicated by var_separator = NULL. */
+    } else {
+        var_separator = get_list_item( spc.evar_list, -1 );
+        if (var_separator == NULL) {
+            fprintf( stderr,
+                     "Error: get_list_item failed on environment variables"
+                     " list.\n" );
+            free( sv.state );
+            free( sv.query );
+            free( sv.sys_move );
+            free( sv.moves );
+            free( sv.cube );
+            return -1;
+        }
+        var_separator->left = spc.svar_list;
+    }
+
+    sv.etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
+    sv.strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
+    sv.egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
+    for (i = 0; i < spc.num_egoals; i++)
+        *(sv.egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i), spc.var_st,
+                                           manager );
+    if (spc.num_sgoals > 0) {
+        sv.sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
+        for (i = 0; i < spc.num_sgoals; i++)
+            *(sv.sgoals+i) = ptree_BDD_symtab( *(spc.sys_goals+i), spc.var_st,
+                                               manager );
+    } else {
+        sv.sgoals = NULL;
+    }
+
+    if (var_separator == NULL) {
+        spc.evar_list = NULL;
+    } else {
+        var_separator->left = NULL;
+    }
+
+    sv.W = compute_winning_set_BDD( manager, sv.etrans, sv.strans,
+                                    sv.egoals, sv.sgoals, verbose );
+    if (sv.W == NULL) {
+        fprintf( stderr,
+                 "Error levelset_serve: failed to construct winning set.\n" );
+        return -1;
+    }
+
+    /* Clients; for stdin, answers go to stdout. */
+    if (socket_path == NULL) {
+        listen_fd = -1;
+        fds[0].fd = STDIN_FILENO;
+    } else {
+        if (strlen( socket_path ) >= sizeof(addr.sun_path)) {
+            fprintf( stderr,
+                     "Error levelset_serve: socket path is too long.\n" );
+            return -1;
+        }
+        listen_fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+        if (listen_fd < 0) {
+            perror( "levelset_serve, socket" );
+            return -1;
+        }
+        memset( &addr, 0, sizeof(addr) );
+        addr.sun_family = AF_UNIX;
+        strcpy( addr.sun_path, socket_path );
+        if (bind( listen_fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0
+            || listen( listen_fd, SERVE_MAX_CLIENTS ) < 0) {
+            perror( "levelset_serve, bind" );
+            close( listen_fd );
+            return -1;
+        }
+        fds[0].fd = listen_fd;
+        if (verbose)
+            logprint( "Listening on %s", socket_path );
+    }
+    fds[0].events = POLLIN;
+    num_fds = 1;
+    for (i = 0; i < SERVE_MAX_CLIENTS+1; i++) {
+        in[i].data = NULL;
+        in[i].len = in[i].size = 0;
+    }
+    out.data = NULL;
+    out.len = out.size = 0;
+
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = serve_handle_signal;
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+    sa.sa_handler = SIG_IGN;
+    sigaction( SIGPIPE, &sa, NULL );  /* Detect closed clients by EPIPE */
+
+    while (!serve_stop && num_fds > 0) {
+        if (poll( fds, num_fds, -1 ) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror( "levelset_serve, poll" );
+            result = -1;
+            break;
+        }
+
+        if (listen_fd >= 0 && (fds[0].revents & POLLIN)) {
+            k = accept( listen_fd, NULL, NULL );
+            if (k >= 0) {
+                if (num_fds-1 >= SERVE_MAX_CLIENTS) {
+                    /* fds[0] is the listening socket. */
+                    close( k );
+                } else {
+                    fds[num_fds].fd = k;
+                    fds[num_fds].events = POLLIN;
+                    fds[num_fds].revents = 0;
+                    num_fds++;
+                }
+            }
+        }
+
+        for (i = (listen_fd >= 0 ? 1 : 0); i < num_fds; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            out_fd = (listen_fd >= 0) ? fds[i].fd : STDOUT_FILENO;
+
+            num_read = read( fds[i].fd, readbuf, SERVE_READ_LEN );
+            if (num_read > 0)
+                servebuf_append( in+i, readbuf, num_read );
+
+            /* Answer each complete frame, in order. */
+            j = 0;
+            while (num_read > 0 && in[i].len-j >= 4) {
+                frame_len = read_u32( in[i].data+j );
+                if (frame_len > SERVE_MAX_FRAME) {
+                    fprintf( stderr,
+                             "Warning: closing client that sent frame of"
+                             " length %u.\n", frame_len );
+                    num_read = 0;
+                    break;
+                }
+                if (in[i].len-j-4 < frame_len)
+                    break;
+                out.len = 0;
+                servebuf_append_u32( &out, 0 );  /* Filled in below */
+                if (serve_request( &sv, in[i].data+j+4, frame_len, &out )
+                    < 0 && sv.verbose)
+                    logprint( "Failed to answer request from client %d", i );
+                *out.data = ((out.len-4) >> 24) & 0xff;
+                *(out.data+1) = ((out.len-4) >> 16) & 0xff;
+                *(out.data+2) = ((out.len-4) >> 8) & 0xff;
+                *(out.data+3) = (out.len-4) & 0xff;
+                if (write_all( out_fd, out.data, out.len )) {
+                    num_read = 0;
+                    break;
+                }
+                j += 4+frame_len;
+            }
+            if (num_read > 0) {
+                memmove( in[i].data, in[i].data+j, in[i].len-j );
+                in[i].len -= j;
+            } else if (num_read == 0
+                       || (errno != EINTR && errno != EAGAIN)) {
+                /* End of input, or error; drop the client. */
+                if (listen_fd >= 0)
+                    close( fds[i].fd );
+                free( in[i].data );
+                for (k = i; k < num_fds-1; k++) {
+                    fds[k] = fds[k+1];
+                    in[k] = in[k+1];
+                }
+                num_fds--;
+                in[num_fds].data = NULL;
+                in[num_fds].len = in[num_fds].size = 0;
+                i--;
+            }
+        }
+    }
+
+    /* Pre-exit clean-up */
+    for (i = (listen_fd >= 0 ? 1 : 0); i < num_fds; i++) {
+        if (listen_fd >= 0)
+            close( fds[i].fd );
+        free( in[i].data );
+    }
+    free( out.data );
+    if (listen_fd >= 0) {
+        close( listen_fd );
+        unlink( socket_path );
+    }
+    if (sv.Y != NULL) {
+        for (i = 0; i < spc.num_sgoals; i++) {
+            for (j = 0; j < *(sv.num_sublevels+i); j++)
+                Cudd_RecursiveDeref( manager, *(*(sv.Y+i)+j) );
+            if (*(sv.num_sublevels+i) > 0)
+                free( *(sv.Y+i) );
+        }
+        free( sv.Y );
+        free( sv.num_sublevels );
+    }
+    if (sv.Ys != NULL) {
+        if (verbose > 1)
+            logprint( "Strategy moves were found in cache for %d of %d"
+                      " queries.", sv.move_hits,
+                      sv.move_hits + sv.move_misses );
+        for (i = 0; i < spc.num_sgoals; i++) {
+            for (j = 0; j < *(sv.num_levels+i); j++) {
+                Cudd_RecursiveDeref( manager, *(*(sv.Ys+i)+j) );
+                for (k = 0; k < spc.num_egoals; k++)
+                    Cudd_RecursiveDeref( manager, *(*(*(sv.X_ijr+i)+j)+k) );
+                free( *(*(sv.X_ijr+i)+j) );
+            }
+            free( *(sv.Ys+i) );
+            free( *(sv.X_ijr+i) );
+        }
+        free( sv.Ys );
+        free( sv.X_ijr );
+        free( sv.num_levels );
+        Cudd_RecursiveDeref( manager, sv.strans_into_W );
+    }
+    movecache_flush( &sv );
+    free( sv.moves );
+    Cudd_RecursiveDeref( manager, sv.W );
+    Cudd_RecursiveDeref( manager, sv.etrans );
+    Cudd_RecursiveDeref( manager, sv.strans );
+    for (i = 0; i < spc.num_egoals; i++)
+        Cudd_RecursiveDeref( manager, *(sv.egoals+i) );
+    for (i = 0; i < spc.num_sgoals; i++)
+        Cudd_RecursiveDeref( manager, *(sv.sgoals+i) );
+    free( sv.egoals );
+    free( sv.sgoals );
+    free( sv.cube );
+    free( sv.state );
+    free( sv.query );
+    free( sv.sys_move );
+    if (env_nogoal_flag) {
+        spc.num_egoals = 0;
+        delete_tree( *spc.env_goals );
+        free( spc.env_goals );
+    }
+
+    return result;
+}
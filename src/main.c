@@ -18,16 +18,9 @@
 #include "solve.h"
 #include "automaton.h"
 #include "gr1c_util.h"
-extern int yyparse( void );
-extern void yyrestart( FILE *new_file );
-
-
-/**************************
- **** Global variables ****/
-
-extern specification_t spc;
-
-/**************************/
+#include "checkpoint.h"
+#include "resultcache.h"
+#include "context.h"
 
 
 /* Output formats */
@@ -59,13 +52,24 @@ int main( int argc, char **argv )
     bool ptdump_flag = False;
     bool logging_flag = False;
     unsigned char init_flags = ALL_ENV_EXIST_SYS_INIT;
+    unsigned char synth_flags = SYNTH_DEFAULT;
     byte format_option = OUTPUT_FORMAT_JSON;
     unsigned char verbose = 0;
     bool reading_options = True;  /* For disabling option parsing using "--" */
     int input_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    int checkpoint_index = -1;  /* For command-line flag "--checkpoint". */
+    int checkpoint_interval = CHECKPOINT_DEFAULT_INTERVAL;
+    bool resume_flag = False;
+    int cache_index = -1;  /* For command-line flag "--cache". */
+    unsigned long cache_size = 0;  /* Maximum size in bytes; 0 if unlimited */
+    bool cache_refresh = False;
+    char cache_tag[32];
+    int cache_hits, cache_misses;
     char dumpfilename[64];
     char **command_argv = NULL;
+    bool serve_flag = False;  /* Binary protocol in interactive mode */
+    int socket_index = -1;  /* For command-line flag "--socket". */
 
     byte verification_model = 0;  /* For command-line flag "-P". */
     ptree_t *original_env_init = NULL;
@@ -132,6 +136,20 @@ int main( int argc, char **argv )
                 return -1;
             }
 
+        } else if (!strncmp( argv[1], "batch", strlen( "batch" ) )
+                   && argv[1][strlen("batch")] == '\0') {
+
+            command_argv = malloc( sizeof(char *)*argc );
+            command_argv[0] = strdup( "gr1c batch" );
+            command_argv[argc-1] = NULL;
+            for (i = 1; i < argc-1; i++)
+                command_argv[i] = argv[i+1];
+
+            if (execvp( "gr1c-batch", command_argv ) < 0) {
+                perror( "gr1c, execvp" );
+                return -1;
+            }
+
         } else if (!strncmp( argv[1], "help", strlen( "help" ) )
                    && argv[1][strlen("help")] == '\0') {
             reading_options = False;
@@ -236,6 +254,78 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "reuse", strlen( "reuse" ) )) {
+                synth_flags |= SYNTH_REUSE_NODES;
+            } else if (!strncmp( argv[i]+2, "minimize", strlen( "minimize" ) )) {
+                synth_flags |= SYNTH_MINIMIZE;
+            } else if (!strncmp( argv[i]+2, "reachable", strlen( "reachable" ) )) {
+                synth_flags |= SYNTH_RESTRICT_REACH;
+            } else if (!strncmp( argv[i]+2, "lean", strlen( "lean" ) )) {
+                synth_flags |= SYNTH_LEAN_SUBLEVELS;
+            } else if (!strncmp( argv[i]+2, "threads", strlen( "threads" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                if (strtol( argv[i+1], NULL, 10 ) < 1) {
+                    fprintf( stderr, "Number of threads must be positive.\n" );
+                    return 1;
+                }
+                setsolverthreads( strtol( argv[i+1], NULL, 10 ) );
+                i++;
+            } else if (!strncmp( argv[i]+2, "checkpoint-interval",
+                                 strlen( "checkpoint-interval" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                checkpoint_interval = strtol( argv[i+1], NULL, 10 );
+                if (checkpoint_interval < 0) {
+                    fprintf( stderr,
+                             "Checkpoint interval must be nonnegative.\n" );
+                    return 1;
+                }
+                i++;
+            } else if (!strncmp( argv[i]+2, "checkpoint",
+                                 strlen( "checkpoint" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                checkpoint_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "resume", strlen( "resume" ) )) {
+                resume_flag = True;
+            } else if (!strncmp( argv[i]+2, "cache-size",
+                                 strlen( "cache-size" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                cache_size = strtoul( argv[i+1], NULL, 10 )*1024*1024;
+                i++;
+            } else if (!strncmp( argv[i]+2, "cache-refresh",
+                                 strlen( "cache-refresh" ) )) {
+                cache_refresh = True;
+            } else if (!strncmp( argv[i]+2, "cache", strlen( "cache" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                cache_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "serve", strlen( "serve" ) )) {
+                run_option = GR1C_MODE_INTERACTIVE;
+                serve_flag = True;
+            } else if (!strncmp( argv[i]+2, "socket", strlen( "socket" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                run_option = GR1C_MODE_INTERACTIVE;
+                serve_flag = True;
+                socket_index = i+1;
+                i++;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -254,7 +344,12 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvlspriP] [-n INIT] [-t TYPE] [-o FILE] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvlspriP] [--reuse] [--minimize] [--reachable] [--lean]\n"
+                "       [--threads N]\n"
+                "       [--checkpoint PREFIX [--checkpoint-interval S] [--resume]]\n"
+                "       [--cache DIR [--cache-size MB] [--cache-refresh]]\n"
+                "       [--serve [--socket PATH]]\n"
+                "       [-n INIT] [-t TYPE] [-o FILE] [[--] FILE]\n\n"
                 "  -h          this help message\n"
                 "  -V          print version and exit\n"
                 "  -v          be verbose; use -vv to be more verbose\n"
@@ -273,9 +368,39 @@ int main( int argc, char **argv )
                 "  -i          interactive mode\n"
                 "  -o FILE     output strategy to FILE, rather than stdout (default)\n"
                 "  -P          create Spin Promela model of strategy;\n"
-                "              output to stdout, so requires -o flag to also be used\n" );
+                "              output to stdout, so requires -o flag to also be used\n"
+                "  --reuse     during synthesis, prefer moves to states that are\n"
+                "              already in the strategy; often gives smaller strategies\n"
+                "  --minimize  merge bisimilar nodes of the strategy after synthesis\n"
+                "  --reachable before extracting a strategy, restrict sublevel sets\n"
+                "              to states reachable from initial states\n"
+                "  --lean      use less memory during synthesis by recomputing\n"
+                "              intermediate fixpoint sets when needed; slower\n"
+                "  --threads N compute the winning set using N threads, in parallel\n"
+                "              over goals (default is 1)\n"
+                "  --checkpoint PREFIX\n"
+                "              periodically save progress of fixpoint computations\n"
+                "              to files with names that begin with PREFIX\n"
+                "  --checkpoint-interval S\n"
+                "              with --checkpoint, save progress at most once every\n"
+                "              S seconds (default is 300)\n"
+                "  --resume    with --checkpoint, resume from saved progress, if any\n" );
+        printf( "  --cache DIR reuse winning sets, sublevel sets, and strategies saved\n"
+                "              in DIR from previous solutions of the same problem,\n"
+                "              and BDDs of unchanged parts of edited specifications\n"
+                "  --cache-size MB\n"
+                "              with --cache, delete least recently used results to\n"
+                "              keep DIR within the given size (default is no limit)\n"
+                "  --cache-refresh\n"
+                "              with --cache, do not reuse results, but save new ones\n"
+                "  --serve     interactive mode, but answer batches of queries in the\n"
+                "              binary protocol of doc/interaction.md\n"
+                "  --socket PATH\n"
+                "              with --serve, accept clients on a Unix domain socket\n"
+                "              at PATH, rather than reading stdin\n" );
         printf( "\nFor other commands, use: %s COMMAND [...]\n\n"
                 "  rg          solve reachability game\n"
+                "  batch       solve many specifications using several threads\n"
                 "  autman      manipulate finite-memory strategies\n"
                 "  patch       patch or modify a given strategy (incremental synthesis)\n"
                 "  help        this help message (equivalent to -h)\n\n"
@@ -289,6 +414,29 @@ int main( int argc, char **argv )
                 " implemented.\n" );
         return 1;
     }
+    if (resume_flag && checkpoint_index < 0) {
+        fprintf( stderr, "--resume can only be used with --checkpoint.\n" );
+        return 1;
+    }
+    if (checkpoint_interval != CHECKPOINT_DEFAULT_INTERVAL
+        && checkpoint_index < 0) {
+        fprintf( stderr,
+                 "--checkpoint-interval can only be used with"
+                 " --checkpoint.\n" );
+        return 1;
+    }
+    if ((cache_size > 0 || cache_refresh) && cache_index < 0) {
+        fprintf( stderr,
+                 "--cache-size and --cache-refresh can only be used with"
+                 " --cache.\n" );
+        return 1;
+    }
+    if (checkpoint_index >= 0 && input_index < 0) {
+        fprintf( stderr,
+                 "--checkpoint requires the specification to be given"
+                 " in a file.\n" );
+        return 1;
+    }
     if (verification_model > 0 && output_file_index < 0) {
         printf( "-P flag can only be used with -o flag because the"
                 " verification model is\noutput to stdout.\n" );
@@ -315,16 +463,22 @@ int main( int argc, char **argv )
             perror( "gr1c, fopen" );
             return -1;
         }
-        yyrestart( fp );
+        if (checkpoint_index >= 0) {
+            /* Checkpoints are only used for the same specification. */
+            setcheckpoint( argv[checkpoint_index],
+                           checkpoint_interval, resume_flag,
+                           checkpoint_filehash( fp ) );
+            rewind( fp );
+        }
     } else {
-        yyrestart( stdin );
+        fp = stdin;
     }
 
     /* Parse the specification. */
     if (verbose)
         logprint( "Parsing input..." );
     SPC_INIT( spc );
-    if (yyparse())
+    if (gr1c_parse( fp, &spc, NULL ))
         return 2;
     if (verbose)
         logprint( "Done." );
@@ -515,6 +669,7 @@ int main( int argc, char **argv )
     }
     spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
                                                      verbose );
+    spc.var_st = vars_symtab( spc.evar_list, spc.svar_list );
 
     /* Merge component safety (transition) formulas */
     if (spc.et_array_len > 1) {
@@ -549,6 +704,16 @@ int main( int argc, char **argv )
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
+    /* Results are identified by the expanded specification, so that,
+       e.g., formatting and comments in the input are irrelevant. */
+    if (cache_index >= 0) {
+        setresultcache( argv[cache_index], cache_size, cache_refresh,
+                        init_flags );
+        /* Options that change the strategy are part of its tag. */
+        snprintf( cache_tag, sizeof(cache_tag), "strategy%d",
+                  synth_flags & (SYNTH_REUSE_NODES | SYNTH_MINIMIZE) );
+    }
+
     manager = Cudd_Init( 2*(num_env+num_sys),
                          0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
     Cudd_SetMaxCacheHard( manager, (unsigned int)-1 );
@@ -564,7 +729,14 @@ int main( int argc, char **argv )
             return -1;
         }
 
-        i = levelset_interactive( manager, init_flags, stdin, stdout, verbose );
+        if (serve_flag) {
+            i = levelset_serve( manager,
+                                (socket_index >= 0) ? argv[socket_index] : NULL,
+                                verbose );
+        } else {
+            i = levelset_interactive( manager, init_flags, stdin, stdout,
+                                      verbose );
+        }
         if (i == 0) {
             printf( "Not realizable.\n" );
             return 3;
@@ -597,19 +769,35 @@ int main( int argc, char **argv )
 
         if (run_option == GR1C_MODE_SYNTHESIS && T != NULL) {
 
-            if (verbose)
-                logprint( "Synthesizing a strategy..." );
-            strategy = synthesize( manager, init_flags, verbose );
-            if (verbose)
-                logprint( "Done." );
+            if (cache_index >= 0) {
+                strategy = rcache_load_aut( cache_tag, num_env+num_sys );
+                if (verbose && strategy != NULL)
+                    logprint( "Loaded strategy from result cache." );
+            }
             if (strategy == NULL) {
-                fprintf( stderr, "Error while attempting synthesis.\n" );
-                return -1;
+                if (verbose)
+                    logprint( "Synthesizing a strategy..." );
+                strategy = synthesize( manager, init_flags, synth_flags,
+                                       verbose );
+                if (verbose)
+                    logprint( "Done." );
+                if (strategy == NULL) {
+                    fprintf( stderr, "Error while attempting synthesis.\n" );
+                    return -1;
+                }
+                if (cache_index >= 0)
+                    rcache_save_aut( cache_tag, strategy, num_env+num_sys );
             }
 
         }
     }
 
+    if (cache_index >= 0 && verbose) {
+        rcache_stats( &cache_hits, &cache_misses );
+        logprint( "Result cache: %d hits, %d misses.",
+                  cache_hits, cache_misses );
+    }
+
     if (strategy != NULL) {  /* De-expand nonboolean variables */
         tmppt = spc.nonbool_var_list;
         while (tmppt) {
@@ -673,6 +861,7 @@ int main( int argc, char **argv )
     /* Clean-up */
     delete_tree( spc.evar_list );
     delete_tree( spc.svar_list );
+    symtab_free( spc.var_st );
     delete_tree( spc.nonbool_var_list );
     delete_tree( spc.env_init );
     delete_tree( spc.sys_init );
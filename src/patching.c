@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "common.h"
 #include "logging.h"
@@ -16,9 +17,9 @@
 #include "patching.h"
 #include "solve_support.h"
 #include "gr1c_util.h"
-
-
-extern specification_t spc;
+#include "context.h"
+#include "solve.h"
+#include "checkpoint.h"
 
 
 /* Pretty print state vector, default is to list nonzero variables.
@@ -65,91 +66,323 @@ void pprint_state( vartype *state, int num_env, int num_sys, FILE *fp )
 }
 
 
-/* Returns strategy with patched goal mode, or NULL if error. */
-anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
-                                 anode_t *strategy, int goal_mode,
-                                 anode_t ***affected, int *affected_len,
-                                 DdNode *etrans, DdNode *strans,
-                                 DdNode **egoals,
-                                 DdNode *N_BDD, vartype **N, int N_len,
-                                 unsigned char verbose )
+/* Defined in automaton.c */
+extern int anode_ptrcmp( const void *p1, const void *p2 );
+extern int aut_intcmp( const void *p1, const void *p2 );
+
+
+/* Index of the strategy given to patch_localfixpoint_aut(), built
+   before it is changed.  Nodes are identified by their position in the
+   node list at that time.  Nodes of goal mode i are only changed or
+   deleted when goal mode i is patched, so the index of goal mode i
+   remains valid until then, though positions of nodes of other modes
+   may no longer refer to nodes in the strategy. */
+typedef struct {
+    anode_t **nodes;
+    int num_nodes;
+    int *mode;  /* Goal mode of each node when the index was built */
+
+    int num_modes;
+    int *mode_len;
+    int **mode_nodes;  /* Positions of the nodes of each goal mode */
+    vartype ***mode_states;
+    stateidx_t **by_mode;  /* Index of the states in mode_states */
+
+    vartype **sys_states;  /* System part of the state of each node */
+    stateidx_t *by_sys;
+
+    /* Predecessors of node i are at positions *(pred+k) for
+       *(pred_off+i) <= k < *(pred_off+i+1), in increasing order, and
+       node *(pred+k) has a transition to i at index *(pred_j+k). */
+    int *pred_off;
+    int *pred;
+    int *pred_j;
+} stratidx_t;
+
+stratidx_t *stratidx_new( anode_t *strategy, int num_modes,
+                          int num_env, int num_sys )
+{
+    stratidx_t *sidx;
+    anode_t **sorted, **target;
+    anode_t *node;
+    int *position, *fill;
+    int n, i, j, k, t;
+
+    sidx = malloc( sizeof(stratidx_t) );
+    if (sidx == NULL) {
+        perror( "stratidx_new, malloc" );
+        exit(-1);
+    }
+    n = aut_size( strategy );
+    sidx->num_nodes = n;
+    sidx->num_modes = num_modes;
+    sidx->nodes = malloc( (n+1)*sizeof(anode_t *) );
+    sidx->mode = malloc( (n+1)*sizeof(int) );
+    sidx->sys_states = malloc( (n+1)*sizeof(vartype *) );
+    sidx->pred_off = calloc( n+1, sizeof(int) );
+    sidx->mode_len = calloc( num_modes+1, sizeof(int) );
+    sidx->mode_nodes = malloc( (num_modes+1)*sizeof(int *) );
+    sidx->mode_states = malloc( (num_modes+1)*sizeof(vartype **) );
+    sidx->by_mode = malloc( (num_modes+1)*sizeof(stateidx_t *) );
+    sorted = malloc( (n+1)*sizeof(anode_t *) );
+    position = malloc( (n+1)*sizeof(int) );
+    if (sidx->nodes == NULL || sidx->mode == NULL || sidx->sys_states == NULL
+        || sidx->pred_off == NULL || sidx->mode_len == NULL
+        || sidx->mode_nodes == NULL || sidx->mode_states == NULL
+        || sidx->by_mode == NULL || sorted == NULL || position == NULL) {
+        perror( "stratidx_new, malloc" );
+        exit(-1);
+    }
+
+    for (node = strategy, i = 0; node != NULL; node = node->next, i++) {
+        *(sidx->nodes+i) = *(sorted+i) = node;
+        *(sidx->mode+i) = node->mode;
+        *(sidx->sys_states+i) = node->state+num_env;
+        if (node->mode >= 0 && node->mode < num_modes)
+            (*(sidx->mode_len + node->mode))++;
+    }
+    for (k = 0; k < num_modes; k++) {
+        *(sidx->mode_nodes+k) = malloc( (*(sidx->mode_len+k)+1)*sizeof(int) );
+        *(sidx->mode_states+k) = malloc( (*(sidx->mode_len+k)+1)
+                                         *sizeof(vartype *) );
+        if (*(sidx->mode_nodes+k) == NULL || *(sidx->mode_states+k) == NULL) {
+            perror( "stratidx_new, malloc" );
+            exit(-1);
+        }
+        *(sidx->mode_len+k) = 0;
+    }
+    for (i = 0; i < n; i++) {
+        k = *(sidx->mode+i);
+        if (k < 0 || k >= num_modes)
+            continue;
+        *(*(sidx->mode_nodes+k) + *(sidx->mode_len+k)) = i;
+        *(*(sidx->mode_states+k) + *(sidx->mode_len+k))
+            = (*(sidx->nodes+i))->state;
+        (*(sidx->mode_len+k))++;
+    }
+    for (k = 0; k < num_modes; k++)
+        *(sidx->by_mode+k) = stateidx_new( *(sidx->mode_states+k),
+                                           *(sidx->mode_len+k),
+                                           num_env+num_sys );
+    sidx->by_sys = stateidx_new( sidx->sys_states, n, num_sys );
+
+    /* Predecessor lists, as in aut_copy() mapping transitions to
+       positions through an array sorted by address. */
+    qsort( sorted, n, sizeof(anode_t *), anode_ptrcmp );
+    for (i = 0; i < n; i++) {
+        target = bsearch( sidx->nodes+i, sorted, n, sizeof(anode_t *),
+                          anode_ptrcmp );
+        *(position + (target - sorted)) = i;
+    }
+    for (i = 0; i < n; i++) {
+        node = *(sidx->nodes+i);
+        for (j = 0; j < node->trans_len; j++) {
+            target = bsearch( node->trans+j, sorted, n, sizeof(anode_t *),
+                              anode_ptrcmp );
+            if (target != NULL)
+                (*(sidx->pred_off + *(position + (target - sorted)) + 1))++;
+        }
+    }
+    for (i = 0; i < n; i++)
+        *(sidx->pred_off+i+1) += *(sidx->pred_off+i);
+    sidx->pred = malloc( (*(sidx->pred_off+n)+1)*sizeof(int) );
+    sidx->pred_j = malloc( (*(sidx->pred_off+n)+1)*sizeof(int) );
+    fill = malloc( (n+1)*sizeof(int) );
+    if (sidx->pred == NULL || sidx->pred_j == NULL || fill == NULL) {
+        perror( "stratidx_new, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < n; i++)
+        *(fill+i) = *(sidx->pred_off+i);
+    for (i = 0; i < n; i++) {
+        node = *(sidx->nodes+i);
+        for (j = 0; j < node->trans_len; j++) {
+            target = bsearch( node->trans+j, sorted, n, sizeof(anode_t *),
+                              anode_ptrcmp );
+            if (target == NULL)
+                continue;
+            t = *(position + (target - sorted));
+            *(sidx->pred + *(fill+t)) = i;
+            *(sidx->pred_j + *(fill+t)) = j;
+            (*(fill+t))++;
+        }
+    }
+
+    free( fill );
+    free( sorted );
+    free( position );
+    return sidx;
+}
+
+void stratidx_free( stratidx_t *sidx )
+{
+    int k;
+    if (sidx == NULL)
+        return;
+    for (k = 0; k < sidx->num_modes; k++) {
+        stateidx_free( *(sidx->by_mode+k) );
+        free( *(sidx->mode_nodes+k) );
+        free( *(sidx->mode_states+k) );
+    }
+    stateidx_free( sidx->by_sys );
+    free( sidx->by_mode );
+    free( sidx->mode_nodes );
+    free( sidx->mode_states );
+    free( sidx->mode_len );
+    free( sidx->sys_states );
+    free( sidx->mode );
+    free( sidx->nodes );
+    free( sidx->pred_off );
+    free( sidx->pred );
+    free( sidx->pred_j );
+    free( sidx );
+}
+
+/* Lexicographic comparison of (predecessor, transition index) keys of
+   triples (predecessor, transition index, node), for ordering the Entry
+   set as if found by scanning the node list. */
+int entry_keycmp( const void *p1, const void *p2 )
+{
+    const int *a = (const int *)p1, *b = (const int *)p2;
+    if (*a != *b)
+        return (*a < *b) ? -1 : 1;
+    if (*(a+1) != *(b+1))
+        return (*(a+1) < *(b+1)) ? -1 : 1;
+    return 0;
+}
+
+
+/* Patching of one goal mode is done in three steps, so that the local
+   reachability games of different goal modes can be solved
+   concurrently: localfixpoint_prepare() finds the Entry and Exit sets,
+   synthesize_reachgame() solves the local game, and
+   localfixpoint_merge() connects the local strategy to the original.
+   Preparation of a goal mode only involves nodes of that goal mode, and
+   merging preserves their relative order of reach annotation values,
+   so all goal modes can be prepared before any is merged.  Merging must
+   be in the order of goal modes. */
+typedef struct {
+    int goal_mode;
+    int *in_N;  /* Positions in sidx of nodes of this goal mode in N */
+    int in_N_len;
+    anode_t **Entry;
+    anode_t **Exit;
+    int Entry_len, Exit_len;
+    anode_t *local_strategy;
+} lfp_task_t;
+
+void localfixpoint_prepare( int num_env, int num_sys, int goal_mode,
+                            anode_t ***affected, int *affected_len,
+                            stateidx_t *N_index, stratidx_t *sidx,
+                            lfp_task_t *task, unsigned char verbose )
 {
     int i, j, k;  /* Generic counters */
     anode_t **Exit;
     anode_t **Entry;
     int Exit_len, Entry_len;
-    anode_t *local_strategy;
-    anode_t *head, *node;
+    anode_t *node;
     int min_rgrad;  /* Minimum reach annotation value of affected nodes. */
-    int Exit_rgrad;  /* Maximum value among reached Exit nodes. */
-    int local_max_rgrad;
-    int local_min_rgrad;
+
+    int *in_N;
+    int in_N_len;
+    int *cand;  /* Triples (predecessor, transition index, node) */
+    int cand_len;
+    int best_p, best_j;
+    bool *seen;  /* Indexed by the first position of a state in N */
+
+    task->goal_mode = goal_mode;
+    task->local_strategy = NULL;
+
+    if (verbose)
+        logprint( "Processing for goal mode %d...", goal_mode );
+
+    /* Find nodes of this goal mode with state in N, in the order of
+       the node list, by looking up each (distinct) state of N. */
+    in_N = malloc( sizeof(int)*(*(sidx->mode_len+goal_mode)+1) );
+    if (in_N == NULL) {
+        perror( "localfixpoint_goalmode, malloc" );
+        exit(-1);
+    }
+    in_N_len = 0;
+    for (i = 0; i < N_index->len; i++) {
+        if (stateidx_find( N_index, *(N_index->states+i) ) != i)
+            continue;  /* Repeated state */
+        j = stateidx_find( *(sidx->by_mode+goal_mode),
+                           *(N_index->states+i) );
+        while (j >= 0) {
+            *(in_N+in_N_len) = *(*(sidx->mode_nodes+goal_mode)+j);
+            in_N_len++;
+            j = stateidx_next( *(sidx->by_mode+goal_mode), j );
+        }
+    }
+    qsort( in_N, in_N_len, sizeof(int), aut_intcmp );
 
     /* Pre-allocate space for Entry and Exit sets; the number of
        elements actually used is tracked by Entry_len and Exit_len,
        respectively. */
-    Exit = malloc( sizeof(anode_t *)*N_len );
+    Exit = malloc( sizeof(anode_t *)*(in_N_len+1) );
     if (Exit == NULL) {
         perror( "localfixpoint_goalmode, malloc" );
         exit(-1);
     }
-    Entry = malloc( sizeof(anode_t *)*N_len );
+    Entry = malloc( sizeof(anode_t *)*(in_N_len+1) );
     if (Entry == NULL) {
         perror( "localfixpoint_goalmode, malloc" );
         exit(-1);
     }
 
-    /* Ignore goal modes that are unaffected by the change. */
-    if (*(affected_len + goal_mode) == 0) {
-        free( Exit );
-        free( Entry );
-        return strategy;
+    /* Build initial Exit set */
+    for (i = 0; i < in_N_len; i++)
+        *(Exit+i) = *(sidx->nodes + *(in_N+i));
+    Exit_len = in_N_len;
+
+    /* Build Entry set, i.e., nodes in N that are entered from nodes of
+       this goal mode not in N.  Predecessors with another goal mode
+       are skipped before dereferencing them, as they may have been
+       deleted.  Sorting by the first such transition gives the order
+       in which scanning the node list would find the Entry nodes. */
+    cand = malloc( 3*sizeof(int)*(in_N_len+1) );
+    seen = calloc( N_index->len+1, sizeof(bool) );
+    if (cand == NULL || seen == NULL) {
+        perror( "localfixpoint_goalmode, malloc" );
+        exit(-1);
     }
-
-    if (verbose)
-        logprint( "Processing for goal mode %d...", goal_mode );
-
-    /* Build Entry set and initial Exit set */
-    Exit_len = Entry_len = 0;
-    head = strategy;
-    while (head) {
-        /* Though we use linear search in N, if we could sort N
-           earlier, or somehow ensure the input (from the game
-           edge change file) is already ordered, then this could
-           be made into a binary search. */
-        if (head->mode == goal_mode) {
-            for (i = 0; i < N_len; i++)
-                if (statecmp( head->state, *(N+i), num_env+num_sys ))
-                    break;
-
-            if (i < N_len) {  /* Was a match found? */
-                Exit_len++;
-                *(Exit+Exit_len-1) = head;
-            } else {
-                /* Test for nominal membership in Entry set; i.e.,
-                   current node is not in N, check if it leads into N. */
-                for (j = 0; j < head->trans_len; j++) {
-                    for (k = 0; k < N_len; k++)
-                        if ((*(head->trans+j))->mode == goal_mode
-                            && statecmp( (*(head->trans+j))->state, *(N+k),
-                                         num_env+num_sys ))
-                            break;
-                    if (k < N_len) {
-                        for (k = 0; k < Entry_len; k++)
-                            if (statecmp((*(Entry+k))->state,
-                                         (*(head->trans+j))->state,
-                                         num_env+num_sys ))
-                                break;
-                        if (k == Entry_len) {
-                            Entry_len++;
-                            *(Entry+Entry_len-1) = *(head->trans+j);
-                        }
-                    }
-                }
+    cand_len = 0;
+    for (i = 0; i < in_N_len; i++) {
+        best_p = best_j = -1;
+        for (k = *(sidx->pred_off + *(in_N+i));
+             k < *(sidx->pred_off + *(in_N+i) + 1); k++) {
+            if (*(sidx->mode + *(sidx->pred+k)) != goal_mode
+                || stateidx_find( N_index,
+                                  (*(sidx->nodes + *(sidx->pred+k)))->state )
+                   >= 0)
+                continue;
+            if (best_p < 0 || *(sidx->pred+k) < best_p
+                || (*(sidx->pred+k) == best_p && *(sidx->pred_j+k) < best_j)) {
+                best_p = *(sidx->pred+k);
+                best_j = *(sidx->pred_j+k);
             }
         }
-        head = head->next;
+        if (best_p >= 0) {
+            *(cand+3*cand_len) = best_p;
+            *(cand+3*cand_len+1) = best_j;
+            *(cand+3*cand_len+2) = *(in_N+i);
+            cand_len++;
+        }
+    }
+    qsort( cand, cand_len, 3*sizeof(int), entry_keycmp );
+    Entry_len = 0;
+    for (i = 0; i < cand_len; i++) {
+        node = *(sidx->nodes + *(cand+3*i+2));
+        j = stateidx_find( N_index, node->state );
+        if (!*(seen+j)) {
+            *(seen+j) = True;
+            *(Entry+Entry_len) = node;
+            Entry_len++;
+        }
     }
+    free( cand );
+    free( seen );
 
     /* Find minimum reach annotation value among nodes in the
        Entry and U_i sets, and remove any initial Exit nodes greater
@@ -198,14 +431,50 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
         }
     }
 
-    local_strategy = synthesize_reachgame( manager, num_env, num_sys,
-                                           Entry, Entry_len, Exit, Exit_len,
-                                           etrans, strans, egoals, N_BDD,
-                                           verbose );
-    if (local_strategy == NULL) {
-        free( Exit );
-        free( Entry );
-        return NULL;
+    task->in_N = in_N;
+    task->in_N_len = in_N_len;
+    task->Entry = Entry;
+    task->Entry_len = Entry_len;
+    task->Exit = Exit;
+    task->Exit_len = Exit_len;
+}
+
+
+/* Returns strategy with the local strategy of task connected, or NULL
+   if error.  The arrays of task are freed. */
+anode_t *localfixpoint_merge( int num_env, int num_sys, anode_t *strategy,
+                              anode_t ***affected, int *affected_len,
+                              stateidx_t *N_index, stratidx_t *sidx,
+                              lfp_task_t *task, unsigned char verbose )
+{
+    int i, j;  /* Generic counters */
+    int goal_mode = task->goal_mode;
+    anode_t **Exit = task->Exit;
+    anode_t **Entry = task->Entry;
+    int Exit_len = task->Exit_len, Entry_len = task->Entry_len;
+    int *in_N = task->in_N;
+    int in_N_len = task->in_N_len;
+    anode_t *local_strategy = task->local_strategy;
+    anode_t *head, *node;
+    int min_rgrad;  /* Minimum reach annotation value of affected nodes. */
+    int Exit_rgrad;  /* Maximum value among reached Exit nodes. */
+    int local_max_rgrad;
+    int local_min_rgrad;
+
+    anode_t **local_nodes;
+    vartype **local_states, **Exit_states;
+    stateidx_t *local_index, *Exit_index;
+    int local_len;
+
+    /* Reach annotation values may have been scaled since preparation. */
+    min_rgrad = -1;
+    for (i = 0; i < Entry_len; i++) {
+        if ((*(Entry+i))->rgrad < min_rgrad || min_rgrad == -1)
+            min_rgrad = (*(Entry+i))->rgrad;
+    }
+    for (i = 0; i < *(affected_len+goal_mode); i++) {
+        if ((*(*(affected+goal_mode)+i))->rgrad < min_rgrad || min_rgrad == -1)
+            min_rgrad = (*(*(affected+goal_mode)+i))->rgrad;
     }
 
     if (verbose > 1) {
@@ -226,12 +495,28 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
         node = node->next;
     }
 
+    /* Index states of the local strategy and of Exit nodes. */
+    local_len = aut_size( local_strategy );
+    local_nodes = malloc( sizeof(anode_t *)*(local_len+1) );
+    local_states = malloc( sizeof(vartype *)*(local_len+1) );
+    Exit_states = malloc( sizeof(vartype *)*(Exit_len+1) );
+    if (local_nodes == NULL || local_states == NULL || Exit_states == NULL) {
+        perror( "localfixpoint_goalmode, malloc" );
+        exit(-1);
+    }
+    for (node = local_strategy, i = 0; node != NULL; node = node->next, i++) {
+        *(local_nodes+i) = node;
+        *(local_states+i) = node->state;
+    }
+    for (i = 0; i < Exit_len; i++)
+        *(Exit_states+i) = (*(Exit+i))->state;
+    local_index = stateidx_new( local_states, local_len, num_env+num_sys );
+    Exit_index = stateidx_new( Exit_states, Exit_len, num_env+num_sys );
+
     /* Connect local strategy to original */
     for (i = 0; i < Entry_len; i++) {
-        node = local_strategy;
-        while (node && !statecmp( (*(Entry+i))->state, node->state,
-                                  num_env+num_sys ))
-            node = node->next;
+        j = stateidx_find( local_index, (*(Entry+i))->state );
+        node = (j >= 0) ? *(local_nodes+j) : NULL;
         if (node == NULL) {
             fprintf( stderr,
                      "Error localfixpoint_goalmode: expected Entry node"
@@ -247,12 +532,8 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
     node = local_strategy;
     while (node) {
         if (node->trans_len == 0) {  /* Terminal node of the local strategy? */
-            for (i = 0; i < Exit_len; i++) {
-                if (statecmp( node->state, (*(Exit+i))->state,
-                              num_env+num_sys ))
-                    break;
-            }
-            if (i == Exit_len) {
+            i = stateidx_find( Exit_index, node->state );
+            if (i < 0) {
                 fprintf( stderr,
                          "Error localfixpoint_goalmode: terminal node in"
                          " local strategy does not have a\nmatching Exit"
@@ -264,8 +545,7 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
             if ((*(Exit+i))->rgrad > Exit_rgrad)
                 Exit_rgrad = (*(Exit+i))->rgrad;
 
-            if (forward_modereach( *(Exit+i), goal_mode, N, N_len,
-                                   -1, num_env+num_sys )) {
+            if (forward_modereach( *(Exit+i), goal_mode, N_index, -1 )) {
                 fprintf( stderr,
                          "Error localfixpoint_goalmode: forward graph"
                          " reachability computation failed\nfrom Exit node"
@@ -281,23 +561,22 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
         }
         node = node->next;
     }
+    stateidx_free( local_index );
+    stateidx_free( Exit_index );
+    free( local_nodes );
+    free( local_states );
+    free( Exit_states );
 
     /* Delete useless nodes from N_i (whose function is now replaced
-       by the local strategy). */
-    node = strategy;
-    while (node) {
-        if (node->mode != goal_mode) {
-            if (node->mode == -1)
-                node->mode = goal_mode;
-            node = node->next;
-            continue;
-        }
-        for (i = 0; i < N_len; i++)
-            if (statecmp( node->state, *(N+i), num_env+num_sys ))
-                break;
-        if (i < N_len)
+       by the local strategy).  Nodes marked by forward_modereach() or
+       as Exit nodes are in N, so all marks are among these. */
+    for (i = 0; i < in_N_len; i++) {
+        node = *(sidx->nodes + *(in_N+i));
+        if (node->mode == -1) {
+            node->mode = goal_mode;
+        } else if (node->mode == goal_mode) {
             node->mode = -2;
-        node = node->next;
+        }
     }
     node = strategy;
     while (node) {
@@ -343,17 +622,284 @@ anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
 
     free( Entry );
     free( Exit );
+    free( in_N );
+    task->local_strategy = NULL;
 
     return strategy;
 }
 
 
-#define INPUT_STRING_LEN 1024
+
+
+/* Returns strategy with patched goal mode, or NULL if error. */
+anode_t *localfixpoint_goalmode( DdManager *manager, int num_env, int num_sys,
+                                 anode_t *strategy, int goal_mode,
+                                 anode_t ***affected, int *affected_len,
+                                 DdNode *etrans, DdNode *strans,
+                                 DdNode **egoals, DdNode *N_BDD,
+                                 stateidx_t *N_index, stratidx_t *sidx,
+                                 unsigned char verbose )
+{
+    lfp_task_t task;
+
+    /* Ignore goal modes that are unaffected by the change. */
+    if (*(affected_len + goal_mode) == 0)
+        return strategy;
+
+    localfixpoint_prepare( num_env, num_sys, goal_mode, affected, affected_len,
+                           N_index, sidx, &task, verbose );
+    task.local_strategy = synthesize_reachgame( manager, num_env, num_sys,
+                                                task.Entry, task.Entry_len,
+                                                task.Exit, task.Exit_len,
+                                                etrans, strans, egoals, N_BDD,
+                                                verbose );
+    if (task.local_strategy == NULL) {
+        free( task.Exit );
+        free( task.Entry );
+        free( task.in_N );
+        return NULL;
+    }
+
+    return localfixpoint_merge( num_env, num_sys, strategy,
+                                affected, affected_len, N_index, sidx,
+                                &task, verbose );
+}
+
+
+/* State of a thread that solves local reachability games of some goal
+   modes in its own CUDD manager; cf. localfixpoint_parallel(). */
+typedef struct {
+    gr1c_ctx_t ctx;
+    int num_env, num_sys;
+    DdNode *etrans, *strans, **egoals, *N_BDD;
+    lfp_task_t *tasks;
+    int num_tasks;
+    int offset, stride;  /* This thread solves tasks offset+k*stride. */
+    int error;
+} lfp_worker_t;
+
+void *lfp_worker_body( void *arg )
+{
+    lfp_worker_t *w = (lfp_worker_t *)arg;
+    lfp_task_t *task;
+    int i;
+
+    gr1c_ctx_bind( &(w->ctx) );
+    for (i = w->offset; i < w->num_tasks; i += w->stride) {
+        task = w->tasks + i;
+        task->local_strategy = synthesize_reachgame( w->ctx.manager,
+                                                     w->num_env, w->num_sys,
+                                                     task->Entry,
+                                                     task->Entry_len,
+                                                     task->Exit,
+                                                     task->Exit_len,
+                                                     w->etrans, w->strans,
+                                                     w->egoals, w->N_BDD, 0 );
+        if (task->local_strategy == NULL) {
+            w->error = 1;
+            break;
+        }
+    }
+    gr1c_ctx_bind( NULL );
+    return NULL;
+}
+
+/* Patch all affected goal modes, solving their local reachability games
+   concurrently using up to num_threads threads.  The result is the same
+   as from applying localfixpoint_goalmode() to each goal mode in order.
+   Returns NULL if error, in which case the strategy has been freed. */
+anode_t *localfixpoint_parallel( DdManager *manager, int num_env, int num_sys,
+                                 anode_t *strategy,
+                                 anode_t ***affected, int *affected_len,
+                                 DdNode *etrans, DdNode *strans,
+                                 DdNode **egoals, DdNode *N_BDD,
+                                 stateidx_t *N_index, stratidx_t *sidx,
+                                 int num_threads, unsigned char verbose )
+{
+    lfp_task_t *tasks;
+    int num_tasks;
+    anode_t *result;
+    lfp_worker_t *workers;
+    int num_workers;
+    pthread_t *threads;
+    int i, j, goal_mode;
+    bool failed = False;
+
+    tasks = malloc( spc.num_sgoals*sizeof(lfp_task_t) );
+    if (tasks == NULL) {
+        perror( "localfixpoint_parallel, malloc" );
+        exit(-1);
+    }
+    num_tasks = 0;
+    for (goal_mode = 0; goal_mode < spc.num_sgoals; goal_mode++) {
+        if (*(affected_len + goal_mode) == 0)
+            continue;
+        localfixpoint_prepare( num_env, num_sys, goal_mode,
+                               affected, affected_len, N_index, sidx,
+                               tasks+num_tasks, verbose );
+        num_tasks++;
+    }
+
+    num_workers = (num_tasks < num_threads) ? num_tasks : num_threads;
+    if (verbose)
+        logprint( "Solving local reachability games of %d goal modes"
+                  " using %d threads...", num_tasks, num_workers );
+    workers = malloc( num_workers*sizeof(lfp_worker_t) );
+    threads = malloc( num_workers*sizeof(pthread_t) );
+    if (workers == NULL || threads == NULL) {
+        perror( "localfixpoint_parallel, malloc" );
+        exit(-1);
+    }
+
+    /* All copying is done before any thread starts, because the
+       manager of the caller is used in each copy. */
+    for (i = 0; i < num_workers; i++) {
+        (workers+i)->ctx.spec = spc;
+        (workers+i)->ctx.manager = par_manager_new( manager,
+                                                    num_env, num_sys );
+        if ((workers+i)->ctx.manager == NULL) {
+            fprintf( stderr,
+                     "Error localfixpoint_parallel: failed to create CUDD"
+                     " manager for thread %d.\n", i );
+            exit(-1);
+        }
+        (workers+i)->ctx.init_flags = 0;
+        (workers+i)->ctx.synth_flags = 0;
+        (workers+i)->ctx.verbose = 0;
+        (workers+i)->num_env = num_env;
+        (workers+i)->num_sys = num_sys;
+        (workers+i)->etrans = par_transfer( manager, (workers+i)->ctx.manager,
+                                            etrans );
+        (workers+i)->strans = par_transfer( manager, (workers+i)->ctx.manager,
+                                            strans );
+        (workers+i)->N_BDD = par_transfer( manager, (workers+i)->ctx.manager,
+                                           N_BDD );
+        (workers+i)->egoals = malloc( (spc.num_egoals+1)*sizeof(DdNode *) );
+        if ((workers+i)->egoals == NULL) {
+            perror( "localfixpoint_parallel, malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < spc.num_egoals; j++)
+            *((workers+i)->egoals+j) = par_transfer( manager,
+                                                     (workers+i)->ctx.manager,
+                                                     *(egoals+j) );
+        (workers+i)->tasks = tasks;
+        (workers+i)->num_tasks = num_tasks;
+        (workers+i)->offset = i;
+        (workers+i)->stride = num_workers;
+        (workers+i)->error = 0;
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        if (pthread_create( threads+i, NULL, lfp_worker_body, workers+i )) {
+            fprintf( stderr,
+                     "Error localfixpoint_parallel: failed to create"
+                     " thread.\n" );
+            exit(-1);
+        }
+    }
+    for (i = 0; i < num_workers; i++) {
+        pthread_join( *(threads+i), NULL );
+        if ((workers+i)->error)
+            failed = True;
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        Cudd_RecursiveDeref( (workers+i)->ctx.manager, (workers+i)->etrans );
+        Cudd_RecursiveDeref( (workers+i)->ctx.manager, (workers+i)->strans );
+        Cudd_RecursiveDeref( (workers+i)->ctx.manager, (workers+i)->N_BDD );
+        for (j = 0; j < spc.num_egoals; j++)
+            Cudd_RecursiveDeref( (workers+i)->ctx.manager,
+                                 *((workers+i)->egoals+j) );
+        free( (workers+i)->egoals );
+        Cudd_Quit( (workers+i)->ctx.manager );
+    }
+    free( workers );
+    free( threads );
+
+    /* Connect local strategies in the order of goal modes, as would be
+       done by sequential patching. */
+    for (i = 0; i < num_tasks; i++) {
+        if (failed || (tasks+i)->local_strategy == NULL) {
+            failed = True;
+            delete_aut( (tasks+i)->local_strategy );
+            free( (tasks+i)->Entry );
+            free( (tasks+i)->Exit );
+            free( (tasks+i)->in_N );
+            continue;
+        }
+        result = localfixpoint_merge( num_env, num_sys, strategy,
+                                      affected, affected_len, N_index, sidx,
+                                      tasks+i, verbose );
+        if (result == NULL) {
+            failed = True;
+        } else {
+            strategy = result;
+        }
+    }
+    free( tasks );
+
+    if (failed) {
+        delete_aut( strategy );
+        return NULL;
+    }
+    return strategy;
+}
+
+
 anode_t *patch_localfixpoint( DdManager *manager,
                               FILE *strategy_fp, FILE *change_fp,
                               int original_num_env, int original_num_sys,
                               ptree_t *nonbool_var_list, int *offw,
                               unsigned char verbose )
+{
+    anode_t *strategy;
+
+    if (change_fp == NULL)
+        return NULL;  /* Require game changes to be listed in an open stream. */
+
+    if (strategy_fp == NULL)
+        strategy_fp = stdin;
+
+    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
+    if (strategy == NULL) {
+        return NULL;
+    }
+    if (verbose)
+        logprint( "Read in strategy of size %d", aut_size( strategy ) );
+
+    if (tree_size( spc.nonbool_var_list ) > 0) {
+        if (verbose > 1)
+            logprint( "Expanding nonbool variables in the given strategy"
+                      " automaton..." );
+        if (aut_expand_bool( strategy,
+                             spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
+            fprintf( stderr,
+                     "Error patch_localfixpoint: Failed to expand"
+                     " nonboolean variables in given automaton." );
+            return NULL;
+        }
+        if (verbose > 1) {
+            logprint( "Given strategy after variable expansion:" );
+            logprint_startline();
+            dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
+                          getlogstream() );
+            logprint_endline();
+        }
+    }
+
+    return patch_localfixpoint_aut( manager, strategy, change_fp,
+                                    original_num_env, original_num_sys,
+                                    offw, NULL, verbose );
+}
+
+
+#define INPUT_STRING_LEN 1024
+anode_t *patch_localfixpoint_aut( DdManager *manager,
+                                  anode_t *strategy, FILE *change_fp,
+                                  int original_num_env, int original_num_sys,
+                                  int *offw, patch_bdds_t *bdds,
+                                  unsigned char verbose )
 {
     ptree_t *var_separator;
     DdNode *etrans, *strans, **egoals;
@@ -374,11 +920,15 @@ anode_t *patch_localfixpoint( DdManager *manager,
     int i, j, k;  /* Generic counters */
     DdNode *tmp, *tmp2;
     int num_read;
-    anode_t *strategy, *result_strategy;
+    anode_t *result_strategy;
     anode_t *node, *head;
-    int node_counter;
     vartype **N = NULL;  /* "neighborhood" of states */
     int N_len = 0;
+    stateidx_t *N_index = NULL;
+    stratidx_t *sidx = NULL;  /* Index of the given strategy */
+    int *preds = NULL;  /* Positions in sidx of nodes affected by blocksys */
+    int preds_len;
+    int m;
     int goal_mode;
     DdNode *N_BDD = NULL;  /* Characteristic function for set of states N. */
     bool break_flag;
@@ -388,47 +938,22 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                     set change.  Called U_i in the
                                     manuscript. */
     int *affected_len = NULL;  /* Lengths of arrays in affected */
+    int num_affected;  /* Number of goal modes with nonempty U_i */
 
     DdNode **vars, **pvars;
     int *cube;
     DdNode *ddval;
 
-    if (change_fp == NULL)
-        return NULL;  /* Require game changes to be listed in an open stream. */
-
-    if (strategy_fp == NULL)
-        strategy_fp = stdin;
+    if (change_fp == NULL || strategy == NULL) {
+        delete_aut( strategy );
+        return NULL;
+    }
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
-    if (strategy == NULL) {
-        return NULL;
-    }
-    if (verbose)
-        logprint( "Read in strategy of size %d", aut_size( strategy ) );
-
     num_nonbool = tree_size( spc.nonbool_var_list );
     if (num_nonbool > 0) {
-        if (verbose > 1)
-            logprint( "Expanding nonbool variables in the given strategy"
-                      " automaton..." );
-        if (aut_expand_bool( strategy,
-                             spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
-            fprintf( stderr,
-                     "Error patch_localfixpoint: Failed to expand"
-                     " nonboolean variables in given automaton." );
-            return NULL;
-        }
-        if (verbose > 1) {
-            logprint( "Given strategy after variable expansion:" );
-            logprint_startline();
-            dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
-                          getlogstream() );
-            logprint_endline();
-        }
-
         num_enonbool = 0;
         while (*(offw+2*num_enonbool) < num_env)
             num_enonbool++;
@@ -494,6 +1019,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
             free( affected );
             free( affected_len );
             free( cube );
+            delete_aut( strategy );
             return NULL;
         }
 
@@ -514,6 +1040,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                 free( affected );
                 free( affected_len );
                 free( cube );
+                delete_aut( strategy );
                 return NULL;
             }
             free( state );
@@ -544,6 +1071,11 @@ anode_t *patch_localfixpoint( DdManager *manager,
     }
     ddval = NULL;
 
+    /* Index N and the strategy, so that affected nodes and Entry and
+       Exit sets can be found without scanning the strategy. */
+    N_index = stateidx_new( N, N_len, num_env+num_sys );
+    sidx = stratidx_new( strategy, spc.num_sgoals, num_env, num_sys );
+
     /* Chain together environment and system variable lists for
        working with BDD library. */
     if (spc.evar_list == NULL) {
@@ -560,6 +1092,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
             free( affected );
             free( affected_len );
             free( cube );
+            delete_aut( strategy );
             return NULL;
         }
         var_separator->left = spc.svar_list;
@@ -576,7 +1109,13 @@ anode_t *patch_localfixpoint( DdManager *manager,
         logprint_raw( "Relevant env trans (one per line):" );
     }
     for (i = 0; i < spc.et_array_len; i++) {
-        etrans_part = ptree_BDD( *(spc.env_trans_array+i), spc.evar_list, manager );
+        if (bdds != NULL) {
+            etrans_part = *(bdds->etrans_parts+i);
+            Cudd_Ref( etrans_part );
+        } else {
+            etrans_part = ptree_BDD_symtab( *(spc.env_trans_array+i),
+                                            spc.var_st, manager );
+        }
         for (j = 0; j < N_len; j++) {
             for (k = 0; k < num_env+num_sys; k++) {
                 *(cube+k) = *(*(N+j)+k);
@@ -587,6 +1126,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                 fprintf( stderr,
                          "Error patch_localfixpoint: building characteristic"
                          " function of N." );
+                delete_aut( strategy );
                 return NULL;
             }
             Cudd_Ref( ddval );
@@ -595,6 +1135,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
             if (tmp2 == NULL) {
                 fprintf( stderr,
                          "Error patch_localfixpoint: computing cofactor." );
+                delete_aut( strategy );
                 return NULL;
             }
             Cudd_Ref( tmp2 );
@@ -636,7 +1177,13 @@ anode_t *patch_localfixpoint( DdManager *manager,
         logprint_raw( "Relevant sys trans (one per line):" );
     }
     for (i = 0; i < spc.st_array_len; i++) {
-        strans_part = ptree_BDD( *(spc.sys_trans_array+i), spc.evar_list, manager );
+        if (bdds != NULL) {
+            strans_part = *(bdds->strans_parts+i);
+            Cudd_Ref( strans_part );
+        } else {
+            strans_part = ptree_BDD_symtab( *(spc.sys_trans_array+i),
+                                            spc.var_st, manager );
+        }
         for (j = 0; j < N_len; j++) {
             for (k = 0; k < num_env+num_sys; k++) {
                 *(cube+k) = *(*(N+j)+k);
@@ -647,6 +1194,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                 fprintf( stderr,
                          "Error patch_localfixpoint: building characteristic"
                          " function of N." );
+                delete_aut( strategy );
                 return NULL;
             }
             Cudd_Ref( ddval );
@@ -655,6 +1203,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
             if (tmp2 == NULL) {
                 fprintf( stderr,
                          "Error patch_localfixpoint: computing cofactor." );
+                delete_aut( strategy );
                 return NULL;
             }
             Cudd_Ref( tmp2 );
@@ -691,8 +1240,15 @@ anode_t *patch_localfixpoint( DdManager *manager,
     /* Build goal BDDs, if present. */
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
-        for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+        for (i = 0; i < spc.num_egoals; i++) {
+            if (bdds != NULL) {
+                *(egoals+i) = *(bdds->egoals+i);
+                Cudd_Ref( *(egoals+i) );
+            } else {
+                *(egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i), spc.var_st,
+                                                manager );
+            }
+        }
     } else {
         egoals = NULL;
     }
@@ -732,6 +1288,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                     fprintf( stderr,
                              "Error: invalid arguments to restrict or relax"
                              " command.\n" );
+                    delete_aut( strategy );
                     return NULL;
                 }
 
@@ -745,6 +1302,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                      "Error patch_localfixpoint: failed to"
                                      " expand nonbool values in edge change"
                                      " file\n" );
+                            delete_aut( strategy );
                             return NULL;
                         }
                         free( state_frag );
@@ -757,6 +1315,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                      "Error patch_localfixpoint: failed to"
                                      " expand nonbool values in edge change"
                                      " file\n" );
+                            delete_aut( strategy );
                             return NULL;
                         }
                         free( state_frag );
@@ -790,8 +1349,9 @@ anode_t *patch_localfixpoint( DdManager *manager,
 
                 /* Find nodes in strategy that are affected by this change */
                 for (j = 0; j < spc.num_sgoals; j++) {
-                    node = find_anode( strategy, j, state, num_env+num_sys );
-                    while (node != NULL) {
+                    m = stateidx_find( *(sidx->by_mode+j), state );
+                    while (m >= 0) {
+                        node = *(sidx->nodes + *(*(sidx->mode_nodes+j)+m));
                         if (!strncmp( line, "restrict ", strlen( "restrict " ) )
                             && (num_read
                                 == 2*(original_num_env+original_num_sys))) {
@@ -812,16 +1372,12 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                     }
                                     /* If affected state is not in N,
                                        then fail. */
-                                    for (i = 0; i < N_len; i++) {
-                                        if (statecmp( state, *(N+i),
-                                                      num_env+num_sys ))
-                                            break;
-                                    }
-                                    if (i == N_len) {
+                                    if (stateidx_find( N_index, state ) < 0) {
                                         fprintf( stderr,
                                                  "Error patch_localfixpoint:"
                                                  " affected state not"
                                                  " contained in N.\n" );
+                                        delete_aut( strategy );
                                         return NULL;
                                     }
                                     *(*(affected + node->mode)
@@ -850,16 +1406,12 @@ anode_t *patch_localfixpoint( DdManager *manager,
                                     exit(-1);
                                 }
                                 /* If affected state is not in N, then fail. */
-                                for (i = 0; i < N_len; i++) {
-                                    if (statecmp( state, *(N+i),
-                                                  num_env+num_sys ))
-                                        break;
-                                }
-                                if (i == N_len) {
+                                if (stateidx_find( N_index, state ) < 0) {
                                     fprintf( stderr,
                                              "Error patch_localfixpoint:"
                                              " affected state not contained"
                                              " in N.\n" );
+                                    delete_aut( strategy );
                                     return NULL;
                                 }
                                 *(*(affected + node->mode)
@@ -867,7 +1419,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                             }
                         }
 
-                        node = find_anode( node->next, j, state, num_env+num_sys );
+                        m = stateidx_next( *(sidx->by_mode+j), m );
                     }
                 }
 
@@ -918,6 +1470,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                     fprintf( stderr,
                              "Error: invalid arguments to blocksys"
                              " command.\n%d\n%s\n", num_read, line );
+                    delete_aut( strategy );
                     return NULL;
                 }
                 if (num_nonbool > 0) {
@@ -933,6 +1486,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                         fprintf( stderr,
                                  "Error patch_localfixpoint: failed to expand"
                                  " nonbool values in edge change file\n" );
+                        delete_aut( strategy );
                         return NULL;
                     }
                     free( state_frag );
@@ -946,41 +1500,50 @@ anode_t *patch_localfixpoint( DdManager *manager,
                     logprint_endline();
                 }
 
-                /* Find nodes in strategy that are affected by this change */
-                head = strategy;
-                node_counter = 0;
-                while (head) {
-                    for (i = 0; i < head->trans_len; i++) {
-                        if (statecmp( state, (*(head->trans+i))->state+num_env,
-                                      num_sys )) {
-                            (*(affected_len + head->mode))++;
-                            *(affected + head->mode)
-                                = realloc( *(affected + head->mode),
-                                           sizeof(anode_t *)
-                                           *(*(affected_len + head->mode)) );
-                            if (*(affected + head->mode) == NULL) {
-                                perror( "patch_localfixpoint, realloc" );
-                                exit(-1);
-                            }
-                            /* If affected state is not in N, then fail. */
-                            for (i = 0; i < N_len; i++) {
-                                if (statecmp( head->state, *(N+i),
-                                              num_env+num_sys ))
-                                    break;
-                            }
-                            if (i == N_len) {
-                                fprintf( stderr,
-                                         "Error patch_localfixpoint: affected"
-                                         " state not contained in N.\n" );
-                                return NULL;
-                            }
-                            *(*(affected + head->mode)
-                              + *(affected_len + head->mode)-1) = head;
-                            break;
-                        }
+                /* Find nodes in strategy that are affected by this
+                   change, i.e., predecessors of nodes with the blocked
+                   system state, in the order of the node list. */
+                preds_len = 0;
+                m = stateidx_find( sidx->by_sys, state );
+                while (m >= 0) {
+                    preds = realloc( preds, sizeof(int)
+                                     *(preds_len + *(sidx->pred_off+m+1)
+                                       - *(sidx->pred_off+m) + 1) );
+                    if (preds == NULL) {
+                        perror( "patch_localfixpoint, realloc" );
+                        exit(-1);
+                    }
+                    for (k = *(sidx->pred_off+m);
+                         k < *(sidx->pred_off+m+1); k++) {
+                        *(preds+preds_len) = *(sidx->pred+k);
+                        preds_len++;
                     }
-                    head = head->next;
-                    node_counter++;
+                    m = stateidx_next( sidx->by_sys, m );
+                }
+                qsort( preds, preds_len, sizeof(int), aut_intcmp );
+                for (k = 0; k < preds_len; k++) {
+                    if (k > 0 && *(preds+k) == *(preds+k-1))
+                        continue;
+                    head = *(sidx->nodes + *(preds+k));
+                    (*(affected_len + head->mode))++;
+                    *(affected + head->mode)
+                        = realloc( *(affected + head->mode),
+                                   sizeof(anode_t *)
+                                   *(*(affected_len + head->mode)) );
+                    if (*(affected + head->mode) == NULL) {
+                        perror( "patch_localfixpoint, realloc" );
+                        exit(-1);
+                    }
+                    /* If affected state is not in N, then fail. */
+                    if (stateidx_find( N_index, head->state ) < 0) {
+                        fprintf( stderr,
+                                 "Error patch_localfixpoint: affected"
+                                 " state not contained in N.\n" );
+                        delete_aut( strategy );
+                        return NULL;
+                    }
+                    *(*(affected + head->mode)
+                      + *(affected_len + head->mode)-1) = head;
                 }
 
                 vertex2 = state_to_BDD( manager, state,
@@ -1002,6 +1565,7 @@ anode_t *patch_localfixpoint( DdManager *manager,
                 fprintf( stderr,
                          "Error patch_localfixpoint: unrecognized line in"
                          " given edge change file.\n" );
+                delete_aut( strategy );
                 return NULL;
             }
         } while (fgets( line, INPUT_STRING_LEN, change_fp ));
@@ -1018,22 +1582,50 @@ anode_t *patch_localfixpoint( DdManager *manager,
     if (!Cudd_SetVarMap( manager, vars, pvars, num_env+num_sys )) {
         fprintf( stderr,
                  "Error: failed to define variable map in CUDD manager.\n" );
+        delete_aut( strategy );
         return NULL;
     }
     free( vars );
     free( pvars );
 
+    /* Local reachability games of different goal modes are
+       independent, so solve them concurrently if several threads are
+       available; cf. setsolverthreads().  Checkpoints of
+       synthesize_reachgame() are per process, so they preclude this. */
+    num_affected = 0;
     for (goal_mode = 0; goal_mode < spc.num_sgoals; goal_mode++) {
-
-        result_strategy = localfixpoint_goalmode( manager, num_env, num_sys,
-                                                  strategy, goal_mode,
+        if (*(affected_len + goal_mode) > 0)
+            num_affected++;
+    }
+    if (num_affected > 1 && getsolverthreads() > 1 && !checkpoint_enabled()) {
+        result_strategy = localfixpoint_parallel( manager, num_env, num_sys,
+                                                  strategy,
                                                   affected, affected_len,
                                                   etrans, strans, egoals,
-                                                  N_BDD, N, N_len,
+                                                  N_BDD, N_index, sidx,
+                                                  getsolverthreads(),
                                                   verbose );
-        if (result_strategy == NULL)
-            break;
-        strategy = result_strategy;
+        if (result_strategy == NULL) {
+            goal_mode = -1;
+            strategy = NULL;  /* Freed by localfixpoint_parallel() */
+        } else {
+            strategy = result_strategy;
+            goal_mode = spc.num_sgoals;
+        }
+    } else {
+        for (goal_mode = 0; goal_mode < spc.num_sgoals; goal_mode++) {
+
+            result_strategy = localfixpoint_goalmode( manager,
+                                                      num_env, num_sys,
+                                                      strategy, goal_mode,
+                                                      affected, affected_len,
+                                                      etrans, strans, egoals,
+                                                      N_BDD, N_index, sidx,
+                                                      verbose );
+            if (result_strategy == NULL)
+                break;
+            strategy = result_strategy;
+        }
     }
 
     if (goal_mode != spc.num_sgoals) {  /* Did a local patching attempt fail? */
@@ -1058,6 +1650,9 @@ anode_t *patch_localfixpoint( DdManager *manager,
         free( spc.env_goals );
     }
     Cudd_RecursiveDeref( manager, N_BDD );
+    stateidx_free( N_index );
+    stratidx_free( sidx );
+    free( preds );
     for (i = 0; i < N_len; i++)
         free( *(N+i) );
     free( N );
@@ -13,6 +13,43 @@
 #include "automaton.h"
 
 
+/** BDDs of a specification that are used by the patching algorithms.
+   Building these once allows a sequence of patching operations (cf.
+   patch_serve()) to avoid constructing them again for every operation.
+   Components are referenced and belong to the manager given to
+   patch_bdds_new().  After patch_bdds_edit(), the transition BDDs
+   describe the changed game rather than the formulae in spc. */
+typedef struct {
+    DdNode **etrans_parts;  /* One per element of spc.env_trans_array */
+    DdNode **strans_parts;  /* One per element of spc.sys_trans_array */
+    DdNode *etrans;
+    DdNode *strans;
+
+    /* If the specification has no environment goals, then egoals has
+       one element, which is True. */
+    DdNode **egoals;
+    int num_egoals;
+
+    DdNode **sgoals;  /* One per element of spc.sys_goals */
+} patch_bdds_t;
+
+/** Build BDDs of the specification for use by the patching
+   algorithms.  The caller is responsible for freeing the result with
+   patch_bdds_free().  Return NULL if error. */
+patch_bdds_t *patch_bdds_new( DdManager *manager );
+void patch_bdds_free( DdManager *manager, patch_bdds_t *bdds );
+
+/** Apply the restrict, relax, and blocksys commands of an edge change
+   file (as given to patch_localfixpoint()) to the transition BDDs in
+   bdds, including each of etrans_parts and strans_parts, so that later
+   patching operations are against the changed game.  Lines that list
+   states of N are ignored.  The specification must not have nonboolean
+   variables.  Return 0 on success, or -1 if error, in which case bdds
+   may be partially changed. */
+int patch_bdds_edit( DdManager *manager, patch_bdds_t *bdds,
+                     FILE *change_fp );
+
+
 /** Implementation of algorithm from [[LPJM13]](md_papers.html#LPJM13)
 
      S.C. Livingston, P. Prabhakar, A.B. Jose, R.M. Murray.
@@ -36,6 +73,20 @@ anode_t *patch_localfixpoint( DdManager *manager,
                               ptree_t *nonbool_var_list, int *offw,
                               unsigned char verbose );
 
+/** Variant of patch_localfixpoint() that operates on a strategy
+   already in memory, with nonboolean variables expanded.  If bdds is
+   not NULL, then it is used instead of constructing the BDDs of the
+   specification.
+
+   The given strategy is consumed: it becomes part of the returned
+   strategy, or it is freed if NULL is returned to indicate error.  Use
+   aut_copy() to preserve it. */
+anode_t *patch_localfixpoint_aut( DdManager *manager,
+                                  anode_t *strategy, FILE *change_fp,
+                                  int original_num_env, int original_num_sys,
+                                  int *offw, patch_bdds_t *bdds,
+                                  unsigned char verbose );
+
 /** Solve a reachability game symbolically, by blocking an environment
    goal or reaching Exit from Entry.  States are restricted to the set
    N (given as a characteristic function named N_BDD). */
@@ -64,6 +115,17 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
                              int *offw, int num_metric_vars,
                              ptree_t *new_sysgoal, unsigned char verbose );
 
+/** Variant of add_metric_sysgoal() that operates on a strategy already
+   in memory.  bdds is as for patch_localfixpoint_aut().  If new_mode
+   is not NULL, then the index in the goal visitation sequence at which
+   the new system goal was inserted is saved in it; the caller must
+   update the specification accordingly.  The given strategy is
+   consumed, as for patch_localfixpoint_aut(). */
+anode_t *add_metric_sysgoal_aut( DdManager *manager, anode_t *strategy,
+                                 int *offw, int num_metric_vars,
+                                 ptree_t *new_sysgoal, patch_bdds_t *bdds,
+                                 int *new_mode, unsigned char verbose );
+
 /** Implementation of algorithm from [[LM14]](md_papers.html#LM14) for removing sys goals
 
      S.C. Livingston, R.M. Murray.
@@ -97,4 +159,26 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
                      int original_num_env, int original_num_sys,
                      int delete_i, unsigned char verbose );
 
+/** Variant of rm_sysgoal() that operates on a strategy already in
+   memory.  bdds is as for patch_localfixpoint_aut().  The given
+   strategy is consumed, as for patch_localfixpoint_aut(), including
+   when the call is vacuous. */
+anode_t *rm_sysgoal_aut( DdManager *manager, anode_t *strategy,
+                         int delete_i, patch_bdds_t *bdds,
+                         unsigned char verbose );
+
+/** Load the strategy from strategy_fp (stdin if NULL) and the BDDs of
+   the specification once, and then apply patching commands read from
+   infp, one after another, to the strategy in memory.  After each
+   command, write to outfp the nodes that changed.  The protocol is
+   described in [external_notes](md_formats.html).  The specification
+   must not have nonboolean variables.
+
+   Return 0 on success (including if some commands failed), or -1 if
+   error. */
+int patch_serve( DdManager *manager, FILE *strategy_fp,
+                 FILE *infp, FILE *outfp,
+                 int original_num_env, int original_num_sys,
+                 int *offw, int num_metric_vars, unsigned char verbose );
+
 #endif
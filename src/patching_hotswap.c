@@ -17,9 +17,7 @@
 #include "solve.h"
 #include "solve_support.h"
 #include "solve_metric.h"
-
-
-extern specification_t spc;
+#include "context.h"
 
 
 /* Defined in patching.c */
@@ -38,12 +36,51 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
                              int original_num_env, int original_num_sys,
                              int *offw, int num_metric_vars,
                              ptree_t *new_sysgoal, unsigned char verbose )
+{
+    anode_t *strategy;
+
+    if (strategy_fp == NULL)
+        strategy_fp = stdin;
+
+    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
+    if (strategy == NULL) {
+        return NULL;
+    }
+    if (verbose)
+        logprint( "Read in strategy of size %d", aut_size( strategy ) );
+
+    if (verbose > 1)
+        logprint( "Expanding nonbool variables in the given strategy"
+                  " automaton..." );
+    if (aut_expand_bool( strategy, spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
+        fprintf( stderr,
+                 "Error add_metric_sysgoal: Failed to expand nonboolean"
+                 " variables in given automaton." );
+        return NULL;
+    }
+    if (verbose > 1) {
+        logprint( "Given strategy after variable expansion:" );
+        logprint_startline();
+        dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
+                      getlogstream() );
+        logprint_endline();
+    }
+
+    return add_metric_sysgoal_aut( manager, strategy, offw, num_metric_vars,
+                                   new_sysgoal, NULL, NULL, verbose );
+}
+
+
+anode_t *add_metric_sysgoal_aut( DdManager *manager, anode_t *strategy,
+                                 int *offw, int num_metric_vars,
+                                 ptree_t *new_sysgoal, patch_bdds_t *bdds,
+                                 int *new_mode, unsigned char verbose )
 {
     ptree_t *var_separator;
     DdNode *etrans, *strans, **egoals, **sgoals;
     bool env_nogoal_flag = False;  /* Indicate environment has no goals */
 
-    anode_t *strategy = NULL, *component_strategy;
+    anode_t *component_strategy;
     int num_env, num_sys;
     anode_t *node1, *node2;
 
@@ -68,36 +105,12 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
     DdNode *tmp, *tmp2;
     DdNode **vars, **pvars;
 
-    if (strategy_fp == NULL)
-        strategy_fp = stdin;
+    if (strategy == NULL)
+        return NULL;
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
-    if (strategy == NULL) {
-        return NULL;
-    }
-    if (verbose)
-        logprint( "Read in strategy of size %d", aut_size( strategy ) );
-
-    if (verbose > 1)
-        logprint( "Expanding nonbool variables in the given strategy"
-                  " automaton..." );
-    if (aut_expand_bool( strategy, spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
-        fprintf( stderr,
-                 "Error add_metric_sysgoal: Failed to expand nonboolean"
-                 " variables in given automaton." );
-        return NULL;
-    }
-    if (verbose > 1) {
-        logprint( "Given strategy after variable expansion:" );
-        logprint_startline();
-        dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
-                      getlogstream() );
-        logprint_endline();
-    }
-
     /* Set environment goal to True (i.e., any state) if none was
        given. This simplifies the implementation below. */
     if (spc.num_egoals == 0) {
@@ -119,40 +132,63 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
             fprintf( stderr,
                      "Error: get_list_item failed on environment variables"
                      " list.\n" );
+            delete_aut( strategy );
             return NULL;
         }
         var_separator->left = spc.svar_list;
     }
 
-    /* Generate BDDs for the various parse trees from the problem spec. */
-    if (verbose > 1)
-        logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
-    if (verbose > 1) {
-        logprint( "Done." );
-        logprint( "Building system transition BDD..." );
+    /* Generate BDDs for the various parse trees from the problem spec,
+       unless they were given. */
+    if (bdds != NULL) {
+        etrans = bdds->etrans;
+        Cudd_Ref( etrans );
+        strans = bdds->strans;
+        Cudd_Ref( strans );
+    } else {
+        if (verbose > 1)
+            logprint( "Building environment transition BDD..." );
+        etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
+        if (verbose > 1) {
+            logprint( "Done." );
+            logprint( "Building system transition BDD..." );
+        }
+        strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Done." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
-    if (verbose > 1)
-        logprint( "Done." );
 
     /* Build goal BDDs, if present. */
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
-        for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+        for (i = 0; i < spc.num_egoals; i++) {
+            if (bdds != NULL) {
+                *(egoals+i) = *(bdds->egoals+i);
+                Cudd_Ref( *(egoals+i) );
+            } else {
+                *(egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i), spc.var_st,
+                                                manager );
+            }
+        }
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
-        for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+        for (i = 0; i < spc.num_sgoals; i++) {
+            if (bdds != NULL) {
+                *(sgoals+i) = *(bdds->sgoals+i);
+                Cudd_Ref( *(sgoals+i) );
+            } else {
+                *(sgoals+i) = ptree_BDD_symtab( *(spc.sys_goals+i), spc.var_st,
+                                                manager );
+            }
+        }
     } else {
         sgoals = NULL;
     }
 
-    new_sgoal = ptree_BDD( new_sysgoal, spc.evar_list, manager );
+    new_sgoal = ptree_BDD_symtab( new_sysgoal, spc.var_st, manager );
 
     if (var_separator == NULL) {
         spc.evar_list = NULL;
@@ -176,6 +212,7 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
                          "Error add_metric_sysgoal: bounds_DDset() failed to"
                          " compute distance from original goal %d",
                          i );
+                delete_aut( strategy );
                 return NULL;
             }
         }
@@ -266,6 +303,7 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
     if (!Cudd_SetVarMap( manager, vars, pvars, num_env+num_sys )) {
         fprintf( stderr,
                  "Error: failed to define variable map in CUDD manager.\n" );
+        delete_aut( strategy );
         return NULL;
     }
     free( vars );
@@ -502,6 +540,8 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
     Gi_succ = NULL;
 
     /* Update labels, thus completing the insertion process */
+    if (new_mode != NULL)
+        *new_mode = (istar[0] == spc.num_sgoals-1) ? spc.num_sgoals : istar[1];
     if (istar[0] == spc.num_sgoals-1) {
         node1 = strategy;
         while (node1) {
@@ -562,12 +602,49 @@ anode_t *add_metric_sysgoal( DdManager *manager, FILE *strategy_fp,
 anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
                      int original_num_env, int original_num_sys,
                      int delete_i, unsigned char verbose )
+{
+    anode_t *strategy;
+
+    if (strategy_fp == NULL)
+        strategy_fp = stdin;
+
+    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
+    if (strategy == NULL) {
+        return NULL;
+    }
+    if (verbose)
+        logprint( "Read in strategy of size %d", aut_size( strategy ) );
+
+    if (verbose > 1)
+        logprint( "Expanding nonbool variables in the given strategy"
+                  " automaton..." );
+    if (aut_expand_bool( strategy,
+                         spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
+        fprintf( stderr,
+                 "Error rm_sysgoal: Failed to expand nonboolean variables"
+                 " in given automaton." );
+        return NULL;
+    }
+    if (verbose > 1) {
+        logprint( "Given strategy after variable expansion:" );
+        logprint_startline();
+        dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
+                      getlogstream() );
+        logprint_endline();
+    }
+
+    return rm_sysgoal_aut( manager, strategy, delete_i, NULL, verbose );
+}
+
+
+anode_t *rm_sysgoal_aut( DdManager *manager, anode_t *strategy,
+                         int delete_i, patch_bdds_t *bdds,
+                         unsigned char verbose )
 {
     ptree_t *var_separator;
     DdNode *etrans, *strans, **egoals;
     bool env_nogoal_flag = False;  /* Indicate environment has no goals */
 
-    anode_t *strategy = NULL;
     int num_env, num_sys;
     int num_del_nodes = 0;
 
@@ -581,49 +658,27 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
     DdNode **vars, **pvars;
     DdNode *tmp;
 
-    if (strategy_fp == NULL)
-        strategy_fp = stdin;
+    if (strategy == NULL)
+        return NULL;
 
     if (delete_i < 0 || delete_i >= spc.num_sgoals) {
         logprint( "Error rm_sysgoal: invoked with goal index %d outside"
                   " bounds [0,%d]",
                   delete_i,
                   spc.num_sgoals-1 );
+        delete_aut( strategy );
         return NULL;
     }
     if (spc.num_sgoals < 3) {
         logprint( "Error rm_sysgoal: Current implementation requires at"
                   " least 3 initial system goals." );
+        delete_aut( strategy );
         return NULL;
     }
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
-    if (strategy == NULL) {
-        return NULL;
-    }
-    if (verbose)
-        logprint( "Read in strategy of size %d", aut_size( strategy ) );
-
-    if (verbose > 1)
-        logprint( "Expanding nonbool variables in the given strategy"
-                  " automaton..." );
-    if (aut_expand_bool( strategy,
-                         spc.evar_list, spc.svar_list, spc.nonbool_var_list )) {
-        fprintf( stderr,
-                 "Error rm_sysgoal: Failed to expand nonboolean variables"
-                 " in given automaton." );
-        return NULL;
-    }
-    if (verbose > 1) {
-        logprint( "Given strategy after variable expansion:" );
-        logprint_startline();
-        dot_aut_dump( strategy, spc.evar_list, spc.svar_list, DOT_AUT_ATTRIB,
-                      getlogstream() );
-        logprint_endline();
-    }
 
     /* Set environment goal to True (i.e., any state) if none was
        given. This simplifies the implementation below. */
@@ -646,28 +701,44 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
             fprintf( stderr,
                      "Error: get_list_item failed on environment variables"
                      " list.\n" );
+            delete_aut( strategy );
             return NULL;
         }
         var_separator->left = spc.svar_list;
     }
 
-    /* Generate BDDs for the various parse trees from the problem spec. */
-    if (verbose > 1)
-        logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
-    if (verbose > 1) {
-        logprint( "Done." );
-        logprint( "Building system transition BDD..." );
+    /* Generate BDDs for the various parse trees from the problem spec,
+       unless they were given. */
+    if (bdds != NULL) {
+        etrans = bdds->etrans;
+        Cudd_Ref( etrans );
+        strans = bdds->strans;
+        Cudd_Ref( strans );
+    } else {
+        if (verbose > 1)
+            logprint( "Building environment transition BDD..." );
+        etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
+        if (verbose > 1) {
+            logprint( "Done." );
+            logprint( "Building system transition BDD..." );
+        }
+        strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Done." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
-    if (verbose > 1)
-        logprint( "Done." );
 
     /* Build goal BDDs, if present. */
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
-        for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+        for (i = 0; i < spc.num_egoals; i++) {
+            if (bdds != NULL) {
+                *(egoals+i) = *(bdds->egoals+i);
+                Cudd_Ref( *(egoals+i) );
+            } else {
+                *(egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i), spc.var_st,
+                                                manager );
+            }
+        }
     } else {
         egoals = NULL;
     }
@@ -697,6 +768,7 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
         if (verbose)
             logprint( "rm_sysgoal: Did not find nodes to be deleted "
                       "nor nodes of successor mode." );
+        delete_aut( strategy );
         return NULL;
     }
 
@@ -786,6 +858,7 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
                  "Error: failed to define variable map in CUDD manager.\n" );
         free( Entry );
         free( Exit );
+        delete_aut( strategy );
         return NULL;
     }
     free( vars );
@@ -803,6 +876,7 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
         free( Exit );
         free( Entry );
         /* XXX Need to free other resources, e.g., etrans */
+        delete_aut( strategy );
         return NULL;
     }
     if (verbose > 1) {
@@ -823,6 +897,7 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
             fprintf( stderr,
                      "Error rm_sysgoal: expected Entry node"
                      " missing from local strategy" );
+            delete_aut( strategy );
             return NULL;
         }
 
@@ -844,6 +919,7 @@ anode_t *rm_sysgoal( DdManager *manager, FILE *strategy_fp,
                 fprintf( stderr,
                          "Error rm_sysgoal: terminal node in"
                          " local strategy does not have a\nmatch in Exit\n" );
+                delete_aut( strategy );
                 return NULL;
             }
 
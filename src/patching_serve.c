@@ -0,0 +1,573 @@
+/* patching_serve.c -- Apply a stream of patching commands to a strategy
+ *                     kept in memory; cf. patch_serve() in patching.h.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "logging.h"
+#include "automaton.h"
+#include "ptree.h"
+#include "patching.h"
+#include "solve_support.h"
+#include "context.h"
+
+
+/* Defined in automaton.c */
+extern int anode_ptrcmp( const void *p1, const void *p2 );
+
+
+#define INPUT_STRING_LEN 1024
+#define SERVE_END_MARK "---"
+
+
+/* Build the BDD of a state formula over the variables of the
+   specification. */
+DdNode *serve_formula_BDD( DdManager *manager, ptree_t *formula )
+{
+    return ptree_BDD_symtab( formula, spc.var_st, manager );
+}
+
+
+patch_bdds_t *patch_bdds_new( DdManager *manager )
+{
+    patch_bdds_t *bdds;
+    int i;
+
+    bdds = malloc( sizeof(patch_bdds_t) );
+    if (bdds == NULL) {
+        perror( "patch_bdds_new, malloc" );
+        exit(-1);
+    }
+    bdds->etrans_parts = malloc( spc.et_array_len*sizeof(DdNode *) );
+    bdds->strans_parts = malloc( spc.st_array_len*sizeof(DdNode *) );
+    bdds->num_egoals = (spc.num_egoals > 0) ? spc.num_egoals : 1;
+    bdds->egoals = malloc( bdds->num_egoals*sizeof(DdNode *) );
+    bdds->sgoals = malloc( (spc.num_sgoals > 0 ? spc.num_sgoals : 1)
+                           *sizeof(DdNode *) );
+    if (bdds->etrans_parts == NULL || bdds->strans_parts == NULL
+        || bdds->egoals == NULL || bdds->sgoals == NULL) {
+        perror( "patch_bdds_new, malloc" );
+        exit(-1);
+    }
+
+    for (i = 0; i < spc.et_array_len; i++) {
+        *(bdds->etrans_parts+i) = serve_formula_BDD( manager,
+                                                     *(spc.env_trans_array+i) );
+        if (*(bdds->etrans_parts+i) == NULL)
+            return NULL;
+    }
+    for (i = 0; i < spc.st_array_len; i++) {
+        *(bdds->strans_parts+i) = serve_formula_BDD( manager,
+                                                     *(spc.sys_trans_array+i) );
+        if (*(bdds->strans_parts+i) == NULL)
+            return NULL;
+    }
+    bdds->etrans = BDD_nary( bdds->etrans_parts, spc.et_array_len, PT_AND,
+                             manager );
+    bdds->strans = BDD_nary( bdds->strans_parts, spc.st_array_len, PT_AND,
+                             manager );
+
+    /* Environment goal is True (i.e., any state) if none was given. */
+    if (spc.num_egoals == 0) {
+        *(bdds->egoals) = Cudd_ReadOne( manager );
+        Cudd_Ref( *(bdds->egoals) );
+    } else {
+        for (i = 0; i < spc.num_egoals; i++)
+            *(bdds->egoals+i) = serve_formula_BDD( manager,
+                                                   *(spc.env_goals+i) );
+    }
+    for (i = 0; i < spc.num_sgoals; i++)
+        *(bdds->sgoals+i) = serve_formula_BDD( manager, *(spc.sys_goals+i) );
+
+    return bdds;
+}
+
+
+void patch_bdds_free( DdManager *manager, patch_bdds_t *bdds )
+{
+    int i;
+
+    if (bdds == NULL)
+        return;
+
+    for (i = 0; i < spc.et_array_len; i++)
+        Cudd_RecursiveDeref( manager, *(bdds->etrans_parts+i) );
+    for (i = 0; i < spc.st_array_len; i++)
+        Cudd_RecursiveDeref( manager, *(bdds->strans_parts+i) );
+    Cudd_RecursiveDeref( manager, bdds->etrans );
+    Cudd_RecursiveDeref( manager, bdds->strans );
+    for (i = 0; i < bdds->num_egoals; i++)
+        Cudd_RecursiveDeref( manager, *(bdds->egoals+i) );
+    for (i = 0; i < spc.num_sgoals; i++)
+        Cudd_RecursiveDeref( manager, *(bdds->sgoals+i) );
+    free( bdds->etrans_parts );
+    free( bdds->strans_parts );
+    free( bdds->egoals );
+    free( bdds->sgoals );
+    free( bdds );
+}
+
+
+/* Remove (if relax is False) or add (if relax is True) the edges in
+   edge_BDD in each of the len BDDs in parts, and in whole, which is
+   their conjunction. */
+void patch_bdds_fold( DdManager *manager, DdNode **parts, int len,
+                      DdNode **whole, DdNode *edge_BDD, byte relax )
+{
+    DdNode *tmp;
+    int i;
+
+    for (i = -1; i < len; i++) {
+        if (relax) {
+            tmp = Cudd_bddOr( manager, (i < 0) ? *whole : *(parts+i),
+                              edge_BDD );
+        } else {
+            tmp = Cudd_bddAnd( manager, (i < 0) ? *whole : *(parts+i),
+                               Cudd_Not( edge_BDD ) );
+        }
+        Cudd_Ref( tmp );
+        if (i < 0) {
+            Cudd_RecursiveDeref( manager, *whole );
+            *whole = tmp;
+        } else {
+            Cudd_RecursiveDeref( manager, *(parts+i) );
+            *(parts+i) = tmp;
+        }
+    }
+}
+
+
+int patch_bdds_edit( DdManager *manager, patch_bdds_t *bdds,
+                     FILE *change_fp )
+{
+    char line[INPUT_STRING_LEN];
+    vartype *state;
+    DdNode *vertex1, *vertex2, *edge_BDD;
+    int num_env, num_sys;
+    int num_read;
+    byte relax;
+
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+
+    while (fgets( line, INPUT_STRING_LEN, change_fp )) {
+        if (!strncmp( line, "restrict ", strlen( "restrict " ) )
+            || !strncmp( line, "relax ", strlen( "relax " ) )) {
+            relax = !strncmp( line, "relax ", strlen( "relax " ) );
+            num_read = read_state_str( strchr( line, ' ' )+1, &state,
+                                       2*(num_env+num_sys) );
+            if (num_read != 2*(num_env+num_sys)
+                && num_read != 2*num_env+num_sys) {
+                if (num_read > 0)
+                    free( state );
+                fprintf( stderr,
+                         "Error patch_bdds_edit: invalid arguments to"
+                         " restrict or relax command.\n" );
+                return -1;
+            }
+            vertex1 = state_to_BDD( manager, state, 0, num_env+num_sys );
+            vertex2 = state_to_BDD( manager, state+num_env+num_sys,
+                                    num_env+num_sys,
+                                    num_read-(num_env+num_sys) );
+            edge_BDD = Cudd_bddAnd( manager, vertex1, vertex2 );
+            Cudd_Ref( edge_BDD );
+            Cudd_RecursiveDeref( manager, vertex1 );
+            Cudd_RecursiveDeref( manager, vertex2 );
+            if (num_read == 2*num_env+num_sys) {
+                patch_bdds_fold( manager, bdds->etrans_parts,
+                                 spc.et_array_len, &(bdds->etrans),
+                                 edge_BDD, relax );
+            } else {
+                patch_bdds_fold( manager, bdds->strans_parts,
+                                 spc.st_array_len, &(bdds->strans),
+                                 edge_BDD, relax );
+            }
+            Cudd_RecursiveDeref( manager, edge_BDD );
+            free( state );
+
+        } else if (!strncmp( line, "blocksys ", strlen( "blocksys " ) )) {
+            num_read = read_state_str( line+strlen( "blocksys" )+1,
+                                       &state, num_sys );
+            if (num_read != num_sys) {
+                if (num_read > 0)
+                    free( state );
+                fprintf( stderr,
+                         "Error patch_bdds_edit: invalid arguments to"
+                         " blocksys command.\n" );
+                return -1;
+            }
+            edge_BDD = state_to_BDD( manager, state,
+                                     2*num_env+num_sys, num_sys );
+            patch_bdds_fold( manager, bdds->strans_parts, spc.st_array_len,
+                             &(bdds->strans), edge_BDD, False );
+            Cudd_RecursiveDeref( manager, edge_BDD );
+            free( state );
+        }
+    }
+
+    return 0;
+}
+
+
+/* Render each node of the strategy as it would appear (without the
+   leading ID) in the "gr1c automaton" format, version 1.  The number
+   of nodes is saved in *len.  Transitions are mapped to IDs through an
+   array of nodes sorted by address, rather than by anode_index(),
+   which would be quadratic in the size of the strategy. */
+char **serve_aut_lines( anode_t *head, int state_len, int *len )
+{
+    anode_t **nodes, **sorted, **target;
+    int *position;
+    anode_t *node;
+    char **lines;
+    size_t line_size;
+    FILE *linefp;
+    int n, i, j;
+
+    n = aut_size( head );
+    *len = n;
+    if (n == 0)
+        return NULL;
+
+    nodes = malloc( n*sizeof(anode_t *) );
+    sorted = malloc( n*sizeof(anode_t *) );
+    position = malloc( n*sizeof(int) );
+    lines = malloc( n*sizeof(char *) );
+    if (nodes == NULL || sorted == NULL || position == NULL || lines == NULL) {
+        perror( "serve_aut_lines, malloc" );
+        exit(-1);
+    }
+    for (node = head, i = 0; node != NULL; node = node->next, i++)
+        *(nodes+i) = *(sorted+i) = node;
+    qsort( sorted, n, sizeof(anode_t *), anode_ptrcmp );
+    for (i = 0; i < n; i++) {
+        target = bsearch( nodes+i, sorted, n, sizeof(anode_t *),
+                          anode_ptrcmp );
+        *(position + (target - sorted)) = i;
+    }
+
+    for (i = 0; i < n; i++) {
+        node = *(nodes+i);
+        linefp = open_memstream( lines+i, &line_size );
+        if (linefp == NULL) {
+            perror( "serve_aut_lines, open_memstream" );
+            exit(-1);
+        }
+        for (j = 0; j < state_len; j++)
+            fprintf( linefp, " %d", *(node->state+j) );
+        fprintf( linefp, " %d %d %d", node->initial, node->mode, node->rgrad );
+        for (j = 0; j < node->trans_len; j++) {
+            target = bsearch( node->trans+j, sorted, n, sizeof(anode_t *),
+                              anode_ptrcmp );
+            fprintf( linefp, " %d",
+                     (target == NULL) ? -1 : *(position + (target - sorted)) );
+        }
+        fclose( linefp );
+    }
+
+    free( nodes );
+    free( sorted );
+    free( position );
+    return lines;
+}
+
+
+void serve_free_lines( char **lines, int len )
+{
+    int i;
+    for (i = 0; i < len; i++)
+        free( *(lines+i) );
+    free( lines );
+}
+
+
+/* Write the nodes in lines that differ from those at the same position
+   in old_lines, followed by the end mark. */
+void serve_diff( char **old_lines, int old_len, char **lines, int len,
+                 FILE *outfp )
+{
+    int i;
+
+    fprintf( outfp, "size %d\n", len );
+    for (i = 0; i < len; i++) {
+        if (i >= old_len || strcmp( *(lines+i), *(old_lines+i) ))
+            fprintf( outfp, "%d%s\n", i, *(lines+i) );
+    }
+    fprintf( outfp, SERVE_END_MARK "\n" );
+}
+
+
+/* Parse a state formula given as a string, and check that it only
+   involves variables of the specification.  Return NULL if error. */
+ptree_t *serve_parse_formula( char *input )
+{
+    specification_t scratch;
+    ptree_t *formula = NULL;
+    ptree_t *tmppt = NULL;
+    char *badvar;
+    FILE *fp;
+
+    fp = fmemopen( input, strlen( input ), "r" );
+    if (fp == NULL) {
+        perror( "serve_parse_formula, fmemopen" );
+        return NULL;
+    }
+    SPC_INIT( scratch );
+    if (gr1c_parse( fp, &scratch, &formula )) {
+        fclose( fp );
+        delete_tree( formula );
+        return NULL;
+    }
+    fclose( fp );
+    if (formula == NULL)
+        return NULL;
+
+    if (spc.svar_list == NULL) {
+        spc.svar_list = spc.evar_list;
+    } else {
+        tmppt = get_list_item( spc.svar_list, -1 );
+        tmppt->left = spc.evar_list;
+    }
+    badvar = check_vars( formula, spc.svar_list, NULL );
+    if (tmppt != NULL) {
+        tmppt->left = NULL;
+    } else {
+        spc.svar_list = NULL;
+    }
+    if (badvar != NULL) {
+        fprintf( stderr,
+                 "Error serve_parse_formula: Unrecognized variable: %s\n",
+                 badvar );
+        free( badvar );
+        delete_tree( formula );
+        return NULL;
+    }
+
+    return formula;
+}
+
+
+int patch_serve( DdManager *manager, FILE *strategy_fp,
+                 FILE *infp, FILE *outfp,
+                 int original_num_env, int original_num_sys,
+                 int *offw, int num_metric_vars, unsigned char verbose )
+{
+    anode_t *strategy, *result;
+    patch_bdds_t *bdds;
+    char line[INPUT_STRING_LEN];
+    char *edit_buf;
+    size_t edit_size;
+    FILE *editfp;
+    ptree_t *formula;
+    DdNode *goal_BDD;
+    char **lines, **new_lines;
+    int len, new_len;
+    int num_env, num_sys;
+    int goal_mode;
+    int i;
+    anode_t *node;
+    char *endptr;
+
+    if (infp == NULL)
+        infp = stdin;
+    if (outfp == NULL)
+        outfp = stdout;
+    if (strategy_fp == NULL)
+        strategy_fp = stdin;
+
+    if (tree_size( spc.nonbool_var_list ) > 0) {
+        fprintf( stderr,
+                 "Error patch_serve: nonboolean variables are not supported.\n" );
+        return -1;
+    }
+
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+
+    strategy = aut_aut_load( original_num_env+original_num_sys, strategy_fp );
+    if (strategy == NULL)
+        return -1;
+    if (verbose)
+        logprint( "Read in strategy of size %d", aut_size( strategy ) );
+
+    bdds = patch_bdds_new( manager );
+    if (bdds == NULL) {
+        delete_aut( strategy );
+        return -1;
+    }
+
+    lines = serve_aut_lines( strategy, num_env+num_sys, &len );
+    serve_diff( NULL, 0, lines, len, outfp );
+    fflush( outfp );
+
+    while (fgets( line, INPUT_STRING_LEN, infp )) {
+        /* Blank or comment line? */
+        if (strlen( line ) < 1 || *line == '\n' || *line == '#')
+            continue;
+        if (*(line+strlen( line )-1) == '\n')
+            *(line+strlen( line )-1) = '\0';
+
+        if (!strncmp( line, "quit", strlen( "quit" ) )) {
+            break;
+        } else if (!strncmp( line, "dump", strlen( "dump" ) )) {
+            serve_diff( NULL, 0, lines, len, outfp );
+            fflush( outfp );
+            continue;
+        }
+
+        /* The patching algorithms consume the strategy given to them,
+           so give them a copy and keep the current one for rollback. */
+        result = NULL;
+
+        if (!strncmp( line, "edit", strlen( "edit" ) )) {
+            editfp = open_memstream( &edit_buf, &edit_size );
+            if (editfp == NULL) {
+                perror( "patch_serve, open_memstream" );
+                exit(-1);
+            }
+            while (fgets( line, INPUT_STRING_LEN, infp )) {
+                if (!strncmp( line, "end", strlen( "end" ) ))
+                    break;
+                fputs( line, editfp );
+            }
+            fclose( editfp );
+
+            if (edit_size > 0) {
+                editfp = fmemopen( edit_buf, edit_size, "r" );
+                if (editfp == NULL) {
+                    perror( "patch_serve, fmemopen" );
+                    exit(-1);
+                }
+                result = patch_localfixpoint_aut( manager,
+                                                  aut_copy( strategy,
+                                                            num_env+num_sys ),
+                                                  editfp,
+                                                  original_num_env,
+                                                  original_num_sys,
+                                                  offw, bdds, verbose );
+                fclose( editfp );
+            }
+
+            /* Later commands must be against the changed game. */
+            if (result != NULL) {
+                editfp = fmemopen( edit_buf, edit_size, "r" );
+                if (editfp == NULL) {
+                    perror( "patch_serve, fmemopen" );
+                    exit(-1);
+                }
+                if (patch_bdds_edit( manager, bdds, editfp )) {
+                    fprintf( stderr,
+                             "Error patch_serve: failed to apply edit to"
+                             " transition BDDs.\n" );
+                    fclose( editfp );
+                    free( edit_buf );
+                    serve_free_lines( lines, len );
+                    patch_bdds_free( manager, bdds );
+                    delete_aut( result );
+                    delete_aut( strategy );
+                    return -1;
+                }
+                fclose( editfp );
+            }
+            free( edit_buf );
+
+        } else if (!strncmp( line, "addgoal ", strlen( "addgoal " ) )) {
+            formula = serve_parse_formula( line+strlen( "addgoal " ) );
+            if (formula != NULL) {
+                result = add_metric_sysgoal_aut( manager,
+                                                 aut_copy( strategy,
+                                                           num_env+num_sys ),
+                                                 offw, num_metric_vars,
+                                                 formula, bdds, &goal_mode,
+                                                 verbose );
+                if (result != NULL) {
+                    goal_BDD = serve_formula_BDD( manager, formula );
+                    if (goal_BDD == NULL) {
+                        fprintf( stderr,
+                                 "Error patch_serve: failed to build BDD of"
+                                 " new system goal.\n" );
+                        delete_aut( result );
+                        result = NULL;
+                    }
+                }
+                if (result == NULL) {
+                    delete_tree( formula );
+                } else {
+                    /* Insert the new goal where the strategy visits it. */
+                    spc.sys_goals = realloc( spc.sys_goals,
+                                             (spc.num_sgoals+1)
+                                             *sizeof(ptree_t *) );
+                    bdds->sgoals = realloc( bdds->sgoals,
+                                            (spc.num_sgoals+1)
+                                            *sizeof(DdNode *) );
+                    if (spc.sys_goals == NULL || bdds->sgoals == NULL) {
+                        perror( "patch_serve, realloc" );
+                        exit(-1);
+                    }
+                    for (i = spc.num_sgoals; i > goal_mode; i--) {
+                        *(spc.sys_goals+i) = *(spc.sys_goals+i-1);
+                        *(bdds->sgoals+i) = *(bdds->sgoals+i-1);
+                    }
+                    *(spc.sys_goals+goal_mode) = formula;
+                    *(bdds->sgoals+goal_mode) = goal_BDD;
+                    (spc.num_sgoals)++;
+                }
+            }
+
+        } else if (!strncmp( line, "rmgoal ", strlen( "rmgoal " ) )) {
+            goal_mode = strtol( line+strlen( "rmgoal " ), &endptr, 10 );
+            if (endptr != line+strlen( "rmgoal " ))
+                result = rm_sysgoal_aut( manager,
+                                         aut_copy( strategy, num_env+num_sys ),
+                                         goal_mode, bdds, verbose );
+            if (result != NULL) {
+                /* Relabel so that goal modes again match the order of
+                   system goals in the specification. */
+                node = result;
+                while (node) {
+                    if (node->mode > goal_mode)
+                        (node->mode)--;
+                    node = node->next;
+                }
+                delete_tree( *(spc.sys_goals+goal_mode) );
+                Cudd_RecursiveDeref( manager, *(bdds->sgoals+goal_mode) );
+                for (i = goal_mode; i < spc.num_sgoals-1; i++) {
+                    *(spc.sys_goals+i) = *(spc.sys_goals+i+1);
+                    *(bdds->sgoals+i) = *(bdds->sgoals+i+1);
+                }
+                (spc.num_sgoals)--;
+            }
+
+        } else {
+            fprintf( outfp, "error: unrecognized command\n" SERVE_END_MARK "\n" );
+            fflush( outfp );
+            continue;
+        }
+
+        if (result == NULL) {
+            fprintf( outfp, "error: patching failed\n" SERVE_END_MARK "\n" );
+        } else {
+            delete_aut( strategy );
+            strategy = result;
+            new_lines = serve_aut_lines( strategy, num_env+num_sys, &new_len );
+            serve_diff( lines, len, new_lines, new_len, outfp );
+            serve_free_lines( lines, len );
+            lines = new_lines;
+            len = new_len;
+        }
+        fflush( outfp );
+    }
+
+    serve_free_lines( lines, len );
+    patch_bdds_free( manager, bdds );
+    delete_aut( strategy );
+    return 0;
+}
@@ -9,11 +9,11 @@
 #include <stdio.h>
 
 #include "common.h"
+#include "logging.h"
 #include "patching.h"
 #include "solve_support.h"
-
-
-extern specification_t spc;
+#include "checkpoint.h"
+#include "context.h"
 
 
 anode_t *synthesize_reachgame_BDD( DdManager *manager, int num_env, int num_sys,
@@ -42,6 +42,12 @@ anode_t *synthesize_reachgame_BDD( DdManager *manager, int num_env, int num_sys,
     int offset;
     DdNode *ddval;  /* Store result of evaluating a BDD */
 
+    /* For checkpoints; cf. checkpoint.h */
+    DdNode **ckpt_f;
+    int *ckpt_vals, ckpt_len, ckpt_vals_len;
+    unsigned long ckpt_key;
+    DdNode *ckpt_sets[2];
+
     /* Variables used during CUDD generation (state enumeration). */
     DdGen *gen;
     CUDD_VALUE_TYPE gvalue;
@@ -83,7 +89,84 @@ anode_t *synthesize_reachgame_BDD( DdManager *manager, int num_env, int num_sys,
         Cudd_Ref( *(*X_jr+r) );
     }
 
+    /* Possibly resume from a checkpoint saved at the beginning of some
+       iteration below.  The saved BDDs are the sublevel sets in order,
+       each followed by its X sets; the saved integer is the number of
+       sublevels. */
+    *ckpt_sets = Exit;
+    *(ckpt_sets+1) = N_BDD;
+    ckpt_key = checkpoint_gamekey( etrans, strans, egoals, spc.num_egoals,
+                                   NULL, 0, ckpt_sets, 2 );
+    ckpt_len = checkpoint_load( manager, "reachgame", ckpt_key, &ckpt_f,
+                                &ckpt_vals, &ckpt_vals_len );
+    if (ckpt_len >= 0) {
+        if (ckpt_vals_len != 1 || *ckpt_vals < 1
+            || ckpt_len != (*ckpt_vals)*(1+spc.num_egoals)) {
+            fprintf( stderr,
+                     "Warning: ignoring checkpoint with unexpected"
+                     " contents.\n" );
+            for (k = 0; k < ckpt_len; k++)
+                Cudd_RecursiveDeref( manager, *(ckpt_f+k) );
+        } else {
+            if (verbose)
+                logprint( "Resuming from checkpoint at sublevel %d.",
+                          *ckpt_vals );
+            Cudd_RecursiveDeref( manager, *Y );
+            for (r = 0; r < spc.num_egoals; r++)
+                Cudd_RecursiveDeref( manager, *(*X_jr+r) );
+            free( *X_jr );
+            num_sublevels = *ckpt_vals;
+            Y = realloc( Y, num_sublevels*sizeof(DdNode *) );
+            X_jr = realloc( X_jr, num_sublevels*sizeof(DdNode **) );
+            if (Y == NULL || X_jr == NULL) {
+                perror( "synthesize_reachgame_BDD, realloc" );
+                exit(-1);
+            }
+            k = 0;
+            for (j = 0; j < num_sublevels; j++) {
+                *(Y+j) = *(ckpt_f+k);
+                k++;
+                *(X_jr+j) = malloc( spc.num_egoals*sizeof(DdNode *) );
+                if (*(X_jr+j) == NULL) {
+                    perror( "synthesize_reachgame_BDD, malloc" );
+                    exit(-1);
+                }
+                for (r = 0; r < spc.num_egoals; r++) {
+                    *(*(X_jr+j)+r) = *(ckpt_f+k);
+                    k++;
+                }
+            }
+        }
+        free( ckpt_f );
+        free( ckpt_vals );
+    }
+
     while (True) {
+        if (checkpoint_due()) {
+            ckpt_f = malloc( num_sublevels*(1+spc.num_egoals)
+                             *sizeof(DdNode *) );
+            if (ckpt_f == NULL) {
+                perror( "synthesize_reachgame_BDD, malloc" );
+                exit(-1);
+            }
+            k = 0;
+            for (j = 0; j < num_sublevels; j++) {
+                *(ckpt_f+k) = *(Y+j);
+                k++;
+                for (r = 0; r < spc.num_egoals; r++) {
+                    *(ckpt_f+k) = *(*(X_jr+j)+r);
+                    k++;
+                }
+            }
+            if (checkpoint_save( manager, "reachgame", ckpt_key, ckpt_f, k,
+                                 &num_sublevels, 1 )) {
+                fprintf( stderr, "Warning: failed to save checkpoint.\n" );
+            } else if (verbose > 1) {
+                logprint( "Saved checkpoint." );
+            }
+            free( ckpt_f );
+        }
+
         num_sublevels++;
         Y = realloc( Y, num_sublevels*sizeof(DdNode *) );
         X_jr = realloc( X_jr, num_sublevels*sizeof(DdNode **) );
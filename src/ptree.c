@@ -17,6 +17,92 @@
 #include "ptree.h"
 
 
+/* Recursive part of check_vars(), with the variable lists given as
+   symbol tables. */
+char *check_vars_symtab( ptree_t *head,
+                         symtab_t *var_st, symtab_t *nextvar_st );
+
+/* FNV-1a hash of a variable name */
+unsigned long symtab_hash( char *name );
+
+/* Table of BDDs of the distinct subformulas encountered while building
+   the BDD of a parse tree.  Entries are keyed by node type, constant
+   value, variable index, and the entry indices of the children, so that
+   structurally equal subformulas, e.g., a conjunct repeated in several
+   transition rules, are found by one lookup and built once.  The table
+   holds a reference to each non-NULL fn. */
+typedef struct {
+    int type;
+    int value;
+    int var;
+    int left;
+    int right;
+    DdNode *fn;
+} bddmemo_entry_t;
+
+typedef struct {
+    int num_entries;
+    int num_slots;  /* Power of 2 */
+    int *slots;  /* Indices into entries, or -1 if empty */
+    bddmemo_entry_t *entries;
+} bddmemo_t;
+
+bddmemo_t *bddmemo_new();
+void bddmemo_free( bddmemo_t *memo );
+unsigned long bddmemo_hash( int type, int value, int var, int left, int right );
+
+/* Return index of the entry with the given key, or -1 if none. */
+int bddmemo_find( bddmemo_t *memo,
+                  int type, int value, int var, int left, int right );
+
+/* Add entry, which takes the caller's reference to fn, and return its
+   index.  The key should not already be present. */
+int bddmemo_insert( bddmemo_t *memo,
+                    int type, int value, int var, int left, int right,
+                    DdNode *fn );
+
+/* Recursive part of ptree_BDD_symtab().  Return the index of the entry
+   in memo for the subformula at head. */
+int ptree_BDD_memo( ptree_t *head, symtab_t *st, bddmemo_t *memo,
+                    DdManager *manager );
+
+/* Part of ptree_BDD_memo() for a node of type PT_AND or PT_OR.  The
+   maximal subtree of nodes of the same type is flattened without
+   recursion into its list of operands, which are then combined by
+   BDD_nary().  The entry is keyed as the left-deep chain of operands,
+   so that associated variants of the same formula are shared. */
+int ptree_BDD_nary( ptree_t *head, symtab_t *st, bddmemo_t *memo,
+                    DdManager *manager );
+
+/* Largest intermediate BDD created by BDD_nary() since the last call of
+   ptree_BDD_symtab() in this thread; cf. ptree_BDD_peak_size(). */
+__thread int bdd_peak_size = 0;
+
+/* Binary min-heap of BDDs, ordered by size (number of nodes), for use
+   by BDD_nary(). */
+void bddheap_push( DdNode **heap, int *sizes, int *heap_len,
+                   DdNode *fn, int size );
+DdNode *bddheap_pop( DdNode **heap, int *sizes, int *heap_len );
+
+/* Return referenced BDD of the comparison of given type (PT_EQUALS,
+   PT_LT, etc.) between the operands, which are entries of constants or
+   of nonboolean variables (cf. mark_nonbool()).  num_vars is the offset
+   of primed variables.  Return NULL if the operands are not supported. */
+DdNode *compare_BDD( int type, bddmemo_entry_t *left, bddmemo_entry_t *right,
+                     int num_vars, DdManager *manager );
+
+/* Return referenced BDD of lower <= x <= upper, where x is the unsigned
+   integer with num_bits bits at indices base, base+1, ..., least
+   significant first.  Bounds outside [0, 2^num_bits - 1] are clipped. */
+DdNode *interval_BDD( int base, int num_bits, int lower, int upper,
+                      DdManager *manager );
+
+/* Return referenced BDD of x < y, or of x = y if equality is True,
+   where x and y are unsigned integers as for interval_BDD(). */
+DdNode *bitvec_cmp_BDD( int xbase, int xbits, int ybase, int ybits,
+                        bool equality, DdManager *manager );
+
+
 ptree_t *init_ptree( int type, char *name, int value )
 {
     ptree_t *head = malloc( sizeof(ptree_t) );
@@ -244,23 +330,35 @@ int rmax_tree_value( ptree_t *head, char *name )
 
 char *check_vars( ptree_t *head, ptree_t *var_list, ptree_t *nextvar_list )
 {
+    symtab_t *var_st, *nextvar_st;
     char *name;
-    ptree_t *node;
+
+    if (head == NULL)
+        return NULL;
+    var_st = symtab_new( var_list );
+    nextvar_st = symtab_new( nextvar_list );
+    name = check_vars_symtab( head, var_st, nextvar_st );
+    symtab_free( var_st );
+    symtab_free( nextvar_st );
+    return name;
+}
+
+
+char *check_vars_symtab( ptree_t *head,
+                         symtab_t *var_st, symtab_t *nextvar_st )
+{
+    char *name;
+    int index;
     if (head == NULL)
         return NULL;
 
     if (head->type == PT_VARIABLE || head->type == PT_NEXT_VARIABLE) {
         if (head->type == PT_VARIABLE) {
-            node = var_list;
+            index = symtab_find( var_st, head->name );
         } else {
-            node = nextvar_list;
+            index = symtab_find( nextvar_st, head->name );
         }
-        while (node) {
-            if (!strcmp( head->name, node->name ))
-                break;
-            node = node->left;
-        }
-        if (node == NULL) {
+        if (index < 0) {
             name = malloc( (strlen( head->name )+2)*sizeof(char) );
             if (name == NULL) {
                 perror( "check_vars, malloc" );
@@ -275,8 +373,9 @@ char *check_vars( ptree_t *head, ptree_t *var_list, ptree_t *nextvar_list )
         }
     }
 
-    if ((name = check_vars( head->left, var_list, nextvar_list )) != NULL
-        || (name = check_vars( head->right, var_list, nextvar_list )) != NULL)
+    if ((name = check_vars_symtab( head->left, var_st, nextvar_st )) != NULL
+        || (name = check_vars_symtab( head->right,
+                                      var_st, nextvar_st )) != NULL)
         return name;
     return NULL;
 }
@@ -488,6 +587,43 @@ ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval )
 }
 
 
+ptree_t *mark_nonbool( ptree_t *head, char *name, int maxval )
+{
+    ptree_t *leaf;
+    int i;
+
+    if (head == NULL)
+        return NULL;
+
+    if (head->type == PT_EQUALS || head->type == PT_NOTEQ
+        || head->type == PT_LT || head->type == PT_GT
+        || head->type == PT_LE || head->type == PT_GE) {
+        for (i = 0; i < 2; i++) {
+            leaf = (i == 0) ? head->left : head->right;
+            if (leaf == NULL
+                || !(leaf->type == PT_VARIABLE
+                     || leaf->type == PT_NEXT_VARIABLE)
+                || strcmp( leaf->name, name ))
+                continue;
+            if (maxval > 0) {
+                leaf->value = maxval;
+            } else {
+                /* The only value is 0. */
+                free( leaf->name );
+                leaf->name = NULL;
+                leaf->type = PT_CONSTANT;
+                leaf->value = 0;
+            }
+        }
+        return head;
+    }
+
+    head->left = mark_nonbool( head->left, name, maxval );
+    head->right = mark_nonbool( head->right, name, maxval );
+    return head;
+}
+
+
 ptree_t *unreach_expanded_bool( char *name, int lower, int upper, int type )
 {
     ptree_t *head, *node;
@@ -527,6 +663,27 @@ int tree_size( ptree_t *head )
 }
 
 
+unsigned long ptree_hash( ptree_t *head, unsigned long h )
+{
+    char *c;
+    int i;
+
+    /* FNV-1a over the fields of each node, in preorder */
+    if (head == NULL)
+        return PTREE_HASH_STEP( h, 0xff );
+    h = PTREE_HASH_STEP( h, (unsigned char)head->type );
+    for (i = 0; i < sizeof(int); i++)
+        h = PTREE_HASH_STEP( h, (unsigned int)head->value >> 8*i & 0xff );
+    if (head->name != NULL) {
+        for (c = head->name; *c != '\0'; c++)
+            h = PTREE_HASH_STEP( h, (unsigned char)*c );
+    }
+    h = PTREE_HASH_STEP( h, 0xfe );
+    h = ptree_hash( head->left, h );
+    return ptree_hash( head->right, h );
+}
+
+
 void print_node( ptree_t *node, FILE *fp )
 {
     if (fp == NULL)
@@ -963,110 +1120,249 @@ void print_formula( ptree_t *head, FILE *fp, unsigned char format_flags )
 
 DdNode *ptree_BDD( ptree_t *head, ptree_t *var_list, DdManager *manager )
 {
-    DdNode *lsub, *rsub,*fn2, *tmp;
-    int index;
+    symtab_t *st;
+    DdNode *fn;
+
+    st = symtab_new( var_list );
+    fn = ptree_BDD_symtab( head, st, manager );
+    symtab_free( st );
+    return fn;
+}
+
+
+DdNode *ptree_BDD_symtab( ptree_t *head, symtab_t *st, DdManager *manager )
+{
+    bddmemo_t *memo;
+    DdNode *fn;
+    int id, i;
+
+    bdd_peak_size = 0;
+    memo = bddmemo_new();
+    /* memo->entries may be moved while building, so read it after. */
+    id = ptree_BDD_memo( head, st, memo, manager );
+    fn = (memo->entries+id)->fn;
+    if (fn != NULL)
+        Cudd_Ref( fn );
+    for (i = 0; i < memo->num_entries; i++) {
+        if ((memo->entries+i)->fn != NULL)
+            Cudd_RecursiveDeref( manager, (memo->entries+i)->fn );
+    }
+    bddmemo_free( memo );
+    return fn;
+}
+
+
+bddmemo_t *bddmemo_new()
+{
+    bddmemo_t *memo;
+    int slot;
+
+    memo = malloc( sizeof(bddmemo_t) );
+    if (memo == NULL) {
+        perror( "bddmemo_new, malloc" );
+        exit(-1);
+    }
+    memo->num_entries = 0;
+    memo->num_slots = 64;
+    memo->slots = malloc( memo->num_slots*sizeof(int) );
+    memo->entries = malloc( (memo->num_slots/2)*sizeof(bddmemo_entry_t) );
+    if (memo->slots == NULL || memo->entries == NULL) {
+        perror( "bddmemo_new, malloc" );
+        exit(-1);
+    }
+    for (slot = 0; slot < memo->num_slots; slot++)
+        *(memo->slots+slot) = -1;
+    return memo;
+}
+
+
+void bddmemo_free( bddmemo_t *memo )
+{
+    free( memo->slots );
+    free( memo->entries );
+    free( memo );
+}
+
+
+unsigned long bddmemo_hash( int type, int value, int var, int left, int right )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    h = PTREE_HASH_STEP( h, (unsigned int)type );
+    h = PTREE_HASH_STEP( h, (unsigned int)value );
+    h = PTREE_HASH_STEP( h, (unsigned int)var );
+    h = PTREE_HASH_STEP( h, (unsigned int)left );
+    h = PTREE_HASH_STEP( h, (unsigned int)right );
+    return h;
+}
+
+
+int bddmemo_find( bddmemo_t *memo,
+                  int type, int value, int var, int left, int right )
+{
+    bddmemo_entry_t *entry;
+    int slot;
+
+    slot = bddmemo_hash( type, value, var, left, right ) & (memo->num_slots-1);
+    while (*(memo->slots+slot) >= 0) {
+        entry = memo->entries + *(memo->slots+slot);
+        if (entry->type == type && entry->value == value && entry->var == var
+            && entry->left == left && entry->right == right)
+            return *(memo->slots+slot);
+        slot = (slot+1) & (memo->num_slots-1);
+    }
+    return -1;
+}
+
+
+int bddmemo_insert( bddmemo_t *memo,
+                    int type, int value, int var, int left, int right,
+                    DdNode *fn )
+{
+    bddmemo_entry_t *entry;
+    int slot, i;
+
+    /* Keep the load factor at most 1/2. */
+    if (2*(memo->num_entries+1) > memo->num_slots) {
+        memo->num_slots *= 2;
+        memo->slots = realloc( memo->slots, memo->num_slots*sizeof(int) );
+        memo->entries = realloc( memo->entries,
+                                 (memo->num_slots/2)*sizeof(bddmemo_entry_t) );
+        if (memo->slots == NULL || memo->entries == NULL) {
+            perror( "bddmemo_insert, realloc" );
+            exit(-1);
+        }
+        for (slot = 0; slot < memo->num_slots; slot++)
+            *(memo->slots+slot) = -1;
+        for (i = 0; i < memo->num_entries; i++) {
+            entry = memo->entries+i;
+            slot = bddmemo_hash( entry->type, entry->value, entry->var,
+                                 entry->left, entry->right )
+                & (memo->num_slots-1);
+            while (*(memo->slots+slot) >= 0)
+                slot = (slot+1) & (memo->num_slots-1);
+            *(memo->slots+slot) = i;
+        }
+    }
+
+    slot = bddmemo_hash( type, value, var, left, right ) & (memo->num_slots-1);
+    while (*(memo->slots+slot) >= 0)
+        slot = (slot+1) & (memo->num_slots-1);
+    entry = memo->entries+memo->num_entries;
+    entry->type = type;
+    entry->value = value;
+    entry->var = var;
+    entry->left = left;
+    entry->right = right;
+    entry->fn = fn;
+    *(memo->slots+slot) = memo->num_entries;
+    return memo->num_entries++;
+}
+
+
+int ptree_BDD_memo( ptree_t *head, symtab_t *st, bddmemo_t *memo,
+                    DdManager *manager )
+{
+    DdNode *lsub = NULL, *rsub = NULL, *fn2, *tmp;
+    int left = -1, right = -1, var = -1, value = 0;
+    int id;
+    char varname[VARNAME_STRING_LEN];
 
     /* Initialize with NULL to ensure meaningful return value in case default
        branches taken. */
     DdNode *fn = NULL;
 
+    if (head->type == PT_AND || head->type == PT_OR)
+        return ptree_BDD_nary( head, st, memo, manager );
+
     switch (head->type) {
-    case PT_AND:
-    case PT_OR:
     case PT_IMPLIES:
     case PT_EQUIV:
-        lsub = ptree_BDD( head->left, var_list, manager );
-        rsub = ptree_BDD( head->right, var_list, manager );
+    case PT_EQUALS:
+    case PT_NOTEQ:
+    case PT_LT:
+    case PT_GT:
+    case PT_LE:
+    case PT_GE:
+        left = ptree_BDD_memo( head->left, st, memo, manager );
+        right = ptree_BDD_memo( head->right, st, memo, manager );
+        lsub = (memo->entries+left)->fn;
+        rsub = (memo->entries+right)->fn;
         break;
     case PT_NEG:
-        rsub = ptree_BDD( head->right, var_list, manager );
+        right = ptree_BDD_memo( head->right, st, memo, manager );
+        rsub = (memo->entries+right)->fn;
         break;
     case PT_VARIABLE:
-        index = find_list_item( var_list, head->type, head->name, 0 );
-        if (index < 0) {
+    case PT_NEXT_VARIABLE:
+        if (head->value > 0) {
+            /* Nonboolean variable, marked by mark_nonbool(); refer to
+               its least significant bit, which precedes the others. */
+            snprintf( varname, VARNAME_STRING_LEN, "%s0", head->name );
+            var = symtab_find( st, varname );
+            value = head->value;
+        } else {
+            var = symtab_find( st, head->name );
+        }
+        if (var < 0) {
             fprintf( stderr,
-                     "Error: ptree_BDD requested variable \"%s\","
+                     "Error: ptree_BDD requested %svariable \"%s\","
                      " but it is not in given list.\n",
+                     head->type == PT_NEXT_VARIABLE ? "primed " : "",
                      head->name );
             exit(-1);
         }
-        lsub = Cudd_ReadOne( manager );
-        Cudd_Ref( lsub );
-        fn = Cudd_bddAnd( manager, lsub,
-                          Cudd_bddIthVar( manager, index ) );
+        break;
+    case PT_CONSTANT:
+        value = head->value;
+        break;
+    }
+
+    /* Reuse the BDD of an identical subformula, if any. */
+    id = bddmemo_find( memo, head->type, value, var, left, right );
+    if (id >= 0)
+        return id;
+
+    switch (head->type) {
+    case PT_VARIABLE:
+        if (value > 0)  /* Only meaningful in comparisons */
+            break;
+        fn = Cudd_bddIthVar( manager, var );
         Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
         break;
 
     case PT_NEXT_VARIABLE:
-        index = find_list_item( var_list, PT_VARIABLE, head->name, 0 );
-        if (index < 0) {
-            fprintf( stderr,
-                     "Error: ptree_BDD requested primed variable \"%s\","
-                     " but it is not in given list.\n",
-                     head->name );
-            exit(-1);
-        }
-        lsub = Cudd_ReadOne( manager );
-        Cudd_Ref( lsub );
-        fn = Cudd_bddAnd( manager, lsub,
-                          Cudd_bddIthVar( manager,
-                                          tree_size(var_list)+index ) );
+        if (value > 0)
+            break;
+        fn = Cudd_bddIthVar( manager, st->size+var );
         Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
         break;
 
     case PT_CONSTANT:
-        if (head->value == 0) {
+        if (value == 0) {
             fn = Cudd_Not( Cudd_ReadOne( manager ) );
         } else {
             fn = Cudd_ReadOne( manager );
         }
         Cudd_Ref( fn );
         break;
-    }
-
-    switch (head->type) {
-    case PT_AND:
-        fn = Cudd_bddAnd( manager, lsub, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        Cudd_RecursiveDeref( manager, rsub );
-        break;
-
-    case PT_OR:
-        fn = Cudd_bddOr( manager, lsub, rsub );
-        Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, lsub );
-        Cudd_RecursiveDeref( manager, rsub );
-        break;
 
     case PT_IMPLIES:
-        tmp = Cudd_Not( lsub );
-        Cudd_Ref( tmp );
-        Cudd_RecursiveDeref( manager, lsub );
-        fn = Cudd_bddOr( manager, tmp, rsub );
+        if (lsub == NULL || rsub == NULL)
+            break;
+        fn = Cudd_bddOr( manager, Cudd_Not( lsub ), rsub );
         Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, tmp );
-        Cudd_RecursiveDeref( manager, rsub );
         break;
 
     case PT_EQUIV:
+        if (lsub == NULL || rsub == NULL)
+            break;
         /* -> */
-        tmp = Cudd_Not( lsub );
-        Cudd_Ref( tmp );
-        fn = Cudd_bddOr( manager, tmp, rsub );
+        fn = Cudd_bddOr( manager, Cudd_Not( lsub ), rsub );
         Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, tmp );
 
         /* <- */
-        tmp = Cudd_Not( rsub );
-        Cudd_Ref( tmp );
-        Cudd_RecursiveDeref( manager, rsub );
-        fn2 = Cudd_bddOr( manager, tmp, lsub );
+        fn2 = Cudd_bddOr( manager, Cudd_Not( rsub ), lsub );
         Cudd_Ref( fn2 );
-        Cudd_RecursiveDeref( manager, tmp );
-        Cudd_RecursiveDeref( manager, lsub );
 
         /* & */
         tmp = fn;
@@ -1077,12 +1373,449 @@ DdNode *ptree_BDD( ptree_t *head, ptree_t *var_list, DdManager *manager )
         break;
 
     case PT_NEG:
+        if (rsub == NULL)
+            break;
         fn = Cudd_Not( rsub );
         Cudd_Ref( fn );
-        Cudd_RecursiveDeref( manager, rsub );
+        break;
+
+    case PT_EQUALS:
+    case PT_NOTEQ:
+    case PT_LT:
+    case PT_GT:
+    case PT_LE:
+    case PT_GE:
+        fn = compare_BDD( head->type,
+                          memo->entries+left, memo->entries+right,
+                          st->size, manager );
         break;
     }
 
+    /* N.B., unsupported node types are recorded with a NULL BDD. */
+    return bddmemo_insert( memo, head->type, value, var, left, right, fn );
+}
+
+
+int ptree_BDD_nary( ptree_t *head, symtab_t *st, bddmemo_t *memo,
+                    DdManager *manager )
+{
+    ptree_t **stack, **operands, *node;
+    int stack_len, num_operands, max_len;
+    int *ids;
+    DdNode **fns;
+    int id, next_id, i;
+
+    /* Flatten, preserving the left-to-right order of operands.  Each
+       node is either pushed or an operand, so tree_size() bounds the
+       lengths of both arrays; but to avoid traversing twice, grow them
+       as needed. */
+    max_len = 16;
+    stack = malloc( max_len*sizeof(ptree_t *) );
+    operands = malloc( max_len*sizeof(ptree_t *) );
+    if (stack == NULL || operands == NULL) {
+        perror( "ptree_BDD_nary, malloc" );
+        exit(-1);
+    }
+    stack_len = num_operands = 0;
+    *(stack+(stack_len++)) = head;
+    while (stack_len > 0) {
+        node = *(stack+(--stack_len));
+        if (stack_len+2 > max_len || num_operands+1 > max_len) {
+            max_len *= 2;
+            stack = realloc( stack, max_len*sizeof(ptree_t *) );
+            operands = realloc( operands, max_len*sizeof(ptree_t *) );
+            if (stack == NULL || operands == NULL) {
+                perror( "ptree_BDD_nary, realloc" );
+                exit(-1);
+            }
+        }
+        if (node->type == head->type) {
+            *(stack+(stack_len++)) = node->right;
+            *(stack+(stack_len++)) = node->left;
+        } else {
+            *(operands+(num_operands++)) = node;
+        }
+    }
+    free( stack );
+
+    ids = malloc( num_operands*sizeof(int) );
+    if (ids == NULL) {
+        perror( "ptree_BDD_nary, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_operands; i++)
+        *(ids+i) = ptree_BDD_memo( *(operands+i), st, memo, manager );
+    free( operands );
+
+    /* Find or create the entry for each prefix of the chain.  The BDD of
+       an entry is built only when it is needed as a whole, so entries of
+       prefixes that are not themselves subformulas have fn = NULL. */
+    id = *ids;
+    for (i = 1; i < num_operands; i++) {
+        next_id = bddmemo_find( memo, head->type, 0, -1, id, *(ids+i) );
+        if (next_id < 0)
+            next_id = bddmemo_insert( memo, head->type, 0, -1, id, *(ids+i),
+                                      NULL );
+        id = next_id;
+    }
+    if ((memo->entries+id)->fn != NULL) {
+        free( ids );
+        return id;
+    }
+
+    fns = malloc( num_operands*sizeof(DdNode *) );
+    if (fns == NULL) {
+        perror( "ptree_BDD_nary, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_operands; i++) {
+        *(fns+i) = (memo->entries+*(ids+i))->fn;
+        if (*(fns+i) == NULL)
+            break;
+    }
+    if (i == num_operands)
+        (memo->entries+id)->fn = BDD_nary( fns, num_operands, head->type,
+                                           manager );
+    free( fns );
+    free( ids );
+    return id;
+}
+
+
+DdNode *BDD_nary( DdNode **fns, int len, int type, DdManager *manager )
+{
+    DdNode **heap, *fn, *fn1, *fn2, *absorbing;
+    int *sizes;
+    int heap_len, size, i;
+
+    if (type != PT_AND && type != PT_OR) {
+        fprintf( stderr, "Error BDD_nary: unsupported operator type %d.\n",
+                 type );
+        return NULL;
+    }
+    if (type == PT_AND) {
+        absorbing = Cudd_Not( Cudd_ReadOne( manager ) );
+    } else {
+        absorbing = Cudd_ReadOne( manager );
+    }
+    if (len <= 0) {
+        fn = Cudd_Not( absorbing );
+        Cudd_Ref( fn );
+        return fn;
+    }
+
+    heap = malloc( len*sizeof(DdNode *) );
+    sizes = malloc( len*sizeof(int) );
+    if (heap == NULL || sizes == NULL) {
+        perror( "BDD_nary, malloc" );
+        exit(-1);
+    }
+    heap_len = 0;
+    for (i = 0; i < len; i++) {
+        Cudd_Ref( *(fns+i) );
+        bddheap_push( heap, sizes, &heap_len, *(fns+i),
+                      Cudd_DagSize( *(fns+i) ) );
+    }
+
+    /* Combine the two smallest operands until one remains. */
+    while (heap_len > 1) {
+        fn1 = bddheap_pop( heap, sizes, &heap_len );
+        fn2 = bddheap_pop( heap, sizes, &heap_len );
+        if (type == PT_AND) {
+            fn = Cudd_bddAnd( manager, fn1, fn2 );
+        } else {
+            fn = Cudd_bddOr( manager, fn1, fn2 );
+        }
+        Cudd_Ref( fn );
+        Cudd_RecursiveDeref( manager, fn1 );
+        Cudd_RecursiveDeref( manager, fn2 );
+
+        if (fn == absorbing) {
+            /* The remaining operands cannot change the result. */
+            while (heap_len > 0)
+                Cudd_RecursiveDeref( manager,
+                                     bddheap_pop( heap, sizes, &heap_len ) );
+        }
+        size = Cudd_DagSize( fn );
+        if (size > bdd_peak_size)
+            bdd_peak_size = size;
+        bddheap_push( heap, sizes, &heap_len, fn, size );
+    }
+
+    fn = *heap;
+    free( heap );
+    free( sizes );
+    return fn;
+}
+
+
+void bddheap_push( DdNode **heap, int *sizes, int *heap_len,
+                   DdNode *fn, int size )
+{
+    int j;
+    for (j = (*heap_len)++; j > 0 && *(sizes+(j-1)/2) > size; j = (j-1)/2) {
+        *(heap+j) = *(heap+(j-1)/2);
+        *(sizes+j) = *(sizes+(j-1)/2);
+    }
+    *(heap+j) = fn;
+    *(sizes+j) = size;
+}
+
+
+DdNode *bddheap_pop( DdNode **heap, int *sizes, int *heap_len )
+{
+    DdNode *top, *last;
+    int last_size, j, k;
+
+    top = *heap;
+    (*heap_len)--;
+    last = *(heap+*heap_len);
+    last_size = *(sizes+*heap_len);
+    for (j = 0; 2*j+1 < *heap_len; j = k) {
+        k = 2*j+1;
+        if (k+1 < *heap_len && *(sizes+k+1) < *(sizes+k))
+            k++;
+        if (last_size <= *(sizes+k))
+            break;
+        *(heap+j) = *(heap+k);
+        *(sizes+j) = *(sizes+k);
+    }
+    *(heap+j) = last;
+    *(sizes+j) = last_size;
+    return top;
+}
+
+
+int ptree_BDD_peak_size()
+{
+    return bdd_peak_size;
+}
+
+
+DdNode *compare_BDD( int type, bddmemo_entry_t *left, bddmemo_entry_t *right,
+                     int num_vars, DdManager *manager )
+{
+    bddmemo_entry_t *tmp;
+    int xbase, xbits, ybase, ybits, maxval, this_val;
+    DdNode *fn, *fn2, *fn3;
+    bool holds;
+
+    if ((left->type != PT_CONSTANT
+         && !((left->type == PT_VARIABLE || left->type == PT_NEXT_VARIABLE)
+              && left->value > 0))
+        || (right->type != PT_CONSTANT
+            && !((right->type == PT_VARIABLE
+                  || right->type == PT_NEXT_VARIABLE)
+                 && right->value > 0))) {
+        fprintf( stderr,
+                 "Error: ptree_BDD only supports comparisons between"
+                 " nonboolean variables and numbers.\n" );
+        return NULL;
+    }
+
+    if (left->type == PT_CONSTANT && right->type == PT_CONSTANT) {
+        switch (type) {
+        case PT_EQUALS:
+            holds = (left->value == right->value);
+            break;
+        case PT_NOTEQ:
+            holds = (left->value != right->value);
+            break;
+        case PT_LT:
+            holds = (left->value < right->value);
+            break;
+        case PT_GT:
+            holds = (left->value > right->value);
+            break;
+        case PT_LE:
+            holds = (left->value <= right->value);
+            break;
+        default:  /* PT_GE */
+            holds = (left->value >= right->value);
+            break;
+        }
+        fn = holds ? Cudd_ReadOne( manager )
+            : Cudd_Not( Cudd_ReadOne( manager ) );
+        Cudd_Ref( fn );
+        return fn;
+    }
+
+    /* Put variable on the left, e.g., 3 < x becomes x > 3. */
+    if (left->type == PT_CONSTANT) {
+        tmp = left;
+        left = right;
+        right = tmp;
+        if (type == PT_LT) {
+            type = PT_GT;
+        } else if (type == PT_GT) {
+            type = PT_LT;
+        } else if (type == PT_LE) {
+            type = PT_GE;
+        } else if (type == PT_GE) {
+            type = PT_LE;
+        }
+    }
+
+    maxval = left->value;
+    xbits = (int)(ceil(log2( maxval+1 )));
+    xbase = left->var;
+    if (left->type == PT_NEXT_VARIABLE)
+        xbase += num_vars;
+
+    if (right->type == PT_CONSTANT) {
+        /* Same sets of values as from expand_to_bool() */
+        this_val = right->value;
+        switch (type) {
+        case PT_EQUALS:
+            return interval_BDD( xbase, xbits, this_val, this_val, manager );
+        case PT_NOTEQ:
+            if (this_val < 0 || this_val > maxval) {
+                fn = Cudd_ReadOne( manager );
+                Cudd_Ref( fn );
+                return fn;
+            }
+            fn = interval_BDD( xbase, xbits, 0, maxval, manager );
+            fn2 = interval_BDD( xbase, xbits, this_val, this_val, manager );
+            fn3 = Cudd_bddAnd( manager, fn, Cudd_Not( fn2 ) );
+            Cudd_Ref( fn3 );
+            Cudd_RecursiveDeref( manager, fn );
+            Cudd_RecursiveDeref( manager, fn2 );
+            return fn3;
+        case PT_LT:
+            return interval_BDD( xbase, xbits, 0, this_val-1, manager );
+        case PT_GT:
+            return interval_BDD( xbase, xbits, this_val+1, maxval, manager );
+        case PT_LE:
+            return interval_BDD( xbase, xbits, 0, this_val, manager );
+        default:  /* PT_GE */
+            return interval_BDD( xbase, xbits, this_val, maxval, manager );
+        }
+    }
+
+    ybits = (int)(ceil(log2( right->value+1 )));
+    ybase = right->var;
+    if (right->type == PT_NEXT_VARIABLE)
+        ybase += num_vars;
+    switch (type) {
+    case PT_EQUALS:
+        return bitvec_cmp_BDD( xbase, xbits, ybase, ybits, True, manager );
+    case PT_NOTEQ:
+        fn = bitvec_cmp_BDD( xbase, xbits, ybase, ybits, True, manager );
+        return Cudd_Not( fn );
+    case PT_LT:
+        return bitvec_cmp_BDD( xbase, xbits, ybase, ybits, False, manager );
+    case PT_GT:
+        return bitvec_cmp_BDD( ybase, ybits, xbase, xbits, False, manager );
+    case PT_LE:
+        fn = bitvec_cmp_BDD( ybase, ybits, xbase, xbits, False, manager );
+        return Cudd_Not( fn );
+    default:  /* PT_GE */
+        fn = bitvec_cmp_BDD( xbase, xbits, ybase, ybits, False, manager );
+        return Cudd_Not( fn );
+    }
+}
+
+
+DdNode *interval_BDD( int base, int num_bits, int lower, int upper,
+                      DdManager *manager )
+{
+    DdNode *fn, *bound, *tmp, *var;
+    int i;
+
+    if (lower < 0)
+        lower = 0;
+    if (upper > (1 << num_bits)-1)
+        upper = (1 << num_bits)-1;
+    if (lower > upper) {
+        fn = Cudd_Not( Cudd_ReadOne( manager ) );
+        Cudd_Ref( fn );
+        return fn;
+    }
+
+    /* Comparators are built from the least significant bit up, so that
+       after step i, bound is the comparison of the lowest i+1 bits. */
+    fn = Cudd_ReadOne( manager );
+    Cudd_Ref( fn );
+    if (lower > 0) {
+        bound = Cudd_ReadOne( manager );
+        Cudd_Ref( bound );
+        for (i = 0; i < num_bits; i++) {
+            var = Cudd_bddIthVar( manager, base+i );
+            if ((lower >> i)&1) {
+                tmp = Cudd_bddAnd( manager, var, bound );
+            } else {
+                tmp = Cudd_bddOr( manager, var, bound );
+            }
+            Cudd_Ref( tmp );
+            Cudd_RecursiveDeref( manager, bound );
+            bound = tmp;
+        }
+        Cudd_RecursiveDeref( manager, fn );
+        fn = bound;
+    }
+    if (upper < (1 << num_bits)-1) {
+        bound = Cudd_ReadOne( manager );
+        Cudd_Ref( bound );
+        for (i = 0; i < num_bits; i++) {
+            var = Cudd_Not( Cudd_bddIthVar( manager, base+i ) );
+            if ((upper >> i)&1) {
+                tmp = Cudd_bddOr( manager, var, bound );
+            } else {
+                tmp = Cudd_bddAnd( manager, var, bound );
+            }
+            Cudd_Ref( tmp );
+            Cudd_RecursiveDeref( manager, bound );
+            bound = tmp;
+        }
+        tmp = Cudd_bddAnd( manager, fn, bound );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, fn );
+        Cudd_RecursiveDeref( manager, bound );
+        fn = tmp;
+    }
+    return fn;
+}
+
+
+DdNode *bitvec_cmp_BDD( int xbase, int xbits, int ybase, int ybits,
+                        bool equality, DdManager *manager )
+{
+    DdNode *fn, *xvar, *yvar, *then_fn, *else_fn, *tmp;
+    int i;
+
+    if (equality) {
+        fn = Cudd_ReadOne( manager );
+    } else {
+        fn = Cudd_Not( Cudd_ReadOne( manager ) );
+    }
+    Cudd_Ref( fn );
+
+    /* Missing high bits of the shorter operand are 0. */
+    for (i = 0; i < xbits || i < ybits; i++) {
+        xvar = (i < xbits) ? Cudd_bddIthVar( manager, xbase+i )
+            : Cudd_Not( Cudd_ReadOne( manager ) );
+        yvar = (i < ybits) ? Cudd_bddIthVar( manager, ybase+i )
+            : Cudd_Not( Cudd_ReadOne( manager ) );
+        if (equality) {
+            /* x_i ? (y_i & fn) : (!y_i & fn) */
+            then_fn = Cudd_bddAnd( manager, yvar, fn );
+            Cudd_Ref( then_fn );
+            else_fn = Cudd_bddAnd( manager, Cudd_Not( yvar ), fn );
+            Cudd_Ref( else_fn );
+        } else {
+            /* x_i ? (y_i & fn) : (y_i | fn) */
+            then_fn = Cudd_bddAnd( manager, yvar, fn );
+            Cudd_Ref( then_fn );
+            else_fn = Cudd_bddOr( manager, yvar, fn );
+            Cudd_Ref( else_fn );
+        }
+        tmp = Cudd_bddIte( manager, xvar, then_fn, else_fn );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, then_fn );
+        Cudd_RecursiveDeref( manager, else_fn );
+        Cudd_RecursiveDeref( manager, fn );
+        fn = tmp;
+    }
     return fn;
 }
 
@@ -1136,3 +1869,83 @@ ptree_t *get_list_item( ptree_t *head, int index )
     }
     return head;
 }
+
+
+unsigned long symtab_hash( char *name )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    for (; *name != '\0'; name++)
+        h = PTREE_HASH_STEP( h, (unsigned char)*name );
+    return h;
+}
+
+
+symtab_t *symtab_new( ptree_t *var_list )
+{
+    symtab_t *st;
+    ptree_t *node;
+    int i, slot;
+
+    st = malloc( sizeof(symtab_t) );
+    if (st == NULL) {
+        perror( "symtab_new, malloc" );
+        exit(-1);
+    }
+    st->size = 0;
+    for (node = var_list; node != NULL; node = node->left)
+        st->size++;
+
+    /* Keep the load factor at most 1/2. */
+    st->num_slots = 1;
+    while (st->num_slots < 2*st->size)
+        st->num_slots <<= 1;
+    st->slots = malloc( st->num_slots*sizeof(int) );
+    st->nodes = malloc( (st->size+1)*sizeof(ptree_t *) );
+    if (st->slots == NULL || st->nodes == NULL) {
+        perror( "symtab_new, malloc" );
+        exit(-1);
+    }
+    for (slot = 0; slot < st->num_slots; slot++)
+        *(st->slots+slot) = -1;
+
+    for (i = 0, node = var_list; node != NULL; i++, node = node->left) {
+        *(st->nodes+i) = node;
+        if (node->name == NULL)
+            continue;
+        slot = symtab_hash( node->name ) & (st->num_slots-1);
+        while (*(st->slots+slot) >= 0) {
+            if (!strcmp( (*(st->nodes+*(st->slots+slot)))->name, node->name ))
+                break;
+            slot = (slot+1) & (st->num_slots-1);
+        }
+        if (*(st->slots+slot) < 0)  /* Keep the first occurrence */
+            *(st->slots+slot) = i;
+    }
+
+    return st;
+}
+
+
+void symtab_free( symtab_t *st )
+{
+    if (st == NULL)
+        return;
+    free( st->slots );
+    free( st->nodes );
+    free( st );
+}
+
+
+int symtab_find( symtab_t *st, char *name )
+{
+    int slot;
+    if (st->size == 0 || name == NULL)
+        return -1;
+    slot = symtab_hash( name ) & (st->num_slots-1);
+    while (*(st->slots+slot) >= 0) {
+        if (!strcmp( (*(st->nodes+*(st->slots+slot)))->name, name ))
+            return *(st->slots+slot);
+        slot = (slot+1) & (st->num_slots-1);
+    }
+    return -1;
+}
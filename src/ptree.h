@@ -78,6 +78,22 @@ typedef struct ptree_t
 } ptree_t;
 
 
+/** \brief Symbol table for a list of variables.
+
+   Maps variable names to their (0-based) indices in the list using a
+   hash table with open addressing, and indices to list nodes using an
+   array.  Names are not copied, so the list must not be changed or
+   deleted while the table is in use.  If a name appears several times
+   in the list, then the first occurrence is used, as for
+   find_list_item(). */
+typedef struct {
+    int size;  /**<\brief Number of variables in the list. */
+    int num_slots;  /**<\brief Capacity of the hash table; a power of 2. */
+    int *slots;  /**<\brief Index of the variable in each slot, or -1. */
+    ptree_t **nodes;  /**<\brief List node of each variable. */
+} symtab_t;
+
+
 /**
  * \defgroup PTreeFormulaSyntax Formula syntax in which to print a ptree.
  *
@@ -108,6 +124,19 @@ ptree_t *copy_ptree( ptree_t *head );
 /** Return number of nodes in tree. */
 int tree_size( ptree_t *head );
 
+/** Combine h with a hash of the tree structure, i.e., the type, name,
+   and value of each node and the position of missing children.  Trees
+   that are equal (including as lists) have equal hashes.  To hash
+   several trees, pass the result for one as h for the next; begin
+   with h = PTREE_HASH_INIT. */
+unsigned long ptree_hash( ptree_t *head, unsigned long h );
+#define PTREE_HASH_INIT 14695981039346656037UL
+
+/** Combine h with x, which should be unsigned (e.g., a byte), as in
+   each step of ptree_hash() (FNV-1a).  The hash tables elsewhere in
+   gr1c use these steps, beginning with h = PTREE_HASH_INIT. */
+#define PTREE_HASH_STEP(h, x) (((h) ^ (x))*1099511628211UL)
+
 /** If f is NULL, then use stdout. */
 void print_node( ptree_t *node, FILE *fp );
 
@@ -129,15 +158,43 @@ ptree_t *merge_ptrees( ptree_t **heads, int len, int type );
 
 /** Generate BDD corresponding to given parse tree.  var_list is the
    linked list of variable names to refer to; ordering in var_list
-   determines index in the BDD.  Non-Boolean variables and equality
-   are not supported.  fn should be NULL, unless you wish to
-   initialize with a non-constant-True function.
+   determines index in the BDD.  Nonboolean variables must have been
+   expanded to bits in var_list, e.g., by expand_nonbool_variables().
+   Comparisons involving them (e.g., x < 3, or x' = y) must have been
+   prepared by mark_nonbool(), and are encoded directly with a number
+   of BDD operations proportional to the number of bits.
 
    Any primed variables (type of PT_NEXT_VARIABLE) will be given an
    index corresponding to unprimed variables but offset by the total
    number of variables (length of list var_list). */
 DdNode *ptree_BDD( ptree_t *head, ptree_t *var_list, DdManager *manager );
 
+/** Same as ptree_BDD(), but the variables are given by a symbol table,
+   e.g., as created by symtab_new() from var_list, or the var_st field
+   of the specification (cf. vars_symtab() in gr1c_util.h).  When
+   building BDDs from several formulas over the same variables, create
+   the table once and use this function, which avoids walking var_list.
+
+   Structurally equal subformulas are recognized while building, and the
+   BDD of each is constructed only once.  Operands of nested conjunctions
+   (and of nested disjunctions), e.g., as created by merge_ptrees(), are
+   collected without recursion and combined by BDD_nary(). */
+DdNode *ptree_BDD_symtab( ptree_t *head, symtab_t *st, DdManager *manager );
+
+/** Return the conjunction (if type is PT_AND) or disjunction (PT_OR)
+   of the len BDDs in fns.  Operands are combined smallest first, i.e.,
+   the two with fewest nodes are replaced by their result until one
+   remains, which tends to keep intermediate BDDs small regardless of
+   the order of the operands.  The result is referenced; the operands
+   are not dereferenced.  Return NULL on error. */
+DdNode *BDD_nary( DdNode **fns, int len, int type, DdManager *manager );
+
+/** Return the number of nodes of the largest intermediate BDD created by
+   BDD_nary() in the calling thread since the most recent call of
+   ptree_BDD() or ptree_BDD_symtab(), e.g., for diagnosing the cost of
+   building the transition relation. */
+int ptree_BDD_peak_size();
+
 /** Generate Graphviz DOT file depicting the parse tree.  Return 0 on
    success, -1 on error. */
 int tree_dot_dump( ptree_t *head, char *filename );
@@ -195,11 +252,25 @@ ptree_t *var_to_bool( char *name, int maxval );
 
 /** Expand all occurrences of name (a variable) in formula described
    by the tree head, replacing by Boolean variables as would be found
-   by var_to_bool().  Changes are made in-place.
+   by var_to_bool().  Changes are made in-place.  Comparisons are
+   rewritten into disjunctions over values, which can be large, so use
+   this only where a formula over the bits is needed; to build BDDs,
+   use mark_nonbool() instead.
 
    Return the (possibly new) head pointer, or NULL if error. */
 ptree_t *expand_to_bool( ptree_t *head, char *name, int maxval );
 
+/** Mark occurrences of name (a variable with domain {0,...,maxval}) in
+   comparisons of the formula described by the tree head, so that
+   ptree_BDD() can encode them over the bits that are named as by
+   var_to_bool().  Marked variable nodes have value = maxval (or are
+   replaced by the constant 0 if maxval = 0).  Changes are made
+   in-place, and the set of states described is the same as after
+   expand_to_bool().
+
+   Return the head pointer. */
+ptree_t *mark_nonbool( ptree_t *head, char *name, int maxval );
+
 /** Create tree describing unreachable values of a
    nonboolean-expanded-to-boolean variable.  E.g., this can be used to
    handle "don't care" values that appear as a side-effect of
@@ -244,5 +315,17 @@ ptree_t *get_list_item( ptree_t *head, int index );
    If head is NULL, then return -1. */
 int find_list_item( ptree_t *head, int type, char *name, int value );
 
+/** Create symbol table for the variables in the list var_list, which
+   may be NULL (i.e., empty). */
+symtab_t *symtab_new( ptree_t *var_list );
+
+void symtab_free( symtab_t *st );
+
+/** Return index (0-base) of the variable with the given name, or -1 if
+   not found.  This gives the same result as
+   find_list_item( var_list, PT_VARIABLE, name, 0 ) if all variables in
+   var_list have type PT_VARIABLE. */
+int symtab_find( symtab_t *st, char *name );
+
 
 #endif
@@ -0,0 +1,998 @@
+/* resultcache.c -- Definitions for signatures appearing in resultcache.h.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "resultcache.h"
+#include "checkpoint.h"
+#include "context.h"
+
+
+#define RCACHE_VERSION 2
+#define FILENAME_LEN 256
+char *rcache_dir = NULL;
+unsigned long rcache_max_size = 0;
+bool rcache_refresh = False;
+unsigned long rcache_key = 0;
+char *rcache_spec = NULL;  /* Canonical text of the specification */
+int rcache_hits = 0;
+int rcache_misses = 0;
+
+
+/* Files of the cache directory, for finding least recently used
+   entries; cf. rcache_evict(). */
+typedef struct {
+    char *name;
+    time_t mtime;
+    unsigned long size;
+} rcache_file_t;
+
+/* Place in filename the name of the file for the given key, tag, and
+   extension.  If ext is NULL, then the name is the basename for
+   bddarray_save() and bddarray_load().  Return 0 on success, -1 if the
+   name is too long. */
+int rcache_filename( char *filename, unsigned long key, char *tag,
+                     char *ext );
+
+/* Mix the integer x into the hash h. */
+unsigned long rcache_hash_int( unsigned long h, int x );
+
+/* Mix the variables of st, in order, into the hash h. */
+unsigned long rcache_hash_vars( unsigned long h, symtab_t *st );
+
+/* Mark the file as recently used. */
+void rcache_touch( char *filename );
+
+/* Delete least recently used entries until the total size of the
+   cache is within the limit.  Return the number of deleted entries,
+   or -1 on error. */
+int rcache_evict();
+
+int rcache_filecmp( const void *f1, const void *f2 );
+
+/* Key of the entry of distance bounds for the given metric variables */
+unsigned long rcache_minmax_key( int *offw, int num_metric_vars );
+
+/* Write the parse tree to fp, in the order that ptree_hash() visits it,
+   such that different trees yield different text. */
+void rcache_write_ptree( FILE *fp, ptree_t *head );
+
+/* Return the canonical text of the global specification, i.e., the
+   data from which rcache_spec_hash() is computed.  The caller should
+   free() it. */
+char *rcache_spec_text( unsigned char init_flags );
+
+/* Return the canonical text of the entry of distance bounds for the
+   given metric variables, or of the component head, respectively. */
+char *rcache_minmax_text( int *offw, int num_metric_vars );
+char *rcache_component_text( ptree_t *head, symtab_t *st );
+
+/* Save text as that of the entry with the given key and tag, in the
+   file DIR/gr1c-KEY-TAG.spec.  Return 0 on success, -1 on error. */
+int rcache_save_spec( unsigned long key, char *tag, char *text );
+
+/* Compare text with that saved for the entry with the given key and
+   tag.  Return 1 if they are equal, 0 if nothing is saved, and -1 if
+   the entry belongs to a different problem, i.e., the keys collide. */
+int rcache_check_spec( unsigned long key, char *tag, char *text );
+
+
+void setresultcache( char *dir, unsigned long max_size, bool refresh,
+                     unsigned char init_flags )
+{
+    rcache_dir = dir;
+    rcache_max_size = max_size;
+    rcache_refresh = refresh;
+    rcache_hits = rcache_misses = 0;
+    free( rcache_spec );
+    rcache_spec = NULL;
+    if (dir != NULL) {
+        rcache_key = rcache_spec_hash( init_flags );
+        rcache_spec = rcache_spec_text( init_flags );
+    }
+}
+
+
+bool rcache_enabled()
+{
+    return rcache_dir != NULL;
+}
+
+
+void rcache_stats( int *hits, int *misses )
+{
+    *hits = rcache_hits;
+    *misses = rcache_misses;
+}
+
+
+unsigned long rcache_hash_int( unsigned long h, int x )
+{
+    int i;
+    for (i = 0; i < sizeof(int); i++)
+        h = PTREE_HASH_STEP( h, (unsigned int)x >> 8*i & 0xff );
+    return h;
+}
+
+unsigned long rcache_hash_vars( unsigned long h, symtab_t *st )
+{
+    char *c;
+    int i;
+    h = rcache_hash_int( h, st->size );
+    for (i = 0; i < st->size; i++) {
+        h = rcache_hash_int( h, (*(st->nodes+i))->value );
+        for (c = (*(st->nodes+i))->name; *c != '\0'; c++)
+            h = PTREE_HASH_STEP( h, (unsigned char)*c );
+        h = PTREE_HASH_STEP( h, 0xfe );
+    }
+    return h;
+}
+
+
+unsigned long rcache_spec_hash( unsigned char init_flags )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    int i;
+
+    h = rcache_hash_int( h, RCACHE_VERSION );
+    h = rcache_hash_int( h, init_flags );
+
+    /* The order of the variable lists is the variable order. */
+    h = ptree_hash( spc.evar_list, h );
+    h = ptree_hash( spc.svar_list, h );
+
+    h = ptree_hash( spc.env_init, h );
+    h = ptree_hash( spc.sys_init, h );
+    h = rcache_hash_int( h, spc.et_array_len );
+    for (i = 0; i < spc.et_array_len; i++)
+        h = ptree_hash( *(spc.env_trans_array+i), h );
+    h = rcache_hash_int( h, spc.st_array_len );
+    for (i = 0; i < spc.st_array_len; i++)
+        h = ptree_hash( *(spc.sys_trans_array+i), h );
+    h = rcache_hash_int( h, spc.num_egoals );
+    for (i = 0; i < spc.num_egoals; i++)
+        h = ptree_hash( *(spc.env_goals+i), h );
+    h = rcache_hash_int( h, spc.num_sgoals );
+    for (i = 0; i < spc.num_sgoals; i++)
+        h = ptree_hash( *(spc.sys_goals+i), h );
+
+    return h;
+}
+
+
+void rcache_write_ptree( FILE *fp, ptree_t *head )
+{
+    if (head == NULL) {
+        fprintf( fp, ".\n" );
+        return;
+    }
+    if (head->name == NULL) {
+        fprintf( fp, "%d %d -\n", head->type, head->value );
+    } else {
+        fprintf( fp, "%d %d %lu:%s\n", head->type, head->value,
+                 (unsigned long)strlen( head->name ), head->name );
+    }
+    rcache_write_ptree( fp, head->left );
+    rcache_write_ptree( fp, head->right );
+}
+
+
+char *rcache_spec_text( unsigned char init_flags )
+{
+    FILE *fp;
+    char *text;
+    size_t len;
+    int i;
+
+    fp = open_memstream( &text, &len );
+    if (fp == NULL) {
+        perror( "rcache_spec_text, open_memstream" );
+        exit(-1);
+    }
+    fprintf( fp, "gr1c cache %d\ninit %d\n", RCACHE_VERSION, init_flags );
+    rcache_write_ptree( fp, spc.evar_list );
+    rcache_write_ptree( fp, spc.svar_list );
+    rcache_write_ptree( fp, spc.env_init );
+    rcache_write_ptree( fp, spc.sys_init );
+    fprintf( fp, "env_trans %d\n", spc.et_array_len );
+    for (i = 0; i < spc.et_array_len; i++)
+        rcache_write_ptree( fp, *(spc.env_trans_array+i) );
+    fprintf( fp, "sys_trans %d\n", spc.st_array_len );
+    for (i = 0; i < spc.st_array_len; i++)
+        rcache_write_ptree( fp, *(spc.sys_trans_array+i) );
+    fprintf( fp, "env_goals %d\n", spc.num_egoals );
+    for (i = 0; i < spc.num_egoals; i++)
+        rcache_write_ptree( fp, *(spc.env_goals+i) );
+    fprintf( fp, "sys_goals %d\n", spc.num_sgoals );
+    for (i = 0; i < spc.num_sgoals; i++)
+        rcache_write_ptree( fp, *(spc.sys_goals+i) );
+    if (fclose( fp )) {
+        perror( "rcache_spec_text, fclose" );
+        exit(-1);
+    }
+    return text;
+}
+
+
+char *rcache_minmax_text( int *offw, int num_metric_vars )
+{
+    FILE *fp;
+    char *text;
+    size_t len;
+    int i;
+
+    fp = open_memstream( &text, &len );
+    if (fp == NULL) {
+        perror( "rcache_minmax_text, open_memstream" );
+        exit(-1);
+    }
+    fprintf( fp, "%smetric %d\n", rcache_spec, num_metric_vars );
+    for (i = 0; i < 2*num_metric_vars; i++)
+        fprintf( fp, "%d\n", *(offw+i) );
+    if (fclose( fp )) {
+        perror( "rcache_minmax_text, fclose" );
+        exit(-1);
+    }
+    return text;
+}
+
+
+char *rcache_component_text( ptree_t *head, symtab_t *st )
+{
+    FILE *fp;
+    char *text;
+    size_t len;
+    int i;
+
+    fp = open_memstream( &text, &len );
+    if (fp == NULL) {
+        perror( "rcache_component_text, open_memstream" );
+        exit(-1);
+    }
+    fprintf( fp, "gr1c cache %d\ncomponent\n%d\n", RCACHE_VERSION, st->size );
+    for (i = 0; i < st->size; i++)
+        fprintf( fp, "%d %lu:%s\n", (*(st->nodes+i))->value,
+                 (unsigned long)strlen( (*(st->nodes+i))->name ),
+                 (*(st->nodes+i))->name );
+    rcache_write_ptree( fp, head );
+    if (fclose( fp )) {
+        perror( "rcache_component_text, fclose" );
+        exit(-1);
+    }
+    return text;
+}
+
+
+int rcache_save_spec( unsigned long key, char *tag, char *text )
+{
+    char filename[FILENAME_LEN], tmpfilename[FILENAME_LEN+4];
+    FILE *fp;
+
+    if (rcache_filename( filename, key, tag, "spec" ))
+        return -1;
+    sprintf( tmpfilename, "%s.tmp", filename );
+    fp = fopen( tmpfilename, "w" );
+    if (fp == NULL) {
+        perror( "rcache_save_spec, fopen" );
+        return -1;
+    }
+    fputs( text, fp );
+    if (fclose( fp ) || rename( tmpfilename, filename )) {
+        perror( "rcache_save_spec, rename" );
+        return -1;
+    }
+    return 0;
+}
+
+
+int rcache_check_spec( unsigned long key, char *tag, char *text )
+{
+    char filename[FILENAME_LEN];
+    FILE *fp;
+    char *c;
+    bool equal;
+
+    if (rcache_filename( filename, key, tag, "spec" ))
+        return 0;
+    fp = fopen( filename, "r" );
+    if (fp == NULL)
+        return 0;
+    for (c = text; *c != '\0'; c++) {
+        if (getc( fp ) != (unsigned char)*c)
+            break;
+    }
+    equal = (*c == '\0' && getc( fp ) == EOF);
+    fclose( fp );
+    if (!equal) {
+        fprintf( stderr,
+                 "Warning: ignoring cache entry \"%s\" of a different"
+                 " problem.\n", filename );
+        return -1;
+    }
+    return 1;
+}
+
+
+int rcache_filename( char *filename, unsigned long key, char *tag,
+                     char *ext )
+{
+    if (strlen( rcache_dir ) + strlen( tag )
+        + (ext == NULL ? 0 : strlen( ext )+1) + 2*sizeof(unsigned long) + 8
+        > FILENAME_LEN)
+        return -1;
+    if (ext == NULL) {
+        sprintf( filename, "%s/gr1c-%lx-%s", rcache_dir, key, tag );
+    } else {
+        sprintf( filename, "%s/gr1c-%lx-%s.%s", rcache_dir, key, tag, ext );
+    }
+    return 0;
+}
+
+
+void rcache_touch( char *filename )
+{
+    utime( filename, NULL );
+}
+
+
+int rcache_filecmp( const void *f1, const void *f2 )
+{
+    if (((rcache_file_t *)f1)->mtime < ((rcache_file_t *)f2)->mtime)
+        return -1;
+    if (((rcache_file_t *)f1)->mtime > ((rcache_file_t *)f2)->mtime)
+        return 1;
+    return 0;
+}
+
+
+int rcache_evict()
+{
+    DIR *dp;
+    struct dirent *de;
+    struct stat sb;
+    char filename[FILENAME_LEN+8];
+    rcache_file_t *files = NULL;
+    int files_len = 0;
+    unsigned long total = 0;
+    int num_deleted = 0;
+    int len, i;
+
+    if (rcache_max_size == 0)
+        return 0;
+
+    dp = opendir( rcache_dir );
+    if (dp == NULL) {
+        perror( "rcache_evict, opendir" );
+        return -1;
+    }
+    while ((de = readdir( dp )) != NULL) {
+        if (strncmp( de->d_name, "gr1c-", strlen( "gr1c-" ) )
+            || strlen( rcache_dir ) + strlen( de->d_name ) + 2
+               > FILENAME_LEN)
+            continue;
+        sprintf( filename, "%s/%s", rcache_dir, de->d_name );
+        if (stat( filename, &sb ) || !S_ISREG( sb.st_mode ))
+            continue;
+        total += sb.st_size;
+
+        /* An entry is identified by its .chk or .aut file.  The sizes of
+           the corresponding .dddmp and .spec files are included below. */
+        len = strlen( de->d_name );
+        if (len < 4 || (strcmp( de->d_name+len-4, ".chk" )
+                        && strcmp( de->d_name+len-4, ".aut" )))
+            continue;
+        files = realloc( files, (files_len+1)*sizeof(rcache_file_t) );
+        if (files == NULL) {
+            perror( "rcache_evict, realloc" );
+            exit(-1);
+        }
+        (files+files_len)->name = strdup( de->d_name );
+        if ((files+files_len)->name == NULL) {
+            perror( "rcache_evict, strdup" );
+            exit(-1);
+        }
+        (files+files_len)->mtime = sb.st_mtime;
+        (files+files_len)->size = sb.st_size;
+        files_len++;
+    }
+    closedir( dp );
+
+    qsort( files, files_len, sizeof(rcache_file_t), rcache_filecmp );
+    for (i = 0; i < files_len && total > rcache_max_size; i++) {
+        sprintf( filename, "%s/%s", rcache_dir, (files+i)->name );
+        if (remove( filename ))
+            continue;
+        total -= (files+i)->size;
+        len = strlen( filename );
+        if (!strcmp( filename+len-4, ".chk" )) {
+            strcpy( filename+len-4, ".dddmp" );
+            if (!stat( filename, &sb ) && !remove( filename ))
+                total -= sb.st_size;
+        }
+        strcpy( filename+len-4, ".spec" );
+        if (!stat( filename, &sb ) && !remove( filename ))
+            total -= sb.st_size;
+        num_deleted++;
+    }
+
+    for (i = 0; i < files_len; i++)
+        free( (files+i)->name );
+    free( files );
+    return num_deleted;
+}
+
+
+DdNode *rcache_load_winning( DdManager *manager )
+{
+    char basename[FILENAME_LEN];
+    DdNode **f, **vars, **pvars;
+    DdNode *W;
+    int *vals, vals_len;
+    int num_env, num_sys;
+    int i;
+
+    if (rcache_dir == NULL)
+        return NULL;
+    if (rcache_refresh
+        || rcache_filename( basename, rcache_key, "winning", NULL )
+        || rcache_check_spec( rcache_key, "winning", rcache_spec ) <= 0) {
+        rcache_misses++;
+        return NULL;
+    }
+    i = bddarray_load( manager, basename, rcache_key, True,
+                       &f, &vals, &vals_len );
+    if (i < 0) {
+        rcache_misses++;
+        return NULL;
+    }
+    free( vals );
+    if (i != 1) {
+        for (; i > 0; i--)
+            Cudd_RecursiveDeref( manager, *(f+i-1) );
+        free( f );
+        rcache_misses++;
+        return NULL;
+    }
+    W = *f;
+    free( f );
+
+    /* Define the variable map, as would have been done while computing
+       the winning set. */
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+    vars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    pvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    if (vars == NULL || pvars == NULL) {
+        perror( "rcache_load_winning, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_env+num_sys; i++) {
+        *(vars+i) = Cudd_bddIthVar( manager, i );
+        *(pvars+i) = Cudd_bddIthVar( manager, i+num_env+num_sys );
+    }
+    if (!Cudd_SetVarMap( manager, vars, pvars, num_env+num_sys )) {
+        fprintf( stderr,
+                 "Error: failed to define variable map in CUDD manager.\n" );
+        free( vars );
+        free( pvars );
+        Cudd_RecursiveDeref( manager, W );
+        return NULL;
+    }
+    free( vars );
+    free( pvars );
+
+    sprintf( basename+strlen( basename ), ".chk" );
+    rcache_touch( basename );
+    rcache_hits++;
+    return W;
+}
+
+
+int rcache_save_winning( DdManager *manager, DdNode *W )
+{
+    char basename[FILENAME_LEN];
+
+    if (rcache_dir == NULL)
+        return -1;
+    if (rcache_filename( basename, rcache_key, "winning", NULL )) {
+        fprintf( stderr,
+                 "Error rcache_save_winning: cache directory name is too"
+                 " long.\n" );
+        return -1;
+    }
+    if (rcache_save_spec( rcache_key, "winning", rcache_spec )
+        || bddarray_save( manager, basename, rcache_key, &W, 1, NULL, 0 ))
+        return -1;
+    rcache_evict();
+    return 0;
+}
+
+
+DdNode ***rcache_load_sublevels( DdManager *manager,
+                                 int num_env_goals, int num_sys_goals,
+                                 int **num_sublevels, DdNode *****X_ijr )
+{
+    char basename[FILENAME_LEN];
+    DdNode **f;
+    DdNode ***Y;
+    int *vals, vals_len, f_len;
+    int expected_len;
+    int i, j, r, k;
+
+    if (rcache_dir == NULL)
+        return NULL;
+    if (rcache_refresh
+        || rcache_filename( basename, rcache_key, "sublevel", NULL )
+        || rcache_check_spec( rcache_key, "sublevel", rcache_spec ) <= 0) {
+        rcache_misses++;
+        return NULL;
+    }
+    f_len = bddarray_load( manager, basename, rcache_key, True,
+                           &f, &vals, &vals_len );
+    if (f_len < 0) {
+        rcache_misses++;
+        return NULL;
+    }
+
+    /* vals is [has_X, num_env_goals, num_sys_goals, num_sublevels...] */
+    expected_len = -1;
+    if (vals_len == 3+num_sys_goals && *(vals+1) == num_env_goals
+        && *(vals+2) == num_sys_goals && (*vals || X_ijr == NULL)) {
+        expected_len = 0;
+        for (i = 0; i < num_sys_goals; i++)
+            expected_len += *(vals+3+i)*(*vals ? 1+num_env_goals : 1);
+    }
+    if (expected_len != f_len) {
+        for (k = 0; k < f_len; k++)
+            Cudd_RecursiveDeref( manager, *(f+k) );
+        free( f );
+        free( vals );
+        rcache_misses++;
+        return NULL;
+    }
+
+    Y = malloc( num_sys_goals*sizeof(DdNode **) );
+    *num_sublevels = malloc( num_sys_goals*sizeof(int) );
+    if (Y == NULL || *num_sublevels == NULL) {
+        perror( "rcache_load_sublevels, malloc" );
+        exit(-1);
+    }
+    if (X_ijr != NULL) {
+        *X_ijr = malloc( num_sys_goals*sizeof(DdNode ***) );
+        if (*X_ijr == NULL) {
+            perror( "rcache_load_sublevels, malloc" );
+            exit(-1);
+        }
+    }
+    k = 0;
+    for (i = 0; i < num_sys_goals; i++) {
+        *(*num_sublevels+i) = *(vals+3+i);
+        *(Y+i) = malloc( *(*num_sublevels+i)*sizeof(DdNode *) );
+        if (*(Y+i) == NULL) {
+            perror( "rcache_load_sublevels, malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < *(*num_sublevels+i); j++)
+            *(*(Y+i)+j) = *(f+k++);
+    }
+    if (*vals) {
+        for (i = 0; i < num_sys_goals; i++) {
+            if (X_ijr != NULL) {
+                *(*X_ijr+i) = malloc( *(*num_sublevels+i)
+                                      *sizeof(DdNode **) );
+                if (*(*X_ijr+i) == NULL) {
+                    perror( "rcache_load_sublevels, malloc" );
+                    exit(-1);
+                }
+            }
+            for (j = 0; j < *(*num_sublevels+i); j++) {
+                if (X_ijr != NULL) {
+                    *(*(*X_ijr+i)+j) = malloc( num_env_goals
+                                               *sizeof(DdNode *) );
+                    if (*(*(*X_ijr+i)+j) == NULL) {
+                        perror( "rcache_load_sublevels, malloc" );
+                        exit(-1);
+                    }
+                }
+                for (r = 0; r < num_env_goals; r++) {
+                    if (X_ijr != NULL) {
+                        *(*(*(*X_ijr+i)+j)+r) = *(f+k++);
+                    } else {
+                        Cudd_RecursiveDeref( manager, *(f+k++) );
+                    }
+                }
+            }
+        }
+    }
+    free( f );
+    free( vals );
+
+    sprintf( basename+strlen( basename ), ".chk" );
+    rcache_touch( basename );
+    rcache_hits++;
+    return Y;
+}
+
+
+int rcache_save_sublevels( DdManager *manager, DdNode ***Y,
+                           DdNode ****X_ijr, int *num_sublevels,
+                           int num_env_goals, int num_sys_goals )
+{
+    char basename[FILENAME_LEN];
+    DdNode **f;
+    int *vals;
+    int f_len, result;
+    int i, j, r, k;
+
+    if (rcache_dir == NULL)
+        return -1;
+    if (rcache_filename( basename, rcache_key, "sublevel", NULL )) {
+        fprintf( stderr,
+                 "Error rcache_save_sublevels: cache directory name is too"
+                 " long.\n" );
+        return -1;
+    }
+    if (rcache_save_spec( rcache_key, "sublevel", rcache_spec ))
+        return -1;
+
+    vals = malloc( (3+num_sys_goals)*sizeof(int) );
+    if (vals == NULL) {
+        perror( "rcache_save_sublevels, malloc" );
+        exit(-1);
+    }
+    *vals = (X_ijr != NULL);
+    *(vals+1) = num_env_goals;
+    *(vals+2) = num_sys_goals;
+    f_len = 0;
+    for (i = 0; i < num_sys_goals; i++) {
+        *(vals+3+i) = *(num_sublevels+i);
+        f_len += *(num_sublevels+i)*(X_ijr != NULL ? 1+num_env_goals : 1);
+    }
+    f = malloc( (f_len > 0 ? f_len : 1)*sizeof(DdNode *) );
+    if (f == NULL) {
+        perror( "rcache_save_sublevels, malloc" );
+        exit(-1);
+    }
+    k = 0;
+    for (i = 0; i < num_sys_goals; i++) {
+        for (j = 0; j < *(num_sublevels+i); j++)
+            *(f+k++) = *(*(Y+i)+j);
+    }
+    if (X_ijr != NULL) {
+        for (i = 0; i < num_sys_goals; i++) {
+            for (j = 0; j < *(num_sublevels+i); j++) {
+                for (r = 0; r < num_env_goals; r++)
+                    *(f+k++) = *(*(*(X_ijr+i)+j)+r);
+            }
+        }
+    }
+
+    result = bddarray_save( manager, basename, rcache_key,
+                            f, f_len, vals, 3+num_sys_goals );
+    free( f );
+    free( vals );
+    if (result)
+        return -1;
+    rcache_evict();
+    return 0;
+}
+
+
+unsigned long rcache_minmax_key( int *offw, int num_metric_vars )
+{
+    unsigned long key = rcache_key;
+    int i;
+    key = rcache_hash_int( key, num_metric_vars );
+    for (i = 0; i < 2*num_metric_vars; i++)
+        key = rcache_hash_int( key, *(offw+i) );
+    return key;
+}
+
+
+int rcache_load_minmax( DdManager *manager, int *offw, int num_metric_vars,
+                        int num_sys_goals, int *num_sublevels,
+                        double ***Min, double ***Max )
+{
+    char basename[FILENAME_LEN];
+    unsigned long key;
+    char *text;
+    DdNode **f;
+    int *vals, vals_len, f_len;
+    int expected_len;
+    bool usable;
+    int i, j, k;
+
+    if (rcache_dir == NULL)
+        return -1;
+    key = rcache_minmax_key( offw, num_metric_vars );
+    if (rcache_refresh || rcache_filename( basename, key, "minmax", NULL )) {
+        rcache_misses++;
+        return -1;
+    }
+    text = rcache_minmax_text( offw, num_metric_vars );
+    i = rcache_check_spec( key, "minmax", text );
+    free( text );
+    if (i <= 0) {
+        rcache_misses++;
+        return -1;
+    }
+    f_len = bddarray_load( manager, basename, key, False,
+                           &f, &vals, &vals_len );
+    if (f_len < 0) {
+        rcache_misses++;
+        return -1;
+    }
+    for (k = 0; k < f_len; k++)
+        Cudd_RecursiveDeref( manager, *(f+k) );
+    free( f );
+
+    /* vals is [num_metric_vars, offw..., num_sys_goals, num_sublevels...,
+       Min and Max of goal 0, Min and Max of goal 1, ...] */
+    expected_len = 2+2*num_metric_vars+num_sys_goals;
+    for (i = 0; i < num_sys_goals; i++)
+        expected_len += 2*(*(num_sublevels+i)-1);
+    usable = (vals_len == expected_len && *vals == num_metric_vars
+              && *(vals+1+2*num_metric_vars) == num_sys_goals);
+    for (k = 0; usable && k < 2*num_metric_vars; k++) {
+        if (*(vals+1+k) != *(offw+k))
+            usable = False;
+    }
+    for (i = 0; usable && i < num_sys_goals; i++) {
+        if (*(vals+2+2*num_metric_vars+i) != *(num_sublevels+i))
+            usable = False;
+    }
+    if (!usable) {
+        free( vals );
+        rcache_misses++;
+        return -1;
+    }
+
+    *Min = malloc( num_sys_goals*sizeof(double *) );
+    *Max = malloc( num_sys_goals*sizeof(double *) );
+    if (*Min == NULL || *Max == NULL) {
+        perror( "rcache_load_minmax, malloc" );
+        exit(-1);
+    }
+    k = 2+2*num_metric_vars+num_sys_goals;
+    for (i = 0; i < num_sys_goals; i++) {
+        *(*Min+i) = malloc( (*(num_sublevels+i)-1)*sizeof(double) );
+        *(*Max+i) = malloc( (*(num_sublevels+i)-1)*sizeof(double) );
+        if (*(*Min+i) == NULL || *(*Max+i) == NULL) {
+            perror( "rcache_load_minmax, malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < *(num_sublevels+i)-1; j++)
+            *(*(*Min+i)+j) = *(vals+k++);
+        for (j = 0; j < *(num_sublevels+i)-1; j++)
+            *(*(*Max+i)+j) = *(vals+k++);
+    }
+    free( vals );
+
+    sprintf( basename+strlen( basename ), ".chk" );
+    rcache_touch( basename );
+    rcache_hits++;
+    return 0;
+}
+
+
+int rcache_save_minmax( DdManager *manager, int *offw, int num_metric_vars,
+                        int num_sys_goals, int *num_sublevels,
+                        double **Min, double **Max )
+{
+    char basename[FILENAME_LEN];
+    unsigned long key;
+    char *text;
+    int *vals;
+    int vals_len, result;
+    int i, j, k;
+
+    if (rcache_dir == NULL)
+        return -1;
+    key = rcache_minmax_key( offw, num_metric_vars );
+    if (rcache_filename( basename, key, "minmax", NULL )) {
+        fprintf( stderr,
+                 "Error rcache_save_minmax: cache directory name is too"
+                 " long.\n" );
+        return -1;
+    }
+
+    /* Distances are integral, so nothing is lost by saving them as
+       integers, but check in case the metric is changed. */
+    for (i = 0; i < num_sys_goals; i++) {
+        for (j = 0; j < *(num_sublevels+i)-1; j++) {
+            if (*(*(Min+i)+j) != (int)*(*(Min+i)+j)
+                || *(*(Max+i)+j) != (int)*(*(Max+i)+j))
+                return -1;
+        }
+    }
+
+    vals_len = 2+2*num_metric_vars+num_sys_goals;
+    for (i = 0; i < num_sys_goals; i++)
+        vals_len += 2*(*(num_sublevels+i)-1);
+    vals = malloc( vals_len*sizeof(int) );
+    if (vals == NULL) {
+        perror( "rcache_save_minmax, malloc" );
+        exit(-1);
+    }
+    k = 0;
+    *(vals+k++) = num_metric_vars;
+    for (i = 0; i < 2*num_metric_vars; i++)
+        *(vals+k++) = *(offw+i);
+    *(vals+k++) = num_sys_goals;
+    for (i = 0; i < num_sys_goals; i++)
+        *(vals+k++) = *(num_sublevels+i);
+    for (i = 0; i < num_sys_goals; i++) {
+        for (j = 0; j < *(num_sublevels+i)-1; j++)
+            *(vals+k++) = (int)*(*(Min+i)+j);
+        for (j = 0; j < *(num_sublevels+i)-1; j++)
+            *(vals+k++) = (int)*(*(Max+i)+j);
+    }
+
+    text = rcache_minmax_text( offw, num_metric_vars );
+    result = rcache_save_spec( key, "minmax", text );
+    free( text );
+    if (!result)
+        result = bddarray_save( manager, basename, key,
+                                NULL, 0, vals, vals_len );
+    free( vals );
+    if (result)
+        return -1;
+    rcache_evict();
+    return 0;
+}
+
+
+DdNode *rcache_ptree_BDD( ptree_t *head, symtab_t *st, DdManager *manager )
+{
+    char basename[FILENAME_LEN];
+    unsigned long key;
+    char *text;
+    DdNode **f;
+    DdNode *fn;
+    int *vals, vals_len;
+    int i;
+
+    if (rcache_dir == NULL || tree_size( head ) < RCACHE_MIN_COMPONENT)
+        return ptree_BDD_symtab( head, st, manager );
+
+    /* The symbol table determines the index of each variable. */
+    key = rcache_hash_int( PTREE_HASH_INIT, RCACHE_VERSION );
+    key = rcache_hash_vars( key, st );
+    key = ptree_hash( head, key );
+    if (rcache_filename( basename, key, "component", NULL ))
+        return ptree_BDD_symtab( head, st, manager );
+
+    /* The BDD is rebuilt in the current variable order, which may
+       differ from that when it was saved, e.g., after reordering. */
+    text = rcache_component_text( head, st );
+    if (!rcache_refresh && rcache_check_spec( key, "component", text ) > 0) {
+        i = bddarray_load( manager, basename, key, False,
+                           &f, &vals, &vals_len );
+        if (i >= 0) {
+            free( vals );
+            if (i == 1) {
+                fn = *f;
+                free( f );
+                free( text );
+                sprintf( basename+strlen( basename ), ".chk" );
+                rcache_touch( basename );
+                rcache_hits++;
+                return fn;
+            }
+            for (; i > 0; i--)
+                Cudd_RecursiveDeref( manager, *(f+i-1) );
+            free( f );
+        }
+    }
+    rcache_misses++;
+
+    fn = ptree_BDD_symtab( head, st, manager );
+    if (fn != NULL && !rcache_save_spec( key, "component", text )
+        && !bddarray_save( manager, basename, key, &fn, 1, NULL, 0 ))
+        rcache_evict();
+    free( text );
+    return fn;
+}
+
+
+DdNode *rcache_conj_BDD( ptree_t **heads, int len, symtab_t *st,
+                         DdManager *manager )
+{
+    DdNode **fns, *fn;
+    int i, j;
+
+    fns = malloc( len*sizeof(DdNode *) );
+    if (len > 0 && fns == NULL) {
+        perror( "rcache_conj_BDD, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < len; i++) {
+        *(fns+i) = rcache_ptree_BDD( *(heads+i), st, manager );
+        if (*(fns+i) == NULL) {
+            for (j = 0; j < i; j++)
+                Cudd_RecursiveDeref( manager, *(fns+j) );
+            free( fns );
+            return NULL;
+        }
+    }
+    fn = BDD_nary( fns, len, PT_AND, manager );
+    for (i = 0; i < len; i++)
+        Cudd_RecursiveDeref( manager, *(fns+i) );
+    free( fns );
+    return fn;
+}
+
+
+anode_t *rcache_load_aut( char *tag, int state_len )
+{
+    char filename[FILENAME_LEN];
+    FILE *fp;
+    anode_t *head;
+
+    if (rcache_dir == NULL)
+        return NULL;
+    if (rcache_refresh
+        || rcache_filename( filename, rcache_key, tag, "aut" )
+        || rcache_check_spec( rcache_key, tag, rcache_spec ) <= 0) {
+        rcache_misses++;
+        return NULL;
+    }
+    fp = fopen( filename, "r" );
+    if (fp == NULL) {
+        rcache_misses++;
+        return NULL;
+    }
+    head = aut_aut_load( state_len, fp );
+    fclose( fp );
+    if (head == NULL) {
+        fprintf( stderr,
+                 "Warning: ignoring malformed file \"%s\".\n", filename );
+        rcache_misses++;
+        return NULL;
+    }
+
+    rcache_touch( filename );
+    rcache_hits++;
+    return head;
+}
+
+
+int rcache_save_aut( char *tag, anode_t *head, int state_len )
+{
+    char filename[FILENAME_LEN], tmpfilename[FILENAME_LEN+4];
+    FILE *fp;
+
+    if (rcache_dir == NULL)
+        return -1;
+    if (rcache_filename( filename, rcache_key, tag, "aut" )) {
+        fprintf( stderr,
+                 "Error rcache_save_aut: cache directory name is too long.\n" );
+        return -1;
+    }
+    if (rcache_save_spec( rcache_key, tag, rcache_spec ))
+        return -1;
+    sprintf( tmpfilename, "%s.tmp", filename );
+    fp = fopen( tmpfilename, "w" );
+    if (fp == NULL) {
+        perror( "rcache_save_aut, fopen" );
+        return -1;
+    }
+    aut_aut_dump( head, state_len, fp );
+    if (fclose( fp ) || rename( tmpfilename, filename )) {
+        perror( "rcache_save_aut, rename" );
+        return -1;
+    }
+    rcache_evict();
+    return 0;
+}
@@ -0,0 +1,131 @@
+/** \file resultcache.h
+ * \brief Persistent cache of winning sets, sublevel sets, and strategies.
+ *
+ * Results are stored in a directory and are found using a key that is
+ * a hash of the specification after expansion of nonboolean variables
+ * (cf. expand_nonbool_GR1()), the interpretation of initial conditions,
+ * and the variable order.  Thus, solving the same problem again, e.g.,
+ * when the specification file was only reformatted, can skip the
+ * fixpoint computations.  BDDs are saved in the format of checkpoints
+ * (cf. checkpoint.h), with names of the form DIR/gr1c-KEY-TAG, and
+ * strategies are saved in "gr1c automaton" format, with names of the
+ * form DIR/gr1c-KEY-TAG.aut.  Because different problems can have the
+ * same key, each entry is accompanied by the canonical text of the
+ * problem, in DIR/gr1c-KEY-TAG.spec, and an entry is only used if that
+ * text is equal to that of the problem being solved.
+ *
+ * Independently of the key, BDDs of the components of the specification
+ * (e.g., each element of env_trans_array) can be cached, so that after
+ * a specification is edited, only the changed parts are rebuilt; cf.
+ * rcache_ptree_BDD().
+ *
+ * Tables of bounds on distance to system goals (cf. compute_minmax() in
+ * solve_metric.c) are saved with a key that also depends on the metric
+ * variables; cf. rcache_load_minmax().
+ *
+ * If a maximum size is given, then after each save the least recently
+ * used entries are deleted until the total size of the cache is within
+ * the limit.  Only files with names that begin with "gr1c-" are
+ * considered as entries of the cache.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "common.h"
+#include "automaton.h"
+
+
+/** Enable the result cache.  The problem being solved is the global
+   specification, which should already have been expanded into Boolean
+   variables, together with init_flags; it is identified as by
+   rcache_spec_hash().  max_size is the maximum total size in bytes of
+   files in the cache directory, or 0 to not limit the size.  If
+   refresh is True, then nothing is loaded from the cache, but results
+   are still saved (i.e., every lookup is a miss).  If dir is NULL,
+   then the cache is disabled (default). */
+void setresultcache( char *dir, unsigned long max_size, bool refresh,
+                     unsigned char init_flags );
+
+/** Return True if the result cache is enabled. */
+bool rcache_enabled();
+
+/** Hash the global specification, which should already have been
+   expanded into Boolean variables, together with init_flags. */
+unsigned long rcache_spec_hash( unsigned char init_flags );
+
+/** Load the winning set.  If found, the variable map of the manager is
+   defined as by compute_winning_set_BDD().  Return the (referenced)
+   BDD, or NULL if it is not in the cache. */
+DdNode *rcache_load_winning( DdManager *manager );
+
+/** Save the winning set.  Return 0 on success, -1 on error. */
+int rcache_save_winning( DdManager *manager, DdNode *W );
+
+/** Load sublevel sets in the form returned by compute_sublevel_sets().
+   If X_ijr is NULL, then only the Y sets are loaded; otherwise, the
+   cache entry is only used if it includes the X sets.  Return NULL if
+   no usable entry is in the cache. */
+DdNode ***rcache_load_sublevels( DdManager *manager,
+                                 int num_env_goals, int num_sys_goals,
+                                 int **num_sublevels, DdNode *****X_ijr );
+
+/** Save sublevel sets as returned by compute_sublevel_sets().  X_ijr
+   may be NULL.  Return 0 on success, -1 on error. */
+int rcache_save_sublevels( DdManager *manager, DdNode ***Y,
+                           DdNode ****X_ijr, int *num_sublevels,
+                           int num_env_goals, int num_sys_goals );
+
+/** Load the tables of bounds on distance to the system goals that are
+   computed by compute_minmax() (cf. solve_metric.h) for the metric
+   variables given by offw, as returned by get_offsets().  The entry is
+   only used if it was saved with the same numbers of sublevel sets.
+   On success, *Min and *Max point to new arrays in the form returned
+   by compute_minmax(), and 0 is returned.  Return -1 if no usable
+   entry is in the cache. */
+int rcache_load_minmax( DdManager *manager, int *offw, int num_metric_vars,
+                        int num_sys_goals, int *num_sublevels,
+                        double ***Min, double ***Max );
+
+/** Save tables of bounds on distance as computed by compute_minmax().
+   The values are saved as integers, which is exact for the distance
+   used by solve_metric.c.  Return 0 on success, -1 on error. */
+int rcache_save_minmax( DdManager *manager, int *offw, int num_metric_vars,
+                        int num_sys_goals, int *num_sublevels,
+                        double **Min, double **Max );
+
+/** Minimum number of parse tree nodes in a component for its BDD to
+   be cached by rcache_ptree_BDD().  Smaller components are faster to
+   build than to load. */
+#define RCACHE_MIN_COMPONENT 32
+
+/** Build BDD as ptree_BDD_symtab() does, but if the result cache is
+   enabled, then first try to load it from the cache, and save it there
+   after building it.  The entry is found using a hash of the parse tree
+   and of the variables in st, i.e., it does not depend on the rest of
+   the specification. */
+DdNode *rcache_ptree_BDD( ptree_t *head, symtab_t *st, DdManager *manager );
+
+/** Return the conjunction of the BDDs of the len parse trees in heads,
+   each obtained from rcache_ptree_BDD().  E.g., use this with
+   env_trans_array instead of calling ptree_BDD() on env_trans. */
+DdNode *rcache_conj_BDD( ptree_t **heads, int len, symtab_t *st,
+                         DdManager *manager );
+
+/** Load strategy with the given tag (e.g., indicating the options used
+   during synthesis).  Return NULL if not in the cache. */
+anode_t *rcache_load_aut( char *tag, int state_len );
+
+/** Save strategy with the given tag.  Return 0 on success, -1 on
+   error. */
+int rcache_save_aut( char *tag, anode_t *head, int state_len );
+
+/** Get the numbers of lookups that were hits and misses so far. */
+void rcache_stats( int *hits, int *misses );
+
+
+#endif
@@ -18,15 +18,8 @@
 #include "solve.h"
 #include "patching.h"
 #include "gr1c_util.h"
-extern int yyparse( void );
-
-
-/**************************
- **** Global variables ****/
-
-extern specification_t spc;
-
-/**************************/
+#include "checkpoint.h"
+#include "context.h"
 
 
 /* Output formats */
@@ -68,6 +61,9 @@ int main( int argc, char **argv )
     bool reading_options = True;  /* For disabling option parsing using "--" */
     int input_index = -1;
     int output_file_index = -1;  /* For command-line flag "-o". */
+    int checkpoint_index = -1;  /* For command-line flag "--checkpoint". */
+    int checkpoint_interval = CHECKPOINT_DEFAULT_INTERVAL;
+    bool resume_flag = False;
     char dumpfilename[64];
 
     int i, j, var_index;
@@ -171,6 +167,29 @@ int main( int argc, char **argv )
             } else if (!strncmp( argv[i]+2, "version", strlen( "version" ) )) {
                 PRINT_VERSION();
                 return 0;
+            } else if (!strncmp( argv[i]+2, "checkpoint-interval",
+                                 strlen( "checkpoint-interval" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                checkpoint_interval = strtol( argv[i+1], NULL, 10 );
+                if (checkpoint_interval < 0) {
+                    fprintf( stderr,
+                             "Checkpoint interval must be nonnegative.\n" );
+                    return 1;
+                }
+                i++;
+            } else if (!strncmp( argv[i]+2, "checkpoint",
+                                 strlen( "checkpoint" ) )) {
+                if (i == argc-1) {
+                    fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
+                    return 1;
+                }
+                checkpoint_index = i+1;
+                i++;
+            } else if (!strncmp( argv[i]+2, "resume", strlen( "resume" ) )) {
+                resume_flag = True;
             } else {
                 fprintf( stderr, "Invalid flag given. Try \"-h\".\n" );
                 return 1;
@@ -184,7 +203,9 @@ int main( int argc, char **argv )
 
     if (help_flag) {
         /* Split among printf() calls to conform with ISO C90 string length */
-        printf( "Usage: %s [-hVvls] [-t TYPE] [-o FILE] [[--] FILE]\n\n"
+        printf( "Usage: %s [-hVvls] [-t TYPE] [-o FILE]\n"
+                "       [--checkpoint PREFIX [--checkpoint-interval S] [--resume]]\n"
+                "       [[--] FILE]\n\n"
                 "  -h        this help message\n"
                 "  -V        print version and exit\n"
                 "  -v        be verbose\n"
@@ -197,10 +218,35 @@ int main( int argc, char **argv )
                 "  -s        only check specification syntax (return 2 on error)\n"
 /*                "  -r        only check realizability; do not synthesize strategy\n"
                 "            (return 0 if realizable, 3 if not)\n" */
-                "  -o FILE   output strategy to FILE, rather than stdout (default)\n" );
+                "  -o FILE   output strategy to FILE, rather than stdout (default)\n"
+                "  --checkpoint PREFIX\n"
+                "            periodically save progress of the fixpoint computation\n"
+                "            to files with names that begin with PREFIX\n"
+                "  --checkpoint-interval S\n"
+                "            with --checkpoint, save progress at most once every\n"
+                "            S seconds (default is 300)\n"
+                "  --resume  with --checkpoint, resume from saved progress, if any\n" );
         return 0;
     }
 
+    if (resume_flag && checkpoint_index < 0) {
+        fprintf( stderr, "--resume can only be used with --checkpoint.\n" );
+        return 1;
+    }
+    if (checkpoint_interval != CHECKPOINT_DEFAULT_INTERVAL
+        && checkpoint_index < 0) {
+        fprintf( stderr,
+                 "--checkpoint-interval can only be used with"
+                 " --checkpoint.\n" );
+        return 1;
+    }
+    if (checkpoint_index >= 0 && input_index < 0) {
+        fprintf( stderr,
+                 "--checkpoint requires the specification to be given"
+                 " in a file.\n" );
+        return 1;
+    }
+
     if (logging_flag) {
         openlogfile( "rg" );
         verbose = 1;
@@ -217,6 +263,13 @@ int main( int argc, char **argv )
             perror( "gr1c-rg, fopen" );
             return -1;
         }
+        if (checkpoint_index >= 0) {
+            /* Checkpoints are only used for the same specification. */
+            setcheckpoint( argv[checkpoint_index],
+                           checkpoint_interval, resume_flag,
+                           checkpoint_filehash( fp ) );
+            rewind( fp );
+        }
         stdin_backup = stdin;
         stdin = fp;
     }
@@ -225,7 +278,7 @@ int main( int argc, char **argv )
     if (verbose)
         logprint( "Parsing input..." );
     SPC_INIT( spc );
-    if (yyparse())
+    if (gr1c_parse( NULL, &spc, NULL ))
         return 2;
     if (verbose)
         logprint( "Done." );
@@ -402,6 +455,7 @@ int main( int argc, char **argv )
         return -1;
     spc.nonbool_var_list = expand_nonbool_variables( &spc.evar_list, &spc.svar_list,
                                                      verbose );
+    spc.var_st = vars_symtab( spc.evar_list, spc.svar_list );
 
     /* Merge component safety (transition) formulas */
     if (spc.et_array_len > 1) {
@@ -478,31 +532,32 @@ int main( int argc, char **argv )
 
     /* Generate BDDs for the various parse trees from the problem spec. */
     if (spc.env_init != NULL) {
-        einit = ptree_BDD( spc.env_init, spc.evar_list, manager );
+        einit = ptree_BDD_symtab( spc.env_init, spc.var_st, manager );
     } else {
         einit = Cudd_ReadOne( manager );
         Cudd_Ref( einit );
     }
     if (spc.sys_init != NULL) {
-        sinit = ptree_BDD( spc.sys_init, spc.evar_list, manager );
+        sinit = ptree_BDD_symtab( spc.sys_init, spc.var_st, manager );
     } else {
         sinit = Cudd_ReadOne( manager );
         Cudd_Ref( sinit );
     }
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
     if (verbose > 1)
         logprint( "Done." );
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = ptree_BDD_symtab( *(spc.env_goals+i),
+                                            spc.var_st, manager );
     } else {
         egoals = NULL;
     }
@@ -510,7 +565,7 @@ int main( int argc, char **argv )
     Entry = Cudd_bddAnd( manager, einit, sinit );
     Cudd_Ref( Entry );
     if (spc.num_sgoals > 0) {
-        Exit = ptree_BDD( *spc.sys_goals, spc.evar_list, manager );
+        Exit = ptree_BDD_symtab( *spc.sys_goals, spc.var_st, manager );
     } else {
         Exit = Cudd_Not( Cudd_ReadOne( manager ) );  /* No exit */
         Cudd_Ref( Exit );
@@ -595,6 +650,7 @@ int main( int argc, char **argv )
     /* Clean-up */
     delete_tree( spc.evar_list );
     delete_tree( spc.svar_list );
+    symtab_free( spc.var_st );
     delete_tree( spc.env_init );
     delete_tree( spc.sys_init );
     delete_tree( spc.env_trans );
@@ -5,23 +5,50 @@
  */
 
 
-%{
-  #include <stdlib.h>
-  #include <stdio.h>
+%code requires {
   #include "common.h"
   #include "ptree.h"
-  void yyerror( char const * );
-  int yylex( void );
 
-  specification_t spc;
+  #ifndef YY_TYPEDEF_YY_SCANNER_T
+  #define YY_TYPEDEF_YY_SCANNER_T
+  typedef void *yyscan_t;
+  #endif
+
+  /* State of one call of gr1c_parse(), so that the parser is reentrant. */
+  typedef struct {
+      specification_t *spec;
+
+      /* General purpose tree pointer,
+         which facilitates cleaner Yacc parsing code. */
+      ptree_t *tree;
+  } parse_state_t;
+}
+
+%{
+  #include <stdlib.h>
+  #include <stdio.h>
 
-  /* General purpose tree pointer,
-     which facilitates cleaner Yacc parsing code. */
-  ptree_t *gen_tree_ptr = NULL;
+  /* Actions refer to the specification and tree pointer of the parse
+     state given to yyparse(). */
+  #define spc (*(ps->spec))
+  #define gen_tree_ptr (ps->tree)
 %}
 
+%code {
+  void yyerror( YYLTYPE *llocp, yyscan_t scanner, parse_state_t *ps,
+                char const *s );
+  int yylex( YYSTYPE *lvalp, YYLTYPE *llocp, yyscan_t scanner );
+  int yylex_init( yyscan_t *scanner );
+  void yyset_in( FILE *in_str, yyscan_t scanner );
+  int yylex_destroy( yyscan_t scanner );
+}
+
+%define api.pure
 %error-verbose
 %locations
+%parse-param { yyscan_t scanner }
+%parse-param { parse_state_t *ps }
+%lex-param { yyscan_t scanner }
 
 
 %union {
@@ -548,7 +575,36 @@ tpropformula: TRUE_CONSTANT  {
 
 %%
 
-void yyerror( char const *s )
+void yyerror( YYLTYPE *llocp, yyscan_t scanner, parse_state_t *ps,
+              char const *s )
 {
     fprintf( stderr, "%s\n", s );
 }
+
+
+#undef spc
+#undef gen_tree_ptr
+
+int gr1c_parse( FILE *fp, specification_t *spec, ptree_t **formula )
+{
+    yyscan_t scanner;
+    parse_state_t state;
+    int result;
+
+    state.spec = spec;
+    state.tree = NULL;
+    if (yylex_init( &scanner )) {
+        perror( "gr1c_parse, yylex_init" );
+        exit(-1);
+    }
+    yyset_in( (fp == NULL ? stdin : fp), scanner );
+    result = yyparse( scanner, &state );
+    yylex_destroy( scanner );
+
+    if (formula != NULL) {
+        *formula = state.tree;
+    } else {
+        delete_tree( state.tree );
+    }
+    return result;
+}
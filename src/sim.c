@@ -5,68 +5,230 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "sim.h"
 #include "common.h"
 #include "gr1c_util.h"
 #include "automaton.h"
 #include "logging.h"
+#include "solve.h"
 #include "solve_support.h"
 #include "solve_metric.h"
+#include "context.h"
+
+
+/* Memory of a play for the current goal: the set of pairs (state, next
+   state) that were chosen, so that a choice is not repeated from the
+   same state.  Pairs are kept in an open addressing hash table. */
+typedef struct {
+    vartype *pairs;  /* 2*state_len entries per slot */
+    bool *used;
+    int size;  /* Number of slots; a power of 2 */
+    int count;
+    int state_len;
+} sim_mem_t;
+
+/* BDDs and buffers for receding horizon simulation in one manager, so
+   that plays in different threads do not share any CUDD state. */
+typedef struct {
+    DdManager *manager;
+    DdNode *W;
+    DdNode *etrans;
+    DdNode *strans_into_W;
+    DdNode *trans;  /* etrans and strans_into_W, for backtracking */
+    DdNode **sgoals;
+    DdNode **goal_dist;  /* ADD of distance to each goal (within W) */
+    int num_sgoals;
+    int horizon;
+    int num_env, num_sys;
+    int *cube;
+    vartype *candidate_state, *finit_state, *fnext_state;
+    anode_t **hstacks;  /* Number of stacks is equal to the horizon. */
+} sim_rhc_t;
+
+sim_mem_t *sim_mem_new( int state_len );
+void sim_mem_free( sim_mem_t *mem );
+void sim_mem_clear( sim_mem_t *mem );
+bool sim_mem_find( sim_mem_t *mem, vartype *state, vartype *next_state );
+void sim_mem_add( sim_mem_t *mem, vartype *state, vartype *next_state );
+
+/* Prepare sim for simulation in manager, where the given BDDs belong
+   and are not released until sim_rhc_free() is called.  The variable
+   map of manager must be defined as by compute_winning_set_BDD(). */
+void sim_rhc_init( sim_rhc_t *sim, DdManager *manager, DdNode *W,
+                   DdNode *etrans, DdNode *strans_into_W, DdNode **sgoals,
+                   int *offw, int num_metric_vars, int horizon,
+                   int num_env, int num_sys );
+void sim_rhc_free( sim_rhc_t *sim );
+
+/* Empty the horizon stacks of sim. */
+void sim_rhc_clear( sim_rhc_t *sim );
+
+/* Return True if state is in the goal with index goal. */
+bool sim_in_goal( sim_rhc_t *sim, int goal, vartype *state );
+
+/* Take one step of the play from state, writing the next state into
+   next_state.  The environment move is chosen uniformly at random,
+   using the stream rng if it is not NULL, else rand().  If state is in
+   the current goal, then *current_goal is advanced first and mem is
+   cleared.  States found within the horizon are kept in the stacks
+   of sim, and are not considered again by later steps, until
+   sim_rhc_clear() is called.  Return 0 on success, 1 if no state
+   within the horizon is nearer the goal (i.e., every candidate is in
+   mem or the stacks), and -1 on error. */
+int sim_rhc_step( sim_rhc_t *sim, sim_mem_t *mem, int *current_goal,
+                  vartype *state, vartype *next_state,
+                  unsigned long *rng, unsigned char verbose );
+
+/* Next number from the pseudorandom stream with state *s (splitmix64) */
+unsigned long sim_rand( unsigned long *s );
+
+
+sim_mem_t *sim_mem_new( int state_len )
+{
+    sim_mem_t *mem = malloc( sizeof(sim_mem_t) );
+    if (mem == NULL) {
+        perror( "sim_mem_new, malloc" );
+        exit(-1);
+    }
+    mem->size = 64;
+    mem->count = 0;
+    mem->state_len = state_len;
+    mem->pairs = malloc( mem->size*2*state_len*sizeof(vartype) );
+    mem->used = calloc( mem->size, sizeof(bool) );
+    if ((state_len > 0 && mem->pairs == NULL) || mem->used == NULL) {
+        perror( "sim_mem_new, malloc" );
+        exit(-1);
+    }
+    return mem;
+}
 
+void sim_mem_free( sim_mem_t *mem )
+{
+    if (mem == NULL)
+        return;
+    free( mem->pairs );
+    free( mem->used );
+    free( mem );
+}
 
-extern specification_t spc;
+void sim_mem_clear( sim_mem_t *mem )
+{
+    memset( mem->used, 0, mem->size*sizeof(bool) );
+    mem->count = 0;
+}
 
+unsigned long sim_mem_hash( sim_mem_t *mem, vartype *state,
+                            vartype *next_state )
+{
+    unsigned long h = PTREE_HASH_INIT;
+    int i;
+    for (i = 0; i < mem->state_len; i++)
+        h = PTREE_HASH_STEP( h, (unsigned long)*(state+i) );
+    for (i = 0; i < mem->state_len; i++)
+        h = PTREE_HASH_STEP( h, (unsigned long)*(next_state+i) );
+    return h;
+}
 
-anode_t *sim_rhc( DdManager *manager, DdNode *W,
-                  DdNode *etrans, DdNode *strans, DdNode **sgoals,
-                  char *metric_vars, int horizon, vartype *init_state,
-                  int num_it, unsigned char verbose )
+/* Return the slot of the pair, or of the empty slot where it would be
+   inserted. */
+int sim_mem_slot( sim_mem_t *mem, vartype *state, vartype *next_state )
 {
-    int *offw, num_metric_vars;
-    anode_t *play;
-    int num_env, num_sys;
-    vartype *candidate_state, *next_state;
-    int current_goal = 0;
-    int current_it = 0, i, j;
-    vartype **env_moves;
-    int emoves_len, emove_index;
-    DdNode *strans_into_W;
-    double Max, Min, next_min;
+    vartype *pair;
+    int k;
+
+    k = sim_mem_hash( mem, state, next_state ) & (mem->size-1);
+    while (*(mem->used+k)) {
+        pair = mem->pairs + k*2*mem->state_len;
+        if (statecmp( pair, state, mem->state_len )
+            && statecmp( pair+mem->state_len, next_state, mem->state_len ))
+            break;
+        k = (k+1) & (mem->size-1);
+    }
+    return k;
+}
 
-    /* Number of stacks is equal to the horizon. */
-    anode_t *node, *prev_node, **hstacks = NULL;
-    int hdepth;
-    vartype *fnext_state, *finit_state;
+bool sim_mem_find( sim_mem_t *mem, vartype *state, vartype *next_state )
+{
+    return *(mem->used + sim_mem_slot( mem, state, next_state ));
+}
 
-    anode_t **MEM = NULL;
-    int MEM_len = 0, MEM_index;
+void sim_mem_add( sim_mem_t *mem, vartype *state, vartype *next_state )
+{
+    vartype *old_pairs, *pair;
+    bool *old_used;
+    int old_size;
+    int i, k;
+
+    if (2*(mem->count+1) > mem->size) {  /* Keep load at most 1/2 */
+        old_pairs = mem->pairs;
+        old_used = mem->used;
+        old_size = mem->size;
+        mem->size *= 2;
+        mem->pairs = malloc( mem->size*2*mem->state_len*sizeof(vartype) );
+        mem->used = calloc( mem->size, sizeof(bool) );
+        if ((mem->state_len > 0 && mem->pairs == NULL) || mem->used == NULL) {
+            perror( "sim_mem_add, malloc" );
+            exit(-1);
+        }
+        for (i = 0; i < old_size; i++) {
+            if (!*(old_used+i))
+                continue;
+            pair = old_pairs + i*2*mem->state_len;
+            k = sim_mem_slot( mem, pair, pair+mem->state_len );
+            *(mem->used+k) = True;
+            memcpy( mem->pairs + k*2*mem->state_len, pair,
+                    2*mem->state_len*sizeof(vartype) );
+        }
+        free( old_pairs );
+        free( old_used );
+    }
 
-    int *cube;  /* length will be twice total number of variables (to
-                   account for both variables and their primes). */
-    DdNode *tmp, *tmp2, *ddval;
+    k = sim_mem_slot( mem, state, next_state );
+    if (*(mem->used+k))
+        return;
+    *(mem->used+k) = True;
+    memcpy( mem->pairs + k*2*mem->state_len, state,
+            mem->state_len*sizeof(vartype) );
+    memcpy( mem->pairs + k*2*mem->state_len + mem->state_len, next_state,
+            mem->state_len*sizeof(vartype) );
+    mem->count++;
+}
 
-    /* Variables used during CUDD generation (state enumeration). */
-    DdGen *gen;
-    CUDD_VALUE_TYPE gvalue;
-    int *gcube;
-    DdNode **vars, **pvars;
 
-    if (init_state == NULL || horizon < 1)
-        return NULL;
+unsigned long sim_rand( unsigned long *s )
+{
+    unsigned long z;
+    *s += 0x9E3779B97F4A7C15UL;
+    z = *s;
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9UL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBUL;
+    return z ^ (z >> 31);
+}
 
-    offw = get_offsets( metric_vars, &num_metric_vars );
-    if (offw == NULL)
-        return NULL;
 
-    srand( time(NULL) );
-    num_env = tree_size( spc.evar_list );
-    num_sys = tree_size( spc.svar_list );
+/* Set the variable map of manager as by compute_winning_set_BDD(), and
+   return the referenced conjunction of strans with the primed copy of
+   W, or NULL on error. */
+DdNode *sim_strans_into_W( DdManager *manager, DdNode *W, DdNode *strans,
+                           int num_env, int num_sys )
+{
+    DdNode **vars, **pvars;
+    DdNode *tmp, *strans_into_W;
+    int i;
 
     vars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
     pvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    if (vars == NULL || pvars == NULL) {
+        perror( "sim_strans_into_W, malloc" );
+        exit(-1);
+    }
     for (i = 0; i < num_env+num_sys; i++) {
         *(vars+i) = Cudd_bddIthVar( manager, i );
         *(pvars+i) = Cudd_bddIthVar( manager, i+num_env+num_sys );
@@ -74,35 +236,13 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     if (!Cudd_SetVarMap( manager, vars, pvars, num_env+num_sys )) {
         fprintf( stderr,
                  "Error: failed to define variable map in CUDD manager.\n" );
+        free( vars );
+        free( pvars );
         return NULL;
     }
     free( vars );
     free( pvars );
 
-    hstacks = malloc( horizon*sizeof(anode_t *) );
-    if (hstacks == NULL) {
-        perror( "sim_rhc, malloc" );
-        exit(-1);
-    }
-    for (i = 0; i < horizon; i++)
-        *(hstacks+i) = NULL;
-
-    next_state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    candidate_state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    finit_state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    fnext_state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    if (next_state == NULL || candidate_state == NULL || finit_state == NULL
-        || fnext_state == NULL) {
-        perror( "sim_rhc, malloc" );
-        exit(-1);
-    }
-
-    cube = malloc( 2*(num_env+num_sys)*sizeof(int) );
-    if (cube == NULL) {
-        perror( "sim_rhc, malloc" );
-        exit(-1);
-    }
-
     tmp = Cudd_bddVarMap( manager, W );
     if (tmp == NULL) {
         fprintf( stderr,
@@ -114,287 +254,372 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     strans_into_W = Cudd_bddAnd( manager, strans, tmp );
     Cudd_Ref( strans_into_W );
     Cudd_RecursiveDeref( manager, tmp );
+    return strans_into_W;
+}
 
-    play = insert_anode( NULL, current_it, -1, False,
-                         init_state, num_env+num_sys );
-    while (current_it < num_it) {
-        if (verbose)
-            logprint( "Beginning simulation iteration %d...", current_it );
-        current_it++;
 
-        /* Check if time to switch attention to next goal. */
-        state_to_cube( init_state, cube, num_env+num_sys );
-        ddval = Cudd_Eval( manager, *(sgoals+current_goal), cube );
-        if (!Cudd_IsComplement( ddval )) {
-            current_goal = (current_goal+1) % spc.num_sgoals;
-            free( MEM );
-            MEM = NULL;
-            MEM_len = 0;
-        }
+void sim_rhc_init( sim_rhc_t *sim, DdManager *manager, DdNode *W,
+                   DdNode *etrans, DdNode *strans_into_W, DdNode **sgoals,
+                   int *offw, int num_metric_vars, int horizon,
+                   int num_env, int num_sys )
+{
+    DdNode *tmp;
+    int i;
+
+    sim->manager = manager;
+    sim->W = W;
+    sim->etrans = etrans;
+    sim->strans_into_W = strans_into_W;
+    sim->sgoals = sgoals;
+    sim->num_sgoals = spc.num_sgoals;
+    sim->horizon = horizon;
+    sim->num_env = num_env;
+    sim->num_sys = num_sys;
+
+    sim->trans = Cudd_bddAnd( manager, etrans, strans_into_W );
+    Cudd_Ref( sim->trans );
+
+    /* The distance to the goal is needed for each candidate state, so
+       build it once for each goal and only evaluate it afterward. */
+    sim->goal_dist = malloc( (sim->num_sgoals+1)*sizeof(DdNode *) );
+    if (sim->goal_dist == NULL) {
+        perror( "sim_rhc_init, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < sim->num_sgoals; i++) {
+        tmp = Cudd_bddAnd( manager, *(sgoals+i), W );
+        Cudd_Ref( tmp );
+        *(sim->goal_dist+i) = dist_to_set_ADD( manager, tmp,
+                                               offw, num_metric_vars );
+        Cudd_RecursiveDeref( manager, tmp );
+    }
 
-        for (MEM_index = 0; MEM_index < MEM_len; MEM_index++) {
-            if (statecmp( (*(MEM+MEM_index))->state, init_state,
-                          num_env+num_sys ))
-                break;
-        }
-        if (MEM_index >= MEM_len) {
-            MEM_len++;
-            MEM_index = MEM_len-1;
-            MEM = realloc( MEM, MEM_len*sizeof(anode_t *) );
-            *(MEM+MEM_index) = insert_anode( NULL, 0, -1, False,
-                                             init_state, num_env+num_sys );
+    sim->hstacks = malloc( horizon*sizeof(anode_t *) );
+    sim->candidate_state = malloc( (num_env+num_sys)*sizeof(vartype) );
+    sim->finit_state = malloc( (num_env+num_sys)*sizeof(vartype) );
+    sim->fnext_state = malloc( (num_env+num_sys)*sizeof(vartype) );
+    sim->cube = malloc( 2*(num_env+num_sys)*sizeof(int) );
+    if (sim->hstacks == NULL || sim->candidate_state == NULL
+        || sim->finit_state == NULL || sim->fnext_state == NULL
+        || sim->cube == NULL) {
+        perror( "sim_rhc_init, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < horizon; i++)
+        *(sim->hstacks+i) = NULL;
+}
+
+void sim_rhc_clear( sim_rhc_t *sim )
+{
+    int i;
+    for (i = 0; i < sim->horizon; i++) {
+        delete_aut( *(sim->hstacks+i) );
+        *(sim->hstacks+i) = NULL;
+    }
+}
+
+void sim_rhc_free( sim_rhc_t *sim )
+{
+    int i;
+    sim_rhc_clear( sim );
+    Cudd_RecursiveDeref( sim->manager, sim->trans );
+    for (i = 0; i < sim->num_sgoals; i++)
+        Cudd_RecursiveDeref( sim->manager, *(sim->goal_dist+i) );
+    free( sim->goal_dist );
+    free( sim->hstacks );
+    free( sim->candidate_state );
+    free( sim->finit_state );
+    free( sim->fnext_state );
+    free( sim->cube );
+}
+
+
+bool sim_in_goal( sim_rhc_t *sim, int goal, vartype *state )
+{
+    DdNode *ddval;
+    state_to_cube( state, sim->cube, sim->num_env+sim->num_sys );
+    ddval = Cudd_Eval( sim->manager, *(sim->sgoals+goal), sim->cube );
+    return !Cudd_IsComplement( ddval );
+}
+
+
+/* Consider candidate as a state found at the given depth of the
+   horizon from state, and if it is new and nearer the goal than the
+   best so far (*next_min), then copy it into next_state. */
+void sim_consider( sim_rhc_t *sim, sim_mem_t *mem, int goal,
+                   vartype *state, vartype *candidate, int depth,
+                   double *next_min, vartype *next_state )
+{
+    DdNode *ddval;
+    double Min;
+    int j;
+
+    for (j = 0; j <= depth; j++) {
+        if (find_anode( *(sim->hstacks+j), 0,
+                        candidate, sim->num_env+sim->num_sys ) != NULL)
+            return;
+    }
+
+    /* First time to find this state */
+    *(sim->hstacks+depth) = insert_anode( *(sim->hstacks+depth), 0, -1,
+                                          False, candidate,
+                                          sim->num_env+sim->num_sys );
+    if (sim_mem_find( mem, state, candidate ))
+        return;
+
+    state_to_cube( candidate, sim->cube, sim->num_env+sim->num_sys );
+    ddval = Cudd_Eval( sim->manager, *(sim->goal_dist+goal), sim->cube );
+    Min = Cudd_V( ddval );
+    if (ddval == Cudd_ReadPlusInfinity( sim->manager ))
+        Min = -1.;  /* Empty goal set, as from bounds_state() */
+    if (*next_min == -1. || Min < *next_min) {
+        *next_min = Min;
+        for (j = 0; j < sim->num_env+sim->num_sys; j++)
+            *(next_state+j) = *(candidate+j);
+    }
+}
+
+/* Consider all states in tmp2, which is a set of moves of the system
+   for the environment move emove (e.g., as obtained from
+   state_to_cof()). */
+void sim_consider_moves( sim_rhc_t *sim, sim_mem_t *mem, int goal,
+                         vartype *state, vartype *emove, DdNode *tmp2,
+                         vartype *candidate, int depth,
+                         double *next_min, vartype *next_state )
+{
+    int num_env = sim->num_env, num_sys = sim->num_sys;
+    int i;
+
+    /* Variables used during CUDD generation (state enumeration). */
+    DdGen *gen;
+    CUDD_VALUE_TYPE gvalue;
+    int *gcube;
+
+    Cudd_AutodynDisable( sim->manager );
+    Cudd_ForeachCube( sim->manager, tmp2, gen, gcube, gvalue ) {
+        for (i = 0; i < num_env; i++)
+            *(candidate+i) = *(emove+i);
+        initialize_cube( candidate+num_env,
+                         gcube+num_sys+2*num_env, num_sys );
+        while (!saturated_cube( candidate+num_env,
+                                gcube+num_sys+2*num_env, num_sys )) {
+            sim_consider( sim, mem, goal, state, candidate, depth,
+                          next_min, next_state );
+            increment_cube( candidate+num_env,
+                            gcube+num_sys+2*num_env, num_sys );
         }
+        sim_consider( sim, mem, goal, state, candidate, depth,
+                      next_min, next_state );
+    }
+    Cudd_AutodynEnable( sim->manager, CUDD_REORDER_SAME );
+}
+
+
+int sim_rhc_step( sim_rhc_t *sim, sim_mem_t *mem, int *current_goal,
+                  vartype *state, vartype *next_state,
+                  unsigned long *rng, unsigned char verbose )
+{
+    DdManager *manager = sim->manager;
+    int num_env = sim->num_env, num_sys = sim->num_sys;
+    int horizon = sim->horizon;
+    int *cube = sim->cube;
+    vartype **env_moves;
+    int emoves_len, emove_index;
+    anode_t *node, *prev_node;
+    int hdepth;
+    double next_min;
+    DdNode *tmp, *tmp2, *ddval;
+    int i, j;
+
+    /* Check if time to switch attention to next goal. */
+    if (sim_in_goal( sim, *current_goal, state )) {
+        *current_goal = (*current_goal+1) % sim->num_sgoals;
+        sim_mem_clear( mem );
+    }
 
-        env_moves = get_env_moves( manager, cube,
-                                   init_state, etrans,
-                                   num_env, num_sys,
-                                   &emoves_len );
+    env_moves = get_env_moves( manager, cube, state, sim->etrans,
+                               num_env, num_sys, &emoves_len );
+    if (env_moves == NULL || emoves_len == 0) {
+        fprintf( stderr,
+                 "Error sim_rhc: no environment moves from current"
+                 " state.\n" );
+        free( env_moves );
+        return -1;
+    }
+    if (rng == NULL) {
         emove_index = rand() % emoves_len;
+    } else {
+        emove_index = sim_rand( rng ) % emoves_len;
+    }
 
-        tmp = state_to_cof( manager, cube, 2*(num_env+num_sys), init_state,
-                         strans_into_W, 0, num_env+num_sys );
-        tmp2 = state_to_cof( manager, cube, 2*(num_env+num_sys),
-                          *(env_moves+emove_index), tmp,
-                          num_env+num_sys, num_env );
-        Cudd_RecursiveDeref( manager, tmp );
+    tmp = state_to_cof( manager, cube, 2*(num_env+num_sys), state,
+                        sim->strans_into_W, 0, num_env+num_sys );
+    tmp2 = state_to_cof( manager, cube, 2*(num_env+num_sys),
+                         *(env_moves+emove_index), tmp,
+                         num_env+num_sys, num_env );
+    Cudd_RecursiveDeref( manager, tmp );
 
-        tmp = Cudd_bddAnd( manager, *(sgoals+current_goal), W );
-        Cudd_Ref( tmp );
+    next_min = -1.;
+    sim_consider_moves( sim, mem, *current_goal, state,
+                        *(env_moves+emove_index), tmp2,
+                        sim->candidate_state, 0, &next_min, next_state );
+    Cudd_RecursiveDeref( manager, tmp2 );
 
-        next_min = -1.;
-        Cudd_AutodynDisable( manager );
-        Cudd_ForeachCube( manager, tmp2, gen, gcube, gvalue ) {
-            for (i = 0; i < num_env; i++)
-                *(candidate_state+i) = *(*(env_moves+emove_index)+i);
-            initialize_cube( candidate_state+num_env,
-                             gcube+num_sys+2*num_env, num_sys );
-            while (!saturated_cube( candidate_state+num_env,
-                                    gcube+num_sys+2*num_env, num_sys )) {
-                if (find_anode( *hstacks, 0,
-                                candidate_state, num_env+num_sys ) == NULL) {
-                    *hstacks = insert_anode( *hstacks, 0, -1, False,
-                                             candidate_state, num_env+num_sys );
-
-                    node = (*(MEM+MEM_index))->next;
-                    while (node) {
-                        if (statecmp( node->state, candidate_state,
-                                      num_env+num_sys ))
-                            break;
-                        node = node->next;
-                    }
-                    if (node == NULL) {
-                        bounds_state( manager, tmp, candidate_state,
-                                      offw, num_metric_vars, &Min, &Max, 0 );
-                        if (next_min == -1. || Min < next_min) {
-                            next_min = Min;
-                            for (i = 0; i < num_env+num_sys; i++)
-                                *(next_state+i) = *(candidate_state+i);
-                        }
-                    }
-                }
+    if (verbose)
+        logprint( "\t%d possible states at horizon 1.",
+                  aut_size( *(sim->hstacks) ) );
 
-                increment_cube( candidate_state+num_env,
-                                gcube+num_sys+2*num_env, num_sys );
-            }
-            if (find_anode( *hstacks, 0,
-                            candidate_state, num_env+num_sys ) == NULL) {
-                *hstacks = insert_anode( *hstacks, 0, -1, False,
-                                         candidate_state, num_env+num_sys );
-
-                node = (*(MEM+MEM_index))->next;
-                while (node) {
-                    if (statecmp( node->state, candidate_state,
-                                  num_env+num_sys ))
-                        break;
-                    node = node->next;
-                }
-                if (node == NULL) {
-                    bounds_state( manager, tmp, candidate_state,
-                                  offw, num_metric_vars, &Min, &Max, 0 );
-                    if (next_min == -1. || Min < next_min) {
-                        next_min = Min;
-                        for (i = 0; i < num_env+num_sys; i++)
-                            *(next_state+i) = *(candidate_state+i);
-                    }
-                }
+    for (i = 0; i < emoves_len; i++)
+        free( *(env_moves+i) );
+    free( env_moves );
+
+    for (hdepth = 1; hdepth < horizon; hdepth++) {
+
+        node = *(sim->hstacks+hdepth-1);
+        while (node) {
+            for (i = 0; i < num_env+num_sys; i++)
+                *(sim->finit_state+i) = *(node->state+i);
+
+            env_moves = get_env_moves( manager, cube,
+                                       sim->finit_state, sim->etrans,
+                                       num_env, num_sys,
+                                       &emoves_len );
+            for (emove_index = 0; emove_index < emoves_len; emove_index++) {
+
+                tmp = state_to_cof( manager, cube, 2*(num_env+num_sys),
+                                    sim->finit_state, sim->strans_into_W,
+                                    0, num_env+num_sys );
+                tmp2 = state_to_cof( manager, cube, 2*(num_env+num_sys),
+                                     *(env_moves+emove_index), tmp,
+                                     num_env+num_sys, num_env );
+                Cudd_RecursiveDeref( manager, tmp );
+
+                sim_consider_moves( sim, mem, *current_goal, state,
+                                    *(env_moves+emove_index), tmp2,
+                                    sim->fnext_state, hdepth,
+                                    &next_min, next_state );
+                Cudd_RecursiveDeref( manager, tmp2 );
             }
+
+            for (i = 0; i < emoves_len; i++)
+                free( *(env_moves+i) );
+            free( env_moves );
+            node = node->next;
         }
-        Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
-        Cudd_RecursiveDeref( manager, tmp2 );
-        Cudd_RecursiveDeref( manager, tmp );
 
         if (verbose)
-            logprint( "\t%d possible states at horizon 1.",
-                      aut_size( *hstacks ) );
+            logprint( "\t%d possible states at horizon %d.",
+                      aut_size( *(sim->hstacks+hdepth) ), hdepth+1 );
+    }
 
-        for (i = 0; i < emoves_len; i++)
-            free( *(env_moves+i) );
-        free( env_moves );
+    if (next_min == -1.)
+        return 1;
 
-        for (hdepth = 1; hdepth < horizon; hdepth++) {
+    sim_mem_add( mem, state, next_state );
 
-            node = *(hstacks+hdepth-1);
-            while (node) {
+    if (horizon > 1 && find_anode( *(sim->hstacks), 0,
+                                   next_state, num_env+num_sys ) == NULL) {
+        /* Treat horizon of 1 as special case. */
+        for (j = 1; j < horizon; j++) {
+            if ((node = find_anode( *(sim->hstacks+j), 0,
+                                    next_state, num_env+num_sys )) != NULL)
+                break;
+        }
+        if (j >= horizon) {
+            fprintf( stderr, "ERROR: failed to backtrack in sim_rhc().\n" );
+            return -1;
+        }
+
+        while (j > 0) {
+            j--;
+            prev_node = *(sim->hstacks+j);
+            while (prev_node) {
                 for (i = 0; i < num_env+num_sys; i++)
-                    *(finit_state+i) = *(node->state+i);
-
-                env_moves = get_env_moves( manager, cube,
-                                           finit_state, etrans,
-                                           num_env, num_sys,
-                                           &emoves_len );
-                for (emove_index = 0; emove_index < emoves_len; emove_index++) {
-
-                    tmp = state_to_cof( manager, cube, 2*(num_env+num_sys),
-                                     finit_state, strans_into_W,
-                                     0, num_env+num_sys );
-                    tmp2 = state_to_cof( manager, cube, 2*(num_env+num_sys),
-                                      *(env_moves+emove_index), tmp,
-                                      num_env+num_sys, num_env );
-                    Cudd_RecursiveDeref( manager, tmp );
-
-                    tmp = Cudd_bddAnd( manager, *(sgoals+current_goal), W );
-                    Cudd_Ref( tmp );
-
-                    Cudd_AutodynDisable( manager );
-                    Cudd_ForeachCube( manager, tmp2, gen, gcube, gvalue ) {
-                        for (i = 0; i < num_env; i++)
-                            *(fnext_state+i) = *(*(env_moves+emove_index)+i);
-                        initialize_cube( fnext_state+num_env,
-                                         gcube+num_sys+2*num_env, num_sys );
-                        while (!saturated_cube( fnext_state+num_env,
-                                                gcube+num_sys+2*num_env,
-                                                num_sys )) {
-                            for (j = 0; j <= hdepth; j++) {
-                                if (find_anode( *(hstacks+j), 0,
-                                                fnext_state, num_env+num_sys )
-                                    != NULL)
-                                    break;
-                            }
-                            if (j > hdepth) {
-                                /* First time to find this state */
-                                *(hstacks+hdepth)
-                                    = insert_anode( *(hstacks+hdepth), 0, -1,
-                                                    False,
-                                                    fnext_state,
-                                                    num_env+num_sys );
-
-                                prev_node = (*(MEM+MEM_index))->next;
-                                while (prev_node) {
-                                    if (statecmp( prev_node->state, fnext_state,
-                                                  num_env+num_sys ))
-                                        break;
-                                    prev_node = prev_node->next;
-                                }
-                                if (prev_node == NULL) {
-                                    bounds_state( manager, tmp, fnext_state,
-                                                  offw, num_metric_vars,
-                                                  &Min, &Max, 0 );
-                                    if (next_min == -1. || Min < next_min) {
-                                        next_min = Min;
-                                        for (i = 0; i < num_env+num_sys; i++)
-                                            *(next_state+i) = *(fnext_state+i);
-                                    }
-                                }
-                            }
-
-                            increment_cube( fnext_state+num_env,
-                                            gcube+num_sys+2*num_env, num_sys );
-                        }
-                        for (j = 0; j <= hdepth; j++) {
-                            if (find_anode( *(hstacks+j), 0,
-                                            fnext_state, num_env+num_sys )
-                                != NULL)
-                                break;
-                        }
-                        if (j > hdepth) {
-                            *(hstacks+hdepth)
-                                = insert_anode( *(hstacks+hdepth), 0, -1, False,
-                                                fnext_state, num_env+num_sys );
-
-                            prev_node = (*(MEM+MEM_index))->next;
-                            while (prev_node) {
-                                if (statecmp( prev_node->state, fnext_state,
-                                              num_env+num_sys ))
-                                    break;
-                                prev_node = prev_node->next;
-                            }
-                            if (prev_node == NULL) {
-                                bounds_state( manager, tmp, fnext_state,
-                                              offw, num_metric_vars,
-                                              &Min, &Max, 0 );
-                                if (next_min == -1. || Min < next_min) {
-                                    next_min = Min;
-                                    for (i = 0; i < num_env+num_sys; i++)
-                                        *(next_state+i) = *(fnext_state+i);
-                                }
-                            }
-                        }
-                    }
-                    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
-                    Cudd_RecursiveDeref( manager, tmp2 );
-                    Cudd_RecursiveDeref( manager, tmp );
+                    *(cube+i) = *(prev_node->state+i);
+                for (i = 0; i < num_env+num_sys; i++)
+                    *(cube+num_env+num_sys+i) = *(node->state+i);
+                ddval = Cudd_Eval( manager, sim->trans, cube );
+                if (!Cudd_IsComplement( ddval )) {
+                    node = prev_node;
+                    break;
                 }
 
-                for (i = 0; i < emoves_len; i++)
-                    free( *(env_moves+i) );
-                free( env_moves );
-                node = node->next;
+                prev_node = prev_node->next;
+            }
+            if (prev_node == NULL) {
+                fprintf( stderr,
+                         "ERROR: failed to backtrack in sim_rhc().\n" );
+                return -1;
             }
-
-            if (verbose)
-                logprint( "\t%d possible states at horizon %d.",
-                          aut_size( *(hstacks+hdepth) ), hdepth+1 );
         }
+        for (i = 0; i < num_env+num_sys; i++)
+            *(next_state+i) = *(node->state+i);
+    }
 
-        node = *(MEM+MEM_index);
-        while (node->next)
-            node = node->next;
-        node->next = insert_anode( NULL, 0, -1, False,
-                                   next_state, num_env+num_sys );
-
-        if (horizon > 1 && find_anode( *hstacks, 0,
-                                       next_state, num_env+num_sys ) == NULL) {
-            /* Treat horizon of 1 as special case. */
-            for (j = 1; j < horizon; j++) {
-                if ((node = find_anode( *(hstacks+j), 0,
-                                        next_state, num_env+num_sys )) != NULL)
-                    break;
-            }
-            if (j >= horizon) {
-                fprintf( stderr, "ERROR: failed to backtrack in sim_rhc().\n" );
-                return NULL;
-            }
+    return 0;
+}
 
-            tmp = Cudd_bddAnd( manager, etrans, strans );
-            Cudd_Ref( tmp );
-
-            while (j > 0) {
-                j--;
-                prev_node = *(hstacks+j);
-                while (prev_node) {
-                    for (i = 0; i < num_env+num_sys; i++)
-                        *(cube+i) = *(prev_node->state+i);
-                    for (i = 0; i < num_env+num_sys; i++)
-                        *(cube+num_env+num_sys+i) = *(node->state+i);
-                    ddval = Cudd_Eval( manager, tmp, cube );
-                    if (!Cudd_IsComplement( ddval )) {
-                        node = prev_node;
-                        break;
-                    }
-
-                    prev_node = prev_node->next;
-                }
-                if (prev_node == NULL) {
-                    fprintf( stderr,
-                             "ERROR: failed to backtrack in sim_rhc().\n" );
-                    return NULL;
-                }
-            }
-            for (i = 0; i < num_env+num_sys; i++)
-                *(next_state+i) = *(node->state+i);
 
-            Cudd_RecursiveDeref( manager, tmp );
+anode_t *sim_rhc( DdManager *manager, DdNode *W,
+                  DdNode *etrans, DdNode *strans, DdNode **sgoals,
+                  char *metric_vars, int horizon, vartype *init_state,
+                  int num_it, unsigned char verbose )
+{
+    int *offw, num_metric_vars;
+    anode_t *play;
+    int num_env, num_sys;
+    vartype *next_state;
+    int current_goal = 0;
+    int current_it = 0, i;
+    DdNode *strans_into_W;
+    sim_rhc_t sim;
+    sim_mem_t *mem;
+
+    if (init_state == NULL || horizon < 1)
+        return NULL;
+
+    offw = get_offsets( metric_vars, &num_metric_vars );
+    if (offw == NULL)
+        return NULL;
+
+    srand( time(NULL) );
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+
+    strans_into_W = sim_strans_into_W( manager, W, strans, num_env, num_sys );
+    if (strans_into_W == NULL) {
+        free( offw );
+        return NULL;
+    }
+    sim_rhc_init( &sim, manager, W, etrans, strans_into_W, sgoals,
+                  offw, num_metric_vars, horizon, num_env, num_sys );
+    mem = sim_mem_new( num_env+num_sys );
+
+    next_state = malloc( (num_env+num_sys)*sizeof(vartype) );
+    if (next_state == NULL) {
+        perror( "sim_rhc, malloc" );
+        exit(-1);
+    }
+
+    play = insert_anode( NULL, current_it, -1, False,
+                         init_state, num_env+num_sys );
+    while (current_it < num_it) {
+        if (verbose)
+            logprint( "Beginning simulation iteration %d...", current_it );
+        current_it++;
+
+        if (sim_rhc_step( &sim, mem, &current_goal, init_state, next_state,
+                          NULL, verbose )) {
+            fprintf( stderr,
+                     "Error sim_rhc: failed to find next state at"
+                     " iteration %d.\n", current_it );
+            delete_aut( play );
+            play = NULL;
+            break;
         }
+        /* States within the horizon of one step are not relevant to
+           the next, which begins from a different state. */
+        sim_rhc_clear( &sim );
 
         play = insert_anode( play, current_it, -1, False,
                              next_state, num_env+num_sys );
@@ -405,13 +630,236 @@ anode_t *sim_rhc( DdManager *manager, DdNode *W,
     }
 
 
+    sim_rhc_free( &sim );
+    sim_mem_free( mem );
     Cudd_RecursiveDeref( manager, strans_into_W );
     free( next_state );
-    free( candidate_state );
-    free( finit_state );
-    free( fnext_state );
-    free( hstacks );
-    free( cube );
     free( offw );
     return play;
 }
+
+
+/* State of a thread of sim_rhc_batch() */
+typedef struct {
+    sim_rhc_t sim;
+    DdNode *W, *etrans, *strans_into_W, **sgoals;
+    vartype *init_state;
+    int num_it;
+    int num_plays;
+    int offset, stride;  /* This thread runs plays offset+k*stride. */
+    unsigned long seed;
+
+    /* Results */
+    long steps;
+    long *goal_visits;
+    int violations;  /* Plays that ended for lack of a move */
+    int failures;  /* Plays that ended because of an error */
+} sim_worker_t;
+
+void *sim_worker_body( void *arg )
+{
+    sim_worker_t *w = (sim_worker_t *)arg;
+    int num_vars = w->sim.num_env+w->sim.num_sys;
+    vartype *state, *next_state;
+    sim_mem_t *mem;
+    unsigned long rng;
+    int current_goal;
+    int p, it, i, result;
+
+    state = malloc( num_vars*sizeof(vartype) );
+    next_state = malloc( num_vars*sizeof(vartype) );
+    if (state == NULL || next_state == NULL) {
+        perror( "sim_worker_body, malloc" );
+        exit(-1);
+    }
+    mem = sim_mem_new( num_vars );
+
+    for (p = w->offset; p < w->num_plays; p += w->stride) {
+        /* Stream of play p, which does not depend on the thread */
+        rng = w->seed + p;
+        rng = sim_rand( &rng );
+
+        for (i = 0; i < num_vars; i++)
+            *(state+i) = *(w->init_state+i);
+        current_goal = 0;
+        sim_mem_clear( mem );
+        for (it = 0; it < w->num_it; it++) {
+            /* With one goal, current_goal is not changed by a visit,
+               so check here rather than after the step. */
+            if (sim_in_goal( &(w->sim), current_goal, state ))
+                (*(w->goal_visits+current_goal))++;
+            result = sim_rhc_step( &(w->sim), mem, &current_goal,
+                                   state, next_state, &rng, 0 );
+            sim_rhc_clear( &(w->sim) );
+            if (result > 0) {
+                w->violations++;
+                break;
+            } else if (result < 0) {
+                w->failures++;
+                break;
+            }
+            w->steps++;
+            for (i = 0; i < num_vars; i++)
+                *(state+i) = *(next_state+i);
+        }
+    }
+
+    sim_mem_free( mem );
+    free( state );
+    free( next_state );
+    return NULL;
+}
+
+
+int sim_rhc_batch( DdManager *manager, DdNode *W,
+                   DdNode *etrans, DdNode *strans, DdNode **sgoals,
+                   char *metric_vars, int horizon, vartype *init_state,
+                   int num_it, int num_plays, int num_threads,
+                   unsigned long seed, FILE *fp, unsigned char verbose )
+{
+    int *offw, num_metric_vars;
+    int num_env, num_sys;
+    DdNode *strans_into_W;
+    DdManager *wmanager;
+    sim_worker_t *workers;
+    int num_workers;
+    pthread_t *threads;
+    struct timespec start, now;
+    double seconds;
+    long steps, goal_visits;
+    int violations, failures;
+    int i, j;
+
+    if (init_state == NULL || horizon < 1 || num_plays < 1
+        || spc.num_sgoals < 1)
+        return -1;
+
+    offw = get_offsets( metric_vars, &num_metric_vars );
+    if (offw == NULL)
+        return -1;
+
+    num_env = tree_size( spc.evar_list );
+    num_sys = tree_size( spc.svar_list );
+
+    strans_into_W = sim_strans_into_W( manager, W, strans, num_env, num_sys );
+    if (strans_into_W == NULL) {
+        free( offw );
+        return -1;
+    }
+
+    num_workers = (num_plays < num_threads) ? num_plays : num_threads;
+    if (num_workers < 1)
+        num_workers = 1;
+    if (verbose)
+        logprint( "Running %d plays using %d threads...",
+                  num_plays, num_workers );
+    workers = malloc( num_workers*sizeof(sim_worker_t) );
+    threads = malloc( num_workers*sizeof(pthread_t) );
+    if (workers == NULL || threads == NULL) {
+        perror( "sim_rhc_batch, malloc" );
+        exit(-1);
+    }
+
+    /* Each thread has its own manager with copies of the BDDs, which
+       are made (and the distance ADDs built) before any thread starts,
+       since the manager of the caller is used for each copy. */
+    for (i = 0; i < num_workers; i++) {
+        wmanager = par_manager_new( manager, num_env, num_sys );
+        if (wmanager == NULL) {
+            fprintf( stderr,
+                     "Error sim_rhc_batch: failed to create CUDD manager"
+                     " for thread %d.\n", i );
+            exit(-1);
+        }
+        (workers+i)->W = par_transfer( manager, wmanager, W );
+        (workers+i)->etrans = par_transfer( manager, wmanager, etrans );
+        (workers+i)->strans_into_W = par_transfer( manager, wmanager,
+                                                   strans_into_W );
+        (workers+i)->sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
+        (workers+i)->goal_visits = calloc( spc.num_sgoals, sizeof(long) );
+        if ((workers+i)->sgoals == NULL || (workers+i)->goal_visits == NULL) {
+            perror( "sim_rhc_batch, malloc" );
+            exit(-1);
+        }
+        for (j = 0; j < spc.num_sgoals; j++)
+            *((workers+i)->sgoals+j) = par_transfer( manager, wmanager,
+                                                     *(sgoals+j) );
+        sim_rhc_init( &((workers+i)->sim), wmanager, (workers+i)->W,
+                      (workers+i)->etrans, (workers+i)->strans_into_W,
+                      (workers+i)->sgoals, offw, num_metric_vars,
+                      horizon, num_env, num_sys );
+        (workers+i)->init_state = init_state;
+        (workers+i)->num_it = num_it;
+        (workers+i)->num_plays = num_plays;
+        (workers+i)->offset = i;
+        (workers+i)->stride = num_workers;
+        (workers+i)->seed = seed;
+        (workers+i)->steps = 0;
+        (workers+i)->violations = (workers+i)->failures = 0;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for (i = 0; i < num_workers; i++) {
+        if (pthread_create( threads+i, NULL, sim_worker_body, workers+i )) {
+            fprintf( stderr,
+                     "Error sim_rhc_batch: failed to create thread.\n" );
+            exit(-1);
+        }
+    }
+    for (i = 0; i < num_workers; i++)
+        pthread_join( *(threads+i), NULL );
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    seconds = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec)*1e-9;
+
+    steps = 0;
+    violations = failures = 0;
+    for (i = 0; i < num_workers; i++) {
+        steps += (workers+i)->steps;
+        violations += (workers+i)->violations;
+        failures += (workers+i)->failures;
+    }
+
+    fprintf( fp, "{\"plays\": %d, \"threads\": %d, \"seed\": %lu,\n",
+             num_plays, num_workers, seed );
+    fprintf( fp, " \"horizon\": %d, \"max_steps\": %d,\n", horizon, num_it );
+    fprintf( fp, " \"steps\": %ld, \"seconds\": %f,"
+             " \"steps_per_second\": %f,\n",
+             steps, seconds, (seconds > 0.) ? steps/seconds : 0. );
+    fprintf( fp, " \"completed_plays\": %d, \"horizon_violations\": %d,"
+             " \"failed_plays\": %d,\n",
+             num_plays-violations-failures, violations, failures );
+    fprintf( fp, " \"goal_visits\": [" );
+    for (j = 0; j < spc.num_sgoals; j++) {
+        goal_visits = 0;
+        for (i = 0; i < num_workers; i++)
+            goal_visits += *((workers+i)->goal_visits+j);
+        fprintf( fp, "%s%ld", (j > 0) ? ", " : "", goal_visits );
+    }
+    fprintf( fp, "],\n \"goal_visit_rate\": [" );
+    for (j = 0; j < spc.num_sgoals; j++) {
+        goal_visits = 0;
+        for (i = 0; i < num_workers; i++)
+            goal_visits += *((workers+i)->goal_visits+j);
+        fprintf( fp, "%s%f", (j > 0) ? ", " : "",
+                 (steps > 0) ? (double)goal_visits/steps : 0. );
+    }
+    fprintf( fp, "]}\n" );
+
+    for (i = 0; i < num_workers; i++) {
+        wmanager = (workers+i)->sim.manager;
+        sim_rhc_free( &((workers+i)->sim) );
+        Cudd_RecursiveDeref( wmanager, (workers+i)->W );
+        Cudd_RecursiveDeref( wmanager, (workers+i)->etrans );
+        Cudd_RecursiveDeref( wmanager, (workers+i)->strans_into_W );
+        for (j = 0; j < spc.num_sgoals; j++)
+            Cudd_RecursiveDeref( wmanager, *((workers+i)->sgoals+j) );
+        free( (workers+i)->sgoals );
+        free( (workers+i)->goal_visits );
+        Cudd_Quit( wmanager );
+    }
+    free( workers );
+    free( threads );
+    Cudd_RecursiveDeref( manager, strans_into_W );
+    free( offw );
+    return 0;
+}
@@ -9,6 +9,8 @@
 #ifndef SIM_H
 #define SIM_H
 
+#include <stdio.h>
+
 #include "common.h"
 #include "automaton.h"
 
@@ -19,11 +21,28 @@
    Some core functions for working with strategy automata have changed
    recently, and sim_rhc() has not yet been carefully checked
    following those changes.  As such, sim_rhc() should be considered
-   as possibly temporarily defunct. */
+   as possibly temporarily defunct.
+
+   Return the play, or NULL on error, including when no state within
+   the horizon is nearer the current goal. */
 anode_t *sim_rhc( DdManager *manager, DdNode *W,
                   DdNode *etrans, DdNode *strans, DdNode **sgoals,
                   char *metric_vars, int horizon, vartype *init_state,
                   int num_it, unsigned char verbose );
 
+/** Run num_plays independent plays of at most num_it steps each, as
+   by sim_rhc() from init_state, using up to num_threads threads, and
+   write aggregate statistics to fp as a JSON object.  Each thread has
+   its own CUDD manager with copies of the given BDDs.  Each play has
+   its own stream of pseudorandom numbers, determined by seed and the
+   index of the play, so results do not depend on num_threads.  A play
+   ends early (a "horizon violation") if no state within the horizon
+   is nearer the current goal.  Return 0 on success, -1 on error. */
+int sim_rhc_batch( DdManager *manager, DdNode *W,
+                   DdNode *etrans, DdNode *strans, DdNode **sgoals,
+                   char *metric_vars, int horizon, vartype *init_state,
+                   int num_it, int num_plays, int num_threads,
+                   unsigned long seed, FILE *fp, unsigned char verbose );
+
 
 #endif
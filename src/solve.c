@@ -15,33 +15,389 @@
 #include "solve.h"
 #include "solve_support.h"
 #include "automaton.h"
-
-
-extern specification_t spc;
+#include "resultcache.h"
+#include "context.h"
 
 
 DdNode *check_realizable_internal( DdManager *manager, DdNode *W,
                                    unsigned char init_flags,
                                    unsigned char verbose );
 
+/* Index of the nodes of a strategy while it is constructed by
+   synthesize(), by goal mode and values of environment variables.  Each
+   bucket is a chain of entries in the reverse order of insertion, which
+   is the order of the strategy because insert_anode() adds at the
+   front.  Removed nodes are left in their chains as NULL. */
+typedef struct {
+    anode_t **nodes;  /* Node of each entry, or NULL if removed */
+    int *chain;  /* Next entry in the same bucket, or -1 */
+    int len;  /* Number of entries */
+    int size;  /* Allocated length of nodes and chain */
+    int *table;  /* First entry of each bucket, or -1 */
+    unsigned long mask;  /* Number of buckets, minus 1 */
+    int num_env;
+} nodeidx_t;
+
+/* Defined in automaton.c */
+unsigned long aut_sighash( int block, int *seq, int seq_len );
+
+void nodeidx_init( nodeidx_t *ni, int num_env );
+void nodeidx_free( nodeidx_t *ni );
+void nodeidx_add( nodeidx_t *ni, anode_t *node );
+void nodeidx_remove( nodeidx_t *ni, anode_t *node );
+
+/* Return the first entry from e onward in its chain that has the given
+   mode and environment part of state, or -1 if there is none. */
+int nodeidx_seek( nodeidx_t *ni, int e, int mode, vartype *env_move );
+
+/* Search the strategy for a node that is an admissible successor.
+
+   trans is the set of admissible next states, as a BDD over primed
+   variables that is obtained by cofactoring with respect to the
+   current state and the environment move env_move.  A candidate node
+   must agree with env_move, satisfy trans, and have the goal mode that
+   synthesize() would assign to it, i.e., (mode+1) mod num_sgoals if
+   its state is in goal_set, and mode otherwise.  Candidates are found
+   in ni, the index of the strategy.  ecube is a work array of length
+   2*(num_env+num_sys).
+
+   Return pointer to the first such node in the strategy, or NULL if
+   none is found. */
+anode_t *find_reusable_successor( DdManager *manager, nodeidx_t *ni,
+                                  DdNode *trans, DdNode *goal_set,
+                                  vartype *env_move, int mode, int num_sgoals,
+                                  int num_env, int num_sys, int *ecube );
+
+/* X sets for the most recently used sublevels, which are recomputed on
+   demand when synthesize() is invoked with SYNTH_LEAN_SUBLEVELS.  Slots
+   are replaced in the order that they were filled. */
+#define XCACHE_LEN 4
+typedef struct {
+    int goal[XCACHE_LEN];  /* System goal of each slot, or -1 if empty */
+    int level[XCACHE_LEN];  /* Sublevel of each slot */
+    DdNode **X[XCACHE_LEN];  /* One set per environment goal in each slot */
+    int next;  /* Index of slot to be replaced next */
+    int hits, misses;
+} xcache_t;
+
+/* Return the X sets for system goal i and sublevel j, as indexed in
+   synthesize() after the sublevel sets are shifted.  The sets are
+   taken from xc or, if not present, computed and stored in xc.  Y_prev
+   is the sublevel set that precedes j as obtained from
+   compute_sublevel_sets(), or NULL if j = 0.  The returned array
+   belongs to xc and is valid until the next call.  Return NULL on
+   error. */
+DdNode **get_X_sets( DdManager *manager, xcache_t *xc, int i, int j,
+                     DdNode *W, DdNode *etrans, DdNode *strans,
+                     DdNode **egoals, int num_egoals, DdNode *sgoal,
+                     DdNode *Y_prev, int num_env, int num_sys, int *cube );
+
+/* Replace *f by Cudd_bddRestrict( manager, *f, care ) if the latter is
+   smaller, releasing the reference to the original.  Return the size
+   of the BDD that is kept. */
+int restrict_if_smaller( DdManager *manager, DdNode **f, DdNode *care );
+
+/* The sublevel sets are exactly as resulting from the vanilla fixed
+   point formula.  Thus for each system goal i, Y_0 = \emptyset, and Y_1
+   is a union of i-goal states and environment-blocking states.
+
+   For the purpose of synthesis, it is enough to delete Y_0 and replace
+   Y_1 with the intersection of i-goal states and the winning set W,
+   and then shift the indices down (so that Y_1 is now called Y_0, Y_2
+   is now called Y_1, etc.).  This function does so in place for Y,
+   X_ijr, and num_sublevels as obtained from compute_sublevel_sets().
+   If X_ijr is NULL, then the original Y_1 of each goal is moved to
+   the array Y_1 (which is needed to recompute X sets of the shifted
+   sublevel 1; cf. get_X_sets()).  Also used by levelset_serve(). */
+void shift_sublevel_sets( DdManager *manager, DdNode *W, DdNode **sgoals,
+                          int num_sgoals, int num_egoals,
+                          DdNode ***Y, DdNode ****X_ijr, int *num_sublevels,
+                          DdNode **Y_1 );
+
 
 void logprint_state( vartype *state ) {
+    int i = 0;
+    ptree_t *var;
+    for (var = spc.evar_list; var != NULL; var = var->left)
+        logprint( "\t%s = %d;", var->name, *(state+(i++)) );
+    for (var = spc.svar_list; var != NULL; var = var->left)
+        logprint( "\t%s = %d;", var->name, *(state+(i++)) );
+}
+
+
+void nodeidx_init( nodeidx_t *ni, int num_env )
+{
+    unsigned long h;
+
+    ni->num_env = num_env;
+    ni->len = 0;
+    ni->size = 64;
+    ni->mask = 63;
+    ni->nodes = malloc( ni->size*sizeof(anode_t *) );
+    ni->chain = malloc( ni->size*sizeof(int) );
+    ni->table = malloc( (ni->mask+1)*sizeof(int) );
+    if (ni->nodes == NULL || ni->chain == NULL || ni->table == NULL) {
+        perror( "nodeidx_init, malloc" );
+        exit(-1);
+    }
+    for (h = 0; h <= ni->mask; h++)
+        *(ni->table+h) = -1;
+}
+
+
+void nodeidx_free( nodeidx_t *ni )
+{
+    free( ni->nodes );
+    free( ni->chain );
+    free( ni->table );
+}
+
+
+void nodeidx_add( nodeidx_t *ni, anode_t *node )
+{
+    unsigned long h;
+    int e;
+
+    if (ni->len == ni->size) {
+        ni->size *= 2;
+        ni->nodes = realloc( ni->nodes, ni->size*sizeof(anode_t *) );
+        ni->chain = realloc( ni->chain, ni->size*sizeof(int) );
+        if (ni->nodes == NULL || ni->chain == NULL) {
+            perror( "nodeidx_add, realloc" );
+            exit(-1);
+        }
+    }
+    *(ni->nodes+ni->len) = node;
+    ni->len++;
+
+    if (ni->len > ni->mask+1) {
+        /* Double the number of buckets and rebuild the chains, in
+           increasing order of entries so that each is reversed. */
+        ni->mask = 2*ni->mask+1;
+        free( ni->table );
+        ni->table = malloc( (ni->mask+1)*sizeof(int) );
+        if (ni->table == NULL) {
+            perror( "nodeidx_add, malloc" );
+            exit(-1);
+        }
+        for (h = 0; h <= ni->mask; h++)
+            *(ni->table+h) = -1;
+        e = 0;
+    } else {
+        e = ni->len-1;
+    }
+    for (; e < ni->len; e++) {
+        if (*(ni->nodes+e) == NULL)
+            continue;
+        h = aut_sighash( (*(ni->nodes+e))->mode, (*(ni->nodes+e))->state,
+                         ni->num_env ) & ni->mask;
+        *(ni->chain+e) = *(ni->table+h);
+        *(ni->table+h) = e;
+    }
+}
+
+
+void nodeidx_remove( nodeidx_t *ni, anode_t *node )
+{
+    int e;
+
+    e = *(ni->table+(aut_sighash( node->mode, node->state, ni->num_env )
+                     & ni->mask));
+    while (e >= 0 && *(ni->nodes+e) != node)
+        e = *(ni->chain+e);
+    if (e >= 0)
+        *(ni->nodes+e) = NULL;
+}
+
+
+int nodeidx_seek( nodeidx_t *ni, int e, int mode, vartype *env_move )
+{
+    while (e >= 0 && (*(ni->nodes+e) == NULL
+                      || (*(ni->nodes+e))->mode != mode
+                      || (ni->num_env > 0
+                          && !statecmp( (*(ni->nodes+e))->state, env_move,
+                                        ni->num_env ))))
+        e = *(ni->chain+e);
+    return e;
+}
+
+
+anode_t *find_reusable_successor( DdManager *manager, nodeidx_t *ni,
+                                  DdNode *trans, DdNode *goal_set,
+                                  vartype *env_move, int mode, int num_sgoals,
+                                  int num_env, int num_sys, int *ecube )
+{
+    anode_t *head;
     int i;
-    int num_env, num_sys;
-    num_env = tree_size( spc.evar_list );
-    num_sys = tree_size( spc.svar_list );
-    for (i = 0; i < num_env+num_sys; i++) {
-        logprint( "\t%s = %d;",
-                  (i < num_env ?
-                   (get_list_item( spc.evar_list, i ))->name
-                   : (get_list_item( spc.svar_list, i-num_env ))->name),
-                  *(state+i) );
+    int next_mode;
+    int e, e_next;  /* Entries with mode and mode+1, respectively */
+    DdNode *ddval;
+
+    /* A candidate has either mode or the next one.  Merging the two
+       chains by entry visits candidates in the order of the strategy. */
+    next_mode = (mode == num_sgoals-1) ? 0 : mode+1;
+    e = nodeidx_seek( ni, *(ni->table+(aut_sighash( mode, env_move, num_env )
+                                       & ni->mask)),
+                      mode, env_move );
+    if (next_mode != mode) {
+        e_next = nodeidx_seek( ni,
+                               *(ni->table+(aut_sighash( next_mode, env_move,
+                                                         num_env )
+                                            & ni->mask)),
+                               next_mode, env_move );
+    } else {
+        e_next = -1;
+    }
+
+    while (e >= 0 || e_next >= 0) {
+        if (e_next > e) {
+            head = *(ni->nodes+e_next);
+            e_next = nodeidx_seek( ni, *(ni->chain+e_next),
+                                   next_mode, env_move );
+        } else {
+            head = *(ni->nodes+e);
+            e = nodeidx_seek( ni, *(ni->chain+e), mode, env_move );
+        }
+
+        state_to_cube( head->state, ecube, num_env+num_sys );
+        ddval = Cudd_Eval( manager, goal_set, ecube );
+        if (Cudd_IsComplement( ddval ) ? head->mode != mode
+            : head->mode != next_mode)
+            continue;
+
+        /* trans is over primed variables; unprimed values are irrelevant. */
+        for (i = 0; i < num_env+num_sys; i++) {
+            *(ecube+num_env+num_sys+i) = *(head->state+i);
+            *(ecube+i) = 0;
+        }
+        ddval = Cudd_Eval( manager, trans, ecube );
+        if (!Cudd_IsComplement( ddval ))
+            return head;
+    }
+
+    return NULL;
+}
+
+
+DdNode **get_X_sets( DdManager *manager, xcache_t *xc, int i, int j,
+                     DdNode *W, DdNode *etrans, DdNode *strans,
+                     DdNode **egoals, int num_egoals, DdNode *sgoal,
+                     DdNode *Y_prev, int num_env, int num_sys, int *cube )
+{
+    DdNode *Y_exmod;
+    int k, r;
+
+    for (k = 0; k < XCACHE_LEN; k++) {
+        if (xc->goal[k] == i && xc->level[k] == j) {
+            (xc->hits)++;
+            return xc->X[k];
+        }
+    }
+    (xc->misses)++;
+
+    k = xc->next;
+    xc->next = (xc->next + 1) % XCACHE_LEN;
+    if (xc->goal[k] >= 0) {
+        for (r = 0; r < num_egoals; r++)
+            Cudd_RecursiveDeref( manager, *(xc->X[k]+r) );
+    } else {
+        xc->X[k] = malloc( num_egoals*sizeof(DdNode *) );
+        if (xc->X[k] == NULL) {
+            perror( "get_X_sets, malloc" );
+            exit(-1);
+        }
+    }
+    xc->goal[k] = -1;
+
+    if (Y_prev == NULL)
+        Y_prev = Cudd_Not( Cudd_ReadOne( manager ) );
+    Y_exmod = compute_existsmodal( manager, Y_prev, etrans, strans,
+                                   num_env, num_sys, cube );
+    if (Y_exmod == NULL)
+        return NULL;
+    for (r = 0; r < num_egoals; r++) {
+        *(xc->X[k]+r) = compute_sublevel_X( manager, W, Y_exmod,
+                                            etrans, strans,
+                                            *(egoals+r), sgoal,
+                                            num_env, num_sys, cube );
+        if (*(xc->X[k]+r) == NULL)
+            return NULL;
+    }
+    Cudd_RecursiveDeref( manager, Y_exmod );
+
+    xc->goal[k] = i;
+    xc->level[k] = j;
+    return xc->X[k];
+}
+
+
+int restrict_if_smaller( DdManager *manager, DdNode **f, DdNode *care )
+{
+    DdNode *tmp;
+    int size, restricted_size;
+    size = Cudd_DagSize( *f );
+    tmp = Cudd_bddRestrict( manager, *f, care );
+    if (tmp == NULL)
+        return size;
+    Cudd_Ref( tmp );
+    restricted_size = Cudd_DagSize( tmp );
+    if (restricted_size < size) {
+        Cudd_RecursiveDeref( manager, *f );
+        *f = tmp;
+        return restricted_size;
+    }
+    Cudd_RecursiveDeref( manager, tmp );
+    return size;
+}
+
+
+void shift_sublevel_sets( DdManager *manager, DdNode *W, DdNode **sgoals,
+                          int num_sgoals, int num_egoals,
+                          DdNode ***Y, DdNode ****X_ijr, int *num_sublevels,
+                          DdNode **Y_1 )
+{
+    int i, j, r;
+    for (i = 0; i < num_sgoals; i++) {
+        Cudd_RecursiveDeref( manager, *(*(Y+i)) );
+        if (X_ijr == NULL) {
+            *(Y_1+i) = *(*(Y+i)+1);
+        } else {
+            Cudd_RecursiveDeref( manager, *(*(Y+i)+1) );
+            for (r = 0; r < num_egoals; r++)
+                Cudd_RecursiveDeref( manager, *(*(*(X_ijr+i))+r) );
+            free( *(*(X_ijr+i)) );
+        }
+
+        *(*(Y+i)+1) = Cudd_bddAnd( manager, *(sgoals+i), W );
+        Cudd_Ref( *(*(Y+i)+1) );
+
+        (*(num_sublevels+i))--;
+        for (j = 0; j < *(num_sublevels+i); j++) {
+            *(*(Y+i)+j) = *(*(Y+i)+j+1);
+            if (X_ijr != NULL)
+                *(*(X_ijr+i)+j) = *(*(X_ijr+i)+j+1);
+        }
+
+        assert( *(num_sublevels+i) > 0 );
+        *(Y+i) = realloc( *(Y+i), (*(num_sublevels+i))*sizeof(DdNode *) );
+        if (*(Y+i) == NULL) {
+            perror( "shift_sublevel_sets, realloc" );
+            exit(-1);
+        }
+        if (X_ijr != NULL) {
+            *(X_ijr+i) = realloc( *(X_ijr+i),
+                                  (*(num_sublevels+i))*sizeof(DdNode **) );
+            if (*(X_ijr+i) == NULL) {
+                perror( "shift_sublevel_sets, realloc" );
+                exit(-1);
+            }
+        }
     }
 }
 
 
-anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
-                     unsigned char verbose )
+anode_t *synthesize( DdManager *manager, unsigned char init_flags,
+                     unsigned char synth_flags, unsigned char verbose )
 {
     anode_t *strategy = NULL;
     anode_t *this_node_stack = NULL;
@@ -62,6 +418,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     DdNode *Y_i_primed;
     int *num_sublevels;
     DdNode ****X_ijr = NULL;
+    DdNode **X_j;  /* X sets of one sublevel, one per environment goal */
+    DdNode **Y_1 = NULL;  /* Y_1 sets before shifting; cf. get_X_sets() */
+    xcache_t xcache;
+    int *xcube = NULL;
+
+    DdNode *reach;  /* States reachable from initial states;
+                       cf. SYNTH_RESTRICT_REACH */
+    int size_before, size_after;
 
     DdNode *tmp, *tmp2;
     int i, j, r, k;  /* Generic counters */
@@ -73,6 +437,10 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     int num_env, num_sys;
     int *cube;  /* length will be twice total number of variables (to
                    account for both variables and their primes). */
+    int *ecube = NULL;  /* For evaluating BDDs while searching for
+                           reusable nodes; cf. SYNTH_REUSE_NODES */
+    nodeidx_t strategy_index;  /* Used only with SYNTH_REUSE_NODES */
+    int num_reused = 0, num_edges = 0;
 
     /* Variables used during CUDD generation (state enumeration). */
     DdGen *gen;
@@ -104,6 +472,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         perror( "synthesize, malloc" );
         exit(-1);
     }
+    if (synth_flags & SYNTH_REUSE_NODES) {
+        ecube = (int *)malloc( sizeof(int)*2*(num_env+num_sys) );
+        if (ecube == NULL) {
+            perror( "synthesize, malloc" );
+            exit(-1);
+        }
+        nodeidx_init( &strategy_index, num_env );
+    }
 
     /* Chain together environment and system variable lists for
        working with BDD library. */
@@ -126,25 +502,42 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
 
     /* Generate BDDs for the various parse trees from the problem spec. */
     if (spc.env_init != NULL) {
-        einit = ptree_BDD( spc.env_init, spc.evar_list, manager );
+        einit = ptree_BDD_symtab( spc.env_init, spc.var_st, manager );
     } else {
         einit = Cudd_ReadOne( manager );
         Cudd_Ref( einit );
     }
     if (spc.sys_init != NULL) {
-        sinit = ptree_BDD( spc.sys_init, spc.evar_list, manager );
+        sinit = ptree_BDD_symtab( spc.sys_init, spc.var_st, manager );
     } else {
         sinit = Cudd_ReadOne( manager );
         Cudd_Ref( sinit );
     }
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    if (rcache_enabled()) {
+        /* Reuse BDDs of unchanged components; cf. resultcache.h */
+        etrans = rcache_conj_BDD( spc.env_trans_array, spc.et_array_len,
+                                  spc.var_st, manager );
+    } else {
+        etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Peak intermediate BDD size: %d",
+                      ptree_BDD_peak_size() );
+    }
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    if (rcache_enabled()) {
+        strans = rcache_conj_BDD( spc.sys_trans_array, spc.st_array_len,
+                                  spc.var_st, manager );
+    } else {
+        strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Peak intermediate BDD size: %d",
+                      ptree_BDD_peak_size() );
+    }
     if (verbose > 1)
         logprint( "Done." );
 
@@ -152,14 +545,16 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = rcache_ptree_BDD( *(spc.env_goals+i),
+                                            spc.var_st, manager );
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *(sgoals+i) = rcache_ptree_BDD( *(spc.sys_goals+i),
+                                            spc.var_st, manager );
     } else {
         sgoals = NULL;
     }
@@ -170,8 +565,16 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         var_separator->left = NULL;
     }
 
-    W = compute_winning_set_BDD( manager, etrans, strans, egoals, sgoals,
-                                 verbose );
+    W = rcache_load_winning( manager );
+    if (W != NULL) {
+        if (verbose)
+            logprint( "Loaded winning set from result cache." );
+    } else {
+        W = compute_winning_set_BDD( manager, etrans, strans, egoals, sgoals,
+                                     verbose );
+        if (W != NULL && rcache_enabled())
+            rcache_save_winning( manager, W );
+    }
     if (W == NULL) {
         fprintf( stderr,
                  "Error synthesize: failed to construct winning set.\n" );
@@ -179,10 +582,25 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         free( cube );
         return NULL;
     }
-    Y = compute_sublevel_sets( manager, W, etrans, strans,
-                               egoals, spc.num_egoals,
-                               sgoals, spc.num_sgoals,
-                               &num_sublevels, &X_ijr, verbose );
+    Y = rcache_load_sublevels( manager, spc.num_egoals, spc.num_sgoals,
+                               &num_sublevels,
+                               ((synth_flags & SYNTH_LEAN_SUBLEVELS) ?
+                                NULL : &X_ijr) );
+    if (Y != NULL) {
+        if (verbose)
+            logprint( "Loaded sublevel sets from result cache." );
+    } else {
+        Y = compute_sublevel_sets( manager, W, etrans, strans,
+                                   egoals, spc.num_egoals,
+                                   sgoals, spc.num_sgoals,
+                                   &num_sublevels,
+                                   ((synth_flags & SYNTH_LEAN_SUBLEVELS) ?
+                                    NULL : &X_ijr),
+                                   verbose );
+        if (Y != NULL && rcache_enabled())
+            rcache_save_sublevels( manager, Y, X_ijr, num_sublevels,
+                                   spc.num_egoals, spc.num_sgoals );
+    }
     if (Y == NULL) {
         fprintf( stderr,
                  "Error synthesize: failed to construct sublevel sets.\n" );
@@ -190,41 +608,27 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         free( cube );
         return NULL;
     }
-
-    /* The sublevel sets are exactly as resulting from the vanilla
-       fixed point formula.  Thus for each system goal i, Y_0 = \emptyset,
-       and Y_1 is a union of i-goal states and environment-blocking states.
-
-       For the purpose of synthesis, it is enough to delete Y_0 and
-       replace Y_1 with the intersection of i-goal states and the
-       winning set, and then shift the indices down (so that Y_1 is
-       now called Y_0, Y_2 is now called Y_1, etc.) */
-    for (i = 0; i < spc.num_sgoals; i++) {
-        Cudd_RecursiveDeref( manager, *(*(Y+i)) );
-        Cudd_RecursiveDeref( manager, *(*(Y+i)+1) );
-        for (r = 0; r < spc.num_egoals; r++)
-            Cudd_RecursiveDeref( manager, *(*(*(X_ijr+i))+r) );
-        free( *(*(X_ijr+i)) );
-
-        *(*(Y+i)+1) = Cudd_bddAnd( manager, *(sgoals+i), W );
-        Cudd_Ref( *(*(Y+i)+1) );
-
-        (*(num_sublevels+i))--;
-        for (j = 0; j < *(num_sublevels+i); j++) {
-            *(*(Y+i)+j) = *(*(Y+i)+j+1);
-            *(*(X_ijr+i)+j) = *(*(X_ijr+i)+j+1);
-        }
-
-        assert( *(num_sublevels+i) > 0 );
-        *(Y+i) = realloc( *(Y+i), (*(num_sublevels+i))*sizeof(DdNode *) );
-        *(X_ijr+i) = realloc( *(X_ijr+i),
-                              (*(num_sublevels+i))*sizeof(DdNode **) );
-        if (*(Y+i) == NULL || *(X_ijr+i) == NULL) {
-            perror( "synthesize, realloc" );
+    if (verbose > 1)
+        logprint( "Cudd_ReadMemoryInUse (bytes) after computing sublevel"
+                  " sets: %lu",
+                  (unsigned long)Cudd_ReadMemoryInUse( manager ) );
+
+    if (synth_flags & SYNTH_LEAN_SUBLEVELS) {
+        Y_1 = malloc( spc.num_sgoals*sizeof(DdNode *) );
+        xcube = malloc( sizeof(int)*2*(num_env+num_sys) );
+        if (Y_1 == NULL || xcube == NULL) {
+            perror( "synthesize, malloc" );
             exit(-1);
         }
+        for (k = 0; k < XCACHE_LEN; k++)
+            xcache.goal[k] = -1;
+        xcache.next = 0;
+        xcache.hits = xcache.misses = 0;
     }
 
+    shift_sublevel_sets( manager, W, sgoals, spc.num_sgoals, spc.num_egoals,
+                         Y, X_ijr, num_sublevels, Y_1 );
+
     /* Make primed form of W and take conjunction with system
        transition (safety) formula, for use while stepping down Y_i
        sets.  Note that we assume the variable map has been
@@ -441,9 +845,61 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                      " strategy.\n" );
             return NULL;
         }
+        if (synth_flags & SYNTH_REUSE_NODES)
+            nodeidx_add( &strategy_index, strategy );
         node = node->next;
     }
 
+    /* Every state visited below is reachable from the initial states
+       by transitions that satisfy etrans and strans_into_W, so outside
+       of this set the sublevel sets can be simplified arbitrarily. */
+    if (synth_flags & SYNTH_RESTRICT_REACH) {
+        if (verbose > 1)
+            logprint( "Computing states reachable from initial states..." );
+        tmp = Cudd_Not( Cudd_ReadOne( manager ) );
+        Cudd_Ref( tmp );
+        node = this_node_stack;
+        while (node) {
+            tmp2 = state_to_BDD( manager, node->state, 0, num_env+num_sys );
+            reach = Cudd_bddOr( manager, tmp, tmp2 );
+            Cudd_Ref( reach );
+            Cudd_RecursiveDeref( manager, tmp );
+            Cudd_RecursiveDeref( manager, tmp2 );
+            tmp = reach;
+            node = node->next;
+        }
+        reach = compute_forward_reach( manager, tmp, etrans, strans_into_W,
+                                       num_env, num_sys, cube );
+        Cudd_RecursiveDeref( manager, tmp );
+        if (reach == NULL) {
+            fprintf( stderr,
+                     "Error synthesize: failed to compute reachable"
+                     " states.\n" );
+            return NULL;
+        }
+
+        size_before = Cudd_DagSize( strans_into_W );
+        size_after = restrict_if_smaller( manager, &strans_into_W, reach );
+        /* X sets that are recomputed on demand are obtained from the
+           sublevel sets, so those are not restricted in lean mode. */
+        for (i = 0; i < spc.num_sgoals && X_ijr != NULL; i++) {
+            for (j = 0; j < *(num_sublevels+i); j++) {
+                size_before += Cudd_DagSize( *(*(Y+i)+j) );
+                size_after += restrict_if_smaller( manager, *(Y+i)+j, reach );
+                for (r = 0; r < spc.num_egoals; r++) {
+                    size_before += Cudd_DagSize( *(*(*(X_ijr+i)+j)+r) );
+                    size_after += restrict_if_smaller( manager,
+                                                       *(*(X_ijr+i)+j)+r,
+                                                       reach );
+                }
+            }
+        }
+        Cudd_RecursiveDeref( manager, reach );
+        if (verbose > 1)
+            logprint( "Done.  Total size of BDDs used for extraction reduced"
+                      " from %d to %d nodes.", size_before, size_after );
+    }
+
     if (verbose > 1) {
         logprint( "Constructing enumerative strategy..." );
         logprint( "Beginning with node stack size %d.",
@@ -500,6 +956,8 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                     logprint( "}" );
                 }
                 initial = node->initial;
+                if (synth_flags & SYNTH_REUSE_NODES)
+                    nodeidx_remove( &strategy_index, node );
                 strategy = delete_anode( strategy, node );
                 new_node = find_anode( strategy, this_node_stack->mode,
                                        this_node_stack->state,
@@ -521,6 +979,8 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                                  " strategy.\n" );
                         return NULL;
                     }
+                    if (synth_flags & SYNTH_REUSE_NODES)
+                        nodeidx_add( &strategy_index, strategy );
                     new_node = find_anode( strategy, this_node_stack->mode,
                                            this_node_stack->state,
                                            num_env+num_sys );
@@ -590,12 +1050,32 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
                 if (j > 0) {
                     for (offset = 1; offset >= 0; offset--) {
+                    if (X_ijr != NULL) {
+                        X_j = *(*(X_ijr+node->mode)+j - offset);
+                    } else {
+                        X_j = get_X_sets( manager, &xcache,
+                                          node->mode, j - offset,
+                                          W, etrans, strans,
+                                          egoals, spc.num_egoals,
+                                          *(sgoals+node->mode),
+                                          (j - offset == 0 ? NULL
+                                           : (j - offset == 1 ?
+                                              *(Y_1+node->mode)
+                                              : *(*(Y+node->mode)
+                                                  +j - offset-1))),
+                                          num_env, num_sys, xcube );
+                        if (X_j == NULL) {
+                            fprintf( stderr,
+                                     "Error synthesize: failed to recompute"
+                                     " X sets.\n" );
+                            return NULL;
+                        }
+                    }
                     for (r = 0; r < spc.num_egoals; r++) {
                         Cudd_RecursiveDeref( manager, tmp );
                         Cudd_RecursiveDeref( manager, Y_i_primed );
                         Y_i_primed
-                            = Cudd_bddVarMap( manager,
-                                              *(*(*(X_ijr+node->mode)+j - offset)+r) );
+                            = Cudd_bddVarMap( manager, *(X_j+r) );
                         if (Y_i_primed == NULL) {
                             fprintf( stderr,
                                      "Error synthesize: Error in swapping"
@@ -679,6 +1159,26 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                 Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
             }
 
+            /* Prefer a successor that is already in the strategy, if
+               any.  Because tmp is the set of admissible moves, the
+               resulting transition is one that could have been
+               obtained from the cube generator above. */
+            num_edges++;
+            if (synth_flags & SYNTH_REUSE_NODES) {
+                new_node = find_reusable_successor( manager, &strategy_index,
+                                                    tmp,
+                                                    **(Y+node->mode),
+                                                    (num_env > 0 ?
+                                                     *(env_moves+k) : NULL),
+                                                    node->mode, spc.num_sgoals,
+                                                    num_env, num_sys, ecube );
+                if (new_node != NULL) {
+                    num_reused++;
+                    for (i = 0; i < num_env+num_sys; i++)
+                        *(cube+num_env+num_sys+i) = *(new_node->state+i);
+                }
+            }
+
             Cudd_RecursiveDeref( manager, tmp );
             initialize_cube( state, cube+num_env+num_sys, num_env+num_sys );
             for (i = 0; i < num_env; i++)
@@ -713,6 +1213,8 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
                              " strategy.\n" );
                     return NULL;
                 }
+                if (synth_flags & SYNTH_REUSE_NODES)
+                    nodeidx_add( &strategy_index, strategy );
                 this_node_stack = insert_anode( this_node_stack, next_mode, -1,
                                                 False,
                                                 state, num_env+num_sys );
@@ -746,6 +1248,44 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         }
     }
 
+    if (synth_flags & SYNTH_REUSE_NODES) {
+        if (verbose > 1)
+            logprint( "Reused existing nodes for %d of %d transitions.",
+                      num_reused, num_edges );
+        nodeidx_free( &strategy_index );
+    }
+
+    if (synth_flags & SYNTH_MINIMIZE) {
+        i = aut_size( strategy );
+        node = aut_minimize( strategy, num_env+num_sys );
+        if (node == NULL) {
+            fprintf( stderr,
+                     "Error synthesize: failed to minimize strategy.\n" );
+            delete_aut( strategy );
+        } else if (verbose > 1) {
+            logprint( "Minimization reduced strategy size from %d to %d.",
+                      i, aut_size( node ) );
+        }
+        strategy = node;
+    }
+
+    if (synth_flags & SYNTH_LEAN_SUBLEVELS) {
+        if (verbose > 1)
+            logprint( "X sets were found in cache for %d of %d lookups.",
+                      xcache.hits, xcache.hits + xcache.misses );
+        for (k = 0; k < XCACHE_LEN; k++) {
+            if (xcache.goal[k] < 0)
+                continue;
+            for (r = 0; r < spc.num_egoals; r++)
+                Cudd_RecursiveDeref( manager, *(xcache.X[k]+r) );
+            free( xcache.X[k] );
+        }
+        for (i = 0; i < spc.num_sgoals; i++)
+            Cudd_RecursiveDeref( manager, *(Y_1+i) );
+        free( Y_1 );
+        free( xcube );
+    }
+
     /* Pre-exit clean-up */
     Cudd_RecursiveDeref( manager, W );
     Cudd_RecursiveDeref( manager, strans_into_W );
@@ -762,10 +1302,13 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
     if (spc.num_sgoals > 0)
         free( sgoals );
     free( cube );
+    free( ecube );
     free( state );
     for (i = 0; i < spc.num_sgoals; i++) {
         for (j = 0; j < *(num_sublevels+i); j++) {
             Cudd_RecursiveDeref( manager, *(*(Y+i)+j) );
+            if (X_ijr == NULL)
+                continue;
             for (r = 0; r < spc.num_egoals; r++) {
                 Cudd_RecursiveDeref( manager, *(*(*(X_ijr+i)+j)+r) );
             }
@@ -773,12 +1316,14 @@ anode_t *synthesize( DdManager *manager,  unsigned char init_flags,
         }
         if (*(num_sublevels+i) > 0) {
             free( *(Y+i) );
-            free( *(X_ijr+i) );
+            if (X_ijr != NULL)
+                free( *(X_ijr+i) );
         }
     }
     if (spc.num_sgoals > 0) {
         free( Y );
-        free( X_ijr );
+        if (X_ijr != NULL)
+            free( X_ijr );
         free( num_sublevels );
     }
     if (env_nogoal_flag) {
@@ -850,13 +1395,13 @@ DdNode *check_realizable_internal( DdManager *manager, DdNode *W,
     }
 
     if (spc.env_init != NULL) {
-        einit = ptree_BDD( spc.env_init, spc.evar_list, manager );
+        einit = ptree_BDD_symtab( spc.env_init, spc.var_st, manager );
     } else {
         einit = Cudd_ReadOne( manager );
         Cudd_Ref( einit );
     }
     if (spc.sys_init != NULL) {
-        sinit = ptree_BDD( spc.sys_init, spc.evar_list, manager );
+        sinit = ptree_BDD_symtab( spc.sys_init, spc.var_st, manager );
     } else {
         sinit = Cudd_ReadOne( manager );
         Cudd_Ref( sinit );
@@ -979,3 +1524,32 @@ DdNode *check_realizable_internal( DdManager *manager, DdNode *W,
         return NULL;
     }
 }
+
+
+DdNode *gr1c_ctx_compute_winning_set( gr1c_ctx_t *ctx )
+{
+    gr1c_ctx_t *prev = gr1c_ctx_bind( ctx );
+    DdNode *W = compute_winning_set( ctx->manager, ctx->verbose );
+    gr1c_ctx_bind( prev );
+    return W;
+}
+
+
+DdNode *gr1c_ctx_check_realizable( gr1c_ctx_t *ctx )
+{
+    gr1c_ctx_t *prev = gr1c_ctx_bind( ctx );
+    DdNode *W = check_realizable( ctx->manager, ctx->init_flags,
+                                  ctx->verbose );
+    gr1c_ctx_bind( prev );
+    return W;
+}
+
+
+anode_t *gr1c_ctx_synthesize( gr1c_ctx_t *ctx )
+{
+    gr1c_ctx_t *prev = gr1c_ctx_bind( ctx );
+    anode_t *strategy = synthesize( ctx->manager, ctx->init_flags,
+                                    ctx->synth_flags, ctx->verbose );
+    gr1c_ctx_bind( prev );
+    return strategy;
+}
@@ -12,6 +12,7 @@
 #include "common.h"
 #include "ptree.h"
 #include "automaton.h"
+#include "context.h"
 
 /* Flags concerning initial conditions. (Consult comments for check_realizable.) */
 #define UNDEFINED_INIT 0
@@ -33,6 +34,42 @@
     }
 
 
+/**
+ * \defgroup SynthFlags flags for synthesize
+ *
+ * \brief Flags to configure strategy extraction.  Combine
+ *   non-conflicting flags with or.
+ *
+ * @{
+ */
+#define SYNTH_DEFAULT 0  /**<\brief Take the first admissible move found. */
+#define SYNTH_REUSE_NODES 1  /**<\brief Before taking the first admissible
+                                move, search the strategy built so far
+                                for a node that is an admissible
+                                successor and prefer it.  If none
+                                exists, then behave as SYNTH_DEFAULT.
+                                This tends to reduce the size of the
+                                resulting strategy. */
+#define SYNTH_MINIMIZE 2  /**<\brief After construction, merge bisimilar
+                             nodes of the strategy; cf. aut_minimize(). */
+#define SYNTH_RESTRICT_REACH 4  /**<\brief Before constructing the strategy,
+                                   restrict the sublevel sets to states
+                                   that are reachable from the initial
+                                   states while remaining in the winning
+                                   set.  Enumeration never leaves these
+                                   states, so the result is unchanged, but
+                                   cofactoring smaller BDDs is cheaper. */
+#define SYNTH_LEAN_SUBLEVELS 8  /**<\brief Do not keep the X fixed point
+                                   sets of every sublevel; instead,
+                                   recompute them when needed and keep
+                                   only those of the most recently used
+                                   sublevels.  This reduces memory usage
+                                   at the cost of time.  If combined with
+                                   SYNTH_RESTRICT_REACH, then the sublevel
+                                   sets are not restricted. */
+/**@}*/
+
+
 /** If realizable, then returns (a pointer to) the characteristic
    function of the winning set.  Otherwise (if problem is not
    realizable), returns NULL.  Given manager must already be
@@ -88,9 +125,12 @@ DdNode *check_realizable( DdManager *manager, unsigned char init_flags,
 /** Synthesize a strategy.  The specification is assumed to be
    realizable when this function is invoked.  Return pointer to
    automaton representing the strategy, or NULL if error. Also read
-   documentation for check_realizable(). */
+   documentation for check_realizable().
+
+   synth_flags configures how moves are selected while the strategy
+   is constructed; it is formed from \ref SynthFlags. */
 anode_t *synthesize( DdManager *manager, unsigned char init_flags,
-                     unsigned char verbose );
+                     unsigned char synth_flags, unsigned char verbose );
 
 /** Compute the set of states that are winning for the system, under
    the specification defined by the global parse trees (generated from
@@ -109,6 +149,65 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                                  DdNode **egoals, DdNode **sgoals,
                                  unsigned char verbose );
 
+/** Compute the winning set as compute_winning_set_BDD() does, but with
+   the fixpoint iterations started from given sets, which can save many
+   iterations when a winning set is already known for a similar game.
+   If Z_init is not NULL, then it must contain the result, and it is
+   used instead of True to start the outer (greatest) fixpoint.  If
+   Y_init is not NULL, then it must be contained in the result, and it
+   is used instead of False to start each least fixpoint Y.
+
+   E.g., if W was computed for etrans and strans, and then only system
+   moves are removed or only environment moves are added, then the
+   winning set can only shrink, so W can be given as Z_init.  In the
+   opposite case, the winning set can only grow, so W can be given as
+   Y_init.  Neither argument is dereferenced. */
+DdNode *compute_winning_set_BDD_seeded( DdManager *manager,
+                                        DdNode *etrans, DdNode *strans,
+                                        DdNode **egoals, DdNode **sgoals,
+                                        DdNode *Z_init, DdNode *Y_init,
+                                        unsigned char verbose );
+
+/** Set the number of threads that compute_winning_set_BDD() may use.
+   If num_threads is greater than 1 and there are several system goals
+   (or one system goal and several environment goals), then the
+   computation is divided among that many threads, each with its own
+   CUDD manager; cf. compute_winning_set_BDD_parallel().  This is
+   ignored while checkpoints are enabled (cf. checkpoint.h).  Default
+   is 1, i.e., no parallelism. */
+void setsolverthreads( int num_threads );
+
+/** Return the number of threads set by setsolverthreads(). */
+int getsolverthreads();
+
+/** Compute the winning set as compute_winning_set_BDD() does, using up
+   to num_threads threads.  Each thread has its own CUDD manager, with
+   copies of etrans, strans, and the goals, and BDDs are moved between
+   managers using Cudd_bddTransfer().  If num_sgoals > 1, then the
+   updates of Z_i for different system goals are computed concurrently;
+   otherwise, the X fixpoints for different environment goals are
+   computed concurrently within each Y iteration.  The variable map of
+   manager must already be defined as by compute_winning_set_BDD().
+   Return the (referenced) winning set, or NULL on error. */
+DdNode *compute_winning_set_BDD_parallel( DdManager *manager,
+                                          DdNode *etrans, DdNode *strans,
+                                          DdNode **egoals, int num_egoals,
+                                          DdNode **sgoals, int num_sgoals,
+                                          int num_env, int num_sys,
+                                          int num_threads,
+                                          unsigned char verbose );
+
+/** Create a CUDD manager for use in another thread, with the same
+   variables and variable order as manager, and with the variable map
+   defined for num_env+num_sys unprimed variables as by
+   compute_winning_set_BDD().  Return NULL on error. */
+DdManager *par_manager_new( DdManager *manager, int num_env, int num_sys );
+
+/** Copy f from manager src to manager dest, e.g., one created by
+   par_manager_new().  Neither manager may be in use by another thread.
+   Return the referenced result, or NULL on error. */
+DdNode *par_transfer( DdManager *src, DdManager *dest, DdNode *f );
+
 /** W is assumed to be (the characteristic function of) the set of
    winning states, e.g., as returned by compute_winning_set().
    num_sublevels is an int array of length equal to the number of
@@ -119,7 +218,9 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
    successful termination it contains (pointers to) the X fixed point
    sets computed for each Y_ij sublevel set. For each Y_ij sublevel
    set, the number of X sets is equal to the number of environment
-   goals. */
+   goals.  If X_ijr is NULL, then the X sets are released as soon as
+   they are no longer needed to build the sublevel sets; they can be
+   recomputed later using compute_sublevel_X(). */
 DdNode ***compute_sublevel_sets( DdManager *manager,
                                  DdNode *W,
                                  DdNode *etrans, DdNode *strans,
@@ -129,6 +230,17 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                                  DdNode *****X_ijr,
                                  unsigned char verbose );
 
+/** Compute the X fixed point set that compute_sublevel_sets() obtains
+   for system goal sgoal and environment goal egoal at a sublevel, where
+   Y_exmod is the exists modal operator (cf. compute_existsmodal())
+   applied to the preceding sublevel set.  cube is a work array of
+   length 2*(num_env+num_sys).  Return the (referenced) result, or NULL
+   on error. */
+DdNode *compute_sublevel_X( DdManager *manager, DdNode *W, DdNode *Y_exmod,
+                            DdNode *etrans, DdNode *strans,
+                            DdNode *egoal, DdNode *sgoal,
+                            int num_env, int num_sys, int *cube );
+
 /** Read commands from input stream infp and write results to outfp.
    Return 1 on successful completion, 0 if specification unrealizable,
    and -1 if error. */
@@ -136,5 +248,28 @@ int levelset_interactive( DdManager *manager, unsigned char init_flags,
                           FILE *infp, FILE *outfp,
                           unsigned char verbose );
 
+/** Answer batches of queries about the winning set, in the binary
+   protocol described in doc/interaction.md, until end of input or until
+   interrupted.  If socket_path is NULL, then read requests from stdin
+   and write responses to stdout; otherwise, listen for clients on a
+   Unix domain socket at socket_path, which is removed on exit.  Return
+   1 on successful completion, and -1 if error. */
+int levelset_serve( DdManager *manager, char *socket_path,
+                    unsigned char verbose );
+
+
+/** Context variant of compute_winning_set(); cf. context.h */
+DdNode *gr1c_ctx_compute_winning_set( gr1c_ctx_t *ctx );
+
+/** Context variant of check_realizable(); cf. context.h */
+DdNode *gr1c_ctx_check_realizable( gr1c_ctx_t *ctx );
+
+/** Context variant of synthesize(); cf. context.h
+
+   Nonboolean variables in the states of the resulting strategy are
+   expanded as in the specification of the context, i.e.,
+   aut_compact_nonbool() is not applied. */
+anode_t *gr1c_ctx_synthesize( gr1c_ctx_t *ctx );
+
 
 #endif
@@ -9,7 +9,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 
 #include "common.h"
 #include "logging.h"
@@ -18,9 +17,8 @@
 #include "solve.h"
 #include "solve_support.h"
 #include "solve_metric.h"
-
-
-extern specification_t spc;
+#include "resultcache.h"
+#include "context.h"
 
 
 int *get_offsets( char *metric_vars, int *num_vars )
@@ -94,200 +92,221 @@ int *get_offsets( char *metric_vars, int *num_vars )
 }
 
 
-int bounds_state( DdManager *manager, DdNode *T, vartype *ref_state,
-                  int *offw, int num_metric_vars,
-                  double *Min, double *Max, unsigned char verbose )
+/* Return ADD of the integer value of the metric variable with binary
+   representation of given width at offset, as decoded by
+   bitvec_to_int(), using the variables with indices offset+shift,
+   offset+shift+1, ..., i.e., unprimed variables if shift is 0.  The
+   result is referenced. */
+DdNode *metric_var_ADD( DdManager *manager, int offset, int width, int shift )
 {
-    vartype *state;
-    double dist;
-    int num_env, num_sys;
-    int i;
-    int *ref_mapped, *this_mapped;
+    DdNode *value, *bit, *term, *coeff, *tmp;
+    int k;
+
+    value = Cudd_ReadZero( manager );
+    Cudd_Ref( value );
+    for (k = 0; k < width; k++) {
+        bit = Cudd_addIthVar( manager, offset+k+shift );
+        Cudd_Ref( bit );
+        coeff = Cudd_addConst( manager, (CUDD_VALUE_TYPE)(1 << k) );
+        Cudd_Ref( coeff );
+        term = Cudd_addIte( manager, bit, coeff, Cudd_ReadZero( manager ) );
+        Cudd_Ref( term );
+        Cudd_RecursiveDeref( manager, bit );
+        Cudd_RecursiveDeref( manager, coeff );
+        tmp = Cudd_addApply( manager, Cudd_addPlus, value, term );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, value );
+        Cudd_RecursiveDeref( manager, term );
+        value = tmp;
+    }
+    return value;
+}
 
-    /* Variables used during CUDD generation (state enumeration). */
-    DdGen *gen;
-    CUDD_VALUE_TYPE gvalue;
-    int *gcube;
+/* Return ADD of the distance over metric variables between the state
+   given by unprimed variables and ref_state, or if ref_state is NULL,
+   the state given by the variables with indices shifted by shift.  The
+   result is referenced. */
+DdNode *metric_dist_ADD( DdManager *manager, int *offw, int num_metric_vars,
+                         vartype *ref_state, int shift )
+{
+    DdNode *dist, *X, *Y, *diff, *neg, *absdiff, *tmp;
+    int i;
 
-    num_env = tree_size( spc.evar_list );
-    num_sys = tree_size( spc.svar_list );
+    dist = Cudd_ReadZero( manager );
+    Cudd_Ref( dist );
+    for (i = 0; i < num_metric_vars; i++) {
+        X = metric_var_ADD( manager, *(offw+2*i), *(offw+2*i+1), 0 );
+        if (ref_state != NULL) {
+            Y = Cudd_addConst( manager,
+                               bitvec_to_int( ref_state+(*(offw+2*i)),
+                                              *(offw+2*i+1) ) );
+            Cudd_Ref( Y );
+        } else {
+            Y = metric_var_ADD( manager, *(offw+2*i), *(offw+2*i+1), shift );
+        }
+        diff = Cudd_addApply( manager, Cudd_addMinus, X, Y );
+        Cudd_Ref( diff );
+        Cudd_RecursiveDeref( manager, X );
+        Cudd_RecursiveDeref( manager, Y );
+        neg = Cudd_addNegate( manager, diff );
+        Cudd_Ref( neg );
+        absdiff = Cudd_addApply( manager, Cudd_addMaximum, diff, neg );
+        Cudd_Ref( absdiff );
+        Cudd_RecursiveDeref( manager, diff );
+        Cudd_RecursiveDeref( manager, neg );
 
-    /* State vector (i.e., valuation of the variables) */
-    state = malloc( sizeof(vartype)*(num_env+num_sys) );
-    if (state == NULL) {
-        perror( "bounds_state, malloc" );
-        exit(-1);
+        /* 1-norm derived metric */
+        tmp = Cudd_addApply( manager, Cudd_addPlus, dist, absdiff );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, dist );
+        Cudd_RecursiveDeref( manager, absdiff );
+        dist = tmp;
     }
+    return dist;
+}
 
-    /* Reference and particular integral vectors */
-    ref_mapped = malloc( num_metric_vars*sizeof(int) );
-    this_mapped = malloc( num_metric_vars*sizeof(int) );
-    if (ref_mapped == NULL || this_mapped == NULL) {
-        perror( "bounds_state, malloc" );
-        exit(-1);
-    }
+/* Find minimum and maximum of the ADD f over states in the set T. */
+void minmax_on_set( DdManager *manager, DdNode *f, DdNode *T,
+                    double *Min, double *Max )
+{
+    DdNode *T_add, *tmp;
 
-    for (i = 0; i < num_metric_vars; i++)
-        *(ref_mapped+i) = bitvec_to_int( ref_state+(*(offw+2*i)),
-                                         *(offw+2*i+1) );
-    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
+    T_add = Cudd_BddToAdd( manager, T );
+    Cudd_Ref( T_add );
 
-    Cudd_AutodynDisable( manager );
-    Cudd_ForeachCube( manager, T, gen, gcube, gvalue ) {
-        initialize_cube( state, gcube, num_env+num_sys );
-        while (!saturated_cube( state, gcube, num_env+num_sys )) {
-
-            for (i = 0; i < num_metric_vars; i++)
-                *(this_mapped+i) = bitvec_to_int( state+(*(offw+2*i)),
-                                                  *(offw+2*i+1) );
-
-            /* 2-norm derived metric */
-            /* dist = 0.; */
-            /* for (i = 0; i < num_metric_vars; i++) */
-            /*     dist += pow(*(this_mapped+i) - *(ref_mapped+i), 2); */
-            /* dist = sqrt( dist ); */
-
-            /* 1-norm derived metric */
-            dist = 0.;
-            for (i = 0; i < num_metric_vars; i++)
-                dist += fabs(*(this_mapped+i) - *(ref_mapped+i));
-            if (*Min == -1. || dist < *Min)
-                *Min = dist;
-            if (*Max == -1. || dist > *Max)
-                *Max = dist;
-
-            increment_cube( state, gcube, num_env+num_sys );
-        }
+    tmp = Cudd_addIte( manager, T_add, f, Cudd_ReadPlusInfinity( manager ) );
+    Cudd_Ref( tmp );
+    *Min = Cudd_V( Cudd_addFindMin( manager, tmp ) );
+    Cudd_RecursiveDeref( manager, tmp );
 
-        for (i = 0; i < num_metric_vars; i++)
-            *(this_mapped+i) = bitvec_to_int( state+(*(offw+2*i)),
-                                              *(offw+2*i+1) );
+    tmp = Cudd_addIte( manager, T_add, f, Cudd_ReadMinusInfinity( manager ) );
+    Cudd_Ref( tmp );
+    *Max = Cudd_V( Cudd_addFindMax( manager, tmp ) );
+    Cudd_RecursiveDeref( manager, tmp );
 
-        /* 2-norm derived metric */
-        /* dist = 0.; */
-        /* for (i = 0; i < num_metric_vars; i++) */
-        /*     dist += pow(*(this_mapped+i) - *(ref_mapped+i), 2); */
-        /* dist = sqrt( dist ); */
+    Cudd_RecursiveDeref( manager, T_add );
+}
 
-        /* 1-norm derived metric */
-        dist = 0.;
-        for (i = 0; i < num_metric_vars; i++)
-            dist += fabs(*(this_mapped+i) - *(ref_mapped+i));
-        if (*Min == -1. || dist < *Min)
-            *Min = dist;
-        if (*Max == -1. || dist > *Max)
-            *Max = dist;
 
-    }
-    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
+int bounds_state( DdManager *manager, DdNode *T, vartype *ref_state,
+                  int *offw, int num_metric_vars,
+                  double *Min, double *Max, unsigned char verbose )
+{
+    DdNode *dist;
+
+    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
+    if (T == Cudd_Not( Cudd_ReadOne( manager ) ))
+        return 0;
+
+    dist = metric_dist_ADD( manager, offw, num_metric_vars, ref_state, 0 );
+    minmax_on_set( manager, dist, T, Min, Max );
+    Cudd_RecursiveDeref( manager, dist );
 
-    free( state );
-    free( ref_mapped );
-    free( this_mapped );
     return 0;
 }
 
 
-int bounds_DDset( DdManager *manager, DdNode *T, DdNode *G,
-                  int *offw, int num_metric_vars,
-                  double *Min, double *Max, unsigned char verbose )
+DdNode *dist_to_set_ADD( DdManager *manager, DdNode *G,
+                         int *offw, int num_metric_vars )
 {
-    vartype **states = NULL;
-    int num_states = 0;
-    vartype *state;
-    double tMin, tMax;  /* Particular distance to goal set */
+    DdNode *dist, *tmp, *tmp2;
+    DdNode *cube;  /* Variables that are not metric, to be abstracted */
+    DdNode **mvars, **pmvars;  /* Metric variables and primed copies */
+    int num_mvars;
+    bool *is_metric;
     int num_env, num_sys;
     int i, k;
-    int *mapped_state;
-
-    /* Variables used during CUDD generation (state enumeration). */
-    DdGen *gen;
-    CUDD_VALUE_TYPE gvalue;
-    int *gcube;
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
 
-    state = malloc( (num_env+num_sys)*sizeof(vartype) );
-    if (state == NULL) {
-        perror( "bounds_DDset, malloc" );
+    is_metric = calloc( num_env+num_sys, sizeof(bool) );
+    mvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    pmvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    if (is_metric == NULL || mvars == NULL || pmvars == NULL) {
+        perror( "dist_to_set_ADD, malloc" );
         exit(-1);
     }
+    num_mvars = 0;
+    for (i = 0; i < num_metric_vars; i++) {
+        for (k = *(offw+2*i); k < *(offw+2*i)+*(offw+2*i+1); k++) {
+            *(is_metric+k) = True;
+            *(mvars+num_mvars) = Cudd_bddIthVar( manager, k );
+            *(pmvars+num_mvars) = Cudd_bddIthVar( manager, k+num_env+num_sys );
+            num_mvars++;
+        }
+    }
+    cube = Cudd_ReadOne( manager );
+    Cudd_Ref( cube );
+    for (i = 0; i < num_env+num_sys; i++) {
+        if (*(is_metric+i))
+            continue;
+        tmp = Cudd_bddAnd( manager, cube, Cudd_bddIthVar( manager, i ) );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, cube );
+        cube = tmp;
+    }
 
-    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
-
-    Cudd_AutodynDisable( manager );
-    Cudd_ForeachCube( manager, T, gen, gcube, gvalue ) {
-        initialize_cube( state, gcube, num_env+num_sys );
-        while (!saturated_cube( state, gcube, num_env+num_sys )) {
-
-            num_states++;
-            states = realloc( states, num_states*sizeof(vartype *) );
-            if (states == NULL) {
-                perror( "bounds_DDset, realloc" );
-                exit(-1);
-            }
-            *(states+num_states-1) = malloc( (num_env+num_sys)
-                                             *sizeof(vartype) );
-            if (*(states+num_states-1) == NULL) {
-                perror( "bounds_DDset, malloc" );
-                exit(-1);
-            }
-            for (i = 0; i < num_env+num_sys; i++)
-                *(*(states+num_states-1)+i) = *(state+i);
+    /* Copy of the projection of G onto metric variables, using primed
+       variables */
+    tmp = Cudd_bddExistAbstract( manager, G, cube );
+    Cudd_Ref( tmp );
+    tmp2 = Cudd_bddSwapVariables( manager, tmp, mvars, pmvars, num_mvars );
+    Cudd_Ref( tmp2 );
+    Cudd_RecursiveDeref( manager, tmp );
+    Cudd_RecursiveDeref( manager, cube );
+
+    /* Distance from each state to the nearest state in G, obtained by
+       taking the minimum over each primed metric variable in turn */
+    dist = metric_dist_ADD( manager, offw, num_metric_vars,
+                            NULL, num_env+num_sys );
+    tmp = Cudd_BddToAdd( manager, tmp2 );
+    Cudd_Ref( tmp );
+    Cudd_RecursiveDeref( manager, tmp2 );
+    tmp2 = Cudd_addIte( manager, tmp, dist, Cudd_ReadPlusInfinity( manager ) );
+    Cudd_Ref( tmp2 );
+    Cudd_RecursiveDeref( manager, tmp );
+    Cudd_RecursiveDeref( manager, dist );
+    dist = tmp2;
+    for (k = num_env+num_sys; k < 2*(num_env+num_sys); k++) {
+        if (!*(is_metric+k-num_env-num_sys))
+            continue;
+        tmp = Cudd_addCompose( manager, dist, Cudd_ReadZero( manager ), k );
+        Cudd_Ref( tmp );
+        tmp2 = Cudd_addCompose( manager, dist, Cudd_ReadOne( manager ), k );
+        Cudd_Ref( tmp2 );
+        Cudd_RecursiveDeref( manager, dist );
+        dist = Cudd_addApply( manager, Cudd_addMinimum, tmp, tmp2 );
+        Cudd_Ref( dist );
+        Cudd_RecursiveDeref( manager, tmp );
+        Cudd_RecursiveDeref( manager, tmp2 );
+    }
 
-            increment_cube( state, gcube, num_env+num_sys );
-        }
+    free( is_metric );
+    free( mvars );
+    free( pmvars );
+    return dist;
+}
 
-        num_states++;
-        states = realloc( states, num_states*sizeof(vartype *) );
-        if (states == NULL) {
-            perror( "bounds_DDset, realloc" );
-            exit(-1);
-        }
 
-        *(states+num_states-1) = malloc( (num_env+num_sys)*sizeof(vartype) );
-        if (*(states+num_states-1) == NULL) {
-            perror( "bounds_DDset, malloc" );
-            exit(-1);
-        }
-        for (i = 0; i < num_env+num_sys; i++)
-            *(*(states+num_states-1)+i) = *(state+i);
+int bounds_DDset( DdManager *manager, DdNode *T, DdNode *G,
+                  int *offw, int num_metric_vars,
+                  double *Min, double *Max, unsigned char verbose )
+{
+    DdNode *dist;
 
-    }
-    Cudd_AutodynEnable( manager, CUDD_REORDER_SAME );
+    *Min = *Max = -1.;  /* Distance is non-negative; thus use -1 as "unset". */
+    if (T == Cudd_Not( Cudd_ReadOne( manager ) )
+        || G == Cudd_Not( Cudd_ReadOne( manager ) ))
+        return 0;
 
-    mapped_state = malloc( num_metric_vars*sizeof(int) );
-    if (mapped_state == NULL) {
-        perror( "bounds_DDset, malloc" );
-        exit(-1);
-    }
-    for (k = 0; k < num_states; k++) {
-        bounds_state( manager, G, *(states+k), offw, num_metric_vars,
-                      &tMin, &tMax, verbose );
-        if (*Min == -1. || tMin < *Min)
-            *Min = tMin;
-        if (*Max == -1. || tMin > *Max)
-            *Max = tMin;
-
-        if (verbose > 1) {
-            for (i = 0; i < num_metric_vars; i++)
-                *(mapped_state+i) = bitvec_to_int( *(states+k)+(*(offw+2*i)),
-                                                   *(offw+2*i+1) );
-            logprint_startline();
-            logprint_raw( "\t" );
-            for (i = 0; i < num_metric_vars; i++)
-                logprint_raw( "%d, ", *(mapped_state+i) );
-            logprint_raw( "mi = %f", tMin );
-            logprint_endline();
-        }
-    }
+    dist = dist_to_set_ADD( manager, G, offw, num_metric_vars );
+    minmax_on_set( manager, dist, T, Min, Max );
+    Cudd_RecursiveDeref( manager, dist );
+    if (verbose > 1)
+        logprint( "bounds_DDset: distance to goal set is from %f to %f",
+                  *Min, *Max );
 
-    free( mapped_state );
-    for (i = 0; i < num_states; i++)
-        free( *(states+i) );
-    free( states );
-    free( state );
     return 0;
 }
 
@@ -328,12 +347,12 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
 
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    (*etrans) = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    (*etrans) = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    (*strans) = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    (*strans) = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
     if (verbose > 1)
         logprint( "Done." );
 
@@ -341,14 +360,16 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
     if (spc.num_egoals > 0) {
         (*egoals) = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *((*egoals)+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *((*egoals)+i) = ptree_BDD_symtab( *(spc.env_goals+i),
+                                               spc.var_st, manager );
     } else {
         (*egoals) = NULL;
     }
     if (spc.num_sgoals > 0) {
         (*sgoals) = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *((*sgoals)+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *((*sgoals)+i) = ptree_BDD_symtab( *(spc.sys_goals+i),
+                                               spc.var_st, manager );
     } else {
         (*sgoals) = NULL;
     }
@@ -359,9 +380,17 @@ DdNode *compute_winning_set_saveBDDs( DdManager *manager,
         var_separator->left = NULL;
     }
 
+    W = rcache_load_winning( manager );
+    if (W != NULL) {
+        if (verbose)
+            logprint( "Loaded winning set from result cache." );
+        return W;
+    }
     W = compute_winning_set_BDD( manager,
                                  (*etrans), (*strans), (*egoals), (*sgoals),
                                  verbose );
+    if (W != NULL && rcache_enabled())
+        rcache_save_winning( manager, W );
     if (W == NULL) {
         fprintf( stderr,
                  "Error compute_winning_set_saveBDDs: failed to construct"
@@ -391,47 +420,66 @@ int compute_minmax( DdManager *manager,DdNode **W,
 
     *W = compute_winning_set_saveBDDs( manager, etrans, strans, &egoals, sgoals,
                                        verbose );
-    Y = compute_sublevel_sets( manager, *W, (*etrans), (*strans),
-                               egoals, spc.num_egoals,
-                               (*sgoals), spc.num_sgoals,
-                               num_sublevels, &X_ijr, verbose );
+    Y = rcache_load_sublevels( manager, spc.num_egoals, spc.num_sgoals,
+                               num_sublevels, NULL );
+    if (Y != NULL) {
+        if (verbose)
+            logprint( "Loaded sublevel sets from result cache." );
+    } else {
+        Y = compute_sublevel_sets( manager, *W, (*etrans), (*strans),
+                                   egoals, spc.num_egoals,
+                                   (*sgoals), spc.num_sgoals,
+                                   num_sublevels, &X_ijr, verbose );
+        if (Y != NULL && rcache_enabled())
+            rcache_save_sublevels( manager, Y, X_ijr, *num_sublevels,
+                                   spc.num_egoals, spc.num_sgoals );
+    }
     if (Y == NULL) {
         fprintf( stderr,
                  "Error compute_minmax: failed to construct sublevel sets.\n" );
         return -1;
     }
 
-    *Min = malloc( spc.num_sgoals*sizeof(double *) );
-    *Max = malloc( spc.num_sgoals*sizeof(double *) );
-    if (*Min == NULL || *Max == NULL) {
-        perror( "compute_minmax, malloc" );
-        exit(-1);
-    }
-
-    for (i = 0; i < spc.num_sgoals; i++) {
-        *(*Min + i) = malloc( (*(*num_sublevels+i)-1)*sizeof(double) );
-        *(*Max + i) = malloc( (*(*num_sublevels+i)-1)*sizeof(double) );
-        if (*(*Min + i) == NULL || *(*Max + i) == NULL) {
+    if (!rcache_load_minmax( manager, offw, num_metric_vars,
+                             spc.num_sgoals, *num_sublevels, Min, Max )) {
+        if (verbose)
+            logprint( "Loaded distance bounds from result cache." );
+    } else {
+        *Min = malloc( spc.num_sgoals*sizeof(double *) );
+        *Max = malloc( spc.num_sgoals*sizeof(double *) );
+        if (*Min == NULL || *Max == NULL) {
             perror( "compute_minmax, malloc" );
             exit(-1);
         }
 
-        *(*(*Min+i)) = *(*(*Max+i)) = 0;
-        for (j = 1; j < *(*num_sublevels+i)-1; j++) {
-            if (verbose > 1)
-                logprint( "goal %d, level %d...", i, j );
-            tmp = Cudd_bddAnd( manager,
-                               *(*(Y+i)+j+1), Cudd_Not( *(*(Y+i)+j) ) );
-            Cudd_Ref( tmp );
-            tmp2 = Cudd_bddAnd( manager, *((*sgoals)+i), *W );
-            Cudd_Ref( tmp2 );
-            if (bounds_DDset( manager, tmp, tmp2, offw, num_metric_vars,
-                              *(*Min+i)+j, *(*Max+i)+j, verbose )) {
-                *(*(*Min+i)+j) = *(*(*Max+i)+j) = -1.;
+        for (i = 0; i < spc.num_sgoals; i++) {
+            *(*Min + i) = malloc( (*(*num_sublevels+i)-1)*sizeof(double) );
+            *(*Max + i) = malloc( (*(*num_sublevels+i)-1)*sizeof(double) );
+            if (*(*Min + i) == NULL || *(*Max + i) == NULL) {
+                perror( "compute_minmax, malloc" );
+                exit(-1);
+            }
+
+            *(*(*Min+i)) = *(*(*Max+i)) = 0;
+            for (j = 1; j < *(*num_sublevels+i)-1; j++) {
+                if (verbose > 1)
+                    logprint( "goal %d, level %d...", i, j );
+                tmp = Cudd_bddAnd( manager,
+                                   *(*(Y+i)+j+1), Cudd_Not( *(*(Y+i)+j) ) );
+                Cudd_Ref( tmp );
+                tmp2 = Cudd_bddAnd( manager, *((*sgoals)+i), *W );
+                Cudd_Ref( tmp2 );
+                if (bounds_DDset( manager, tmp, tmp2, offw, num_metric_vars,
+                                  *(*Min+i)+j, *(*Max+i)+j, verbose )) {
+                    *(*(*Min+i)+j) = *(*(*Max+i)+j) = -1.;
+                }
+                Cudd_RecursiveDeref( manager, tmp );
+                Cudd_RecursiveDeref( manager, tmp2 );
             }
-            Cudd_RecursiveDeref( manager, tmp );
-            Cudd_RecursiveDeref( manager, tmp2 );
         }
+        if (rcache_enabled())
+            rcache_save_minmax( manager, offw, num_metric_vars,
+                                spc.num_sgoals, *num_sublevels, *Min, *Max );
     }
 
 
@@ -444,6 +492,8 @@ int compute_minmax( DdManager *manager,DdNode **W,
     for (i = 0; i < spc.num_sgoals; i++) {
         for (j = 0; j < *(*num_sublevels+i); j++) {
             Cudd_RecursiveDeref( manager, *(*(Y+i)+j) );
+            if (X_ijr == NULL)  /* Y was loaded from the result cache */
+                continue;
             for (r = 0; r < spc.num_egoals; r++) {
                 Cudd_RecursiveDeref( manager, *(*(*(X_ijr+i)+j)+r) );
             }
@@ -451,7 +501,8 @@ int compute_minmax( DdManager *manager,DdNode **W,
         }
         if (*(*num_sublevels+i) > 0) {
             free( *(Y+i) );
-            free( *(X_ijr+i) );
+            if (X_ijr != NULL)
+                free( *(X_ijr+i) );
         }
     }
     if (env_nogoal_flag) {
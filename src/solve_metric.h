@@ -22,6 +22,14 @@
    linked.  get_offsets_list() is a more general version. */
 int *get_offsets( char *metric_vars, int *num_vars );
 
+/** Return ADD of the distance from each state to the nearest state in
+   G, over the metric variables given by offw (cf. get_offsets()).  The
+   value is plus infinity if G is empty.  The result is referenced.
+   E.g., evaluating it at a state gives the minimum computed by
+   bounds_state() for the state and the set G. */
+DdNode *dist_to_set_ADD( DdManager *manager, DdNode *G,
+                         int *offw, int num_metric_vars );
+
 /** G is the goal set against which to measure distance.
    Result is written into given variables Min and Max;
    return 0 on success, -1 error. */
@@ -13,9 +13,9 @@
 #include "logging.h"
 #include "solve.h"
 #include "solve_support.h"
-
-
-extern specification_t spc;
+#include "checkpoint.h"
+#include "resultcache.h"
+#include "context.h"
 
 
 DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
@@ -26,6 +26,15 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
     DdNode *etrans, *strans, **egoals, **sgoals;
     bool env_nogoal_flag = False;  /* Indicate environment has no goals */
 
+    if (rcache_enabled()) {
+        W = rcache_load_winning( manager );
+        if (W != NULL) {
+            if (verbose)
+                logprint( "Loaded winning set from result cache." );
+            return W;
+        }
+    }
+
     /* Set environment goal to True (i.e., any state) if none was
        given. This simplifies the implementation below. */
     if (spc.num_egoals == 0) {
@@ -55,12 +64,29 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
     /* Generate BDDs for the various parse trees from the problem spec. */
     if (verbose > 1)
         logprint( "Building environment transition BDD..." );
-    etrans = ptree_BDD( spc.env_trans, spc.evar_list, manager );
+    if (rcache_enabled()) {
+        /* Reuse BDDs of unchanged components; cf. resultcache.h */
+        etrans = rcache_conj_BDD( spc.env_trans_array, spc.et_array_len,
+                                  spc.var_st, manager );
+    } else {
+        etrans = ptree_BDD_symtab( spc.env_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Peak intermediate BDD size: %d",
+                      ptree_BDD_peak_size() );
+    }
     if (verbose > 1) {
         logprint( "Done." );
         logprint( "Building system transition BDD..." );
     }
-    strans = ptree_BDD( spc.sys_trans, spc.evar_list, manager );
+    if (rcache_enabled()) {
+        strans = rcache_conj_BDD( spc.sys_trans_array, spc.st_array_len,
+                                  spc.var_st, manager );
+    } else {
+        strans = ptree_BDD_symtab( spc.sys_trans, spc.var_st, manager );
+        if (verbose > 1)
+            logprint( "Peak intermediate BDD size: %d",
+                      ptree_BDD_peak_size() );
+    }
     if (verbose > 1)
         logprint( "Done." );
 
@@ -68,14 +94,16 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
     if (spc.num_egoals > 0) {
         egoals = malloc( spc.num_egoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_egoals; i++)
-            *(egoals+i) = ptree_BDD( *(spc.env_goals+i), spc.evar_list, manager );
+            *(egoals+i) = rcache_ptree_BDD( *(spc.env_goals+i),
+                                            spc.var_st, manager );
     } else {
         egoals = NULL;
     }
     if (spc.num_sgoals > 0) {
         sgoals = malloc( spc.num_sgoals*sizeof(DdNode *) );
         for (i = 0; i < spc.num_sgoals; i++)
-            *(sgoals+i) = ptree_BDD( *(spc.sys_goals+i), spc.evar_list, manager );
+            *(sgoals+i) = rcache_ptree_BDD( *(spc.sys_goals+i),
+                                            spc.var_st, manager );
     } else {
         sgoals = NULL;
     }
@@ -90,6 +118,8 @@ DdNode *compute_winning_set( DdManager *manager, unsigned char verbose )
 
     W = compute_winning_set_BDD( manager, etrans, strans, egoals, sgoals,
                                  verbose );
+    if (W != NULL && rcache_enabled())
+        rcache_save_winning( manager, W );
 
     Cudd_RecursiveDeref( manager, etrans );
     Cudd_RecursiveDeref( manager, strans );
@@ -115,6 +145,18 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
                                  DdNode *etrans, DdNode *strans,
                                  DdNode **egoals, DdNode **sgoals,
                                  unsigned char verbose )
+{
+    return compute_winning_set_BDD_seeded( manager, etrans, strans,
+                                           egoals, sgoals, NULL, NULL,
+                                           verbose );
+}
+
+
+DdNode *compute_winning_set_BDD_seeded( DdManager *manager,
+                                        DdNode *etrans, DdNode *strans,
+                                        DdNode **egoals, DdNode **sgoals,
+                                        DdNode *Z_init, DdNode *Y_init,
+                                        unsigned char verbose )
 {
     DdNode *X = NULL, *X_prev = NULL;
     DdNode *Y = NULL, *Y_exmod = NULL, *Y_prev = NULL;
@@ -124,6 +166,12 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
     /* Fixpoint iteration counters */
     int num_it_Z, num_it_Y, num_it_X;
 
+    /* For checkpoints; cf. checkpoint.h */
+    bool resumed = False;
+    DdNode **ckpt_f;
+    int ckpt_vals[3], *ckpt_loaded_vals, ckpt_len;
+    unsigned long ckpt_key;
+
     DdNode *tmp, *tmp2;
     int i, j;  /* Generic counters */
 
@@ -159,6 +207,19 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
     free( vars );
     free( pvars );
 
+    if (getsolverthreads() > 1 && !checkpoint_enabled()
+        && Z_init == NULL && Y_init == NULL
+        && (spc.num_sgoals > 1
+            || (spc.num_sgoals == 1 && spc.num_egoals > 1))) {
+        free( cube );
+        return compute_winning_set_BDD_parallel( manager, etrans, strans,
+                                                 egoals, spc.num_egoals,
+                                                 sgoals, spc.num_sgoals,
+                                                 num_env, num_sys,
+                                                 getsolverthreads(),
+                                                 verbose );
+    }
+
     if (spc.num_sgoals > 0) {
         Z = malloc( spc.num_sgoals*sizeof(DdNode *) );
         Z_prev = malloc( spc.num_sgoals*sizeof(DdNode *) );
@@ -168,49 +229,122 @@ DdNode *compute_winning_set_BDD( DdManager *manager,
         }
     }
 
-    /* Initialize */
-    for (i = 0; i < spc.num_sgoals; i++) {
-        *(Z+i) = Cudd_ReadOne( manager );
-        Cudd_Ref( *(Z+i) );
+    /* Initialize, possibly from a checkpoint saved at the beginning of
+       some Y iteration.  The saved BDDs are Z_prev[0..num_sgoals-1],
+       Z[0..i], and Y; the saved integers are num_it_Z, i, and num_it_Y. */
+    ckpt_key = checkpoint_gamekey( etrans, strans, egoals, spc.num_egoals,
+                                   sgoals, spc.num_sgoals, NULL, 0 );
+    ckpt_len = checkpoint_load( manager, "winning", ckpt_key, &ckpt_f,
+                                &ckpt_loaded_vals, &j );
+    if (ckpt_len >= 0) {
+        if (j == 3 && *(ckpt_loaded_vals+1) >= 0
+            && *(ckpt_loaded_vals+1) < spc.num_sgoals
+            && ckpt_len == spc.num_sgoals + *(ckpt_loaded_vals+1) + 2) {
+            resumed = True;
+            num_it_Z = *ckpt_loaded_vals;
+            for (i = 0; i < spc.num_sgoals; i++) {
+                *(Z_prev+i) = *(ckpt_f+i);
+                if (i <= *(ckpt_loaded_vals+1)) {
+                    *(Z+i) = *(ckpt_f+spc.num_sgoals+i);
+                } else {
+                    *(Z+i) = *(Z_prev+i);
+                }
+            }
+            Y = *(ckpt_f+ckpt_len-1);
+            num_it_Y = *(ckpt_loaded_vals+2);
+            if (verbose)
+                logprint( "Resuming from checkpoint at Z iteration %d,"
+                          " system goal %d, Y iteration %d.",
+                          num_it_Z, *(ckpt_loaded_vals+1), num_it_Y+1 );
+        } else {
+            fprintf( stderr,
+                     "Warning: ignoring checkpoint with unexpected"
+                     " contents.\n" );
+            for (i = 0; i < ckpt_len; i++)
+                Cudd_RecursiveDeref( manager, *(ckpt_f+i) );
+            free( ckpt_loaded_vals );
+        }
+        free( ckpt_f );
+    }
+    if (!resumed) {
+        for (i = 0; i < spc.num_sgoals; i++) {
+            *(Z+i) = (Z_init != NULL) ? Z_init : Cudd_ReadOne( manager );
+            Cudd_Ref( *(Z+i) );
+        }
+        num_it_Z = 0;
     }
 
-    num_it_Z = 0;
     do {
-        num_it_Z++;
-        if (verbose > 1) {
-            logprint( "Z iteration %d", num_it_Z );
-            logprint( "Cudd_ReadMemoryInUse (bytes): %d",
-                      Cudd_ReadMemoryInUse( manager ) );
-        }
+        if (!resumed) {
+            num_it_Z++;
+            if (verbose > 1) {
+                logprint( "Z iteration %d", num_it_Z );
+                logprint( "Cudd_ReadMemoryInUse (bytes): %d",
+                          Cudd_ReadMemoryInUse( manager ) );
+            }
 
-        for (i = 0; i < spc.num_sgoals; i++) {
-            if (*(Z_prev+i) != NULL)
-                Cudd_RecursiveDeref( manager, *(Z_prev+i) );
-            *(Z_prev+i) = *(Z+i);
+            for (i = 0; i < spc.num_sgoals; i++) {
+                if (*(Z_prev+i) != NULL)
+                    Cudd_RecursiveDeref( manager, *(Z_prev+i) );
+                *(Z_prev+i) = *(Z+i);
+            }
         }
 
-        for (i = 0; i < spc.num_sgoals; i++) {
-            if (i == spc.num_sgoals-1) {
-                *(Z+i) = compute_existsmodal( manager, *Z_prev, etrans, strans,
-                                              num_env, num_sys, cube );
+        for (i = (resumed ? *(ckpt_loaded_vals+1) : 0);
+             i < spc.num_sgoals; i++) {
+            if (resumed) {
+                /* Z_i and Y were restored from the checkpoint. */
+                resumed = False;
+                free( ckpt_loaded_vals );
             } else {
-                *(Z+i) = compute_existsmodal( manager, *(Z_prev+i+1),
-                                              etrans, strans, num_env, num_sys,
-                                              cube );
-            }
-            if (*(Z+i) == NULL) {
-                /* fatal error */
-                return NULL;
-            }
+                if (i == spc.num_sgoals-1) {
+                    *(Z+i) = compute_existsmodal( manager, *Z_prev,
+                                                  etrans, strans,
+                                                  num_env, num_sys, cube );
+                } else {
+                    *(Z+i) = compute_existsmodal( manager, *(Z_prev+i+1),
+                                                  etrans, strans,
+                                                  num_env, num_sys, cube );
+                }
+                if (*(Z+i) == NULL) {
+                    /* fatal error */
+                    return NULL;
+                }
 
-            /* (Re)initialize Y */
-            if (Y != NULL)
-                Cudd_RecursiveDeref( manager, Y );
-            Y = Cudd_Not( Cudd_ReadOne( manager ) );
-            Cudd_Ref( Y );
+                /* (Re)initialize Y */
+                if (Y != NULL)
+                    Cudd_RecursiveDeref( manager, Y );
+                Y = (Y_init != NULL) ? Y_init : Cudd_Not( Cudd_ReadOne( manager ) );
+                Cudd_Ref( Y );
 
-            num_it_Y = 0;
+                num_it_Y = 0;
+            }
             do {
+                if (checkpoint_due()) {
+                    ckpt_f = malloc( (spc.num_sgoals+i+2)*sizeof(DdNode *) );
+                    if (ckpt_f == NULL) {
+                        perror( "compute_winning_set_BDD, malloc" );
+                        exit(-1);
+                    }
+                    for (j = 0; j < spc.num_sgoals; j++)
+                        *(ckpt_f+j) = *(Z_prev+j);
+                    for (j = 0; j <= i; j++)
+                        *(ckpt_f+spc.num_sgoals+j) = *(Z+j);
+                    *(ckpt_f+spc.num_sgoals+i+1) = Y;
+                    *ckpt_vals = num_it_Z;
+                    *(ckpt_vals+1) = i;
+                    *(ckpt_vals+2) = num_it_Y;
+                    if (checkpoint_save( manager, "winning", ckpt_key,
+                                         ckpt_f, spc.num_sgoals+i+2,
+                                         ckpt_vals, 3 )) {
+                        fprintf( stderr,
+                                 "Warning: failed to save checkpoint.\n" );
+                    } else if (verbose > 1) {
+                        logprint( "Saved checkpoint." );
+                    }
+                    free( ckpt_f );
+                }
+
                 num_it_Y++;
                 if (verbose > 1) {
                     logprint( "\tY iteration %d", num_it_Y );
@@ -352,14 +486,27 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                                  unsigned char verbose )
 {
     DdNode ***Y = NULL, *Y_exmod = NULL;
-    DdNode *X = NULL, *X_prev = NULL;
+    DdNode *X = NULL;
+    DdNode ****X_local = NULL;  /* Used if X_ijr = NULL */
+    bool keep_X = True;
+
+    /* For checkpoints; cf. checkpoint.h */
+    int i_start = 0;
+    DdNode **ckpt_f;
+    int *ckpt_vals, ckpt_len, ckpt_vals_len, k;
+    unsigned long ckpt_key;
 
     DdNode **vars, **pvars;
     int num_env, num_sys;
     int *cube;
 
-    DdNode *tmp, *tmp2;
-    int i, r;
+    DdNode *tmp;
+    int i, j, r;
+
+    if (X_ijr == NULL) {
+        keep_X = False;
+        X_ijr = &X_local;
+    }
 
     num_env = tree_size( spc.evar_list );
     num_sys = tree_size( spc.svar_list );
@@ -421,8 +568,12 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                 exit(-1);
             }
             for (r = 0; r < num_env_goals; r++) {
-                *(**(*X_ijr+i) + r) = Cudd_Not( Cudd_ReadOne( manager ) );
-                Cudd_Ref( *(**(*X_ijr+i) + r) );
+                if (keep_X) {
+                    *(**(*X_ijr+i) + r) = Cudd_Not( Cudd_ReadOne( manager ) );
+                    Cudd_Ref( *(**(*X_ijr+i) + r) );
+                } else {
+                    *(**(*X_ijr+i) + r) = NULL;
+                }
             }
         }
     } else {
@@ -430,9 +581,119 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
         return NULL;
     }
 
+    /* Possibly resume from a checkpoint saved at the beginning of some
+       iteration below.  The saved BDDs are, for each system goal up to
+       and including the current one, the sublevel sets in order, each
+       followed by its X sets if those are kept.  The saved integers are
+       keep_X, the current system goal, and the numbers of sublevels. */
+    ckpt_key = checkpoint_gamekey( etrans, strans, egoals, num_env_goals,
+                                   sgoals, num_sys_goals, &W, 1 );
+    ckpt_len = checkpoint_load( manager, "sublevel", ckpt_key, &ckpt_f,
+                                &ckpt_vals, &ckpt_vals_len );
+    if (ckpt_len >= 0) {
+        k = 0;
+        if (ckpt_vals_len >= 3 && *ckpt_vals == (keep_X ? 1 : 0)
+            && *(ckpt_vals+1) >= 0 && *(ckpt_vals+1) < num_sys_goals
+            && ckpt_vals_len == *(ckpt_vals+1) + 3) {
+            for (i = 0; i <= *(ckpt_vals+1); i++) {
+                if (*(ckpt_vals+2+i) < 1) {
+                    k = -1;
+                    break;
+                }
+                k += *(ckpt_vals+2+i)*(1 + (keep_X ? num_env_goals : 0));
+            }
+        } else {
+            k = -1;
+        }
+        if (k != ckpt_len) {
+            fprintf( stderr,
+                     "Warning: ignoring checkpoint with unexpected"
+                     " contents.\n" );
+            for (k = 0; k < ckpt_len; k++)
+                Cudd_RecursiveDeref( manager, *(ckpt_f+k) );
+        } else {
+            i_start = *(ckpt_vals+1);
+            if (verbose)
+                logprint( "Resuming from checkpoint at system goal %d,"
+                          " sublevel %d.",
+                          i_start, *(ckpt_vals+2+i_start) );
+            k = 0;
+            for (i = 0; i <= i_start; i++) {
+                Cudd_RecursiveDeref( manager, **(Y+i) );
+                for (r = 0; r < num_env_goals && keep_X; r++)
+                    Cudd_RecursiveDeref( manager, *(**(*X_ijr+i) + r) );
+                free( **(*X_ijr+i) );
+
+                *(*num_sublevels+i) = *(ckpt_vals+2+i);
+                *(Y+i) = realloc( *(Y+i),
+                                  *(*num_sublevels+i)*sizeof(DdNode *) );
+                *(*X_ijr+i) = realloc( *(*X_ijr+i),
+                                       *(*num_sublevels+i)*sizeof(DdNode **) );
+                if (*(Y+i) == NULL || *(*X_ijr+i) == NULL) {
+                    perror( "compute_sublevel_sets, realloc" );
+                    exit(-1);
+                }
+                for (j = 0; j < *(*num_sublevels+i); j++) {
+                    *(*(Y+i)+j) = *(ckpt_f+k);
+                    k++;
+                    *(*(*X_ijr+i)+j) = malloc( num_env_goals*sizeof(DdNode *) );
+                    if (*(*(*X_ijr+i)+j) == NULL) {
+                        perror( "compute_sublevel_sets, malloc" );
+                        exit(-1);
+                    }
+                    for (r = 0; r < num_env_goals; r++) {
+                        if (keep_X) {
+                            *(*(*(*X_ijr+i)+j) + r) = *(ckpt_f+k);
+                            k++;
+                        } else {
+                            *(*(*(*X_ijr+i)+j) + r) = NULL;
+                        }
+                    }
+                }
+            }
+        }
+        free( ckpt_f );
+        free( ckpt_vals );
+    }
+
     /* Build list of Y_i sets from iterations of the fixpoint formula. */
-    for (i = 0; i < num_sys_goals; i++) {
+    for (i = i_start; i < num_sys_goals; i++) {
         while (True) {
+            if (checkpoint_due()) {
+                ckpt_vals = malloc( (i+3)*sizeof(int) );
+                ckpt_len = 0;
+                for (k = 0; k <= i; k++)
+                    ckpt_len += *(*num_sublevels+k)*(1 + (keep_X ?
+                                                          num_env_goals : 0));
+                ckpt_f = malloc( ckpt_len*sizeof(DdNode *) );
+                if (ckpt_vals == NULL || ckpt_f == NULL) {
+                    perror( "compute_sublevel_sets, malloc" );
+                    exit(-1);
+                }
+                *ckpt_vals = (keep_X ? 1 : 0);
+                *(ckpt_vals+1) = i;
+                ckpt_len = 0;
+                for (k = 0; k <= i; k++) {
+                    *(ckpt_vals+2+k) = *(*num_sublevels+k);
+                    for (j = 0; j < *(*num_sublevels+k); j++) {
+                        *(ckpt_f+ckpt_len) = *(*(Y+k)+j);
+                        ckpt_len++;
+                        for (r = 0; r < num_env_goals && keep_X; r++) {
+                            *(ckpt_f+ckpt_len) = *(*(*(*X_ijr+k)+j) + r);
+                            ckpt_len++;
+                        }
+                    }
+                }
+                if (checkpoint_save( manager, "sublevel", ckpt_key,
+                                     ckpt_f, ckpt_len, ckpt_vals, i+3 )) {
+                    fprintf( stderr, "Warning: failed to save checkpoint.\n" );
+                } else if (verbose > 1) {
+                    logprint( "Saved checkpoint." );
+                }
+                free( ckpt_f );
+                free( ckpt_vals );
+            }
+
             (*(*num_sublevels+i))++;
             *(Y+i) = realloc( *(Y+i), *(*num_sublevels+i)*sizeof(DdNode *) );
             *(*X_ijr+i) = realloc( *(*X_ijr+i),
@@ -454,53 +715,24 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                                            etrans, strans, num_env, num_sys,
                                            cube );
 
-            *(*(Y+i)+*(*num_sublevels+i)-1) = Cudd_Not(Cudd_ReadOne( manager ));
+            *(*(Y+i)+*(*num_sublevels+i)-1) = Cudd_Not( Cudd_ReadOne( manager ) );
             Cudd_Ref( *(*(Y+i)+*(*num_sublevels+i)-1) );
             for (r = 0; r < num_env_goals; r++) {
 
-                /* (Re)initialize X */
-                if (X != NULL)
-                    Cudd_RecursiveDeref( manager, X );
-                X = Cudd_ReadOne( manager );
-                Cudd_Ref( X );
-
-                /* Greatest fixpoint for X, for this env goal */
-                do {
-                    if (X_prev != NULL)
-                        Cudd_RecursiveDeref( manager, X_prev );
-                    X_prev = X;
-                    X = compute_existsmodal( manager, X_prev, etrans, strans,
-                                             num_env, num_sys, cube );
-                    if (X == NULL) {
-                        /* fatal error */
-                        return NULL;
-                    }
-
-                    tmp = Cudd_bddAnd( manager, *(sgoals+i), W );
-                    Cudd_Ref( tmp );
-                    tmp2 = Cudd_bddOr( manager, tmp, Y_exmod );
-                    Cudd_Ref( tmp2 );
-                    Cudd_RecursiveDeref( manager, tmp );
-
-                    tmp = Cudd_bddAnd( manager, X, Cudd_Not( *(egoals+r) ) );
-                    Cudd_Ref( tmp );
-                    Cudd_RecursiveDeref( manager, X );
-
-                    X = Cudd_bddOr( manager, tmp2, tmp );
-                    Cudd_Ref( X );
-                    Cudd_RecursiveDeref( manager, tmp );
-                    Cudd_RecursiveDeref( manager, tmp2 );
-
-                    tmp = X;
-                    X = Cudd_bddAnd( manager, X, X_prev );
-                    Cudd_Ref( X );
-                    Cudd_RecursiveDeref( manager, tmp );
-
-                } while (!(Cudd_bddLeq( manager, X, X_prev )
-                           *Cudd_bddLeq( manager, X_prev, X )));
+                X = compute_sublevel_X( manager, W, Y_exmod, etrans, strans,
+                                        *(egoals+r), *(sgoals+i),
+                                        num_env, num_sys, cube );
+                if (X == NULL) {
+                    /* fatal error */
+                    return NULL;
+                }
 
-                *(*(*(*X_ijr+i) + *(*num_sublevels+i)-1) + r) = X;
-                Cudd_Ref( *(*(*(*X_ijr+i) + *(*num_sublevels+i)-1) + r) );
+                if (keep_X) {
+                    *(*(*(*X_ijr+i) + *(*num_sublevels+i)-1) + r) = X;
+                    Cudd_Ref( *(*(*(*X_ijr+i) + *(*num_sublevels+i)-1) + r) );
+                } else {
+                    *(*(*(*X_ijr+i) + *(*num_sublevels+i)-1) + r) = NULL;
+                }
 
                 tmp = *(*(Y+i)+*(*num_sublevels+i)-1);
                 *(*(Y+i)+*(*num_sublevels+i)-1)
@@ -510,8 +742,6 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
 
                 Cudd_RecursiveDeref( manager, X );
                 X = NULL;
-                Cudd_RecursiveDeref( manager, X_prev );
-                X_prev = NULL;
             }
 
             tmp = *(*(Y+i)+*(*num_sublevels+i)-1);
@@ -526,10 +756,10 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
                 *Cudd_bddLeq( manager, *(*(Y+i)+*(*num_sublevels+i)-2),
                               *(*(Y+i)+*(*num_sublevels+i)-1) )) {
                 Cudd_RecursiveDeref( manager, *(*(Y+i)+*(*num_sublevels+i)-1) );
-                for (r = 0; r < num_env_goals; r++) {
+                for (r = 0; r < num_env_goals && keep_X; r++) {
                     Cudd_RecursiveDeref( manager, *(*(*(*X_ijr+i)
                                                       + *(*num_sublevels+i)-1)
-                                                    + r) );
+                                                              + r) );
                 }
                 free( *(*(*X_ijr+i) + *(*num_sublevels+i)-1) );
                 (*(*num_sublevels+i))--;
@@ -548,6 +778,66 @@ DdNode ***compute_sublevel_sets( DdManager *manager,
         Cudd_RecursiveDeref( manager, Y_exmod );
     }
 
+    if (!keep_X) {
+        for (i = 0; i < num_sys_goals; i++) {
+            for (j = 0; j < *(*num_sublevels+i); j++)
+                free( *(*(*X_ijr+i)+j) );
+            free( *(*X_ijr+i) );
+        }
+        free( *X_ijr );
+    }
+
     free( cube );
     return Y;
 }
+
+
+DdNode *compute_sublevel_X( DdManager *manager, DdNode *W, DdNode *Y_exmod,
+                            DdNode *etrans, DdNode *strans,
+                            DdNode *egoal, DdNode *sgoal,
+                            int num_env, int num_sys, int *cube )
+{
+    DdNode *X, *X_prev = NULL;
+    DdNode *tmp, *tmp2;
+
+    X = Cudd_ReadOne( manager );
+    Cudd_Ref( X );
+
+    /* Greatest fixpoint for X, for this env goal */
+    do {
+        if (X_prev != NULL)
+            Cudd_RecursiveDeref( manager, X_prev );
+        X_prev = X;
+        X = compute_existsmodal( manager, X_prev, etrans, strans,
+                                 num_env, num_sys, cube );
+        if (X == NULL) {
+            /* fatal error */
+            return NULL;
+        }
+
+        tmp = Cudd_bddAnd( manager, sgoal, W );
+        Cudd_Ref( tmp );
+        tmp2 = Cudd_bddOr( manager, tmp, Y_exmod );
+        Cudd_Ref( tmp2 );
+        Cudd_RecursiveDeref( manager, tmp );
+
+        tmp = Cudd_bddAnd( manager, X, Cudd_Not( egoal ) );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, X );
+
+        X = Cudd_bddOr( manager, tmp2, tmp );
+        Cudd_Ref( X );
+        Cudd_RecursiveDeref( manager, tmp );
+        Cudd_RecursiveDeref( manager, tmp2 );
+
+        tmp = X;
+        X = Cudd_bddAnd( manager, X, X_prev );
+        Cudd_Ref( X );
+        Cudd_RecursiveDeref( manager, tmp );
+
+    } while (!(Cudd_bddLeq( manager, X, X_prev )
+               *Cudd_bddLeq( manager, X_prev, X )));
+
+    Cudd_RecursiveDeref( manager, X_prev );
+    return X;
+}
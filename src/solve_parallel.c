@@ -0,0 +1,586 @@
+/* solve_parallel.c -- Computation of the winning set using several
+ *                     threads, each with its own CUDD manager.
+ *                     Also consider solve_operators.c
+ *
+ * In each iteration of the outermost (Z) fixpoint, the update of Z_i
+ * depends only on the sets Z_prev of the previous iteration, so the
+ * system goals can be processed concurrently.  If there is only one
+ * system goal, then within each Y iteration the X fixpoints of the
+ * environment goals are computed concurrently instead.
+ *
+ * CUDD managers cannot be shared among threads, so each worker has a
+ * manager with the same variables and variable order as the given
+ * manager, into which the transition and goal BDDs are copied once
+ * using Cudd_bddTransfer().  Inputs and results of each parallel step
+ * are copied by the calling thread while the workers are idle.
+ *
+ *
+ * SCL; 2015
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "logging.h"
+#include "solve.h"
+#include "solve_support.h"
+
+
+/* Number of threads for compute_winning_set_BDD(); cf. setsolverthreads() */
+int solver_threads = 1;
+
+/* Worker state */
+typedef struct {
+    DdManager *manager;
+    DdNode *etrans, *strans;
+    DdNode **egoals;  /* Copies of all environment goals */
+    DdNode **sgoals;  /* Copies of all system goals */
+    int *cube;
+
+    /* Problem dimensions, which are not read from spc because the
+       worker thread does not have the caller's context bound. */
+    int num_env, num_sys;
+    int num_egoals, num_sgoals;
+
+    /* Task for the next parallel step.  Goals k with k % stride ==
+       offset are processed.  Inputs are referenced in the worker manager
+       and are dereferenced by the calling thread. */
+    int offset, stride;
+    DdNode **Z_prev;  /* For per-system-goal steps, length num_sgoals */
+    DdNode *C, *Y_exmod;  /* For per-environment-goal steps */
+    int sgoal_index;
+
+    /* Results */
+    DdNode **Z;  /* Z_i of assigned system goals; others NULL */
+    DdNode *X_union;  /* Union of X sets of assigned environment goals */
+    int error;
+} par_worker_t;
+
+
+/* Create a worker with a manager as from par_manager_new(), and copy
+   the given BDDs into it.  Return NULL on error. */
+par_worker_t *par_worker_new( DdManager *manager,
+                              DdNode *etrans, DdNode *strans,
+                              DdNode **egoals, int num_egoals,
+                              DdNode **sgoals, int num_sgoals,
+                              int num_env, int num_sys );
+
+void par_worker_free( par_worker_t *w );
+
+/* Thread bodies for the two kinds of parallel steps. */
+void *par_sgoals_step( void *arg );
+void *par_egoals_step( void *arg );
+
+/* Run body on each of num_workers workers concurrently.  Return 0 on
+   success, -1 if a thread could not be created or a worker failed. */
+int par_run( par_worker_t **workers, int num_workers,
+             void *(*body)( void * ) );
+
+
+void setsolverthreads( int num_threads )
+{
+    solver_threads = (num_threads < 1) ? 1 : num_threads;
+}
+
+int getsolverthreads()
+{
+    return solver_threads;
+}
+
+
+DdNode *par_transfer( DdManager *src, DdManager *dest, DdNode *f )
+{
+    DdNode *g = Cudd_bddTransfer( src, dest, f );
+    if (g == NULL) {
+        fprintf( stderr, "Error par_transfer: Cudd_bddTransfer failed.\n" );
+        return NULL;
+    }
+    Cudd_Ref( g );
+    return g;
+}
+
+
+DdManager *par_manager_new( DdManager *manager, int num_env, int num_sys )
+{
+    DdManager *new_manager;
+    DdNode **vars, **pvars;
+    int *perm;
+    int i, num_vars;
+
+    num_vars = Cudd_ReadSize( manager );
+    new_manager = Cudd_Init( num_vars,
+                             0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+    if (new_manager == NULL) {
+        fprintf( stderr, "Error par_manager_new: Cudd_Init failed.\n" );
+        return NULL;
+    }
+    Cudd_SetMaxCacheHard( new_manager, (unsigned int)-1 );
+
+    /* Match the variable order, so that copying is cheap. */
+    perm = malloc( num_vars*sizeof(int) );
+    if (perm == NULL) {
+        perror( "par_manager_new, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_vars; i++)
+        *(perm+i) = Cudd_ReadInvPerm( manager, i );
+    if (!Cudd_ShuffleHeap( new_manager, perm ))
+        fprintf( stderr,
+                 "Warning par_manager_new: failed to match variable order.\n" );
+    free( perm );
+    Cudd_AutodynEnable( new_manager, CUDD_REORDER_SAME );
+
+    vars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    pvars = malloc( (num_env+num_sys)*sizeof(DdNode *) );
+    if (vars == NULL || pvars == NULL) {
+        perror( "par_manager_new, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_env+num_sys; i++) {
+        *(vars+i) = Cudd_bddIthVar( new_manager, i );
+        *(pvars+i) = Cudd_bddIthVar( new_manager, i+num_env+num_sys );
+    }
+    if (!Cudd_SetVarMap( new_manager, vars, pvars, num_env+num_sys )) {
+        fprintf( stderr,
+                 "Error: failed to define variable map in CUDD manager.\n" );
+        Cudd_Quit( new_manager );
+        new_manager = NULL;
+    }
+    free( vars );
+    free( pvars );
+    return new_manager;
+}
+
+
+par_worker_t *par_worker_new( DdManager *manager,
+                              DdNode *etrans, DdNode *strans,
+                              DdNode **egoals, int num_egoals,
+                              DdNode **sgoals, int num_sgoals,
+                              int num_env, int num_sys )
+{
+    par_worker_t *w;
+    bool error;
+    int i;
+
+    w = malloc( sizeof(par_worker_t) );
+    if (w == NULL) {
+        perror( "par_worker_new, malloc" );
+        exit(-1);
+    }
+    w->manager = par_manager_new( manager, num_env, num_sys );
+    if (w->manager == NULL) {
+        free( w );
+        return NULL;
+    }
+
+    w->num_env = num_env;
+    w->num_sys = num_sys;
+    w->num_egoals = num_egoals;
+    w->num_sgoals = num_sgoals;
+
+    w->cube = malloc( sizeof(int)*2*(num_env+num_sys) );
+    w->egoals = malloc( (num_egoals+1)*sizeof(DdNode *) );
+    w->sgoals = malloc( (num_sgoals+1)*sizeof(DdNode *) );
+    w->Z = malloc( (num_sgoals+1)*sizeof(DdNode *) );
+    if (w->cube == NULL
+        || w->egoals == NULL || w->sgoals == NULL || w->Z == NULL) {
+        perror( "par_worker_new, malloc" );
+        exit(-1);
+    }
+
+    w->Z_prev = NULL;
+    w->C = w->Y_exmod = w->X_union = NULL;
+    w->error = 0;
+
+    w->etrans = par_transfer( manager, w->manager, etrans );
+    w->strans = par_transfer( manager, w->manager, strans );
+    error = (w->etrans == NULL || w->strans == NULL);
+    for (i = 0; i < num_egoals; i++) {
+        *(w->egoals+i) = par_transfer( manager, w->manager, *(egoals+i) );
+        if (*(w->egoals+i) == NULL)
+            error = True;
+    }
+    for (i = 0; i < num_sgoals; i++) {
+        *(w->sgoals+i) = par_transfer( manager, w->manager, *(sgoals+i) );
+        if (*(w->sgoals+i) == NULL)
+            error = True;
+        *(w->Z+i) = NULL;
+    }
+    if (error) {
+        par_worker_free( w );
+        return NULL;
+    }
+
+    return w;
+}
+
+
+void par_worker_free( par_worker_t *w )
+{
+    int i;
+
+    /* Other BDDs that are still referenced, e.g., after an error,
+       are freed together with the manager. */
+    if (w->etrans != NULL)
+        Cudd_RecursiveDeref( w->manager, w->etrans );
+    if (w->strans != NULL)
+        Cudd_RecursiveDeref( w->manager, w->strans );
+    for (i = 0; i < w->num_egoals; i++) {
+        if (*(w->egoals+i) != NULL)
+            Cudd_RecursiveDeref( w->manager, *(w->egoals+i) );
+    }
+    for (i = 0; i < w->num_sgoals; i++) {
+        if (*(w->sgoals+i) != NULL)
+            Cudd_RecursiveDeref( w->manager, *(w->sgoals+i) );
+    }
+    free( w->Z_prev );
+    free( w->egoals );
+    free( w->sgoals );
+    free( w->Z );
+    free( w->cube );
+    Cudd_Quit( w->manager );
+    free( w );
+}
+
+
+int par_run( par_worker_t **workers, int num_workers,
+             void *(*body)( void * ) )
+{
+    pthread_t *threads;
+    int i, result = 0;
+
+    threads = malloc( num_workers*sizeof(pthread_t) );
+    if (threads == NULL) {
+        perror( "par_run, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_workers; i++) {
+        (*(workers+i))->error = 0;
+        if (pthread_create( threads+i, NULL, body, *(workers+i) )) {
+            fprintf( stderr, "Error par_run: failed to create thread.\n" );
+            /* Wait for those already started. */
+            num_workers = i;
+            result = -1;
+            break;
+        }
+    }
+    for (i = 0; i < num_workers; i++) {
+        pthread_join( *(threads+i), NULL );
+        if ((*(workers+i))->error)
+            result = -1;
+    }
+    free( threads );
+    return result;
+}
+
+
+void *par_sgoals_step( void *arg )
+{
+    par_worker_t *w = (par_worker_t *)arg;
+    DdManager *manager = w->manager;
+    DdNode *C, *X, *Y, *Y_prev, *Y_exmod, *tmp;
+    int i, j;
+
+    for (i = w->offset; i < w->num_sgoals; i += w->stride) {
+        C = compute_existsmodal( manager,
+                                 *(w->Z_prev+((i+1) % w->num_sgoals)),
+                                 w->etrans, w->strans,
+                                 w->num_env, w->num_sys, w->cube );
+        if (C == NULL) {
+            w->error = 1;
+            return NULL;
+        }
+
+        Y = Cudd_Not( Cudd_ReadOne( manager ) );
+        Cudd_Ref( Y );
+        do {
+            Y_prev = Y;
+            Y_exmod = compute_existsmodal( manager, Y_prev,
+                                           w->etrans, w->strans,
+                                           w->num_env, w->num_sys, w->cube );
+            if (Y_exmod == NULL) {
+                w->error = 1;
+                return NULL;
+            }
+
+            Y = Cudd_Not( Cudd_ReadOne( manager ) );
+            Cudd_Ref( Y );
+            for (j = 0; j < w->num_egoals; j++) {
+                X = compute_sublevel_X( manager, C, Y_exmod,
+                                        w->etrans, w->strans,
+                                        *(w->egoals+j), *(w->sgoals+i),
+                                        w->num_env, w->num_sys, w->cube );
+                if (X == NULL) {
+                    w->error = 1;
+                    return NULL;
+                }
+                tmp = Y;
+                Y = Cudd_bddOr( manager, Y, X );
+                Cudd_Ref( Y );
+                Cudd_RecursiveDeref( manager, tmp );
+                Cudd_RecursiveDeref( manager, X );
+            }
+            Cudd_RecursiveDeref( manager, Y_exmod );
+
+            tmp = Y;
+            Y = Cudd_bddOr( manager, Y, Y_prev );
+            Cudd_Ref( Y );
+            Cudd_RecursiveDeref( manager, tmp );
+            Cudd_RecursiveDeref( manager, Y_prev );
+        } while (!(Cudd_bddLeq( manager, Y, Y_prev )
+                   *Cudd_bddLeq( manager, Y_prev, Y )));
+
+        *(w->Z+i) = Cudd_bddAnd( manager, Y, *(w->Z_prev+i) );
+        Cudd_Ref( *(w->Z+i) );
+        Cudd_RecursiveDeref( manager, Y );
+        Cudd_RecursiveDeref( manager, C );
+    }
+
+    return NULL;
+}
+
+
+void *par_egoals_step( void *arg )
+{
+    par_worker_t *w = (par_worker_t *)arg;
+    DdManager *manager = w->manager;
+    DdNode *X, *tmp;
+    int j;
+
+    w->X_union = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( w->X_union );
+    for (j = w->offset; j < w->num_egoals; j += w->stride) {
+        X = compute_sublevel_X( manager, w->C, w->Y_exmod,
+                                w->etrans, w->strans,
+                                *(w->egoals+j), *(w->sgoals+w->sgoal_index),
+                                w->num_env, w->num_sys, w->cube );
+        if (X == NULL) {
+            w->error = 1;
+            return NULL;
+        }
+        tmp = w->X_union;
+        w->X_union = Cudd_bddOr( manager, w->X_union, X );
+        Cudd_Ref( w->X_union );
+        Cudd_RecursiveDeref( manager, tmp );
+        Cudd_RecursiveDeref( manager, X );
+    }
+
+    return NULL;
+}
+
+
+DdNode *compute_winning_set_BDD_parallel( DdManager *manager,
+                                          DdNode *etrans, DdNode *strans,
+                                          DdNode **egoals, int num_egoals,
+                                          DdNode **sgoals, int num_sgoals,
+                                          int num_env, int num_sys,
+                                          int num_threads,
+                                          unsigned char verbose )
+{
+    par_worker_t **workers;
+    int num_workers;
+    bool per_sgoal = (num_sgoals > 1);
+    DdNode **Z, **Z_prev;
+    DdNode *W = NULL;  /* Result, which remains NULL on error */
+    DdNode *C = NULL, *Y, *Y_prev, *Y_exmod, *X, *tmp;
+    int *cube;
+    bool Z_changed;
+    int num_it_Z = 0, num_it_Y;
+    int i, k;
+
+    num_workers = per_sgoal ? num_sgoals : num_egoals;
+    if (num_workers > num_threads)
+        num_workers = num_threads;
+    if (verbose)
+        logprint( "Computing winning set with %d threads, in parallel over"
+                  " %s goals.", num_workers,
+                  per_sgoal ? "system" : "environment" );
+
+    cube = malloc( sizeof(int)*2*(num_env+num_sys) );
+    workers = malloc( num_workers*sizeof(par_worker_t *) );
+    Z = malloc( num_sgoals*sizeof(DdNode *) );
+    Z_prev = malloc( num_sgoals*sizeof(DdNode *) );
+    if (cube == NULL || workers == NULL || Z == NULL || Z_prev == NULL) {
+        perror( "compute_winning_set_BDD_parallel, malloc" );
+        exit(-1);
+    }
+    for (i = 0; i < num_sgoals; i++)
+        *(Z+i) = *(Z_prev+i) = NULL;
+    for (k = 0; k < num_workers; k++) {
+        *(workers+k) = par_worker_new( manager, etrans, strans,
+                                       egoals, num_egoals,
+                                       sgoals, num_sgoals, num_env, num_sys );
+        if (*(workers+k) == NULL) {
+            num_workers = k;
+            goto gc;
+        }
+        (*(workers+k))->offset = k;
+        (*(workers+k))->stride = num_workers;
+        (*(workers+k))->Z_prev = malloc( num_sgoals*sizeof(DdNode *) );
+        if ((*(workers+k))->Z_prev == NULL) {
+            perror( "compute_winning_set_BDD_parallel, malloc" );
+            exit(-1);
+        }
+    }
+
+    for (i = 0; i < num_sgoals; i++) {
+        *(Z+i) = Cudd_ReadOne( manager );
+        Cudd_Ref( *(Z+i) );
+    }
+
+    do {
+        num_it_Z++;
+        if (verbose > 1) {
+            logprint( "Z iteration %d", num_it_Z );
+            logprint( "Cudd_ReadMemoryInUse (bytes): %d",
+                      Cudd_ReadMemoryInUse( manager ) );
+        }
+        for (i = 0; i < num_sgoals; i++) {
+            if (*(Z_prev+i) != NULL)
+                Cudd_RecursiveDeref( manager, *(Z_prev+i) );
+            *(Z_prev+i) = *(Z+i);
+            *(Z+i) = NULL;
+        }
+
+        /* On error, BDDs that are referenced in the managers of workers
+           are freed together with the managers; cf. par_worker_free(). */
+        if (per_sgoal) {
+            for (k = 0; k < num_workers; k++) {
+                for (i = 0; i < num_sgoals; i++) {
+                    *((*(workers+k))->Z_prev+i)
+                        = par_transfer( manager, (*(workers+k))->manager,
+                                        *(Z_prev+i) );
+                    if (*((*(workers+k))->Z_prev+i) == NULL)
+                        goto gc;
+                }
+            }
+            if (par_run( workers, num_workers, par_sgoals_step ))
+                goto gc;
+            for (k = 0; k < num_workers; k++) {
+                for (i = 0; i < num_sgoals; i++)
+                    Cudd_RecursiveDeref( (*(workers+k))->manager,
+                                         *((*(workers+k))->Z_prev+i) );
+                for (i = k; i < num_sgoals; i += num_workers) {
+                    *(Z+i) = par_transfer( (*(workers+k))->manager, manager,
+                                           *((*(workers+k))->Z+i) );
+                    Cudd_RecursiveDeref( (*(workers+k))->manager,
+                                         *((*(workers+k))->Z+i) );
+                    *((*(workers+k))->Z+i) = NULL;
+                    if (*(Z+i) == NULL)
+                        goto gc;
+                }
+            }
+
+        } else {  /* One system goal; parallel over environment goals */
+            C = compute_existsmodal( manager, *Z_prev, etrans, strans,
+                                     num_env, num_sys, cube );
+            if (C == NULL)
+                goto gc;
+            for (k = 0; k < num_workers; k++) {
+                (*(workers+k))->C = par_transfer( manager,
+                                                  (*(workers+k))->manager, C );
+                if ((*(workers+k))->C == NULL)
+                    goto gc;
+                (*(workers+k))->sgoal_index = 0;
+            }
+
+            Y = Cudd_Not( Cudd_ReadOne( manager ) );
+            Cudd_Ref( Y );
+            num_it_Y = 0;
+            do {
+                num_it_Y++;
+                if (verbose > 1)
+                    logprint( "\tY iteration %d", num_it_Y );
+                Y_prev = Y;
+                Y_exmod = compute_existsmodal( manager, Y_prev,
+                                               etrans, strans,
+                                               num_env, num_sys, cube );
+                if (Y_exmod == NULL) {
+                    Cudd_RecursiveDeref( manager, Y_prev );
+                    goto gc;
+                }
+                for (k = 0; k < num_workers; k++) {
+                    (*(workers+k))->Y_exmod
+                        = par_transfer( manager, (*(workers+k))->manager,
+                                        Y_exmod );
+                    if ((*(workers+k))->Y_exmod == NULL) {
+                        Cudd_RecursiveDeref( manager, Y_exmod );
+                        Cudd_RecursiveDeref( manager, Y_prev );
+                        goto gc;
+                    }
+                }
+                Cudd_RecursiveDeref( manager, Y_exmod );
+
+                if (par_run( workers, num_workers, par_egoals_step )) {
+                    Cudd_RecursiveDeref( manager, Y_prev );
+                    goto gc;
+                }
+
+                Y = Y_prev;
+                Cudd_Ref( Y );
+                for (k = 0; k < num_workers; k++) {
+                    Cudd_RecursiveDeref( (*(workers+k))->manager,
+                                         (*(workers+k))->Y_exmod );
+                    X = par_transfer( (*(workers+k))->manager, manager,
+                                      (*(workers+k))->X_union );
+                    Cudd_RecursiveDeref( (*(workers+k))->manager,
+                                         (*(workers+k))->X_union );
+                    if (X == NULL) {
+                        Cudd_RecursiveDeref( manager, Y );
+                        Cudd_RecursiveDeref( manager, Y_prev );
+                        goto gc;
+                    }
+                    tmp = Y;
+                    Y = Cudd_bddOr( manager, Y, X );
+                    Cudd_Ref( Y );
+                    Cudd_RecursiveDeref( manager, tmp );
+                    Cudd_RecursiveDeref( manager, X );
+                }
+                Cudd_RecursiveDeref( manager, Y_prev );
+            } while (!(Cudd_bddLeq( manager, Y, Y_prev )
+                       *Cudd_bddLeq( manager, Y_prev, Y )));
+
+            for (k = 0; k < num_workers; k++)
+                Cudd_RecursiveDeref( (*(workers+k))->manager,
+                                     (*(workers+k))->C );
+            Cudd_RecursiveDeref( manager, C );
+            C = NULL;
+
+            *Z = Cudd_bddAnd( manager, Y, *Z_prev );
+            Cudd_Ref( *Z );
+            Cudd_RecursiveDeref( manager, Y );
+        }
+
+        Z_changed = False;
+        for (i = 0; i < num_sgoals; i++) {
+            if (!(Cudd_bddLeq( manager, *(Z+i), *(Z_prev+i) )
+                  *Cudd_bddLeq( manager, *(Z_prev+i), *(Z+i) ))) {
+                Z_changed = True;
+                break;
+            }
+        }
+    } while (Z_changed);
+    W = *Z;
+    *Z = NULL;
+
+    /* Pre-exit clean-up, also on error */
+  gc:
+    for (k = 0; k < num_workers; k++)
+        par_worker_free( *(workers+k) );
+    free( workers );
+    if (C != NULL)
+        Cudd_RecursiveDeref( manager, C );
+    for (i = 0; i < num_sgoals; i++) {
+        if (*(Z+i) != NULL)
+            Cudd_RecursiveDeref( manager, *(Z+i) );
+        if (*(Z_prev+i) != NULL)
+            Cudd_RecursiveDeref( manager, *(Z_prev+i) );
+    }
+    free( Z );
+    free( Z_prev );
+    free( cube );
+
+    return W;
+}
@@ -355,3 +355,61 @@ DdNode *compute_existsmodal( DdManager *manager, DdNode *C,
     Cudd_RecursiveDeref( manager, tmp );
     return tmp2;
 }
+
+
+DdNode *compute_forward_reach( DdManager *manager, DdNode *init,
+                               DdNode *etrans, DdNode *strans,
+                               int num_env, int num_sys, int *cube )
+{
+    DdNode *R, *R_prev;
+    DdNode *trans, *tmp, *tmp2;
+    DdNode *ddcube;
+    int i;
+
+    /* Quantify over all unprimed variables. */
+    for (i = 0; i < num_env+num_sys; i++)
+        *(cube+i) = 1;
+    for (i = num_env+num_sys; i < 2*(num_env+num_sys); i++)
+        *(cube+i) = 2;
+    ddcube = Cudd_CubeArrayToBdd( manager, cube );
+    if (ddcube == NULL) {
+        fprintf( stderr,
+                 "compute_forward_reach: Error in generating cube for"
+                 " quantification." );
+        return NULL;
+    }
+    Cudd_Ref( ddcube );
+
+    trans = Cudd_bddAnd( manager, etrans, strans );
+    Cudd_Ref( trans );
+
+    R = init;
+    Cudd_Ref( R );
+    do {
+        R_prev = R;
+        tmp = Cudd_bddAndAbstract( manager, trans, R_prev, ddcube );
+        if (tmp == NULL) {
+            fprintf( stderr,
+                     "compute_forward_reach: Error in computing image." );
+            return NULL;
+        }
+        Cudd_Ref( tmp );
+        tmp2 = Cudd_bddVarMap( manager, tmp );
+        if (tmp2 == NULL) {
+            fprintf( stderr,
+                     "compute_forward_reach: Error in swapping variables"
+                     " with primed forms." );
+            return NULL;
+        }
+        Cudd_Ref( tmp2 );
+        Cudd_RecursiveDeref( manager, tmp );
+        R = Cudd_bddOr( manager, R_prev, tmp2 );
+        Cudd_Ref( R );
+        Cudd_RecursiveDeref( manager, tmp2 );
+        Cudd_RecursiveDeref( manager, R_prev );
+    } while (R != R_prev);
+
+    Cudd_RecursiveDeref( manager, trans );
+    Cudd_RecursiveDeref( manager, ddcube );
+    return R;
+}
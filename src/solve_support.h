@@ -73,5 +73,14 @@ DdNode *compute_existsmodal( DdManager *manager, DdNode *C,
                              DdNode *etrans, DdNode *strans,
                              int num_env, int num_sys, int *cube );
 
+/** Compute the set of states that are reachable from states in init
+   using transitions that satisfy both etrans and strans.  As for
+   compute_existsmodal(), the variable map for swapping primed and
+   unprimed forms must already be defined in the CUDD manager.  Return
+   the (referenced) characteristic function, or NULL on error. */
+DdNode *compute_forward_reach( DdManager *manager, DdNode *init,
+                               DdNode *etrans, DdNode *strans,
+                               int num_env, int num_sys, int *cube );
+
 
 #endif
@@ -160,6 +160,21 @@ ptree_t *expand_nonbool_variables( ptree_t **evar_list, ptree_t **svar_list,
 }
 
 
+symtab_t *vars_symtab( ptree_t *evar_list, ptree_t *svar_list )
+{
+    symtab_t *st;
+    ptree_t *var_separator;
+
+    if (evar_list == NULL)
+        return symtab_new( svar_list );
+    var_separator = get_list_item( evar_list, -1 );
+    var_separator->left = svar_list;
+    st = symtab_new( evar_list );
+    var_separator->left = NULL;
+    return st;
+}
+
+
 vartype *expand_nonbool_state( vartype *state, int *offw, int num_nonbool,
                                int mapped_len )
 {
@@ -335,8 +350,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                 if (verbose > 1)
                     logprint( "Expanding nonbool variable %s in SYSINIT...",
                               tmppt->name );
-                (*sys_init) = expand_to_bool( (*sys_init),
-                                              tmppt->name, tmppt->value );
+                (*sys_init) = mark_nonbool( (*sys_init),
+                                            tmppt->name, tmppt->value );
                 if ((*sys_init) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -350,8 +365,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                 if (verbose > 1)
                     logprint( "Expanding nonbool variable %s in ENVINIT...",
                               tmppt->name );
-                (*env_init) = expand_to_bool( (*env_init),
-                                              tmppt->name, tmppt->value );
+                (*env_init) = mark_nonbool( (*env_init),
+                                            tmppt->name, tmppt->value );
                 if ((*env_init) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -366,8 +381,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     logprint( "Expanding nonbool variable %s in ENVTRANS %d...",
                               tmppt->name, i );
                 *((*env_trans_array)+i)
-                    = expand_to_bool( *((*env_trans_array)+i),
-                                      tmppt->name, tmppt->value );
+                    = mark_nonbool( *((*env_trans_array)+i),
+                                    tmppt->name, tmppt->value );
                 if (*((*env_trans_array)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -382,8 +397,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     logprint( "Expanding nonbool variable %s in SYSTRANS %d...",
                               tmppt->name, i );
                 *((*sys_trans_array)+i)
-                    = expand_to_bool( *((*sys_trans_array)+i),
-                                      tmppt->name, tmppt->value );
+                    = mark_nonbool( *((*sys_trans_array)+i),
+                                    tmppt->name, tmppt->value );
                 if (*((*sys_trans_array)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -398,8 +413,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     logprint( "Expanding nonbool variable %s in ENVGOAL %d...",
                               tmppt->name, i );
                 *((*env_goals)+i)
-                    = expand_to_bool( *((*env_goals)+i),
-                                      tmppt->name, tmppt->value );
+                    = mark_nonbool( *((*env_goals)+i),
+                                    tmppt->name, tmppt->value );
                 if (*((*env_goals)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
@@ -414,8 +429,8 @@ int expand_nonbool_GR1( ptree_t *evar_list, ptree_t *svar_list,
                     logprint( "Expanding nonbool variable %s in SYSGOAL %d...",
                               tmppt->name, i );
                 *((*sys_goals)+i)
-                    = expand_to_bool( *((*sys_goals)+i),
-                                      tmppt->name, tmppt->value );
+                    = mark_nonbool( *((*sys_goals)+i),
+                                    tmppt->name, tmppt->value );
                 if (*((*sys_goals)+i) == NULL) {
                     fprintf( stderr,
                              "Error expand_nonbool_GR1: Failed to convert"
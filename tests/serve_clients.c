@@ -0,0 +1,104 @@
+/* Connect many clients at once to gr1c --socket PATH, for use by
+ * test-gr1c.sh.
+ *
+ * Usage: serve_clients PATH N
+ *
+ * All N clients are connected before any of them sends a request.  Then
+ * each sends a request with one query of the winning set and waits for
+ * the response, or for the server to close the connection.  The number
+ * of clients that received a complete response is printed to stdout.
+ *
+ * SCL; 2015
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/* Return 1 if a complete response frame is read from fd within 10
+   seconds, else 0. */
+int read_response( int fd )
+{
+    unsigned char buf[256];
+    size_t len = 0;
+    ssize_t num_read;
+    unsigned int frame_len;
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while (len < sizeof(buf)) {
+        if (poll( &pfd, 1, 10000 ) <= 0)
+            return 0;
+        num_read = read( fd, buf+len, sizeof(buf)-len );
+        if (num_read <= 0)
+            return 0;
+        len += num_read;
+        if (len >= 4) {
+            frame_len = ((unsigned int)buf[0] << 24)
+                | ((unsigned int)buf[1] << 16)
+                | ((unsigned int)buf[2] << 8) | (unsigned int)buf[3];
+            if (len >= 4+frame_len)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+
+int main( int argc, char **argv )
+{
+    /* Frame with the query: winning 0 0 0 ... */
+    unsigned char request[6] = {0, 0, 0, 2, 'w', 0};
+    struct sockaddr_un addr;
+    int *fds;
+    int num_clients, num_answered = 0;
+    int i;
+
+    if (argc != 3) {
+        fprintf( stderr, "Usage: %s PATH N\n", argv[0] );
+        return 1;
+    }
+    num_clients = strtol( argv[2], NULL, 10 );
+    if (num_clients < 1 || strlen( argv[1] ) >= sizeof(addr.sun_path)) {
+        fprintf( stderr, "Invalid arguments.\n" );
+        return 1;
+    }
+    signal( SIGPIPE, SIG_IGN );  /* Rejected clients may see EPIPE */
+    fds = malloc( num_clients*sizeof(int) );
+    if (fds == NULL) {
+        perror( "serve_clients, malloc" );
+        return 1;
+    }
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, argv[1] );
+    for (i = 0; i < num_clients; i++) {
+        *(fds+i) = socket( AF_UNIX, SOCK_STREAM, 0 );
+        if (*(fds+i) < 0
+            || connect( *(fds+i), (struct sockaddr *)&addr,
+                        sizeof(addr) ) < 0) {
+            perror( "serve_clients, connect" );
+            return 1;
+        }
+    }
+
+    for (i = 0; i < num_clients; i++) {
+        if (write( *(fds+i), request, sizeof(request) ) == sizeof(request))
+            num_answered += read_response( *(fds+i) );
+    }
+    for (i = 0; i < num_clients; i++)
+        close( *(fds+i) );
+    free( fds );
+
+    printf( "%d\n", num_answered );
+    return 0;
+}
@@ -24,14 +24,14 @@ fi
 # where the command is `gr1c ARGS` and if FILE is given, then the test
 # case fails if the file is found to already exist.  E.g., the
 # optional FILE is motivated to avoid naming collisions.
-for args in '-notoption' '-hh' '--00f' '-- rg  # where `rg` is not a file.;rg' 'f00f  # attempt to read from file that does not exist.;f00f'; do
+for args in '-notoption' '-hh' '--00f' '--resume' '--checkpoint' '--checkpoint-interval' '--checkpoint-interval 0' '--cache' '--cache-refresh' '--threads' '--threads 0' '-- rg  # where `rg` is not a file.;rg' 'f00f  # attempt to read from file that does not exist.;f00f'; do
     if test $VERBOSE -eq 1; then
         echo "\t gr1c ${args%%;*}"
     fi
     file=${args##*;}
     args=${args%%;*}
     if [ -n "${file}" ]; then
-        if [ -r ${file} ]; then
+        if [ -r "${file}" ]; then
             echo $PREFACE 'Local file `'${file}'` found in tests directory. It will interfere with tests.'
             echo
             exit 1
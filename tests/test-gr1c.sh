@@ -51,6 +51,57 @@ for k in `echo $UNREALIZABLE_REFSPECS`; do
 done
 
 
+# Parallel computation of the winning set should not change results
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests with several solver threads..."
+fi
+for k in `echo $REFSPECS`; do
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  gr1c --threads 3 -t txt $TESTDIR/specs/$k \n\t\tagainst gr1c -t txt $TESTDIR/specs/$k"
+    fi
+    $BUILD_ROOT/gr1c -t txt specs/$k > tmp.threads1.out
+    if ! ($BUILD_ROOT/gr1c --threads 3 -t txt specs/$k | cmp -s tmp.threads1.out -); then
+        echo $PREFACE "synthesis regression test failed for specs/${k} with --threads 3\n"
+        exit 1
+    fi
+done
+rm -f tmp.threads1.out
+if $BUILD_ROOT/gr1c --threads 3 -r specs/trivial_un.spc > /dev/null; then
+    echo $PREFACE "unrealizable specs/trivial_un.spc detected as realizable with --threads 3\n"
+    exit 1
+fi
+
+
+# Strategies from batch mode should be the same as when solving alone
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for batch mode..."
+fi
+rm -f tmp.manifest
+for k in `echo $REFSPECS`; do
+    echo "-t txt -o tmp.batch.${k}.out specs/$k" >> tmp.manifest
+done
+echo "-r specs/trivial_un.spc" >> tmp.manifest
+if ! $BUILD_ROOT/gr1c-batch -j 2 tmp.manifest > /dev/null; then
+    echo $PREFACE "batch mode failed on tmp.manifest\n"
+    exit 1
+fi
+for k in `echo $REFSPECS`; do
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  tmp.batch.${k}.out from gr1c-batch \n\t\tagainst gr1c -t txt $TESTDIR/specs/$k"
+    fi
+    if ! ($BUILD_ROOT/gr1c -t txt specs/$k | cmp -s tmp.batch.${k}.out -); then
+        echo $PREFACE "synthesis regression test failed for specs/${k} in batch mode\n"
+        exit 1
+    fi
+    rm -f tmp.batch.${k}.out
+done
+if ! ($BUILD_ROOT/gr1c-batch tmp.manifest | grep trivial_un | grep -q '"realizable": false'); then
+    echo $PREFACE "unrealizable specs/trivial_un.spc not detected in batch mode\n"
+    exit 1
+fi
+rm -f tmp.manifest tmp.batch.*.out
+
+
 # Testing init_flags besides ALL_ENV_EXIST_SYS_INIT
 if test $VERBOSE -eq 1; then
     echo "\t gr1c -r -n ALL_INIT $TESTDIR/specs/trivial_partwin.spc"
@@ -81,6 +132,84 @@ for k in `echo $REFSPECS`; do
 done
 
 
+# Results loaded from the cache should be the same as when solving
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for the result cache..."
+fi
+rm -rf tmp.cache
+mkdir tmp.cache
+for k in `echo $REFSPECS`; do
+    for trial in 1 2; do
+        if test $VERBOSE -eq 1; then
+            echo "\tComparing  gr1c --cache tmp.cache -t txt $TESTDIR/specs/$k \n\t\tagainst $TESTDIR/expected_outputs/${k}.listdump.out"
+        fi
+        if ! ($BUILD_ROOT/gr1c --cache tmp.cache -t txt specs/$k | cmp -s expected_outputs/${k}.listdump.out -); then
+            echo $PREFACE "synthesis regression test failed for specs/${k} with result cache\n"
+            exit 1
+        fi
+    done
+done
+for trial in 1 2; do
+    if $BUILD_ROOT/gr1c --cache tmp.cache -r specs/trivial_un.spc > /dev/null; then
+        echo $PREFACE "unrealizable specs/trivial_un.spc detected as realizable with result cache\n"
+        exit 1
+    fi
+done
+rm -rf tmp.cache
+
+
+# After one guarantee is edited, the BDDs of unchanged components are
+# loaded from the cache, and results should be the same as without it.
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for the cache of specification components..."
+fi
+rm -rf tmp.cache tmp.edited.spc tmp.uncached.out
+mkdir tmp.cache
+sed 's/\[\]<>(Y_4_0)/[]<>(Y_4_1)/' specs/gridworld_bool.spc > tmp.edited.spc
+for k in specs/gridworld_bool.spc specs/gridworld_bool.spc tmp.edited.spc; do
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  gr1c --cache tmp.cache -t txt $TESTDIR/$k \n\t\tagainst gr1c -t txt $TESTDIR/$k"
+    fi
+    $BUILD_ROOT/gr1c -t txt $k > tmp.uncached.out
+    if ! ($BUILD_ROOT/gr1c --cache tmp.cache -t txt $k | cmp -s tmp.uncached.out -); then
+        echo $PREFACE "synthesis regression test failed for ${k} with component cache\n"
+        exit 1
+    fi
+done
+if ! ls tmp.cache/gr1c-*-component.chk > /dev/null 2>&1; then
+    echo $PREFACE "no component of specs/gridworld_bool.spc saved in cache\n"
+    exit 1
+fi
+rm -rf tmp.cache tmp.edited.spc tmp.uncached.out
+
+
+# Resuming from checkpoints should give the same results as when solving
+# without them.  With an interval of 0, progress is saved at every
+# iteration, so the second run resumes from the last iteration of the
+# first, as if the first were killed then.  All specifications share the
+# prefix, so checkpoints of the others must be ignored.
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for resuming from checkpoints..."
+fi
+rm -f tmp.ckpt-*
+for k in `echo $REFSPECS`; do
+    for flags in "" "--resume"; do
+        if test $VERBOSE -eq 1; then
+            echo "\tComparing  gr1c --checkpoint tmp.ckpt --checkpoint-interval 0 ${flags} -t txt $TESTDIR/specs/$k \n\t\tagainst $TESTDIR/expected_outputs/${k}.listdump.out"
+        fi
+        if ! ($BUILD_ROOT/gr1c --checkpoint tmp.ckpt --checkpoint-interval 0 ${flags} -t txt specs/$k 2> /dev/null | cmp -s expected_outputs/${k}.listdump.out -); then
+            echo $PREFACE "synthesis regression test failed for specs/${k} with checkpoints ${flags}\n"
+            exit 1
+        fi
+    done
+    if ! ls tmp.ckpt-winning.chk > /dev/null 2>&1; then
+        echo $PREFACE "no checkpoint saved for specs/${k}\n"
+        exit 1
+    fi
+done
+rm -f tmp.ckpt-*
+
+
 # Testing init_flags besides ALL_ENV_EXIST_SYS_INIT
 for q in ALL_INIT; do
     for k in count_onestep.spc; do
@@ -141,6 +270,100 @@ for k in `echo $REFSPECS`; do
     fi
 done
 
+# Changing the game and then refreshing the winning set, which starts
+# the fixpoint computations from the previous winning set when the game
+# only became harder or only easier, must give the winning set of the
+# changed specification as solved from scratch.
+if test $VERBOSE -eq 1; then
+    echo "\tComparing winning sets after restrict, relax, and refresh winning\n\t\twith $TESTDIR/specs/trivial_partwin_rewin*.spc"
+fi
+for k in 1 2 3; do
+    $BUILD_ROOT/gr1c -i specs/trivial_partwin_rewin${k}.spc < interaction_scripts/trivial_partwin_winning_IN.txt | grep -o 'True\|False'
+done > tmp.rewin.expected
+if ! ($BUILD_ROOT/gr1c -i specs/trivial_partwin.spc < interaction_scripts/trivial_partwin_rewin_IN.txt | grep -o 'True\|False' | cmp -s tmp.rewin.expected -); then
+    echo $PREFACE "refreshed winning set differs from that of changed specification trivial_partwin_rewin*.spc\n"
+    exit 1
+fi
+rm -f tmp.rewin.expected
+
+# Batch protocol: winning 1 0 1 1, winning 1 0 1 0, winning 0 0 0 0,
+# and sysnexta 0 0 0 0  0 0, in one request frame.
+if test $VERBOSE -eq 1; then
+    echo "\tChecking batch of queries to gr1c --serve $TESTDIR/specs/trivial_partwin.spc"
+fi
+BATCHOUT=`printf '\000\000\000\011w\015w\005w\000a\000\000' | $BUILD_ROOT/gr1c --serve specs/trivial_partwin.spc | od -An -tx1 | tr -d ' \n'`
+if test "$BATCHOUT" != "0000000f000000010001000000000400020103"; then
+    echo $PREFACE "unexpected response to batch of queries using specs/trivial_partwin.spc\n"
+    exit 1
+fi
+
+# Strategy moves: from 1 0 1 1, which is losing, and then along each
+# transition of the strategy that gr1c synthesizes for the same
+# specification, from the state and goal mode of its source node given
+# the environment part of its target node.  The answers must be the
+# system part and goal mode of the target node.  States are packed with
+# the first variable in the lowest bit.
+if test $VERBOSE -eq 1; then
+    echo "\tChecking strategy queries to gr1c --serve $TESTDIR/specs/trivial_partwin.spc"
+fi
+$BUILD_ROOT/gr1c -t aut specs/trivial_partwin.spc > tmp.serve.aut
+awk 'NR > 1 {
+    state[$1] = $2+2*$3+4*$4+8*$5; env[$1] = $2+2*$3; sys[$1] = $4+2*$5
+    mode[$1] = $7; num_succ[$1] = NF-8
+    for (i = 9; i <= NF; i++)
+        succ[$1, i-9] = $i
+    ids[NR-1] = $1; num_nodes = NR-1
+}
+END {
+    req = "s\\015\\000\\000\\000\\000\\000"; ans = "01"; num_queries = 1
+    for (k = 1; k <= num_nodes; k++) {
+        n = ids[k]
+        for (i = 0; i < num_succ[n]; i++) {
+            m = succ[n, i]
+            req = req sprintf( "s\\%03o\\%03o\\000\\000\\000\\%03o", state[n], env[m], mode[n] )
+            ans = ans sprintf( "00%02x%08x", sys[m], mode[m] )
+            num_queries++
+        }
+    }
+    printf( "\\000\\000\\000\\%03o%s\n", 7*num_queries, req ) > "tmp.serve.request"
+    printf( "%08x%s\n", 1+6*(num_queries-1), ans )
+}' tmp.serve.aut > tmp.serve.expected
+REQUEST=`cat tmp.serve.request`
+BATCHOUT=`printf "$REQUEST" | $BUILD_ROOT/gr1c --serve specs/trivial_partwin.spc | od -An -tx1 | tr -d ' \n'`
+if test "$BATCHOUT" != "`cat tmp.serve.expected`"; then
+    echo $PREFACE "unexpected response to strategy queries using specs/trivial_partwin.spc\n"
+    exit 1
+fi
+rm -f tmp.serve.aut tmp.serve.request tmp.serve.expected
+
+# More clients than the server admits (64) connect at once through a
+# socket; the first 64 are answered, the others are closed, and the
+# server keeps running.
+if test $VERBOSE -eq 1; then
+    echo "\tChecking many clients of gr1c --socket with $TESTDIR/specs/trivial_partwin.spc"
+fi
+SOCKPATH=`pwd`/tmp.serve_socket
+rm -f $SOCKPATH
+$BUILD_ROOT/gr1c --socket $SOCKPATH specs/trivial_partwin.spc &
+SERVEPID=$!
+for k in 1 2 3 4 5 6 7 8 9 10; do
+    if test -S $SOCKPATH; then
+        break
+    fi
+    sleep 1
+done
+NUMANSWERED=`./serve_clients $SOCKPATH 70`
+if ! kill -0 $SERVEPID 2> /dev/null; then
+    echo $PREFACE "gr1c --socket exited after too many clients connected\n"
+    exit 1
+fi
+kill $SERVEPID
+wait $SERVEPID || true
+if test "$NUMANSWERED" != "64"; then
+    echo $PREFACE "$NUMANSWERED of 70 clients of gr1c --socket were answered; expected 64\n"
+    exit 1
+fi
+
 
 ################################################################
 # gr1c specification file syntax
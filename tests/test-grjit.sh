@@ -0,0 +1,82 @@
+#!/bin/sh
+# Tests for the program grjit and not targeted at particular units.
+#
+# SCL; 2013.
+
+set -e
+
+BUILD_ROOT=..
+TESTDIR=tests
+PREFACE="============================================================\nERROR:"
+
+if test -z $VERBOSE; then
+    VERBOSE=0
+fi
+
+
+################################################################
+# sim_rhc_batch()
+
+if test $VERBOSE -eq 1; then
+    echo "\nChecking that statistics from grjit --plays do not depend on --threads..."
+fi
+for t in 1 4; do
+    if test $VERBOSE -eq 1; then
+        echo "\tgrjit -m \"40,x,0 0\" --plays 50 --seed 7 --threads $t $TESTDIR/specs/jit_pause.spc"
+    fi
+    $BUILD_ROOT/grjit -m "40,x,0 0" --plays 50 --seed 7 --threads $t specs/jit_pause.spc | grep -v -e '"seconds"' | sed 's/"threads": [0-9]*, //' > tmp.plays.${t}.out
+done
+if ! cmp -s tmp.plays.1.out tmp.plays.4.out; then
+    echo $PREFACE "grjit --plays statistics differ between --threads 1 and --threads 4\n"
+    exit 1
+fi
+if ! grep -q '"goal_visits"' tmp.plays.1.out; then
+    echo $PREFACE "grjit --plays did not report statistics\n"
+    exit 1
+fi
+rm -f tmp.plays.1.out tmp.plays.4.out
+
+
+################################################################
+# Distance bounds in the result cache
+#
+# Bounds should be saved by the first run, loaded by the second, and
+# not used for other metric variables.
+
+if test $VERBOSE -eq 1; then
+    echo "\nPerforming regression tests for distance bounds in the result cache..."
+fi
+rm -rf tmp.cache tmp.uncached.out tmp.minmax.out
+mkdir tmp.cache
+$BUILD_ROOT/grjit -m "-1,x" specs/jit_pause.spc > tmp.uncached.out
+for k in 1 2; do
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  grjit -m \"-1,x\" --cache tmp.cache $TESTDIR/specs/jit_pause.spc (run $k) \n\t\tagainst grjit -m \"-1,x\" $TESTDIR/specs/jit_pause.spc"
+    fi
+    $BUILD_ROOT/grjit -v -m "-1,x" --cache tmp.cache specs/jit_pause.spc > tmp.minmax.out
+    if ! (grep '^horizon:' tmp.minmax.out | cmp -s tmp.uncached.out -); then
+        echo $PREFACE "grjit horizon for specs/jit_pause.spc differs with result cache\n"
+        exit 1
+    fi
+    if grep -q 'Loaded distance bounds' tmp.minmax.out; then
+        loaded=1
+    else
+        loaded=0
+    fi
+    if test $k -eq 1 -a $loaded -eq 1; then
+        echo $PREFACE "grjit loaded distance bounds from an empty result cache\n"
+        exit 1
+    elif test $k -eq 2 -a $loaded -eq 0; then
+        echo $PREFACE "grjit did not load distance bounds saved in result cache\n"
+        exit 1
+    fi
+done
+if ! ls tmp.cache/gr1c-*-minmax.chk > /dev/null 2>&1; then
+    echo $PREFACE "no distance bounds of specs/jit_pause.spc saved in cache\n"
+    exit 1
+fi
+if $BUILD_ROOT/grjit -v -m "-1,e" --cache tmp.cache specs/jit_pause.spc | grep -q 'Loaded distance bounds'; then
+    echo $PREFACE "grjit loaded distance bounds of other metric variables from result cache\n"
+    exit 1
+fi
+rm -rf tmp.cache tmp.uncached.out tmp.minmax.out
@@ -37,4 +37,42 @@ for k in `echo $REFSPECS`; do
         echo $PREFACE "gr1c-patch, patch_localfixpoint() regression test failed for specs/${k}\n"
         exit 1
     fi
+    if test $VERBOSE -eq 1; then
+        echo "\tComparing  gr1c-patch --threads 3 -t aut -a $TESTDIR/expected_outputs/patching/${k}.spc.autdump.out -e $TESTDIR/specs/patching/${k}.edc $TESTDIR/specs/patching/${k}.spc \n\t\tagainst $TESTDIR/expected_outputs/patching/${k}.edc.autdump.out"
+    fi
+    if ! ($BUILD_ROOT/gr1c-patch --threads 3 -t aut -a expected_outputs/patching/${k}.spc.autdump.out -e specs/patching/${k}.edc specs/patching/${k}.spc | cmp -s expected_outputs/patching/${k}.edc.autdump.out -); then
+        echo $PREFACE "gr1c-patch, patch_localfixpoint() regression test failed for specs/${k} with --threads 3\n"
+        exit 1
+    fi
 done
+
+
+################################################################
+# patch_serve()
+
+if test $VERBOSE -eq 1; then
+    echo "\nChecking that gr1c-patch --serve reports the given strategy and keeps it\n\tafter a failed command..."
+fi
+$BUILD_ROOT/gr1c -t aut specs/trivial_2var.spc > tmp.serve.aut
+(echo "size 3"; tail -n +2 tmp.serve.aut; echo "---"
+ echo "error: patching failed"; echo "---"
+ echo "size 3"; tail -n +2 tmp.serve.aut; echo "---") > tmp.serve.expected
+if ! (printf 'addgoal z\ndump\n' | $BUILD_ROOT/gr1c-patch --serve -a tmp.serve.aut specs/trivial_2var.spc 2> /dev/null | cmp -s tmp.serve.expected -); then
+    echo $PREFACE "gr1c-patch --serve failed on specs/trivial_2var.spc\n"
+    exit 1
+fi
+rm -f tmp.serve.aut tmp.serve.expected
+
+if test $VERBOSE -eq 1; then
+    echo "\nChecking that gr1c-patch --serve patches each edit against the game\n\tchanged by the edits before it..."
+fi
+# After the first edit, the only system move from x=1,y=1 to x'=1 is y'=0.
+# The second edit removes that move too, so it must fail, which it would
+# not if the first edit were forgotten.
+$BUILD_ROOT/gr1c -t aut specs/trivial_2var.spc > tmp.serve.aut
+printf 'edit\n0 0\n0 1\n1 0\n1 1\nrestrict 1 1 1 1\nend\nedit\n0 0\n0 1\n1 0\n1 1\nrestrict 1 1 1 0\nend\n' | $BUILD_ROOT/gr1c-patch --serve -a tmp.serve.aut specs/trivial_2var.spc 2> /dev/null > tmp.serve.out
+if test `grep -c '^error' tmp.serve.out` -ne 1 || test "`tail -n 2 tmp.serve.out | head -n 1`" != "error: patching failed"; then
+    echo $PREFACE "gr1c-patch --serve forgot an earlier edit on specs/trivial_2var.spc\n"
+    exit 1
+fi
+rm -f tmp.serve.aut tmp.serve.out
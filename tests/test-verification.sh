@@ -22,13 +22,17 @@ if test $VERBOSE -eq 1; then
     ${SPINEXE} -V
 fi
 
+# Strategies are checked as constructed with default options and with
+# the options listed in SYNFLAGS (one setting at a time).
 REFSPECS="count_onestep.spc empty.spc free_counter.spc gridworld_bool.spc gridworld_env.spc trivial_2var.spc trivial_mustblock.spc"
+SYNFLAGS="--reuse --minimize --reachable --lean"
+for FLAGS in "" `echo $SYNFLAGS`; do
 for REFSPC in `echo $REFSPECS`; do
     if test $VERBOSE -eq 1; then
         echo "\nConstructing strategy for ${TESTDIR}/specs/${REFSPC}"
-        echo "\tgr1c -t aut ${TESTDIR}/specs/${REFSPC} > ${REFSPC}.aut"
+        echo "\tgr1c ${FLAGS} -t aut ${TESTDIR}/specs/${REFSPC} > ${REFSPC}.aut"
     fi
-    $BUILD_ROOT/gr1c -t aut specs/${REFSPC} > ${REFSPC}.aut
+    $BUILD_ROOT/gr1c ${FLAGS} -t aut specs/${REFSPC} > ${REFSPC}.aut
     if test $VERBOSE -eq 1; then
         echo "\nVerifying it using Spin..."
         echo "\tgr1c-autman -i specs/${REFSPC} ${REFSPC}.aut -P -o ${REFSPC}.aut.pml"
@@ -49,3 +53,4 @@ for REFSPC in `echo $REFSPECS`; do
         exit 1
     fi
 done
+done
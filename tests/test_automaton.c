@@ -17,6 +17,9 @@ int main( int argc, char **argv )
     int i, j;  /* Generic counters */
     anode_t *head, *backup_head;
     anode_t *node;  /* Generic node, used for multiple purposes */
+    anode_t *copy;
+    stateidx_t *sidx;
+    vartype ones[10];
     vartype **nodes_states = NULL;
     int state_len = 10;
     int *modes = NULL;
@@ -182,6 +185,35 @@ int main( int argc, char **argv )
 
     delete_aut( head );
     head = NULL;
+
+    /* Each state occurs at positions i, i+state_len, ... in
+       nodes_states, which the index should visit in that order. */
+    sidx = stateidx_new( nodes_states, num_nodes, state_len );
+    for (i = 0; i < state_len; i++) {
+        j = stateidx_find( sidx, *(nodes_states+i) );
+        mode_counter = 0;
+        while (j >= 0) {
+            if (j != i + mode_counter*state_len) {
+                ERRPRINT2( "stateidx_next gave position %d for state %d.",
+                           j, i );
+                abort();
+            }
+            mode_counter++;
+            j = stateidx_next( sidx, j );
+        }
+        if (mode_counter != num_nodes/state_len) {
+            ERRPRINT1( "stateidx found %d occurrences.", mode_counter );
+            abort();
+        }
+    }
+    for (j = 0; j < state_len; j++)
+        *(ones+j) = 1;
+    if (stateidx_find( sidx, ones ) != -1) {
+        ERRPRINT( "stateidx_find found state not in the array." );
+        abort();
+    }
+    stateidx_free( sidx );
+
     free( modes );
     for (i = 0; i < num_nodes; i++)
         free( *(nodes_states+i) );
@@ -219,5 +251,122 @@ int main( int argc, char **argv )
 
     delete_aut( backup_head );
 
+    /* Minimization: a cycle through states 0, 1 in two goal modes is
+       bisimilar to a cycle of length 2, and a node without outgoing
+       transitions is not bisimilar to any node of the cycle. */
+    state_len = 1;
+    i = 0;
+    j = 1;
+    head = insert_anode( NULL, 2, -1, True, &i, state_len );
+    head = insert_anode( head, 1, -1, False, &j, state_len );
+    head = insert_anode( head, 1, -1, False, &i, state_len );
+    head = insert_anode( head, 0, -1, False, &j, state_len );
+    head = insert_anode( head, 0, -1, True, &i, state_len );
+    if (head == NULL
+        || append_anode_trans( head, 0, &i, state_len, 0, &j ) == NULL
+        || append_anode_trans( head, 0, &j, state_len, 1, &i ) == NULL
+        || append_anode_trans( head, 1, &i, state_len, 1, &j ) == NULL
+        || append_anode_trans( head, 1, &j, state_len, 0, &i ) == NULL) {
+        ERRPRINT( "failed to construct automaton for minimization." );
+        abort();
+    }
+    head = aut_minimize( head, state_len );
+    if (head == NULL) {
+        ERRPRINT( "aut_minimize returned NULL." );
+        abort();
+    }
+    if (aut_size( head ) != 3) {
+        ERRPRINT1( "unexpected size after calling aut_minimize; "
+                   "should be 3, found %d",
+                   aut_size( head ) );
+        fflush( stderr );
+        list_aut_dump( head, state_len, stderr );
+        abort();
+    }
+    if (!head->initial || head->mode != 0 || head->trans_len != 1
+        || *(*(head->trans))->state != 1
+        || *((*(head->trans))->trans) != head) {
+        ERRPRINT( "unexpected structure after calling aut_minimize." );
+        fflush( stderr );
+        list_aut_dump( head, state_len, stderr );
+        abort();
+    }
+
+    /* The copy has the same nodes, in order, with transitions among the
+       copied nodes. */
+    backup_head = aut_copy( head, state_len );
+    if (backup_head == NULL || aut_size( backup_head ) != aut_size( head )) {
+        ERRPRINT( "aut_copy failed to copy all nodes." );
+        abort();
+    }
+    node = head;
+    copy = backup_head;
+    for (i = 0; node != NULL; i++) {
+        if (anode_index( backup_head, node ) != -1) {
+            ERRPRINT( "aut_copy returned an original node." );
+            abort();
+        }
+        if (copy->mode != node->mode || copy->initial != node->initial
+            || *(copy->state) != *(node->state)
+            || copy->trans_len != node->trans_len
+            || (node->trans_len > 0
+                && (anode_index( backup_head, *(copy->trans) )
+                    != anode_index( head, *(node->trans) )))) {
+            ERRPRINT1( "copy of node %d differs from the original.", i );
+            fflush( stderr );
+            list_aut_dump( backup_head, state_len, stderr );
+            abort();
+        }
+        node = node->next;
+        copy = copy->next;
+    }
+    delete_aut( backup_head );
+    delete_aut( head );
+
+    /* Minimization of a cycle of num_nodes nodes: if one node has a
+       different state, then no two nodes are bisimilar, which is only
+       found after refining with respect to nodes all along the cycle.
+       If all states are equal, then the cycle is bisimilar to a single
+       node with a transition to itself. */
+    for (mode_counter = 0; mode_counter < 2; mode_counter++) {
+        head = NULL;
+        for (i = 0; i < num_nodes; i++) {
+            j = (mode_counter == 0 && i == 0);
+            head = insert_anode( head, 0, -1, (i == num_nodes-1), &j,
+                                 state_len );
+        }
+        for (node = head; node != NULL; node = node->next) {
+            node->trans = malloc( sizeof(anode_t *) );
+            if (node->trans == NULL) {
+                perror( "test_automaton, malloc" );
+                abort();
+            }
+            *(node->trans) = (node->next == NULL) ? head : node->next;
+            node->trans_len = 1;
+        }
+        head = aut_minimize( head, state_len );
+        if (head == NULL) {
+            ERRPRINT( "aut_minimize returned NULL." );
+            abort();
+        }
+        if (aut_size( head ) != (mode_counter == 0 ? num_nodes : 1)) {
+            ERRPRINT2( "unexpected size after calling aut_minimize on"
+                       " cycle; should be %d, found %d",
+                       (mode_counter == 0 ? num_nodes : 1),
+                       aut_size( head ) );
+            abort();
+        }
+        if (mode_counter == 1
+            && (!head->initial || head->trans_len != 1
+                || *(head->trans) != head)) {
+            ERRPRINT( "unexpected structure after calling aut_minimize"
+                      " on cycle." );
+            fflush( stderr );
+            list_aut_dump( head, state_len, stderr );
+            abort();
+        }
+        delete_aut( head );
+    }
+
     return 0;
 }
@@ -12,8 +12,7 @@
 #include "ptree.h"
 #include "automaton.h"
 #include "patching.h"
-
-specification_t spc;
+#include "context.h"
 
 
 #define STRING_MAXLEN 60
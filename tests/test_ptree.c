@@ -78,6 +78,7 @@ int main( int argc, char **argv )
     ptree_t **heads;
     ptree_t *var_list;
     ptree_t *primed_var_list;
+    symtab_t *st;
     char filename[STRING_MAXLEN];
     char *result;
     int fd;
@@ -155,6 +156,26 @@ int main( int argc, char **argv )
                    node->name, "kitten" );
         abort();
     }
+    st = symtab_new( head );
+    for (i = 0; i < 3; i++) {
+        node = get_list_item( head, i );
+        if (symtab_find( st, node->name ) != i) {
+            ERRPRINT2( "symbol table gives wrong index %d for \"%s\".",
+                       symtab_find( st, node->name ), node->name );
+            abort();
+        }
+    }
+    if (symtab_find( st, "kit" ) >= 0 || symtab_find( st, "kittens" ) >= 0) {
+        ERRPRINT( "symbol table finds name that is not in the list." );
+        abort();
+    }
+    symtab_free( st );
+    st = symtab_new( NULL );
+    if (symtab_find( st, "a" ) >= 0) {
+        ERRPRINT( "symbol table of empty list finds a name." );
+        abort();
+    }
+    symtab_free( st );
     if (tree_size( head ) != 3) {
         ERRPRINT1( "linked list of length 3 detected as having "
                    "wrong length %d.",
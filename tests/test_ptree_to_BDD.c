@@ -20,6 +20,12 @@ int main( int argc, char **argv )
     char manual_eval;
     ptree_t *var_list;
     ptree_t *head, *node;
+    ptree_t **heads;
+    DdNode *g;
+    ptree_t *nb_list;  /* Bits of x and y, with domains {0,1,2}, {0,...,3} */
+    ptree_t *head2;
+    int cmp_types[6] = {PT_EQUALS, PT_NOTEQ, PT_LT, PT_GT, PT_LE, PT_GE};
+    int j;
     int i; /* Generic counter */
 
     /* Test fixture */
@@ -68,6 +74,164 @@ int main( int argc, char **argv )
     }
     free( cube );
     Cudd_RecursiveDeref( manager, f );
+    delete_tree( head );
+
+
+    /************************************************
+     * ((a & b) -> (a & b)) & !(!c & !c), with repeated subformulas
+     ************************************************/
+    head = NULL;
+    head = pusht_terminal( head, PT_VARIABLE, "a", -1 );
+    head = pusht_terminal( head, PT_VARIABLE, "b", -1 );
+    head = pusht_operator( head, PT_AND );
+    head = pusht_terminal( head, PT_VARIABLE, "a", -1 );
+    head = pusht_terminal( head, PT_VARIABLE, "b", -1 );
+    head = pusht_operator( head, PT_AND );
+    head = pusht_operator( head, PT_IMPLIES );
+    head = pusht_terminal( head, PT_VARIABLE, "c", -1 );
+    head = pusht_operator( head, PT_NEG );
+    head = pusht_terminal( head, PT_VARIABLE, "c", -1 );
+    head = pusht_operator( head, PT_NEG );
+    head = pusht_operator( head, PT_AND );
+    head = pusht_operator( head, PT_NEG );
+    head = pusht_operator( head, PT_AND );
+    f = ptree_BDD( head, var_list, manager );
+    if (f != Cudd_bddIthVar( manager, 2 )) {
+        ERRPRINT( "BDD generated from parse tree of "
+                  "\"((a & b) -> (a & b)) & !(!c & !c)\" is not c." );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, f );
+    delete_tree( head );
+
+
+    /************************************************
+     * Long conjunction a & b' & a & b' & ... as from merge_ptrees()
+     ************************************************/
+    heads = malloc( 100000*sizeof(ptree_t *) );
+    if (heads == NULL) {
+        perror( "test_ptree_to_BDD, malloc" );
+        abort();
+    }
+    for (i = 0; i < 100000; i++) {
+        if (i % 2) {
+            *(heads+i) = init_ptree( PT_NEXT_VARIABLE, "b", -1 );
+        } else {
+            *(heads+i) = init_ptree( PT_VARIABLE, "a", -1 );
+        }
+    }
+    head = merge_ptrees( heads, 100000, PT_AND );
+    free( heads );
+    f = ptree_BDD( head, var_list, manager );
+    g = Cudd_bddAnd( manager, Cudd_bddIthVar( manager, 0 ),
+                     Cudd_bddIthVar( manager, 4 ) );
+    Cudd_Ref( g );
+    if (f != g) {
+        ERRPRINT( "BDD generated from merged conjunction of 100000 literals"
+                  " is incorrect." );
+        abort();
+    }
+    if (ptree_BDD_peak_size() != Cudd_DagSize( g )) {
+        ERRPRINT2( "Peak intermediate BDD size is %d; expected %d.",
+                   ptree_BDD_peak_size(), Cudd_DagSize( g ) );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, f );
+    Cudd_RecursiveDeref( manager, g );
+    delete_tree( head );
+
+
+    /************************************************
+     * !!...!(a -> b) with 101 negations, which has more distinct
+     * subformulas than the initial size of the table of BDDs in
+     * ptree_BDD(), so that the table grows while the root is built
+     ************************************************/
+    head = init_ptree( PT_IMPLIES, NULL, 0 );
+    head->left = init_ptree( PT_VARIABLE, "a", -1 );
+    head->right = init_ptree( PT_VARIABLE, "b", -1 );
+    for (i = 0; i < 101; i++) {
+        node = init_ptree( PT_NEG, NULL, 0 );
+        node->right = head;
+        head = node;
+    }
+    f = ptree_BDD( head, var_list, manager );
+    g = Cudd_bddAnd( manager, Cudd_bddIthVar( manager, 0 ),
+                     Cudd_Not( Cudd_bddIthVar( manager, 1 ) ) );
+    Cudd_Ref( g );
+    if (f != g) {
+        ERRPRINT( "BDD generated from 101 negations of \"a -> b\" is not"
+                  " \"a & !b\"." );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, f );
+    Cudd_RecursiveDeref( manager, g );
+    delete_tree( head );
+
+
+    /************************************************
+     * Comparisons of nonboolean variables, encoded directly, and after
+     * expansion to formulas over bits
+     ************************************************/
+    nb_list = var_to_bool( "x", 2 );
+    node = get_list_item( nb_list, -1 );
+    node->left = var_to_bool( "y", 3 );
+    for (i = 0; i < 6; i++) {
+        for (j = -1; j < 5; j++) {
+            head = init_ptree( cmp_types[i], NULL, 0 );
+            head->left = init_ptree( (j % 2) ? PT_NEXT_VARIABLE : PT_VARIABLE,
+                                     "x", 0 );
+            head->right = init_ptree( PT_CONSTANT, NULL, j );
+            head2 = copy_ptree( head );
+            head = expand_to_bool( head, "x", 2 );
+            head2 = mark_nonbool( head2, "x", 2 );
+            f = ptree_BDD( head, nb_list, manager );
+            g = ptree_BDD( head2, nb_list, manager );
+            if (f != g) {
+                ERRPRINT2( "Direct encoding of comparison type %d with %d"
+                           " differs from that of expand_to_bool().",
+                           cmp_types[i], j );
+                abort();
+            }
+            Cudd_RecursiveDeref( manager, f );
+            Cudd_RecursiveDeref( manager, g );
+            delete_tree( head );
+            delete_tree( head2 );
+        }
+    }
+
+    /* x <= y' */
+    head = init_ptree( PT_LE, NULL, 0 );
+    head->left = init_ptree( PT_VARIABLE, "x", 0 );
+    head->right = init_ptree( PT_NEXT_VARIABLE, "y", 0 );
+    head = mark_nonbool( head, "x", 2 );
+    head = mark_nonbool( head, "y", 3 );
+    f = ptree_BDD( head, nb_list, manager );
+    cube = malloc( 8*sizeof(int) );
+    if (cube == NULL) {
+        perror( "test_ptree_to_BDD, malloc" );
+        abort();
+    }
+    for (i = 0; i < 8; i++)
+        *(cube+i) = 0;
+    for (i = 0; i < 16; i++) {
+        /* x is bits 0, 1; y' is bits 6, 7 */
+        *cube = i&1;
+        *(cube+1) = (i >> 1)&1;
+        *(cube+6) = (i >> 2)&1;
+        *(cube+7) = (i >> 3)&1;
+        manual_eval = ((i&3) <= (i >> 2));
+        ddval = Cudd_Eval( manager, f, cube );
+        if ((Cudd_IsComplement( ddval ) && manual_eval)
+            || (!Cudd_IsComplement( ddval ) && !manual_eval)) {
+            ERRPRINT2( "BDD generated for \"x <= y'\" is incorrect at"
+                       " x = %d, y' = %d.", i&3, i >> 2 );
+            abort();
+        }
+    }
+    free( cube );
+    Cudd_RecursiveDeref( manager, f );
+    delete_tree( head );
+    delete_tree( nb_list );
 
 
     if (Cudd_CheckZeroRef( manager ) != 0) {
@@ -0,0 +1,230 @@
+/* Unit tests for distance bounds of solve_metric.c, compared with
+ * brute-force enumeration of states.
+ *
+ * SCL; 2016.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "tests_common.h"
+#include "gr1c_util.h"
+#include "ptree.h"
+#include "solve_support.h"
+#include "solve_metric.h"
+#include "context.h"
+
+
+/* Variables e0, e1 (env), s, x0, x1, x2 (sys); metric variables are
+   e (offset 0, width 2) and x (offset 3, width 3).  Boolean s is not
+   metric. */
+#define NUM_ENV 2
+#define NUM_SYS 4
+#define NUM_VARS (NUM_ENV+NUM_SYS)
+#define NUM_STATES (1 << NUM_VARS)
+#define NUM_METRIC_VARS 2
+
+
+void index_to_state( int k, vartype *state )
+{
+    int i;
+    for (i = 0; i < NUM_VARS; i++)
+        *(state+i) = (k >> i) & 1;
+}
+
+double brute_dist( vartype *state1, vartype *state2, int *offw )
+{
+    int i, v1, v2;
+    double dist = 0.;
+    for (i = 0; i < NUM_METRIC_VARS; i++) {
+        v1 = bitvec_to_int( state1+*(offw+2*i), *(offw+2*i+1) );
+        v2 = bitvec_to_int( state2+*(offw+2*i), *(offw+2*i+1) );
+        dist += (v1 > v2) ? v1-v2 : v2-v1;
+    }
+    return dist;
+}
+
+/* Characteristic function of the set of states whose indices k satisfy
+   k % modulus == residue. */
+DdNode *set_BDD( DdManager *manager, int modulus, int residue )
+{
+    DdNode *S, *ddval, *tmp;
+    vartype state[NUM_VARS];
+    int k;
+
+    S = Cudd_Not( Cudd_ReadOne( manager ) );
+    Cudd_Ref( S );
+    for (k = 0; k < NUM_STATES; k++) {
+        if (k % modulus != residue)
+            continue;
+        index_to_state( k, state );
+        ddval = state_to_BDD( manager, state, 0, NUM_VARS );
+        tmp = Cudd_bddOr( manager, S, ddval );
+        Cudd_Ref( tmp );
+        Cudd_RecursiveDeref( manager, S );
+        Cudd_RecursiveDeref( manager, ddval );
+        S = tmp;
+    }
+    return S;
+}
+
+/* Minimum and maximum over T of the distance to the nearest state of
+   G, or to ref_state if it is not NULL, by enumerating states.  Both
+   are -1 if T or G is empty, as for bounds_DDset(). */
+void brute_bounds( int T_mod, int T_res, int G_mod, int G_res,
+                   vartype *ref_state, int *offw, double *Min, double *Max )
+{
+    vartype t[NUM_VARS], g[NUM_VARS];
+    double nearest, d;
+    int k, l;
+
+    *Min = *Max = -1.;
+    for (k = 0; k < NUM_STATES; k++) {
+        if (k % T_mod != T_res)
+            continue;
+        index_to_state( k, t );
+        if (ref_state != NULL) {
+            nearest = brute_dist( t, ref_state, offw );
+        } else {
+            nearest = -1.;
+            for (l = 0; l < NUM_STATES; l++) {
+                if (l % G_mod != G_res)
+                    continue;
+                index_to_state( l, g );
+                d = brute_dist( t, g, offw );
+                if (nearest < 0 || d < nearest)
+                    nearest = d;
+            }
+            if (nearest < 0)
+                return;  /* G is empty */
+        }
+        if (*Min < 0 || nearest < *Min)
+            *Min = nearest;
+        if (nearest > *Max)
+            *Max = nearest;
+    }
+}
+
+void check_DDset( DdManager *manager, int *offw,
+                  int T_mod, int T_res, int G_mod, int G_res )
+{
+    DdNode *T, *G;
+    double Min, Max, bMin, bMax;
+
+    T = set_BDD( manager, T_mod, T_res );
+    G = set_BDD( manager, G_mod, G_res );
+    if (bounds_DDset( manager, T, G, offw, NUM_METRIC_VARS,
+                      &Min, &Max, 0 )) {
+        ERRPRINT( "bounds_DDset() failed." );
+        abort();
+    }
+    brute_bounds( T_mod, T_res, G_mod, G_res, NULL, offw, &bMin, &bMax );
+    if (Min != bMin || Max != bMax) {
+        fprintf( stderr, "T: k %% %d == %d, G: k %% %d == %d\n",
+                 T_mod, T_res, G_mod, G_res );
+        ERRPRINT2( "bounds_DDset() gave (%f, ...), but enumeration gives"
+                   " Min %f.", Min, bMin );
+        ERRPRINT2( "bounds_DDset() gave (..., %f), but enumeration gives"
+                   " Max %f.", Max, bMax );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, T );
+    Cudd_RecursiveDeref( manager, G );
+}
+
+void check_state( DdManager *manager, int *offw,
+                  int T_mod, int T_res, int ref_index )
+{
+    DdNode *T;
+    vartype ref_state[NUM_VARS];
+    double Min, Max, bMin, bMax;
+
+    index_to_state( ref_index, ref_state );
+    T = set_BDD( manager, T_mod, T_res );
+    if (bounds_state( manager, T, ref_state, offw, NUM_METRIC_VARS,
+                      &Min, &Max, 0 )) {
+        ERRPRINT( "bounds_state() failed." );
+        abort();
+    }
+    brute_bounds( T_mod, T_res, 1, 0, ref_state, offw, &bMin, &bMax );
+    if (Min != bMin || Max != bMax) {
+        fprintf( stderr, "T: k %% %d == %d, reference state index %d\n",
+                 T_mod, T_res, ref_index );
+        ERRPRINT2( "bounds_state() gave (%f, ...), but enumeration gives"
+                   " Min %f.", Min, bMin );
+        ERRPRINT2( "bounds_state() gave (..., %f), but enumeration gives"
+                   " Max %f.", Max, bMax );
+        abort();
+    }
+    Cudd_RecursiveDeref( manager, T );
+}
+
+
+int main( int argc, char **argv )
+{
+    DdManager *manager;
+    DdNode *G, *dist;
+    int offw[2*NUM_METRIC_VARS] = {0, 2, 3, 3};
+    int inputs[2*NUM_VARS];
+    vartype state[NUM_VARS];
+    double Min, Max;
+    int i, k;
+
+    SPC_INIT( spc );
+    spc.evar_list = append_list_item( NULL, PT_VARIABLE, "e0", -1 );
+    append_list_item( spc.evar_list, PT_VARIABLE, "e1", -1 );
+    spc.svar_list = append_list_item( NULL, PT_VARIABLE, "s", -1 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "x0", -1 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "x1", -1 );
+    append_list_item( spc.svar_list, PT_VARIABLE, "x2", -1 );
+    if (tree_size( spc.evar_list ) != NUM_ENV
+        || tree_size( spc.svar_list ) != NUM_SYS) {
+        ERRPRINT( "failed to create lists of variables." );
+        abort();
+    }
+
+    manager = Cudd_Init( 2*NUM_VARS,
+                         0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0 );
+
+    /* Distance to a set, evaluated at each state */
+    G = set_BDD( manager, 7, 2 );
+    dist = dist_to_set_ADD( manager, G, offw, NUM_METRIC_VARS );
+    for (k = 0; k < NUM_STATES; k++) {
+        index_to_state( k, state );
+        for (i = 0; i < 2*NUM_VARS; i++)
+            *(inputs+i) = (i < NUM_VARS) ? *(state+i) : 0;
+        brute_bounds( NUM_STATES, k, 7, 2, NULL, offw, &Min, &Max );
+        if (Cudd_V( Cudd_Eval( manager, dist, inputs ) ) != Min) {
+            ERRPRINT2( "dist_to_set_ADD() at state index %d does not match"
+                       " enumeration, %f.", k, Min );
+            abort();
+        }
+    }
+    Cudd_RecursiveDeref( manager, dist );
+    Cudd_RecursiveDeref( manager, G );
+
+    check_DDset( manager, offw, 3, 1, 5, 2 );
+    check_DDset( manager, offw, 11, 4, 2, 0 );
+    check_DDset( manager, offw, 1, 0, 13, 6 );  /* All states in T */
+    check_DDset( manager, offw, 4, 3, 1, 0 );  /* All states in G */
+    check_DDset( manager, offw, 9, 5, 9, 5 );  /* T equal to G */
+    check_DDset( manager, offw, 1, 1, 3, 0 );  /* Empty T */
+    check_DDset( manager, offw, 3, 0, 1, 1 );  /* Empty G */
+    check_DDset( manager, offw, 1, 1, 1, 1 );  /* Empty T and G */
+
+    check_state( manager, offw, 3, 1, 0 );
+    check_state( manager, offw, 5, 2, 45 );
+    check_state( manager, offw, 1, 0, NUM_STATES-1 );
+    check_state( manager, offw, 1, 1, 17 );  /* Empty T */
+
+    if (Cudd_CheckZeroRef( manager ) != 0) {
+        ERRPRINT1( "Leaked BDD references; Cudd_CheckZeroRef -> %d.",
+                   Cudd_CheckZeroRef( manager ) );
+        abort();
+    }
+    Cudd_Quit( manager );
+    delete_tree( spc.evar_list );
+    delete_tree( spc.svar_list );
+    return 0;
+}